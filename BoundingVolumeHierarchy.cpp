@@ -0,0 +1,397 @@
+#include <algorithm>
+#include <chrono>
+#include <cfloat>
+#include <random>
+#include "BoundingVolumeHierarchy.h"
+
+void BoundingVolumeHierarchy::Build(const vector<BoundingBox>& itemBounds)
+{
+	Clear();
+	if (itemBounds.empty())
+	{
+		return;
+	}
+
+	unsigned int itemCount = static_cast<unsigned int>(itemBounds.size());
+	_itemBounds = itemBounds;
+	_itemCentres.resize(itemCount);
+	_itemOrder.resize(itemCount);
+	_itemLeaves.resize(itemCount);
+	_isItemMoved.assign(itemCount, 0);
+	for (unsigned int i = 0; i < itemCount; i++)
+	{
+		_itemCentres[i] = _itemBounds[i].Center;
+		_itemOrder[i] = i;
+	}
+
+	_nodes.reserve(itemCount * 2);
+	BuildNode(NoNode, 0, itemCount);
+	_builtSurfaceArea = SurfaceArea(_nodes[0].Bounds);
+}
+
+void BoundingVolumeHierarchy::Clear()
+{
+	_nodes.clear();
+	_itemBounds.clear();
+	_itemCentres.clear();
+	_itemOrder.clear();
+	_itemLeaves.clear();
+	_movedItems.clear();
+	_isItemMoved.clear();
+	_builtSurfaceArea = 0.0f;
+}
+
+unsigned int BoundingVolumeHierarchy::BuildNode(unsigned int parent, unsigned int first, unsigned int last)
+{
+	unsigned int nodeIndex = static_cast<unsigned int>(_nodes.size());
+	_nodes.push_back(Node());
+	_nodes[nodeIndex].Parent = parent;
+
+	// Bounds of the items and of their centres
+	BoundingBox bounds = _itemBounds[_itemOrder[first]];
+	Vector3 centreMinimum = _itemCentres[_itemOrder[first]];
+	Vector3 centreMaximum = centreMinimum;
+	for (unsigned int i = first + 1; i < last; i++)
+	{
+		BoundingBox::CreateMerged(bounds, bounds, _itemBounds[_itemOrder[i]]);
+		centreMinimum = Vector3::Min(centreMinimum, _itemCentres[_itemOrder[i]]);
+		centreMaximum = Vector3::Max(centreMaximum, _itemCentres[_itemOrder[i]]);
+	}
+	_nodes[nodeIndex].Bounds = bounds;
+
+	// Split along the axis with the largest spread of centres
+	Vector3 spread = centreMaximum - centreMinimum;
+	int axis = (spread.x > spread.y) ? ((spread.x > spread.z) ? 0 : 2) : ((spread.y > spread.z) ? 1 : 2);
+	float axisMinimum = (axis == 0) ? centreMinimum.x : (axis == 1) ? centreMinimum.y : centreMinimum.z;
+	float axisSpread = (axis == 0) ? spread.x : (axis == 1) ? spread.y : spread.z;
+
+	unsigned int itemCount = last - first;
+	unsigned int split = first;
+	if (itemCount > MaximumLeafItems && axisSpread > 0.0f)
+	{
+		// Bin the centres and evaluate the surface area heuristic at each bin boundary
+		unsigned int binItemCounts[BinCount] = { 0 };
+		BoundingBox binBounds[BinCount];
+		float binScale = BinCount / axisSpread;
+		auto binOf = [&](unsigned int item)
+		{
+			const Vector3& centre = _itemCentres[item];
+			float position = (axis == 0) ? centre.x : (axis == 1) ? centre.y : centre.z;
+			return min(static_cast<unsigned int>((position - axisMinimum) * binScale), BinCount - 1);
+		};
+		for (unsigned int i = first; i < last; i++)
+		{
+			unsigned int bin = binOf(_itemOrder[i]);
+			if (binItemCounts[bin]++ == 0)
+			{
+				binBounds[bin] = _itemBounds[_itemOrder[i]];
+			}
+			else
+			{
+				BoundingBox::CreateMerged(binBounds[bin], binBounds[bin], _itemBounds[_itemOrder[i]]);
+			}
+		}
+
+		// Sweep from the right to find the cost of every right-hand partition
+		float rightCosts[BinCount] = { 0 };
+		BoundingBox rightBounds;
+		unsigned int rightCount = 0;
+		for (unsigned int bin = BinCount - 1; bin > 0; bin--)
+		{
+			if (binItemCounts[bin] != 0)
+			{
+				if (rightCount == 0)
+				{
+					rightBounds = binBounds[bin];
+				}
+				else
+				{
+					BoundingBox::CreateMerged(rightBounds, rightBounds, binBounds[bin]);
+				}
+				rightCount += binItemCounts[bin];
+			}
+			rightCosts[bin] = (rightCount != 0) ? SurfaceArea(rightBounds) * rightCount : 0.0f;
+		}
+
+		// Then sweep from the left, choosing the cheapest boundary
+		float bestCost = SurfaceArea(bounds) * itemCount;
+		unsigned int bestBin = 0;
+		BoundingBox leftBounds;
+		unsigned int leftCount = 0;
+		for (unsigned int bin = 0; bin < BinCount - 1; bin++)
+		{
+			if (binItemCounts[bin] != 0)
+			{
+				if (leftCount == 0)
+				{
+					leftBounds = binBounds[bin];
+				}
+				else
+				{
+					BoundingBox::CreateMerged(leftBounds, leftBounds, binBounds[bin]);
+				}
+				leftCount += binItemCounts[bin];
+			}
+			if (leftCount == 0 || leftCount == itemCount)
+			{
+				continue;
+			}
+			float cost = SurfaceArea(leftBounds) * leftCount + rightCosts[bin + 1];
+			if (cost < bestCost)
+			{
+				bestCost = cost;
+				bestBin = bin + 1;
+			}
+		}
+
+		if (bestBin != 0)
+		{
+			split = static_cast<unsigned int>(partition(_itemOrder.begin() + first, _itemOrder.begin() + last,
+				[&](unsigned int item) { return binOf(item) < bestBin; }) - _itemOrder.begin());
+		}
+	}
+
+	if (split == first || split == last)
+	{
+		// Either the items are few enough to form a leaf, or no split beats keeping
+		// them together. Very large leaves are split at the median instead
+		if (itemCount <= MaximumLeafItems * 4)
+		{
+			_nodes[nodeIndex].FirstItem = first;
+			_nodes[nodeIndex].ItemCount = itemCount;
+			for (unsigned int i = first; i < last; i++)
+			{
+				_itemLeaves[_itemOrder[i]] = nodeIndex;
+			}
+			return nodeIndex;
+		}
+		split = first + itemCount / 2;
+		nth_element(_itemOrder.begin() + first, _itemOrder.begin() + split, _itemOrder.begin() + last,
+			[&](unsigned int a, unsigned int b)
+			{
+				const Vector3& centreA = _itemCentres[a];
+				const Vector3& centreB = _itemCentres[b];
+				return (axis == 0) ? centreA.x < centreB.x : (axis == 1) ? centreA.y < centreB.y : centreA.z < centreB.z;
+			});
+	}
+
+	unsigned int left = BuildNode(nodeIndex, first, split);
+	unsigned int right = BuildNode(nodeIndex, split, last);
+	_nodes[nodeIndex].Left = left;
+	_nodes[nodeIndex].Right = right;
+	return nodeIndex;
+}
+
+void BoundingVolumeHierarchy::SetItemBounds(size_t item, const BoundingBox& bounds)
+{
+	_itemBounds[item] = bounds;
+	_itemCentres[item] = bounds.Center;
+	if (!_isItemMoved[item])
+	{
+		_isItemMoved[item] = 1;
+		_movedItems.push_back(static_cast<unsigned int>(item));
+	}
+}
+
+void BoundingVolumeHierarchy::Refit()
+{
+	if (_movedItems.empty())
+	{
+		return;
+	}
+
+	if (_movedItems.size() * 8 > _itemBounds.size())
+	{
+		// Children are always created after their parent, so a reverse pass over
+		// the nodes refits the whole tree bottom-up
+		for (size_t i = _nodes.size(); i-- > 0;)
+		{
+			RefitNode(static_cast<unsigned int>(i));
+		}
+	}
+	else
+	{
+		// Only a few items have moved, so walk up from each of their leaves
+		for (unsigned int item : _movedItems)
+		{
+			for (unsigned int node = _itemLeaves[item]; node != NoNode; node = _nodes[node].Parent)
+			{
+				RefitNode(node);
+			}
+		}
+	}
+
+	for (unsigned int item : _movedItems)
+	{
+		_isItemMoved[item] = 0;
+	}
+	_movedItems.clear();
+}
+
+void BoundingVolumeHierarchy::RefitNode(unsigned int node)
+{
+	Node& current = _nodes[node];
+	if (current.IsLeaf())
+	{
+		current.Bounds = _itemBounds[_itemOrder[current.FirstItem]];
+		for (unsigned int i = current.FirstItem + 1; i < current.FirstItem + current.ItemCount; i++)
+		{
+			BoundingBox::CreateMerged(current.Bounds, current.Bounds, _itemBounds[_itemOrder[i]]);
+		}
+	}
+	else
+	{
+		BoundingBox::CreateMerged(current.Bounds, _nodes[current.Left].Bounds, _nodes[current.Right].Bounds);
+	}
+}
+
+void BoundingVolumeHierarchy::Cull(const BoundingFrustum& frustum, vector<size_t>& visibleItems) const
+{
+	if (_nodes.empty())
+	{
+		return;
+	}
+
+	unsigned int stack[64];
+	unsigned int stackSize = 0;
+	stack[stackSize++] = 0;
+	while (stackSize > 0)
+	{
+		const Node& node = _nodes[stack[--stackSize]];
+		ContainmentType containment = frustum.Contains(node.Bounds);
+		if (containment == DISJOINT)
+		{
+			continue;
+		}
+		if (containment == CONTAINS)
+		{
+			CollectItems(static_cast<unsigned int>(&node - &_nodes[0]), visibleItems);
+		}
+		else if (node.IsLeaf())
+		{
+			for (unsigned int i = node.FirstItem; i < node.FirstItem + node.ItemCount; i++)
+			{
+				if (frustum.Contains(_itemBounds[_itemOrder[i]]) != DISJOINT)
+				{
+					visibleItems.push_back(_itemOrder[i]);
+				}
+			}
+		}
+		else if (stackSize + 2 <= ARRAYSIZE(stack))
+		{
+			stack[stackSize++] = node.Right;
+			stack[stackSize++] = node.Left;
+		}
+		else
+		{
+			// The tree is deeper than the stack allows, so accept the subtree unculled
+			CollectItems(static_cast<unsigned int>(&node - &_nodes[0]), visibleItems);
+		}
+	}
+}
+
+void BoundingVolumeHierarchy::CollectItems(unsigned int node, vector<size_t>& visibleItems) const
+{
+	// Every item of a subtree occupies a contiguous range of the item order, running
+	// from the first item of its leftmost leaf to the last item of its rightmost leaf
+	unsigned int first = node;
+	while (!_nodes[first].IsLeaf())
+	{
+		first = _nodes[first].Left;
+	}
+	unsigned int last = node;
+	while (!_nodes[last].IsLeaf())
+	{
+		last = _nodes[last].Right;
+	}
+	for (unsigned int i = _nodes[first].FirstItem; i < _nodes[last].FirstItem + _nodes[last].ItemCount; i++)
+	{
+		visibleItems.push_back(_itemOrder[i]);
+	}
+}
+
+bool BoundingVolumeHierarchy::IsRebuildRecommended() const
+{
+	return !_nodes.empty() && SurfaceArea(_nodes[0].Bounds) > _builtSurfaceArea * 2.0f;
+}
+
+float BoundingVolumeHierarchy::SurfaceArea(const BoundingBox& bounds)
+{
+	return 8.0f * (bounds.Extents.x * bounds.Extents.y + bounds.Extents.y * bounds.Extents.z + bounds.Extents.z * bounds.Extents.x);
+}
+
+wstring BenchmarkFrustumCulling()
+{
+	// The view looks out from the middle of the scene, which reaches out to the far plane in every direction
+	const float farDistance = 300.0f;
+	BoundingFrustum viewFrustum(XMMatrixPerspectiveFovLH(XM_PIDIV4, 4.0f / 3.0f, 1.0f, farDistance));
+	const UINT viewCount = 16;
+
+	wstring report;
+	for (size_t itemCount : { 1000, 10000, 100000 })
+	{
+		// Boxes of different sizes spread through the scene, always placed the same way
+		mt19937 generator(1);
+		uniform_real_distribution<float> position(-farDistance, farDistance);
+		uniform_real_distribution<float> extent(0.5f, 3.0f);
+		vector<BoundingBox> itemBounds(itemCount);
+		for (BoundingBox& bounds : itemBounds)
+		{
+			bounds.Center = XMFLOAT3(position(generator), position(generator), position(generator));
+			bounds.Extents = XMFLOAT3(extent(generator), extent(generator), extent(generator));
+		}
+
+		BoundingVolumeHierarchy hierarchy;
+		auto startTime = chrono::high_resolution_clock::now();
+		hierarchy.Build(itemBounds);
+		double buildTime = chrono::duration<double, milli>(chrono::high_resolution_clock::now() - startTime).count();
+
+		// Turn the view around the scene, timing each way of culling
+		double hierarchyTime = 0.0;
+		double bruteForceTime = 0.0;
+		size_t visibleCount = 0;
+		size_t mismatchedViewCount = 0;
+		vector<size_t> hierarchyItems;
+		vector<size_t> bruteForceItems;
+		for (UINT view = 0; view < viewCount; view++)
+		{
+			BoundingFrustum frustum;
+			viewFrustum.Transform(frustum, Matrix::CreateRotationX(0.3f * view) * Matrix::CreateRotationY(XM_2PI * view / viewCount));
+			double bestHierarchyTime = DBL_MAX;
+			double bestBruteForceTime = DBL_MAX;
+			for (UINT run = 0; run < 5; run++)
+			{
+				hierarchyItems.clear();
+				startTime = chrono::high_resolution_clock::now();
+				hierarchy.Cull(frustum, hierarchyItems);
+				bestHierarchyTime = min(bestHierarchyTime, chrono::duration<double, milli>(chrono::high_resolution_clock::now() - startTime).count());
+
+				bruteForceItems.clear();
+				startTime = chrono::high_resolution_clock::now();
+				for (size_t item = 0; item < itemCount; item++)
+				{
+					if (frustum.Contains(itemBounds[item]) != DISJOINT)
+					{
+						bruteForceItems.push_back(item);
+					}
+				}
+				bestBruteForceTime = min(bestBruteForceTime, chrono::duration<double, milli>(chrono::high_resolution_clock::now() - startTime).count());
+			}
+			hierarchyTime += bestHierarchyTime;
+			bruteForceTime += bestBruteForceTime;
+			visibleCount += bruteForceItems.size();
+
+			// Both must find the same items
+			sort(hierarchyItems.begin(), hierarchyItems.end());
+			if (hierarchyItems != bruteForceItems)
+			{
+				mismatchedViewCount++;
+			}
+		}
+		report += L"Frustum culling, " + to_wstring(itemCount) + L" boxes: built in " + to_wstring(buildTime) + L" ms, " +
+			to_wstring(100.0 * visibleCount / (static_cast<double>(itemCount) * viewCount)) + L"% visible, hierarchy " + to_wstring(hierarchyTime / viewCount) +
+			L" ms, every box " + to_wstring(bruteForceTime / viewCount) + L" ms per view (" + to_wstring(bruteForceTime / hierarchyTime) + L" times as fast), " +
+			(mismatchedViewCount == 0 ? L"the same boxes found in every view\n" : to_wstring(mismatchedViewCount) + L" views with different boxes found\n");
+	}
+	return report;
+}
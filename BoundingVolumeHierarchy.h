@@ -0,0 +1,75 @@
+#pragma once
+#include <vector>
+#include <string>
+#include "DirectXCore.h"
+
+using namespace std;
+
+// A bounding volume hierarchy over the world bounds of a set of items (the
+// renderable nodes of a scene graph). The tree is built with a binned surface
+// area heuristic and kept up to date by refitting the bounds of the nodes above
+// any item that has moved. Frustum tests use the SIMD plane tests of
+// DirectXCollision, and whole subtrees that are entirely inside the frustum
+// are accepted without testing their items.
+
+class BoundingVolumeHierarchy
+{
+public:
+	static const unsigned int NoNode = 0xFFFFFFFF;
+
+	BoundingVolumeHierarchy() {};
+	~BoundingVolumeHierarchy() {};
+
+	void Build(const vector<BoundingBox>& itemBounds);
+	void Clear();
+
+	// Record the new bounds of an item. The tree is refitted by the next call to Refit
+	void SetItemBounds(size_t item, const BoundingBox& bounds);
+	void Refit();
+
+	// Appends the items whose bounds intersect the frustum
+	void Cull(const BoundingFrustum& frustum, vector<size_t>& visibleItems) const;
+
+	// Refitting lets the quality of the tree degrade as items move. Once the bounds
+	// of the root have grown well beyond their size when the tree was built, it
+	// should be rebuilt
+	bool IsRebuildRecommended() const;
+
+	size_t GetItemCount() const { return _itemBounds.size(); }
+	const BoundingBox& GetItemBounds(size_t item) const { return _itemBounds[item]; }
+
+private:
+	struct Node
+	{
+		BoundingBox		Bounds;
+		unsigned int	Parent{ NoNode };
+		unsigned int	Left{ NoNode };
+		unsigned int	Right{ NoNode };
+		unsigned int	FirstItem{ 0 };
+		unsigned int	ItemCount{ 0 };
+
+		bool IsLeaf() const { return ItemCount != 0; }
+	};
+
+	static const unsigned int MaximumLeafItems = 4;
+	static const unsigned int BinCount = 12;
+
+	vector<Node>			_nodes;
+	vector<BoundingBox>		_itemBounds;
+	vector<Vector3>			_itemCentres;
+	vector<unsigned int>	_itemOrder;
+	vector<unsigned int>	_itemLeaves;
+	vector<unsigned int>	_movedItems;
+	vector<BYTE>			_isItemMoved;
+	float					_builtSurfaceArea{ 0.0f };
+
+	unsigned int BuildNode(unsigned int parent, unsigned int first, unsigned int last);
+	void RefitNode(unsigned int node);
+	void CollectItems(unsigned int node, vector<size_t>& visibleItems) const;
+
+	static float SurfaceArea(const BoundingBox& bounds);
+};
+
+// Time culling scenes of 1,000, 10,000 and 100,000 boxes against the view frustum from a number of views,
+// through the hierarchy and by testing every box, and return a report of the times
+wstring BenchmarkFrustumCulling();
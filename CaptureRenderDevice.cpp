@@ -0,0 +1,286 @@
+#include "CaptureRenderDevice.h"
+
+void CaptureRenderContext::Capture(CommandType type, const void* object, UINT argument0, UINT argument1, UINT argument2, UINT argument3, UINT argument4, const void* data, UINT dataSize)
+{
+	// The data pointer means nothing once the call has returned. The data itself follows the command
+	Command command;
+	command.Type = type;
+	command.Arguments[0] = argument0;
+	command.Arguments[1] = argument1;
+	command.Arguments[2] = argument2;
+	command.Arguments[3] = argument3;
+	command.Arguments[4] = argument4;
+	command.Object = object;
+	command.Data = nullptr;
+	_renderDevice.CaptureRecord(TraceRecordType::Command, &command, sizeof(Command), data, dataSize);
+}
+
+void CaptureRenderContext::IASetInputLayout(ID3D11InputLayout* inputLayout)
+{
+	_renderContext->IASetInputLayout(inputLayout);
+	Capture(CommandType::SetInputLayout, inputLayout);
+}
+
+void CaptureRenderContext::IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY topology)
+{
+	_renderContext->IASetPrimitiveTopology(topology);
+	Capture(CommandType::SetPrimitiveTopology, nullptr, static_cast<UINT>(topology));
+}
+
+void CaptureRenderContext::IASetVertexBuffer(UINT slot, ID3D11Buffer* vertexBuffer, UINT stride, UINT offset)
+{
+	_renderContext->IASetVertexBuffer(slot, vertexBuffer, stride, offset);
+	Capture(CommandType::SetVertexBuffer, vertexBuffer, slot, stride, offset);
+}
+
+void CaptureRenderContext::IASetIndexBuffer(ID3D11Buffer* indexBuffer, DXGI_FORMAT format, UINT offset)
+{
+	_renderContext->IASetIndexBuffer(indexBuffer, format, offset);
+	Capture(CommandType::SetIndexBuffer, indexBuffer, static_cast<UINT>(format), offset);
+}
+
+void CaptureRenderContext::VSSetShader(ID3D11VertexShader* vertexShader)
+{
+	_renderContext->VSSetShader(vertexShader);
+	Capture(CommandType::SetVertexShader, vertexShader);
+}
+
+void CaptureRenderContext::PSSetShader(ID3D11PixelShader* pixelShader)
+{
+	_renderContext->PSSetShader(pixelShader);
+	Capture(CommandType::SetPixelShader, pixelShader);
+}
+
+void CaptureRenderContext::VSSetConstantBuffer(UINT slot, ID3D11Buffer* constantBuffer)
+{
+	_renderContext->VSSetConstantBuffer(slot, constantBuffer);
+	Capture(CommandType::SetVertexConstantBuffer, constantBuffer, slot);
+}
+
+void CaptureRenderContext::PSSetConstantBuffer(UINT slot, ID3D11Buffer* constantBuffer)
+{
+	_renderContext->PSSetConstantBuffer(slot, constantBuffer);
+	Capture(CommandType::SetPixelConstantBuffer, constantBuffer, slot);
+}
+
+void CaptureRenderContext::VSSetConstantBuffer(UINT slot, ID3D11Buffer* constantBuffer, UINT firstConstant, UINT constantCount)
+{
+	_renderContext->VSSetConstantBuffer(slot, constantBuffer, firstConstant, constantCount);
+	Capture(CommandType::SetVertexConstantBuffer, constantBuffer, slot, firstConstant, constantCount);
+}
+
+void CaptureRenderContext::PSSetShaderResource(UINT slot, ID3D11ShaderResourceView* shaderResource)
+{
+	_renderContext->PSSetShaderResource(slot, shaderResource);
+	Capture(CommandType::SetShaderResource, shaderResource, slot);
+}
+
+void CaptureRenderContext::PSSetSampler(UINT slot, ID3D11SamplerState* sampler)
+{
+	_renderContext->PSSetSampler(slot, sampler);
+	Capture(CommandType::SetSampler, sampler, slot);
+}
+
+void CaptureRenderContext::RSSetState(ID3D11RasterizerState* rasteriserState)
+{
+	_renderContext->RSSetState(rasteriserState);
+	Capture(CommandType::SetRasteriserState, rasteriserState);
+}
+
+void CaptureRenderContext::OMSetBlendState(ID3D11BlendState* blendState)
+{
+	_renderContext->OMSetBlendState(blendState);
+	Capture(CommandType::SetBlendState, blendState);
+}
+
+void CaptureRenderContext::OMSetDepthStencilState(ID3D11DepthStencilState* depthStencilState)
+{
+	_renderContext->OMSetDepthStencilState(depthStencilState);
+	Capture(CommandType::SetDepthStencilState, depthStencilState);
+}
+
+void CaptureRenderContext::UpdateBuffer(ID3D11Buffer* buffer, const void* data)
+{
+	_renderContext->UpdateBuffer(buffer, data);
+	Capture(CommandType::UpdateConstantBuffer, buffer, 0, 0, 0, 0, 0, data, _renderDevice.GetBufferSize(buffer));
+}
+
+void* CaptureRenderContext::Map(ID3D11Buffer* buffer, D3D11_MAP mapType)
+{
+	void* data = _renderContext->Map(buffer, mapType);
+	Capture(CommandType::MapBuffer, buffer, static_cast<UINT>(mapType));
+	return data;
+}
+
+void CaptureRenderContext::Unmap(ID3D11Buffer* buffer)
+{
+	_renderContext->Unmap(buffer);
+	Capture(CommandType::UnmapBuffer, buffer);
+}
+
+void CaptureRenderContext::DrawIndexed(UINT indexCount, UINT startIndex, INT baseVertex)
+{
+	_renderContext->DrawIndexed(indexCount, startIndex, baseVertex);
+	Capture(CommandType::DrawIndexed, nullptr, indexCount, startIndex, static_cast<UINT>(baseVertex));
+}
+
+void CaptureRenderContext::DrawIndexedInstanced(UINT indexCount, UINT instanceCount, UINT startIndex, INT baseVertex, UINT startInstance)
+{
+	_renderContext->DrawIndexedInstanced(indexCount, instanceCount, startIndex, baseVertex, startInstance);
+	Capture(CommandType::DrawIndexedInstanced, nullptr, indexCount, instanceCount, startIndex, static_cast<UINT>(baseVertex), startInstance);
+}
+
+CaptureRenderDevice::CaptureRenderDevice(shared_ptr<IRenderDevice> renderDevice) :
+	_renderDevice(renderDevice), _immediateContext(*this, renderDevice->GetImmediateContext())
+{
+}
+
+CaptureRenderDevice::~CaptureRenderDevice()
+{
+	Close();
+}
+
+bool CaptureRenderDevice::Open(const wstring& fileName)
+{
+	lock_guard<mutex> lock(_lock);
+	if (!_traceWriter.Open(fileName))
+	{
+		return false;
+	}
+	FrameTraceHeader header;
+	_traceWriter.Write(&header, sizeof(header));
+	_capturedFrameCount = 0;
+	return true;
+}
+
+void CaptureRenderDevice::EndFrame()
+{
+	CaptureRecord(TraceRecordType::EndFrame, nullptr, 0);
+	lock_guard<mutex> lock(_lock);
+	_traceWriter.Flush();
+	_capturedFrameCount++;
+}
+
+void CaptureRenderDevice::CaptureRecord(TraceRecordType type, const void* payload, UINT payloadSize, const void* data, UINT dataSize)
+{
+	lock_guard<mutex> lock(_lock);
+	if (!_traceWriter.IsOpen())
+	{
+		return;
+	}
+	TraceRecordHeader header;
+	header.Type = type;
+	header.Size = payloadSize + dataSize;
+	_traceWriter.Write(&header, sizeof(header));
+	if (payloadSize > 0)
+	{
+		_traceWriter.Write(payload, payloadSize);
+	}
+	if (dataSize > 0)
+	{
+		_traceWriter.Write(data, dataSize);
+	}
+}
+
+void CaptureRenderDevice::CaptureCreation(HRESULT result, TraceObjectType objectType, const void* object)
+{
+	if (SUCCEEDED(result))
+	{
+		TraceObjectCreation creation;
+		creation.Handle = reinterpret_cast<UINT64>(object);
+		creation.ObjectType = objectType;
+		creation.Reserved = 0;
+		CaptureRecord(TraceRecordType::CreateObject, &creation, sizeof(creation));
+	}
+}
+
+UINT CaptureRenderDevice::GetBufferSize(const void* buffer)
+{
+	lock_guard<mutex> lock(_lock);
+	auto bufferSize = _bufferSizes.find(buffer);
+	return bufferSize == _bufferSizes.end() ? 0 : bufferSize->second;
+}
+
+HRESULT CaptureRenderDevice::CreateBuffer(const D3D11_BUFFER_DESC* bufferDesc, const D3D11_SUBRESOURCE_DATA* initialData, ID3D11Buffer** buffer)
+{
+	HRESULT result = _renderDevice->CreateBuffer(bufferDesc, initialData, buffer);
+	if (FAILED(result))
+	{
+		return result;
+	}
+	{
+		// An address can be reused once a buffer has been released, so the size is always replaced
+		lock_guard<mutex> lock(_lock);
+		_bufferSizes[*buffer] = bufferDesc->ByteWidth;
+	}
+
+	// The creation is followed by the description of the buffer and then its initial data, if it has any
+	struct
+	{
+		TraceObjectCreation		Creation;
+		D3D11_BUFFER_DESC		BufferDesc;
+	} bufferCreation;
+	bufferCreation.Creation.Handle = reinterpret_cast<UINT64>(*buffer);
+	bufferCreation.Creation.ObjectType = TraceObjectType::Buffer;
+	bufferCreation.Creation.Reserved = 0;
+	bufferCreation.BufferDesc = *bufferDesc;
+	CaptureRecord(TraceRecordType::CreateObject, &bufferCreation, sizeof(bufferCreation),
+		initialData != nullptr ? initialData->pSysMem : nullptr, initialData != nullptr ? bufferDesc->ByteWidth : 0);
+	return result;
+}
+
+HRESULT CaptureRenderDevice::CreateVertexShader(const void* byteCode, SIZE_T byteCodeLength, ID3D11VertexShader** vertexShader)
+{
+	HRESULT result = _renderDevice->CreateVertexShader(byteCode, byteCodeLength, vertexShader);
+	CaptureCreation(result, TraceObjectType::VertexShader, *vertexShader);
+	return result;
+}
+
+HRESULT CaptureRenderDevice::CreatePixelShader(const void* byteCode, SIZE_T byteCodeLength, ID3D11PixelShader** pixelShader)
+{
+	HRESULT result = _renderDevice->CreatePixelShader(byteCode, byteCodeLength, pixelShader);
+	CaptureCreation(result, TraceObjectType::PixelShader, *pixelShader);
+	return result;
+}
+
+HRESULT CaptureRenderDevice::CreateInputLayout(const D3D11_INPUT_ELEMENT_DESC* elements, UINT elementCount, const void* byteCode, SIZE_T byteCodeLength, ID3D11InputLayout** inputLayout)
+{
+	HRESULT result = _renderDevice->CreateInputLayout(elements, elementCount, byteCode, byteCodeLength, inputLayout);
+	CaptureCreation(result, TraceObjectType::InputLayout, *inputLayout);
+	return result;
+}
+
+HRESULT CaptureRenderDevice::CreateRasterizerState(const D3D11_RASTERIZER_DESC* rasteriserDesc, ID3D11RasterizerState** rasteriserState)
+{
+	HRESULT result = _renderDevice->CreateRasterizerState(rasteriserDesc, rasteriserState);
+	CaptureCreation(result, TraceObjectType::RasteriserState, *rasteriserState);
+	return result;
+}
+
+HRESULT CaptureRenderDevice::CreateBlendState(const D3D11_BLEND_DESC* blendDesc, ID3D11BlendState** blendState)
+{
+	HRESULT result = _renderDevice->CreateBlendState(blendDesc, blendState);
+	CaptureCreation(result, TraceObjectType::BlendState, *blendState);
+	return result;
+}
+
+HRESULT CaptureRenderDevice::CreateDepthStencilState(const D3D11_DEPTH_STENCIL_DESC* depthStencilDesc, ID3D11DepthStencilState** depthStencilState)
+{
+	HRESULT result = _renderDevice->CreateDepthStencilState(depthStencilDesc, depthStencilState);
+	CaptureCreation(result, TraceObjectType::DepthStencilState, *depthStencilState);
+	return result;
+}
+
+HRESULT CaptureRenderDevice::CreateSamplerState(const D3D11_SAMPLER_DESC* samplerDesc, ID3D11SamplerState** samplerState)
+{
+	HRESULT result = _renderDevice->CreateSamplerState(samplerDesc, samplerState);
+	CaptureCreation(result, TraceObjectType::SamplerState, *samplerState);
+	return result;
+}
+
+HRESULT CaptureRenderDevice::CreateTextureFromFile(const wchar_t* fileName, ID3D11ShaderResourceView** texture)
+{
+	HRESULT result = _renderDevice->CreateTextureFromFile(fileName, texture);
+	CaptureCreation(result, TraceObjectType::Texture, *texture);
+	return result;
+}
@@ -0,0 +1,111 @@
+#pragma once
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include "core.h"
+#include "DirectXCore.h"
+#include "RenderDevice.h"
+#include "FrameTrace.h"
+#include "TraceWriter.h"
+
+using namespace std;
+
+class CaptureRenderDevice;
+
+// Passes every call on to the render context it wraps and writes it to the trace of the
+// device it belongs to. The context sits below the device state filter, so the trace holds
+// the calls that were actually made, not the ones the renderer asked for.
+//
+// The data written through a map is not captured: reading it back from a dynamic buffer
+// would read memory the CPU is only meant to write, which is slow on most hardware
+
+class CaptureRenderContext : public IRenderContext
+{
+public:
+	CaptureRenderContext(CaptureRenderDevice& renderDevice, IRenderContext* renderContext) : _renderDevice(renderDevice), _renderContext(renderContext) {};
+	~CaptureRenderContext() {};
+
+	void IASetInputLayout(ID3D11InputLayout* inputLayout) override;
+	void IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY topology) override;
+	void IASetVertexBuffer(UINT slot, ID3D11Buffer* vertexBuffer, UINT stride, UINT offset) override;
+	void IASetIndexBuffer(ID3D11Buffer* indexBuffer, DXGI_FORMAT format, UINT offset) override;
+	void VSSetShader(ID3D11VertexShader* vertexShader) override;
+	void PSSetShader(ID3D11PixelShader* pixelShader) override;
+	void VSSetConstantBuffer(UINT slot, ID3D11Buffer* constantBuffer) override;
+	void PSSetConstantBuffer(UINT slot, ID3D11Buffer* constantBuffer) override;
+	void VSSetConstantBuffer(UINT slot, ID3D11Buffer* constantBuffer, UINT firstConstant, UINT constantCount) override;
+	void PSSetShaderResource(UINT slot, ID3D11ShaderResourceView* shaderResource) override;
+	void PSSetSampler(UINT slot, ID3D11SamplerState* sampler) override;
+	void RSSetState(ID3D11RasterizerState* rasteriserState) override;
+	void OMSetBlendState(ID3D11BlendState* blendState) override;
+	void OMSetDepthStencilState(ID3D11DepthStencilState* depthStencilState) override;
+
+	void UpdateBuffer(ID3D11Buffer* buffer, const void* data) override;
+	void* Map(ID3D11Buffer* buffer, D3D11_MAP mapType) override;
+	void Unmap(ID3D11Buffer* buffer) override;
+
+	void DrawIndexed(UINT indexCount, UINT startIndex, INT baseVertex) override;
+	void DrawIndexedInstanced(UINT indexCount, UINT instanceCount, UINT startIndex, INT baseVertex, UINT startInstance) override;
+
+private:
+	CaptureRenderDevice&	_renderDevice;
+	IRenderContext*			_renderContext;
+
+	void Capture(CommandType type, const void* object, UINT argument0 = 0, UINT argument1 = 0, UINT argument2 = 0, UINT argument3 = 0, UINT argument4 = 0, const void* data = nullptr, UINT dataSize = 0);
+};
+
+// A render device that passes every call on to another render device and streams a trace
+// of the calls to disk as it goes. Everything created through the device is written to the
+// trace, including buffers with their initial data, followed by every call made on the
+// immediate context and a marker at the end of every frame. The trace is written by a
+// thread of its own, so capturing only costs the copy of each call into memory.
+//
+// Capture starts when the device is created, so it should be set before any resources are
+// created if the trace is to be replayed.
+
+class CaptureRenderDevice : public IRenderDevice
+{
+public:
+	CaptureRenderDevice(shared_ptr<IRenderDevice> renderDevice);
+	~CaptureRenderDevice();
+
+	bool Open(const wstring& fileName);
+	void Close() { _traceWriter.Close(); }
+	bool IsCapturing() const { return _traceWriter.IsOpen(); }
+	// Mark the end of a frame and hand what has been captured to the writer thread
+	void EndFrame();
+
+	IRenderContext* GetImmediateContext() override { return &_immediateContext; }
+
+	bool IsConstantBufferOffsettingSupported() const override { return _renderDevice->IsConstantBufferOffsettingSupported(); }
+	bool IsConstantBufferNoOverwriteSupported() const override { return _renderDevice->IsConstantBufferNoOverwriteSupported(); }
+
+	HRESULT CreateBuffer(const D3D11_BUFFER_DESC* bufferDesc, const D3D11_SUBRESOURCE_DATA* initialData, ID3D11Buffer** buffer) override;
+	HRESULT CreateVertexShader(const void* byteCode, SIZE_T byteCodeLength, ID3D11VertexShader** vertexShader) override;
+	HRESULT CreatePixelShader(const void* byteCode, SIZE_T byteCodeLength, ID3D11PixelShader** pixelShader) override;
+	HRESULT CreateInputLayout(const D3D11_INPUT_ELEMENT_DESC* elements, UINT elementCount, const void* byteCode, SIZE_T byteCodeLength, ID3D11InputLayout** inputLayout) override;
+	HRESULT CreateRasterizerState(const D3D11_RASTERIZER_DESC* rasteriserDesc, ID3D11RasterizerState** rasteriserState) override;
+	HRESULT CreateBlendState(const D3D11_BLEND_DESC* blendDesc, ID3D11BlendState** blendState) override;
+	HRESULT CreateDepthStencilState(const D3D11_DEPTH_STENCIL_DESC* depthStencilDesc, ID3D11DepthStencilState** depthStencilState) override;
+	HRESULT CreateSamplerState(const D3D11_SAMPLER_DESC* samplerDesc, ID3D11SamplerState** samplerState) override;
+	HRESULT CreateTextureFromFile(const wchar_t* fileName, ID3D11ShaderResourceView** texture) override;
+
+	size_t GetCapturedFrameCount() const { return _capturedFrameCount; }
+	size_t GetCapturedByteCount() const { return _traceWriter.GetWrittenByteCount(); }
+
+private:
+	shared_ptr<IRenderDevice>			_renderDevice;
+	CaptureRenderContext				_immediateContext;
+	TraceWriter							_traceWriter;
+	// Resources can be created from more than one thread
+	mutex								_lock;
+	// The size of every buffer, so that the data of an update can be captured
+	unordered_map<const void*, UINT>	_bufferSizes;
+	size_t								_capturedFrameCount{ 0 };
+
+	void CaptureRecord(TraceRecordType type, const void* payload, UINT payloadSize, const void* data = nullptr, UINT dataSize = 0);
+	void CaptureCreation(HRESULT result, TraceObjectType objectType, const void* object);
+	UINT GetBufferSize(const void* buffer);
+
+	friend class CaptureRenderContext;
+};
@@ -0,0 +1,212 @@
+#include "CommandList.h"
+
+// Commands hold the objects they refer to as untyped pointers
+template<typename T>
+static T* CommandObject(const Command& command)
+{
+	return static_cast<T*>(const_cast<void*>(command.Object));
+}
+
+void CommandList::Append(CommandType type, const void* object, UINT argument0, UINT argument1, UINT argument2, UINT argument3, UINT argument4, const void* data)
+{
+	Command command;
+	command.Type = type;
+	command.Arguments[0] = argument0;
+	command.Arguments[1] = argument1;
+	command.Arguments[2] = argument2;
+	command.Arguments[3] = argument3;
+	command.Arguments[4] = argument4;
+	command.Object = object;
+	command.Data = data;
+	_commands.push_back(command);
+}
+
+void CommandList::SetPipelineState(const PipelineState* pipelineState)
+{
+	Append(CommandType::SetPipelineState, pipelineState);
+}
+
+void CommandList::SetInputLayout(ID3D11InputLayout* inputLayout)
+{
+	Append(CommandType::SetInputLayout, inputLayout);
+}
+
+void CommandList::SetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY topology)
+{
+	Append(CommandType::SetPrimitiveTopology, nullptr, static_cast<UINT>(topology));
+}
+
+void CommandList::SetVertexBuffer(UINT slot, ID3D11Buffer* vertexBuffer, UINT stride, UINT offset)
+{
+	Append(CommandType::SetVertexBuffer, vertexBuffer, slot, stride, offset);
+}
+
+void CommandList::SetIndexBuffer(ID3D11Buffer* indexBuffer, DXGI_FORMAT format, UINT offset)
+{
+	Append(CommandType::SetIndexBuffer, indexBuffer, static_cast<UINT>(format), offset);
+}
+
+void CommandList::SetVertexShader(ID3D11VertexShader* vertexShader)
+{
+	Append(CommandType::SetVertexShader, vertexShader);
+}
+
+void CommandList::SetPixelShader(ID3D11PixelShader* pixelShader)
+{
+	Append(CommandType::SetPixelShader, pixelShader);
+}
+
+void CommandList::SetVertexConstantBuffer(UINT slot, ID3D11Buffer* constantBuffer, UINT firstConstant, UINT constantCount)
+{
+	Append(CommandType::SetVertexConstantBuffer, constantBuffer, slot, firstConstant, constantCount);
+}
+
+void CommandList::SetPixelConstantBuffer(UINT slot, ID3D11Buffer* constantBuffer)
+{
+	Append(CommandType::SetPixelConstantBuffer, constantBuffer, slot);
+}
+
+void CommandList::SetShaderResource(UINT slot, ID3D11ShaderResourceView* shaderResource)
+{
+	Append(CommandType::SetShaderResource, shaderResource, slot);
+}
+
+void CommandList::SetSampler(UINT slot, ID3D11SamplerState* sampler)
+{
+	Append(CommandType::SetSampler, sampler, slot);
+}
+
+void CommandList::SetRasteriserState(ID3D11RasterizerState* rasteriserState)
+{
+	Append(CommandType::SetRasteriserState, rasteriserState);
+}
+
+void CommandList::SetBlendState(ID3D11BlendState* blendState)
+{
+	Append(CommandType::SetBlendState, blendState);
+}
+
+void CommandList::SetDepthStencilState(ID3D11DepthStencilState* depthStencilState)
+{
+	Append(CommandType::SetDepthStencilState, depthStencilState);
+}
+
+void CommandList::UpdateConstantBuffer(ID3D11Buffer* constantBuffer, const void* data)
+{
+	Append(CommandType::UpdateConstantBuffer, constantBuffer, 0, 0, 0, 0, 0, data);
+}
+
+void CommandList::MapBuffer(ID3D11Buffer* buffer, D3D11_MAP mapType)
+{
+	Append(CommandType::MapBuffer, buffer, static_cast<UINT>(mapType));
+}
+
+void CommandList::UnmapBuffer(ID3D11Buffer* buffer)
+{
+	Append(CommandType::UnmapBuffer, buffer);
+}
+
+void CommandList::DrawIndexed(UINT indexCount, UINT startIndex, INT baseVertex)
+{
+	Append(CommandType::DrawIndexed, nullptr, indexCount, startIndex, static_cast<UINT>(baseVertex));
+}
+
+void CommandList::DrawIndexedInstanced(UINT indexCount, UINT instanceCount, UINT startIndex, INT baseVertex, UINT startInstance)
+{
+	Append(CommandType::DrawIndexedInstanced, nullptr, indexCount, instanceCount, startIndex, static_cast<UINT>(baseVertex), startInstance);
+}
+
+void CommandList::Execute(DeviceStateFilter& stateFilter) const
+{
+	for (const Command& command : _commands)
+	{
+		ExecuteCommand(command, stateFilter);
+	}
+}
+
+void CommandList::ExecuteCommand(const Command& command, DeviceStateFilter& stateFilter)
+{
+	const UINT* arguments = command.Arguments;
+	switch (command.Type)
+	{
+	case CommandType::SetPipelineState:
+		stateFilter.SetPipelineState(CommandObject<const PipelineState>(command));
+		break;
+
+	case CommandType::SetInputLayout:
+		stateFilter.IASetInputLayout(CommandObject<ID3D11InputLayout>(command));
+		break;
+
+	case CommandType::SetPrimitiveTopology:
+		stateFilter.IASetPrimitiveTopology(static_cast<D3D11_PRIMITIVE_TOPOLOGY>(arguments[0]));
+		break;
+
+	case CommandType::SetVertexBuffer:
+		stateFilter.IASetVertexBuffer(arguments[0], CommandObject<ID3D11Buffer>(command), arguments[1], arguments[2]);
+		break;
+
+	case CommandType::SetIndexBuffer:
+		stateFilter.IASetIndexBuffer(CommandObject<ID3D11Buffer>(command), static_cast<DXGI_FORMAT>(arguments[0]), arguments[1]);
+		break;
+
+	case CommandType::SetVertexShader:
+		stateFilter.VSSetShader(CommandObject<ID3D11VertexShader>(command));
+		break;
+
+	case CommandType::SetPixelShader:
+		stateFilter.PSSetShader(CommandObject<ID3D11PixelShader>(command));
+		break;
+
+	case CommandType::SetVertexConstantBuffer:
+		if (arguments[2] == 0)
+		{
+			stateFilter.VSSetConstantBuffer(arguments[0], CommandObject<ID3D11Buffer>(command));
+		}
+		else
+		{
+			stateFilter.VSSetConstantBuffer(arguments[0], CommandObject<ID3D11Buffer>(command), arguments[1], arguments[2]);
+		}
+		break;
+
+	case CommandType::SetPixelConstantBuffer:
+		stateFilter.PSSetConstantBuffer(arguments[0], CommandObject<ID3D11Buffer>(command));
+		break;
+
+	case CommandType::SetShaderResource:
+		stateFilter.PSSetShaderResource(arguments[0], CommandObject<ID3D11ShaderResourceView>(command));
+		break;
+
+	case CommandType::SetSampler:
+		stateFilter.PSSetSampler(arguments[0], CommandObject<ID3D11SamplerState>(command));
+		break;
+
+	case CommandType::SetRasteriserState:
+		stateFilter.RSSetState(CommandObject<ID3D11RasterizerState>(command));
+		break;
+
+	case CommandType::SetBlendState:
+		stateFilter.OMSetBlendState(CommandObject<ID3D11BlendState>(command));
+		break;
+
+	case CommandType::SetDepthStencilState:
+		stateFilter.OMSetDepthStencilState(CommandObject<ID3D11DepthStencilState>(command));
+		break;
+
+	case CommandType::UpdateConstantBuffer:
+		stateFilter.GetRenderContext()->UpdateBuffer(CommandObject<ID3D11Buffer>(command), command.Data);
+		break;
+
+	case CommandType::MapBuffer:
+	case CommandType::UnmapBuffer:
+	case CommandType::Count:
+		break;
+
+	case CommandType::DrawIndexed:
+		stateFilter.DrawIndexed(arguments[0], arguments[1], static_cast<INT>(arguments[2]));
+		break;
+
+	case CommandType::DrawIndexedInstanced:
+		stateFilter.DrawIndexedInstanced(arguments[0], arguments[1], arguments[2], static_cast<INT>(arguments[3]), arguments[4]);
+		break;
+	}
+}
@@ -0,0 +1,105 @@
+#pragma once
+#include <vector>
+#include "core.h"
+#include "DirectXCore.h"
+#include "PipelineState.h"
+#include "DeviceStateFilter.h"
+
+using namespace std;
+
+enum class CommandType : UINT
+{
+	SetPipelineState,
+	SetInputLayout,
+	SetPrimitiveTopology,
+	SetVertexBuffer,
+	SetIndexBuffer,
+	SetVertexShader,
+	SetPixelShader,
+	SetVertexConstantBuffer,
+	SetPixelConstantBuffer,
+	SetShaderResource,
+	SetSampler,
+	SetRasteriserState,
+	SetBlendState,
+	SetDepthStencilState,
+	UpdateConstantBuffer,
+	MapBuffer,
+	UnmapBuffer,
+	DrawIndexed,
+	DrawIndexedInstanced,
+	Count
+};
+
+#define CommandTypeCount	static_cast<size_t>(CommandType::Count)
+
+// A single recorded command. Every command has the same size and no padding, so
+// recording the same commands always produces the same bytes. The meaning of the
+// arguments and objects depends on the type of the command
+
+struct Command
+{
+	CommandType		Type;
+	UINT			Arguments[5];
+	const void*		Object;
+	const void*		Data;
+};
+
+static_assert(sizeof(Command) == sizeof(UINT) * 6 + sizeof(void*) * 2, "Commands must not contain padding");
+
+// A list of draw commands recorded in the engine's own format rather than on a device
+// context. Recording only writes to memory, so several lists can be recorded at the same
+// time on different threads and then executed one after the other on the immediate
+// context. Recording is stateless: a command is recorded for every call, and redundant
+// commands are dropped by the device state filter when the list is executed.
+//
+// The objects referenced by the commands are not owned by the list and must stay
+// alive until the list has been executed.
+
+class CommandList
+{
+public:
+	CommandList() {};
+	~CommandList() {};
+
+	void Clear() { _commands.clear(); }
+
+	void SetPipelineState(const PipelineState* pipelineState);
+	void SetInputLayout(ID3D11InputLayout* inputLayout);
+	void SetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY topology);
+	void SetVertexBuffer(UINT slot, ID3D11Buffer* vertexBuffer, UINT stride, UINT offset);
+	void SetIndexBuffer(ID3D11Buffer* indexBuffer, DXGI_FORMAT format, UINT offset);
+	void SetVertexShader(ID3D11VertexShader* vertexShader);
+	void SetPixelShader(ID3D11PixelShader* pixelShader);
+	// A constant count of zero binds the whole buffer. Binding part of a buffer needs Direct3D 11.1
+	void SetVertexConstantBuffer(UINT slot, ID3D11Buffer* constantBuffer, UINT firstConstant = 0, UINT constantCount = 0);
+	void SetPixelConstantBuffer(UINT slot, ID3D11Buffer* constantBuffer);
+	void SetShaderResource(UINT slot, ID3D11ShaderResourceView* shaderResource);
+	void SetSampler(UINT slot, ID3D11SamplerState* sampler);
+	void SetRasteriserState(ID3D11RasterizerState* rasteriserState);
+	void SetBlendState(ID3D11BlendState* blendState);
+	void SetDepthStencilState(ID3D11DepthStencilState* depthStencilState);
+	// The data is copied into the buffer when the list is executed, so it must stay valid until then
+	void UpdateConstantBuffer(ID3D11Buffer* constantBuffer, const void* data);
+	// Maps are only recorded so that they can be counted. The data written through a map is
+	// not part of the list, so maps are not replayed when the list is executed
+	void MapBuffer(ID3D11Buffer* buffer, D3D11_MAP mapType);
+	void UnmapBuffer(ID3D11Buffer* buffer);
+	void DrawIndexed(UINT indexCount, UINT startIndex, INT baseVertex);
+	void DrawIndexedInstanced(UINT indexCount, UINT instanceCount, UINT startIndex, INT baseVertex, UINT startInstance);
+
+	// Replay the commands in order on the render context the filter has been started on
+	void Execute(DeviceStateFilter& stateFilter) const;
+	// Execute a single command, which does not have to come from a list
+	static void ExecuteCommand(const Command& command, DeviceStateFilter& stateFilter);
+
+	size_t GetCommandCount() const { return _commands.size(); }
+	const Command& GetCommand(size_t index) const { return _commands[index]; }
+	const BYTE* GetData() const { return reinterpret_cast<const BYTE*>(_commands.data()); }
+	size_t GetSize() const { return _commands.size() * sizeof(Command); }
+
+private:
+	vector<Command>		_commands;
+
+	void Append(CommandType type, const void* object, UINT argument0 = 0, UINT argument1 = 0, UINT argument2 = 0, UINT argument3 = 0, UINT argument4 = 0, const void* data = nullptr);
+};
@@ -0,0 +1,60 @@
+@echo off
+rem Compile every permutation of the lighting shader into arrays of byte code that
+rem are embedded in the executable (see ShaderPermutations.h). This runs as a
+rem pre-build step, so that no shader has to be compiled when the application starts.
+rem
+rem Permutation bits: 1 = HAS_TEXTURE, 2 = SPECULAR, 4 = NUM_POINT_LIGHTS (0 or 1).
+rem The vertex shaders only depend on HAS_TEXTURE, so only two of each are compiled.
+
+setlocal enabledelayedexpansion
+set SOURCE=%~dp0shader.hlsl
+set OUTPUT_DIRECTORY=%~dp0CompiledShaders
+set TABLE=%OUTPUT_DIRECTORY%\CompiledShaders.h
+set ENTRIES=%OUTPUT_DIRECTORY%\CompiledShaderEntries.inl
+
+rem The step is optional. Without the shader compiler the table is not generated and the
+rem permutations are compiled when the application starts instead
+where fxc >nul 2>nul
+if errorlevel 1 (
+	echo fxc was not found on the path, so the shader permutations will be compiled at runtime
+	exit /b 0
+)
+
+rem The table is written to temporary files that only replace it once every permutation
+rem has compiled, so that a failed build never leaves a partial table behind
+if not exist "%OUTPUT_DIRECTORY%" mkdir "%OUTPUT_DIRECTORY%"
+echo // Generated by CompileShaders.bat. Do not edit> "%TABLE%.tmp"
+echo // Generated by CompileShaders.bat. Do not edit> "%ENTRIES%.tmp"
+
+for /L %%p in (0,1,7) do (
+	set /A "TEXTURE=%%p & 1"
+	set /A "SPECULAR=(%%p >> 1) & 1"
+	set /A "POINT_LIGHTS=(%%p >> 2) & 1"
+	set DEFINES=/D HAS_TEXTURE=!TEXTURE! /D SPECULAR=!SPECULAR! /D NUM_POINT_LIGHTS=!POINT_LIGHTS!
+	call :Compile ps_5_0 PS %%p || goto :Failed
+	if %%p LSS 2 (
+		call :Compile vs_5_0 VS %%p || goto :Failed
+		call :Compile vs_5_0 VSInstanced %%p || goto :Failed
+	)
+)
+
+echo static const EmbeddedShader embeddedShaders[] =>> "%TABLE%.tmp"
+echo {>> "%TABLE%.tmp"
+echo #include "CompiledShaderEntries.inl">> "%TABLE%.tmp"
+echo };>> "%TABLE%.tmp"
+
+rem The entries are moved first, since the table is what the build looks for
+move /Y "%ENTRIES%.tmp" "%ENTRIES%" >nul || goto :Failed
+move /Y "%TABLE%.tmp" "%TABLE%" >nul || goto :Failed
+exit /b 0
+
+:Failed
+del "%TABLE%.tmp" "%ENTRIES%.tmp" 2>nul
+exit /b 1
+
+rem Compile one entry point of one permutation and add it to the table
+:Compile
+fxc /nologo /O3 /T %1 /E %2 %DEFINES% /Vn %2_%3 /Fh "%OUTPUT_DIRECTORY%\%2_%3.h" "%SOURCE%" >nul || exit /b 1
+echo #include "%2_%3.h">> "%TABLE%.tmp"
+echo 	{ "%2", %3, %2_%3, sizeof(%2_%3) },>> "%ENTRIES%.tmp"
+exit /b 0
@@ -0,0 +1,49 @@
+#pragma once
+#include "DirectXCore.h"
+
+// Formats of the constant buffers. These must match the format of the cbuffer
+// structures in the shaders.
+//
+// The constants are split by how often they change. The frame constants are
+// uploaded once per frame, the material constants only when a material is first
+// created and the object constants for each draw.
+
+#define FrameConstantBufferSlot		0
+#define MaterialConstantBufferSlot	1
+#define ObjectConstantBufferSlot	2
+
+struct FrameConstants
+{
+	Matrix		ViewProjection;
+	Vector3		EyePosition;
+	float		Pad = { 0 };
+};
+
+struct MaterialConstants
+{
+	Vector4		AmbientLightColour;
+	Vector4		DirectionalLightColour;
+	Vector4		DirectionalLightVector;
+	Vector4		PointLightColour;
+	Vector3		PointLightPosition;
+	float		PointLightRange = { 0 };
+	Vector4		SpecularColour;
+	float		SpecularPower = { 0 };
+	Vector3		Pad;
+};
+
+struct ObjectConstants
+{
+	Matrix		WorldViewProjection;
+	Matrix		WorldTransformation;
+};
+
+static_assert(sizeof(MaterialConstants) % 16 == 0, "MaterialConstants must be a whole number of shader constants");
+
+// Materials are shared between every node whose material constants are the same
+
+struct MaterialResource
+{
+	ComPtr<ID3D11Buffer>	Buffer;
+	MaterialConstants		Constants;
+};
@@ -0,0 +1,63 @@
+#include "ConstantBufferRing.h"
+
+bool ConstantBufferRing::Initialise(IRenderDevice* renderDevice, UINT size)
+{
+	if (!renderDevice->IsConstantBufferOffsettingSupported())
+	{
+		_renderDevice = nullptr;
+		return false;
+	}
+	_renderDevice = renderDevice;
+	_isNoOverwriteSupported = renderDevice->IsConstantBufferNoOverwriteSupported();
+	CreateBuffer(Align(size));
+	return true;
+}
+
+void ConstantBufferRing::CreateBuffer(UINT size)
+{
+	D3D11_BUFFER_DESC bufferDesc = { 0 };
+	bufferDesc.Usage = D3D11_USAGE_DYNAMIC;
+	bufferDesc.ByteWidth = size;
+	bufferDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+	bufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	ThrowIfFailed(_renderDevice->CreateBuffer(&bufferDesc, NULL, _buffer.ReleaseAndGetAddressOf()));
+	_size = size;
+	_head = 0;
+	_isDiscardRequired = true;
+}
+
+BYTE* ConstantBufferRing::Map(UINT blockSize, UINT blockCount)
+{
+	_blockStride = Align(blockSize);
+	UINT byteCount = _blockStride * blockCount;
+
+	// Grow the ring if a single frame needs more than the whole buffer
+	if (byteCount > _size)
+	{
+		CreateBuffer(Align(max(byteCount, _size * 2)));
+	}
+
+	// A new buffer must be discarded before it can be mapped without overwriting. Otherwise
+	// the frame is placed straight after the previous one if it fits
+	D3D11_MAP mapType = D3D11_MAP_WRITE_NO_OVERWRITE;
+	if (_isDiscardRequired || !_isNoOverwriteSupported || _head + byteCount > _size)
+	{
+		if (!_isDiscardRequired && _isNoOverwriteSupported)
+		{
+			_wrapCount++;
+		}
+		mapType = D3D11_MAP_WRITE_DISCARD;
+		_head = 0;
+		_isDiscardRequired = false;
+	}
+
+	BYTE* mappedBuffer = static_cast<BYTE*>(_renderDevice->GetImmediateContext()->Map(_buffer.Get(), mapType));
+	_mappedOffset = _head;
+	_head += byteCount;
+	return mappedBuffer + _mappedOffset;
+}
+
+void ConstantBufferRing::Unmap()
+{
+	_renderDevice->GetImmediateContext()->Unmap(_buffer.Get());
+}
@@ -0,0 +1,63 @@
+#pragma once
+#include "core.h"
+#include "DirectXCore.h"
+#include "RenderDevice.h"
+
+using namespace std;
+
+// Constant buffers that are bound with an offset must start on a 256 byte boundary
+#define ConstantBufferAlignment			256
+#define DefaultConstantBufferRingSize	(256 * 1024)
+
+// A large dynamic constant buffer that the draws of a frame suballocate their constants
+// from. All of the constants of a frame are written through a single map, and each draw
+// then binds its own block of the buffer. Binding with an offset needs Direct3D 11.1.
+//
+// Frames are allocated one after the other around the ring. A frame that fits in the
+// space after the previous frame is mapped with WRITE_NO_OVERWRITE, since the GPU may
+// still be reading the earlier frames but never the space after them. When a frame
+// does not fit, the ring wraps back to the start and is mapped with WRITE_DISCARD.
+// The driver then hands out fresh memory while the GPU finishes with the old contents,
+// so the ring never has to wait on a fence. Drivers that cannot map dynamic constant
+// buffers with WRITE_NO_OVERWRITE discard the buffer every frame.
+
+class ConstantBufferRing
+{
+public:
+	ConstantBufferRing() {};
+	~ConstantBufferRing() {};
+
+	// Returns false if the device cannot bind constant buffers with an offset
+	bool Initialise(IRenderDevice* renderDevice, UINT size = DefaultConstantBufferRingSize);
+
+	// Reserve space for blockCount blocks of blockSize bytes and map it. Each block is
+	// aligned to ConstantBufferAlignment. Returns a pointer to the first block
+	BYTE* Map(UINT blockSize, UINT blockCount);
+	void Unmap();
+
+	// A block of the last mapping is bound by its offset and size in shader constants of 16 bytes
+	ID3D11Buffer* GetBuffer() const { return _buffer.Get(); }
+	UINT GetFirstConstant(UINT block) const { return (_mappedOffset + block * _blockStride) / 16; }
+	UINT GetConstantCount() const { return _blockStride / 16; }
+
+	UINT GetSize() const { return _size; }
+	UINT GetBlockStride() const { return _blockStride; }
+	UINT GetMappedOffset() const { return _mappedOffset; }
+	size_t GetWrapCount() const { return _wrapCount; }
+	bool IsNoOverwriteSupported() const { return _isNoOverwriteSupported; }
+
+	static UINT Align(UINT size) { return (size + ConstantBufferAlignment - 1) & ~(ConstantBufferAlignment - 1); }
+
+private:
+	IRenderDevice*					_renderDevice{ nullptr };
+	ComPtr<ID3D11Buffer>			_buffer;
+	UINT							_size{ 0 };
+	UINT							_head{ 0 };
+	UINT							_mappedOffset{ 0 };
+	UINT							_blockStride{ 0 };
+	size_t							_wrapCount{ 0 };
+	bool							_isNoOverwriteSupported{ false };
+	bool							_isDiscardRequired{ true };
+
+	void CreateBuffer(UINT size);
+};
@@ -1,30 +1,9 @@
 #pragma once
+#include "ConstantBuffer.h"
+#include "VertexCompression.h"
 
-#define ShaderFileName		L"shader.hlsl"
-#define VertexShaderName	"VS"
-#define PixelShaderName		"PS"
-
-// Format of the constant buffer. This must match the format of the
-// cbuffer structure in the shader
-
-struct CBuffer
-{
-	Matrix		WorldViewProjection;
-	Matrix		WorldTransformation;
-	Vector4		AmbientLightColour;
-	Vector4		DirectionalLightColour;
-	Vector4		DirectionalLightVector;
-	Vector4		PointLightColour;
-	Vector3		PointLightPosition;
-	float		PointLightRange = { 0 };
-	Vector4		SpecularColour;
-	float		SpecularPower = { 0 };
-	Vector3		EyePosition;
-	alignas(16) Vector3		Pad;
-};
-
-// Structure of a single vertex.  This must match the
-// structure of the input vertex in the shader
+// Structure of a single vertex, as the geometry is built. The resource cache compresses
+// it into a CompressedVertex (see VertexCompression.h) before it is uploaded
 
 struct Vertex
 {
@@ -33,17 +12,31 @@ struct Vertex
 };
 
 // The description of the vertex that is passed to CreateInputLayout.  This must
-// match the format of the vertex above and the format of the input vertex in the shader
+// match the format of the compressed vertex and the format of the input vertex in the shader
 
 D3D11_INPUT_ELEMENT_DESC vertexDesc[] =
 {
-	{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
-	{ "NORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+	{ "POSITION", 0, DXGI_FORMAT_R16G16B16A16_SNORM, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+	{ "NORMAL", 0, DXGI_FORMAT_R16G16_SNORM, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+};
+
+// The description of the vertex used by the instanced vertex shader. The per-instance
+// data is read from the second vertex buffer slot and must match InstanceData
+
+D3D11_INPUT_ELEMENT_DESC instancedVertexDesc[] =
+{
+	{ "POSITION", 0, DXGI_FORMAT_R16G16B16A16_SNORM, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+	{ "NORMAL", 0, DXGI_FORMAT_R16G16_SNORM, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+	{ "WORLD", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 0, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+	{ "WORLD", 1, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+	{ "WORLD", 2, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+	{ "WORLD", 3, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+	{ "COLOUR", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
 };
 
 // This example uses hard-coded vertices and indices for a cube. Usually, you will load the verticesa and indices from a model file. 
 // We will see this later in the module. 
-Vertex vertices[] =
+const Vertex vertices[] =
 {
 	{ Vector3(-1.0f, -1.0f, 1.0f), Vector3(0.0f) },    // side 1
 	{ Vector3(1.0f, -1.0f, 1.0f), Vector3(0.0f) },
@@ -76,7 +69,7 @@ Vertex vertices[] =
 	{ Vector3(-1.0f, 1.0f, 1.0f), Vector3(0.0f) }
 };
 
-UINT indices[] = {
+const UINT indices[] = {
 			0, 1, 2,       // side 1
 			2, 1, 3,
 			4, 5, 6,       // side 2
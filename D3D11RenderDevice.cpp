@@ -0,0 +1,164 @@
+#include "D3D11RenderDevice.h"
+#include "WICTextureLoader.h"
+
+D3D11RenderContext::D3D11RenderContext(ComPtr<ID3D11DeviceContext> deviceContext) : _deviceContext(deviceContext)
+{
+	_deviceContext.As(&_deviceContext1);
+}
+
+void D3D11RenderContext::IASetInputLayout(ID3D11InputLayout* inputLayout)
+{
+	_deviceContext->IASetInputLayout(inputLayout);
+}
+
+void D3D11RenderContext::IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY topology)
+{
+	_deviceContext->IASetPrimitiveTopology(topology);
+}
+
+void D3D11RenderContext::IASetVertexBuffer(UINT slot, ID3D11Buffer* vertexBuffer, UINT stride, UINT offset)
+{
+	_deviceContext->IASetVertexBuffers(slot, 1, &vertexBuffer, &stride, &offset);
+}
+
+void D3D11RenderContext::IASetIndexBuffer(ID3D11Buffer* indexBuffer, DXGI_FORMAT format, UINT offset)
+{
+	_deviceContext->IASetIndexBuffer(indexBuffer, format, offset);
+}
+
+void D3D11RenderContext::VSSetShader(ID3D11VertexShader* vertexShader)
+{
+	_deviceContext->VSSetShader(vertexShader, 0, 0);
+}
+
+void D3D11RenderContext::PSSetShader(ID3D11PixelShader* pixelShader)
+{
+	_deviceContext->PSSetShader(pixelShader, 0, 0);
+}
+
+void D3D11RenderContext::VSSetConstantBuffer(UINT slot, ID3D11Buffer* constantBuffer)
+{
+	_deviceContext->VSSetConstantBuffers(slot, 1, &constantBuffer);
+}
+
+void D3D11RenderContext::PSSetConstantBuffer(UINT slot, ID3D11Buffer* constantBuffer)
+{
+	_deviceContext->PSSetConstantBuffers(slot, 1, &constantBuffer);
+}
+
+void D3D11RenderContext::VSSetConstantBuffer(UINT slot, ID3D11Buffer* constantBuffer, UINT firstConstant, UINT constantCount)
+{
+	_deviceContext1->VSSetConstantBuffers1(slot, 1, &constantBuffer, &firstConstant, &constantCount);
+}
+
+void D3D11RenderContext::PSSetShaderResource(UINT slot, ID3D11ShaderResourceView* shaderResource)
+{
+	_deviceContext->PSSetShaderResources(slot, 1, &shaderResource);
+}
+
+void D3D11RenderContext::PSSetSampler(UINT slot, ID3D11SamplerState* sampler)
+{
+	_deviceContext->PSSetSamplers(slot, 1, &sampler);
+}
+
+void D3D11RenderContext::RSSetState(ID3D11RasterizerState* rasteriserState)
+{
+	_deviceContext->RSSetState(rasteriserState);
+}
+
+void D3D11RenderContext::OMSetBlendState(ID3D11BlendState* blendState)
+{
+	_deviceContext->OMSetBlendState(blendState, nullptr, 0xFFFFFFFF);
+}
+
+void D3D11RenderContext::OMSetDepthStencilState(ID3D11DepthStencilState* depthStencilState)
+{
+	_deviceContext->OMSetDepthStencilState(depthStencilState, 0);
+}
+
+void D3D11RenderContext::UpdateBuffer(ID3D11Buffer* buffer, const void* data)
+{
+	_deviceContext->UpdateSubresource(buffer, 0, 0, data, 0, 0);
+}
+
+void* D3D11RenderContext::Map(ID3D11Buffer* buffer, D3D11_MAP mapType)
+{
+	D3D11_MAPPED_SUBRESOURCE mappedBuffer;
+	ThrowIfFailed(_deviceContext->Map(buffer, 0, mapType, 0, &mappedBuffer));
+	return mappedBuffer.pData;
+}
+
+void D3D11RenderContext::Unmap(ID3D11Buffer* buffer)
+{
+	_deviceContext->Unmap(buffer, 0);
+}
+
+void D3D11RenderContext::DrawIndexed(UINT indexCount, UINT startIndex, INT baseVertex)
+{
+	_deviceContext->DrawIndexed(indexCount, startIndex, baseVertex);
+}
+
+void D3D11RenderContext::DrawIndexedInstanced(UINT indexCount, UINT instanceCount, UINT startIndex, INT baseVertex, UINT startInstance)
+{
+	_deviceContext->DrawIndexedInstanced(indexCount, instanceCount, startIndex, baseVertex, startInstance);
+}
+
+D3D11RenderDevice::D3D11RenderDevice(ComPtr<ID3D11Device> device, ComPtr<ID3D11DeviceContext> deviceContext) :
+	_device(device), _deviceContext(deviceContext), _immediateContext(deviceContext)
+{
+	// Constant buffer offsetting also needs the Direct3D 11.1 device context
+	ComPtr<ID3D11DeviceContext1> deviceContext1;
+	D3D11_FEATURE_DATA_D3D11_OPTIONS options = { 0 };
+	if (SUCCEEDED(_device->CheckFeatureSupport(D3D11_FEATURE_D3D11_OPTIONS, &options, sizeof(options))) &&
+		SUCCEEDED(_deviceContext.As(&deviceContext1)))
+	{
+		_isConstantBufferOffsettingSupported = options.ConstantBufferOffsetting != 0;
+		_isConstantBufferNoOverwriteSupported = options.MapNoOverwriteOnDynamicConstantBuffer != 0;
+	}
+}
+
+HRESULT D3D11RenderDevice::CreateBuffer(const D3D11_BUFFER_DESC* bufferDesc, const D3D11_SUBRESOURCE_DATA* initialData, ID3D11Buffer** buffer)
+{
+	return _device->CreateBuffer(bufferDesc, initialData, buffer);
+}
+
+HRESULT D3D11RenderDevice::CreateVertexShader(const void* byteCode, SIZE_T byteCodeLength, ID3D11VertexShader** vertexShader)
+{
+	return _device->CreateVertexShader(byteCode, byteCodeLength, NULL, vertexShader);
+}
+
+HRESULT D3D11RenderDevice::CreatePixelShader(const void* byteCode, SIZE_T byteCodeLength, ID3D11PixelShader** pixelShader)
+{
+	return _device->CreatePixelShader(byteCode, byteCodeLength, NULL, pixelShader);
+}
+
+HRESULT D3D11RenderDevice::CreateInputLayout(const D3D11_INPUT_ELEMENT_DESC* elements, UINT elementCount, const void* byteCode, SIZE_T byteCodeLength, ID3D11InputLayout** inputLayout)
+{
+	return _device->CreateInputLayout(elements, elementCount, byteCode, byteCodeLength, inputLayout);
+}
+
+HRESULT D3D11RenderDevice::CreateRasterizerState(const D3D11_RASTERIZER_DESC* rasteriserDesc, ID3D11RasterizerState** rasteriserState)
+{
+	return _device->CreateRasterizerState(rasteriserDesc, rasteriserState);
+}
+
+HRESULT D3D11RenderDevice::CreateBlendState(const D3D11_BLEND_DESC* blendDesc, ID3D11BlendState** blendState)
+{
+	return _device->CreateBlendState(blendDesc, blendState);
+}
+
+HRESULT D3D11RenderDevice::CreateDepthStencilState(const D3D11_DEPTH_STENCIL_DESC* depthStencilDesc, ID3D11DepthStencilState** depthStencilState)
+{
+	return _device->CreateDepthStencilState(depthStencilDesc, depthStencilState);
+}
+
+HRESULT D3D11RenderDevice::CreateSamplerState(const D3D11_SAMPLER_DESC* samplerDesc, ID3D11SamplerState** samplerState)
+{
+	return _device->CreateSamplerState(samplerDesc, samplerState);
+}
+
+HRESULT D3D11RenderDevice::CreateTextureFromFile(const wchar_t* fileName, ID3D11ShaderResourceView** texture)
+{
+	// The immediate context is used to generate the mipmaps
+	return CreateWICTextureFromFile(_device.Get(), _deviceContext.Get(), fileName, nullptr, texture);
+}
@@ -0,0 +1,75 @@
+#pragma once
+#include <d3d11_1.h>
+#include "core.h"
+#include "DirectXCore.h"
+#include "RenderDevice.h"
+
+using namespace std;
+
+// Passes every call straight on to a Direct3D 11 device context
+
+class D3D11RenderContext : public IRenderContext
+{
+public:
+	D3D11RenderContext(ComPtr<ID3D11DeviceContext> deviceContext);
+	~D3D11RenderContext() {};
+
+	void IASetInputLayout(ID3D11InputLayout* inputLayout) override;
+	void IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY topology) override;
+	void IASetVertexBuffer(UINT slot, ID3D11Buffer* vertexBuffer, UINT stride, UINT offset) override;
+	void IASetIndexBuffer(ID3D11Buffer* indexBuffer, DXGI_FORMAT format, UINT offset) override;
+	void VSSetShader(ID3D11VertexShader* vertexShader) override;
+	void PSSetShader(ID3D11PixelShader* pixelShader) override;
+	void VSSetConstantBuffer(UINT slot, ID3D11Buffer* constantBuffer) override;
+	void PSSetConstantBuffer(UINT slot, ID3D11Buffer* constantBuffer) override;
+	void VSSetConstantBuffer(UINT slot, ID3D11Buffer* constantBuffer, UINT firstConstant, UINT constantCount) override;
+	void PSSetShaderResource(UINT slot, ID3D11ShaderResourceView* shaderResource) override;
+	void PSSetSampler(UINT slot, ID3D11SamplerState* sampler) override;
+	void RSSetState(ID3D11RasterizerState* rasteriserState) override;
+	void OMSetBlendState(ID3D11BlendState* blendState) override;
+	void OMSetDepthStencilState(ID3D11DepthStencilState* depthStencilState) override;
+
+	void UpdateBuffer(ID3D11Buffer* buffer, const void* data) override;
+	void* Map(ID3D11Buffer* buffer, D3D11_MAP mapType) override;
+	void Unmap(ID3D11Buffer* buffer) override;
+
+	void DrawIndexed(UINT indexCount, UINT startIndex, INT baseVertex) override;
+	void DrawIndexedInstanced(UINT indexCount, UINT instanceCount, UINT startIndex, INT baseVertex, UINT startInstance) override;
+
+private:
+	ComPtr<ID3D11DeviceContext>		_deviceContext;
+	// Only available on Direct3D 11.1, where it is used to bind part of a constant buffer
+	ComPtr<ID3D11DeviceContext1>	_deviceContext1;
+};
+
+// A render device on top of a Direct3D 11 device and its immediate context. The
+// optional features are queried once, when the render device is created
+
+class D3D11RenderDevice : public IRenderDevice
+{
+public:
+	D3D11RenderDevice(ComPtr<ID3D11Device> device, ComPtr<ID3D11DeviceContext> deviceContext);
+	~D3D11RenderDevice() {};
+
+	IRenderContext* GetImmediateContext() override { return &_immediateContext; }
+
+	bool IsConstantBufferOffsettingSupported() const override { return _isConstantBufferOffsettingSupported; }
+	bool IsConstantBufferNoOverwriteSupported() const override { return _isConstantBufferNoOverwriteSupported; }
+
+	HRESULT CreateBuffer(const D3D11_BUFFER_DESC* bufferDesc, const D3D11_SUBRESOURCE_DATA* initialData, ID3D11Buffer** buffer) override;
+	HRESULT CreateVertexShader(const void* byteCode, SIZE_T byteCodeLength, ID3D11VertexShader** vertexShader) override;
+	HRESULT CreatePixelShader(const void* byteCode, SIZE_T byteCodeLength, ID3D11PixelShader** pixelShader) override;
+	HRESULT CreateInputLayout(const D3D11_INPUT_ELEMENT_DESC* elements, UINT elementCount, const void* byteCode, SIZE_T byteCodeLength, ID3D11InputLayout** inputLayout) override;
+	HRESULT CreateRasterizerState(const D3D11_RASTERIZER_DESC* rasteriserDesc, ID3D11RasterizerState** rasteriserState) override;
+	HRESULT CreateBlendState(const D3D11_BLEND_DESC* blendDesc, ID3D11BlendState** blendState) override;
+	HRESULT CreateDepthStencilState(const D3D11_DEPTH_STENCIL_DESC* depthStencilDesc, ID3D11DepthStencilState** depthStencilState) override;
+	HRESULT CreateSamplerState(const D3D11_SAMPLER_DESC* samplerDesc, ID3D11SamplerState** samplerState) override;
+	HRESULT CreateTextureFromFile(const wchar_t* fileName, ID3D11ShaderResourceView** texture) override;
+
+private:
+	ComPtr<ID3D11Device>			_device;
+	ComPtr<ID3D11DeviceContext>		_deviceContext;
+	D3D11RenderContext				_immediateContext;
+	bool							_isConstantBufferOffsettingSupported{ false };
+	bool							_isConstantBufferNoOverwriteSupported{ false };
+};
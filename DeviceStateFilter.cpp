@@ -0,0 +1,208 @@
+#include "DeviceStateFilter.h"
+
+void DeviceStateFilter::Begin(IRenderContext* renderContext)
+{
+	// Nothing is known about the state of a different render context
+	if (renderContext != _renderContext)
+	{
+		_renderContext = renderContext;
+		Invalidate();
+	}
+	_statistics = DeviceStateStatistics();
+}
+
+void DeviceStateFilter::Invalidate()
+{
+	_inputLayout.IsKnown = false;
+	_topology.IsKnown = false;
+	for (auto& vertexBuffer : _vertexBuffers)
+	{
+		vertexBuffer.IsKnown = false;
+	}
+	_indexBuffer.IsKnown = false;
+	_vertexShader.IsKnown = false;
+	_pixelShader.IsKnown = false;
+	for (UINT slot = 0; slot < TrackedConstantBufferSlots; slot++)
+	{
+		_vertexConstantBuffers[slot].IsKnown = false;
+		_pixelConstantBuffers[slot].IsKnown = false;
+	}
+	for (auto& shaderResource : _shaderResources)
+	{
+		shaderResource.IsKnown = false;
+	}
+	for (auto& sampler : _samplers)
+	{
+		sampler.IsKnown = false;
+	}
+	_rasteriserState.IsKnown = false;
+	_blendState.IsKnown = false;
+	_depthStencilState.IsKnown = false;
+	_pipelineStateId.IsKnown = false;
+}
+
+void DeviceStateFilter::SetPipelineState(const PipelineState* pipelineState)
+{
+	if (_pipelineStateId.IsKnown && _pipelineStateId.Value == pipelineState->Id)
+	{
+		_statistics.FilteredCallCount++;
+		_totalStatistics.FilteredCallCount++;
+		return;
+	}
+	IASetInputLayout(pipelineState->InputLayout);
+	IASetPrimitiveTopology(pipelineState->Topology);
+	VSSetShader(pipelineState->VertexShader);
+	PSSetShader(pipelineState->PixelShader);
+	RSSetState(pipelineState->RasteriserState);
+	OMSetBlendState(pipelineState->BlendState);
+	OMSetDepthStencilState(pipelineState->DepthStencilState);
+	if (pipelineState->SamplerState != nullptr)
+	{
+		PSSetSampler(0, pipelineState->SamplerState);
+	}
+
+	// Recorded last, since binding any part on its own forgets which pipeline state is bound
+	_pipelineStateId.Value = pipelineState->Id;
+	_pipelineStateId.IsKnown = true;
+}
+
+void DeviceStateFilter::IASetInputLayout(ID3D11InputLayout* inputLayout)
+{
+	if (Track(_inputLayout, inputLayout))
+	{
+		_pipelineStateId.IsKnown = false;
+		_renderContext->IASetInputLayout(inputLayout);
+	}
+}
+
+void DeviceStateFilter::IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY topology)
+{
+	if (Track(_topology, topology))
+	{
+		_pipelineStateId.IsKnown = false;
+		_renderContext->IASetPrimitiveTopology(topology);
+	}
+}
+
+void DeviceStateFilter::IASetVertexBuffer(UINT slot, ID3D11Buffer* vertexBuffer, UINT stride, UINT offset)
+{
+	if (Track(_vertexBuffers, slot, VertexBufferBinding{ vertexBuffer, stride, offset }))
+	{
+		_renderContext->IASetVertexBuffer(slot, vertexBuffer, stride, offset);
+	}
+}
+
+void DeviceStateFilter::IASetIndexBuffer(ID3D11Buffer* indexBuffer, DXGI_FORMAT format, UINT offset)
+{
+	if (Track(_indexBuffer, IndexBufferBinding{ indexBuffer, format, offset }))
+	{
+		_renderContext->IASetIndexBuffer(indexBuffer, format, offset);
+	}
+}
+
+void DeviceStateFilter::VSSetShader(ID3D11VertexShader* vertexShader)
+{
+	if (Track(_vertexShader, vertexShader))
+	{
+		_pipelineStateId.IsKnown = false;
+		_renderContext->VSSetShader(vertexShader);
+	}
+}
+
+void DeviceStateFilter::PSSetShader(ID3D11PixelShader* pixelShader)
+{
+	if (Track(_pixelShader, pixelShader))
+	{
+		_pipelineStateId.IsKnown = false;
+		_renderContext->PSSetShader(pixelShader);
+	}
+}
+
+void DeviceStateFilter::VSSetConstantBuffer(UINT slot, ID3D11Buffer* constantBuffer)
+{
+	// A whole buffer is recorded with a constant count of zero, so that it never matches a partial binding
+	if (Track(_vertexConstantBuffers, slot, ConstantBufferBinding{ constantBuffer, 0, 0 }))
+	{
+		_renderContext->VSSetConstantBuffer(slot, constantBuffer);
+	}
+}
+
+void DeviceStateFilter::PSSetConstantBuffer(UINT slot, ID3D11Buffer* constantBuffer)
+{
+	if (Track(_pixelConstantBuffers, slot, ConstantBufferBinding{ constantBuffer, 0, 0 }))
+	{
+		_renderContext->PSSetConstantBuffer(slot, constantBuffer);
+	}
+}
+
+void DeviceStateFilter::VSSetConstantBuffer(UINT slot, ID3D11Buffer* constantBuffer, UINT firstConstant, UINT constantCount)
+{
+	if (Track(_vertexConstantBuffers, slot, ConstantBufferBinding{ constantBuffer, firstConstant, constantCount }))
+	{
+		_renderContext->VSSetConstantBuffer(slot, constantBuffer, firstConstant, constantCount);
+	}
+}
+
+void DeviceStateFilter::PSSetShaderResource(UINT slot, ID3D11ShaderResourceView* shaderResource)
+{
+	if (Track(_shaderResources, slot, shaderResource))
+	{
+		_renderContext->PSSetShaderResource(slot, shaderResource);
+	}
+}
+
+void DeviceStateFilter::PSSetSampler(UINT slot, ID3D11SamplerState* sampler)
+{
+	if (Track(_samplers, slot, sampler))
+	{
+		_pipelineStateId.IsKnown = false;
+		_renderContext->PSSetSampler(slot, sampler);
+	}
+}
+
+void DeviceStateFilter::RSSetState(ID3D11RasterizerState* rasteriserState)
+{
+	if (Track(_rasteriserState, rasteriserState))
+	{
+		_pipelineStateId.IsKnown = false;
+		_renderContext->RSSetState(rasteriserState);
+	}
+}
+
+void DeviceStateFilter::OMSetBlendState(ID3D11BlendState* blendState)
+{
+	if (Track(_blendState, blendState))
+	{
+		_pipelineStateId.IsKnown = false;
+		_renderContext->OMSetBlendState(blendState);
+	}
+}
+
+void DeviceStateFilter::OMSetDepthStencilState(ID3D11DepthStencilState* depthStencilState)
+{
+	if (Track(_depthStencilState, depthStencilState))
+	{
+		_pipelineStateId.IsKnown = false;
+		_renderContext->OMSetDepthStencilState(depthStencilState);
+	}
+}
+
+void DeviceStateFilter::DrawIndexed(UINT indexCount, UINT startIndex, INT baseVertex)
+{
+	_renderContext->DrawIndexed(indexCount, startIndex, baseVertex);
+	_statistics.DrawCount++;
+	_totalStatistics.DrawCount++;
+}
+
+void DeviceStateFilter::DrawIndexedInstanced(UINT indexCount, UINT instanceCount, UINT startIndex, INT baseVertex, UINT startInstance)
+{
+	_renderContext->DrawIndexedInstanced(indexCount, instanceCount, startIndex, baseVertex, startInstance);
+	_statistics.DrawCount++;
+	_totalStatistics.DrawCount++;
+}
+
+double DeviceStateFilter::GetFilteredPercentage() const
+{
+	size_t callCount = _totalStatistics.IssuedCallCount + _totalStatistics.FilteredCallCount;
+	return (callCount == 0) ? 0.0 : 100.0 * _totalStatistics.FilteredCallCount / callCount;
+}
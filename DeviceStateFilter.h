@@ -0,0 +1,156 @@
+#pragma once
+#include "core.h"
+#include "DirectXCore.h"
+#include "PipelineState.h"
+#include "RenderDevice.h"
+
+using namespace std;
+
+// Number of slots of each kind whose bindings are shadowed. Calls for higher slots
+// are always passed on to the render context
+#define TrackedVertexBufferSlots		2
+#define TrackedConstantBufferSlots		4
+#define TrackedShaderResourceSlots		4
+#define TrackedSamplerSlots				4
+
+struct DeviceStateStatistics
+{
+	size_t		IssuedCallCount{ 0 };
+	size_t		FilteredCallCount{ 0 };
+	size_t		DrawCount{ 0 };
+};
+
+// A thin layer over a render context that shadows the state that has been bound and
+// drops any call that would bind the state that is already bound. Only the calls
+// that the renderer makes for every draw are wrapped; anything else should be called
+// on the render context directly.
+//
+// The shadowed state is kept from one frame to the next. If anything else binds
+// state on the render context, Invalidate must be called so that the next call of
+// every kind is passed on.
+
+class DeviceStateFilter
+{
+public:
+	DeviceStateFilter() {};
+	~DeviceStateFilter() {};
+
+	// Start recording a frame on a render context. The statistics of the frame are reset
+	void Begin(IRenderContext* renderContext);
+	void Invalidate();
+	IRenderContext* GetRenderContext() const { return _renderContext; }
+
+	// Bind everything in a pipeline state. If the same pipeline state is already bound the
+	// whole call is dropped, otherwise only the parts that differ are bound
+	void SetPipelineState(const PipelineState* pipelineState);
+
+	void IASetInputLayout(ID3D11InputLayout* inputLayout);
+	void IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY topology);
+	void IASetVertexBuffer(UINT slot, ID3D11Buffer* vertexBuffer, UINT stride, UINT offset);
+	void IASetIndexBuffer(ID3D11Buffer* indexBuffer, DXGI_FORMAT format, UINT offset);
+	void VSSetShader(ID3D11VertexShader* vertexShader);
+	void PSSetShader(ID3D11PixelShader* pixelShader);
+	void VSSetConstantBuffer(UINT slot, ID3D11Buffer* constantBuffer);
+	void PSSetConstantBuffer(UINT slot, ID3D11Buffer* constantBuffer);
+	// Binds part of a constant buffer. This needs Direct3D 11.1
+	void VSSetConstantBuffer(UINT slot, ID3D11Buffer* constantBuffer, UINT firstConstant, UINT constantCount);
+	void PSSetShaderResource(UINT slot, ID3D11ShaderResourceView* shaderResource);
+	void PSSetSampler(UINT slot, ID3D11SamplerState* sampler);
+	void RSSetState(ID3D11RasterizerState* rasteriserState);
+	void OMSetBlendState(ID3D11BlendState* blendState);
+	void OMSetDepthStencilState(ID3D11DepthStencilState* depthStencilState);
+
+	void DrawIndexed(UINT indexCount, UINT startIndex, INT baseVertex);
+	void DrawIndexedInstanced(UINT indexCount, UINT instanceCount, UINT startIndex, INT baseVertex, UINT startInstance);
+
+	const DeviceStateStatistics& GetStatistics() const { return _statistics; }
+	const DeviceStateStatistics& GetTotalStatistics() const { return _totalStatistics; }
+
+	// The percentage of calls that were dropped since the filter was created
+	double GetFilteredPercentage() const;
+
+private:
+	struct VertexBufferBinding
+	{
+		ID3D11Buffer*	Buffer;
+		UINT			Stride;
+		UINT			Offset;
+		bool operator==(const VertexBufferBinding& other) const { return Buffer == other.Buffer && Stride == other.Stride && Offset == other.Offset; }
+	};
+
+	struct IndexBufferBinding
+	{
+		ID3D11Buffer*	Buffer;
+		DXGI_FORMAT		Format;
+		UINT			Offset;
+		bool operator==(const IndexBufferBinding& other) const { return Buffer == other.Buffer && Format == other.Format && Offset == other.Offset; }
+	};
+
+	struct ConstantBufferBinding
+	{
+		ID3D11Buffer*	Buffer;
+		UINT			FirstConstant;
+		UINT			ConstantCount;
+		bool operator==(const ConstantBufferBinding& other) const { return Buffer == other.Buffer && FirstConstant == other.FirstConstant && ConstantCount == other.ConstantCount; }
+	};
+
+	// A shadowed piece of state. Until it has been set, the state on the device is unknown
+	template<typename T>
+	struct TrackedState
+	{
+		T			Value;
+		bool		IsKnown{ false };
+	};
+
+	IRenderContext*						_renderContext{ nullptr };
+	DeviceStateStatistics				_statistics;
+	DeviceStateStatistics				_totalStatistics;
+
+	TrackedState<ID3D11InputLayout*>		_inputLayout;
+	TrackedState<D3D11_PRIMITIVE_TOPOLOGY>	_topology;
+	TrackedState<VertexBufferBinding>		_vertexBuffers[TrackedVertexBufferSlots];
+	TrackedState<IndexBufferBinding>		_indexBuffer;
+	TrackedState<ID3D11VertexShader*>		_vertexShader;
+	TrackedState<ID3D11PixelShader*>		_pixelShader;
+	TrackedState<ConstantBufferBinding>		_vertexConstantBuffers[TrackedConstantBufferSlots];
+	TrackedState<ConstantBufferBinding>		_pixelConstantBuffers[TrackedConstantBufferSlots];
+	TrackedState<ID3D11ShaderResourceView*>	_shaderResources[TrackedShaderResourceSlots];
+	TrackedState<ID3D11SamplerState*>		_samplers[TrackedSamplerSlots];
+	TrackedState<ID3D11RasterizerState*>	_rasteriserState;
+	TrackedState<ID3D11BlendState*>			_blendState;
+	TrackedState<ID3D11DepthStencilState*>	_depthStencilState;
+	TrackedState<UINT64>					_pipelineStateId;
+
+	// Returns true if the call must be passed on to the render context
+	template<typename T>
+	bool Track(TrackedState<T>& state, const T& value)
+	{
+		if (state.IsKnown && state.Value == value)
+		{
+			_statistics.FilteredCallCount++;
+			_totalStatistics.FilteredCallCount++;
+			return false;
+		}
+		state.Value = value;
+		state.IsKnown = true;
+		CountIssued();
+		return true;
+	}
+
+	template<typename T, size_t N>
+	bool Track(TrackedState<T> (&states)[N], UINT slot, const T& value)
+	{
+		if (slot >= N)
+		{
+			CountIssued();
+			return true;
+		}
+		return Track(states[slot], value);
+	}
+
+	void CountIssued()
+	{
+		_statistics.IssuedCallCount++;
+		_totalStatistics.IssuedCallCount++;
+	}
+};
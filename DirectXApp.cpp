@@ -2,6 +2,9 @@
 #include "CubeNode.h"
 #include "TexturedCubeNode.h"
 #include "TeapotNode.h"
+#include "SceneFile.h"
+
+#define SceneFileName	L"Scene.scene"
 
 DirectXApp app;
 
@@ -10,8 +13,27 @@ void DirectXApp::CreateSceneGraph()
 	// Get the Scene Graph
 	SceneGraphPointer sceneGraph = GetSceneGraph();
 
+	// Load the scene from the scene file. If there is no scene file yet, build the
+	// default scene and export it so that it is loaded from the file next time
+	if (!SceneFile::Load(SceneFileName, *sceneGraph))
+	{
+		CreateDefaultScene();
+		SceneFile::Save(SceneFileName, *sceneGraph);
+	}
+
+	// Cache handles to the nodes that are animated
+	_cubeHandle = sceneGraph->FindHandle(HashName(L"Cube"));
+	_teapotHandle = sceneGraph->FindHandle(HashName(L"Teapot"));
+	_texturedCubeHandle = sceneGraph->FindHandle(HashName(L"Textured Cube"));
+}
+
+void DirectXApp::CreateDefaultScene()
+{
+	// Get the Scene Graph
+	SceneGraphPointer sceneGraph = GetSceneGraph();
+
 	// Create a non-textured cube
-	shared_ptr<CubeNode> cube = make_shared<CubeNode>(
+	shared_ptr<CubeNode> cube = MakeNode<CubeNode>(
 		L"Cube",
 		Vector4(Colors::Gray),
 		Vector4(Colors::Blue),
@@ -26,7 +48,7 @@ void DirectXApp::CreateSceneGraph()
 	sceneGraph->Add(cube);
 
 	// Create a non-textured teapot
-	shared_ptr<TeapotNode> teapot = make_shared<TeapotNode>(
+	shared_ptr<TeapotNode> teapot = MakeNode<TeapotNode>(
 		L"Teapot",
 		Vector4(Colors::Gray),
 		Vector4(Colors::Green),
@@ -41,7 +63,7 @@ void DirectXApp::CreateSceneGraph()
 	sceneGraph->Add(teapot);
 
 	// Create a textured cube
-	shared_ptr<TexturedCubeNode> texturedCube = make_shared<TexturedCubeNode>(
+	shared_ptr<TexturedCubeNode> texturedCube = MakeNode<TexturedCubeNode>(
 		L"Textured Cube",
 		Vector4(Colors::Gray),
 		Vector4(Colors::Red),
@@ -63,22 +85,31 @@ void DirectXApp::UpdateSceneGraph()
 	SceneGraphPointer sceneGraph = GetSceneGraph();
 
 	// Get the non-textured cube and apply rotation
-	SceneNodePointer object = sceneGraph->Find(L"Cube");
-	object->SetWorldTransform(Matrix::CreateRotationY(_rotationAngle * XM_PI / 180.0f) *
-		Matrix::CreateRotationX(_rotationAngle * XM_PI / 180.0f) *
-		Matrix::CreateTranslation(Vector3(4.0f, 0.0f, 0.0f)));
+	SceneNode* object = sceneGraph->Resolve(_cubeHandle);
+	if (object != nullptr)
+	{
+		object->SetWorldTransform(Matrix::CreateRotationY(_rotationAngle * XM_PI / 180.0f) *
+			Matrix::CreateRotationX(_rotationAngle * XM_PI / 180.0f) *
+			Matrix::CreateTranslation(Vector3(4.0f, 0.0f, 0.0f)));
+	}
 
 	// Get the non-textured teapot and apply rotation
-	object = sceneGraph->Find(L"Teapot");
-	object->SetWorldTransform(Matrix::CreateRotationY(-_rotationAngle * XM_PI / 180.0f) * 
-		Matrix::CreateRotationZ(-_rotationAngle * XM_PI / 180.0f) *
-		Matrix::CreateTranslation(Vector3(0.0f, 0.0f, 0.0f)));
+	object = sceneGraph->Resolve(_teapotHandle);
+	if (object != nullptr)
+	{
+		object->SetWorldTransform(Matrix::CreateRotationY(-_rotationAngle * XM_PI / 180.0f) * 
+			Matrix::CreateRotationZ(-_rotationAngle * XM_PI / 180.0f) *
+			Matrix::CreateTranslation(Vector3(0.0f, 0.0f, 0.0f)));
+	}
 
 	// Get the textured cube and apply rotation
-	object = sceneGraph->Find(L"Textured Cube");
-	object->SetWorldTransform(Matrix::CreateRotationX(_rotationAngle * XM_PI / 180.0f) * 
-		Matrix::CreateRotationZ(_rotationAngle * XM_PI / 180.0f) *
-		Matrix::CreateTranslation(Vector3(-4.0f, 0.0f, 0.0f)));
+	object = sceneGraph->Resolve(_texturedCubeHandle);
+	if (object != nullptr)
+	{
+		object->SetWorldTransform(Matrix::CreateRotationX(_rotationAngle * XM_PI / 180.0f) * 
+			Matrix::CreateRotationZ(_rotationAngle * XM_PI / 180.0f) *
+			Matrix::CreateTranslation(Vector3(-4.0f, 0.0f, 0.0f)));
+	}
 
 	// Update the rotation angle
 	_rotationAngle = (_rotationAngle + 1) % 360;
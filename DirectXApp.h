@@ -8,6 +8,13 @@ public:
 	void UpdateSceneGraph();
 
 private:
-	int		_rotationAngle = { 0 };
+	void CreateDefaultScene();
+
+	int				_rotationAngle = { 0 };
+
+	// Handles to the animated nodes, cached when the scene graph is created
+	NodeHandle		_cubeHandle;
+	NodeHandle		_teapotHandle;
+	NodeHandle		_texturedCubeHandle;
 };
 
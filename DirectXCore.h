@@ -4,6 +4,7 @@
 #include <DirectXMath.h>
 #include "SimpleMath.h"
 #include <DirectXColors.h>
+#include <DirectXCollision.h>
 #include <wrl.h>
 
 using namespace DirectX;
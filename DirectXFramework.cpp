@@ -1,4 +1,13 @@
+#include <fstream>
 #include "DirectXFramework.h"
+#include "D3D11RenderDevice.h"
+#include "NullRenderDevice.h"
+#include "TraceReplayer.h"
+#include "NormalGeneration.h"
+#include "MeshSimplifier.h"
+#include "Meshlets.h"
+#include "SoftwareRasteriser.h"
+#include "HeadlessTests.h"
 
 // DirectX libraries that are needed
 #pragma comment(lib, "d3d11.lib")
@@ -107,6 +116,19 @@ const Matrix& DirectXFramework::GetProjectionTransformation() const
 	return _projectionTransformation;
 }
 
+float DirectXFramework::GetErrorTolerance(const Matrix& worldTransformation, const BoundingBox& bounds)
+{
+	// The largest scale of the world transformation turns distances in the mesh into world distances
+	float scale = max(max(worldTransformation.Right().Length(), worldTransformation.Up().Length()), worldTransformation.Backward().Length());
+	Vector3 centre = Vector3::Transform(bounds.Center, worldTransformation);
+	float radius = Vector3(bounds.Extents).Length() * scale;
+	// Nothing is drawn nearer than the near plane
+	float distance = max(Vector3::Distance(centre, _camera.GetEyePosition()) - radius, 1.0f);
+	// The projection maps a height of 2 / _22 at a distance of one onto the height of the window
+	float worldError = _levelOfDetailPixelError * 2.0f * distance / (_projectionTransformation._22 * GetWindowHeight());
+	return worldError / max(scale, FLT_MIN);
+}
+
 void DirectXFramework::SetBackgroundColour(Vector4 backgroundColour)
 {
 	_backgroundColour[0] = backgroundColour.x;
@@ -123,32 +145,292 @@ void DirectXFramework::UpdateSceneGraph()
 {
 }
 
+// Returns the argument that follows an option on the command line, or an empty string if the
+// option is not there. An argument that contains spaces can be put in quotes
+static wstring GetCommandLineArgument(const wstring& commandLine, const wstring& option)
+{
+	size_t position = commandLine.find(option + L" ");
+	if (position == wstring::npos)
+	{
+		return L"";
+	}
+	position = commandLine.find_first_not_of(L' ', position + option.size());
+	if (position == wstring::npos)
+	{
+		return L"";
+	}
+	wchar_t separator = L' ';
+	if (commandLine[position] == L'"')
+	{
+		separator = L'"';
+		position++;
+	}
+	size_t end = commandLine.find(separator, position);
+	return commandLine.substr(position, end == wstring::npos ? wstring::npos : end - position);
+}
+
+bool DirectXFramework::ProcessCommandLine(const wstring& commandLine, int& exitCode)
+{
+	_captureFileName = GetCommandLineArgument(commandLine, L"-capture");
+	_isSoftwareRendering = commandLine.find(L"-software") != wstring::npos;
+	_isStatisticsReportingEnabled = _isStatisticsReportingEnabled || commandLine.find(L"-statistics") != wstring::npos;
+	wstring renderFileName = GetCommandLineArgument(commandLine, L"-render");
+	if (!renderFileName.empty())
+	{
+		// Draw a single frame on the CPU and save it, which needs neither a window nor a GPU
+		_softwareDevice = make_shared<SoftwareRenderDevice>(GetWindowWidth(), GetWindowHeight());
+		_renderDevice = _softwareDevice;
+		bool isRendered = Initialise();
+		if (isRendered)
+		{
+			Update();
+			Render();
+			isRendered = _softwareDevice->SaveBitmap(renderFileName);
+		}
+		Shutdown();
+		exitCode = isRendered ? 0 : -1;
+		return true;
+	}
+	if (commandLine.find(L"-test") != wstring::npos)
+	{
+		// Check the renderer against the null device. The exit code says whether every check passed
+		bool isPassed = false;
+		wstring report = RunHeadlessTests(isPassed);
+		OutputDebugStringW(report.c_str());
+		wofstream reportFile(L"TestReport.txt");
+		reportFile << report;
+		exitCode = reportFile && isPassed ? 0 : -1;
+		return true;
+	}
+	if (commandLine.find(L"-benchmarkhierarchy") != wstring::npos)
+	{
+		// Time updating the world transformations of scene graphs of several sizes
+		wstring report = BenchmarkTransformHierarchy();
+		OutputDebugStringW(report.c_str());
+		wofstream reportFile(L"HierarchyBenchmark.txt");
+		reportFile << report;
+		exitCode = reportFile ? 0 : -1;
+		return true;
+	}
+	if (commandLine.find(L"-benchmarklookup") != wstring::npos)
+	{
+		// Time looking nodes up by name in scenes of several sizes
+		wstring report = BenchmarkNodeLookup();
+		OutputDebugStringW(report.c_str());
+		wofstream reportFile(L"LookupBenchmark.txt");
+		reportFile << report;
+		exitCode = reportFile ? 0 : -1;
+		return true;
+	}
+	if (commandLine.find(L"-benchmarkculling") != wstring::npos)
+	{
+		// Time culling scenes of several sizes against the view frustum
+		wstring report = BenchmarkFrustumCulling();
+		OutputDebugStringW(report.c_str());
+		wofstream reportFile(L"CullingBenchmark.txt");
+		reportFile << report;
+		exitCode = reportFile ? 0 : -1;
+		return true;
+	}
+	if (commandLine.find(L"-benchmarkrasteriser") != wstring::npos)
+	{
+		// Time the software rasteriser with frames of several sizes, with and without the thread pool
+		wstring report = BenchmarkSoftwareRasteriser();
+		OutputDebugStringW(report.c_str());
+		wofstream reportFile(L"RasteriserBenchmark.txt");
+		reportFile << report;
+		exitCode = reportFile ? 0 : -1;
+		return true;
+	}
+	wstring normalBenchmarkArgument = GetCommandLineArgument(commandLine, L"-benchmarknormals");
+	if (!normalBenchmarkArgument.empty())
+	{
+		// Time normal generation for a mesh of the given number of triangles with every thread count
+		size_t triangleCount = wcstoull(normalBenchmarkArgument.c_str(), nullptr, 10);
+		wstring report = BenchmarkNormalGeneration(triangleCount, NormalWeighting::Area) + BenchmarkNormalGeneration(triangleCount, NormalWeighting::Angle);
+		OutputDebugStringW(report.c_str());
+		wofstream reportFile(L"NormalBenchmark.txt");
+		reportFile << report;
+		exitCode = reportFile ? 0 : -1;
+		return true;
+	}
+	wstring simplificationBenchmarkArgument = GetCommandLineArgument(commandLine, L"-benchmarksimplification");
+	if (!simplificationBenchmarkArgument.empty())
+	{
+		// Time building the levels of detail of a mesh of the given number of triangles
+		size_t triangleCount = wcstoull(simplificationBenchmarkArgument.c_str(), nullptr, 10);
+		wstring report = BenchmarkSimplification(triangleCount);
+		OutputDebugStringW(report.c_str());
+		wofstream reportFile(L"SimplificationBenchmark.txt");
+		reportFile << report;
+		exitCode = reportFile ? 0 : -1;
+		return true;
+	}
+	wstring meshletBenchmarkArgument = GetCommandLineArgument(commandLine, L"-benchmarkmeshlets");
+	if (!meshletBenchmarkArgument.empty())
+	{
+		// Time splitting a mesh of the given number of triangles into meshlets and culling them
+		size_t triangleCount = wcstoull(meshletBenchmarkArgument.c_str(), nullptr, 10);
+		wstring report = BenchmarkMeshletCulling(triangleCount);
+		OutputDebugStringW(report.c_str());
+		wofstream reportFile(L"MeshletBenchmark.txt");
+		reportFile << report;
+		exitCode = reportFile ? 0 : -1;
+		return true;
+	}
+	wstring replayFileName = GetCommandLineArgument(commandLine, L"-replay");
+	if (replayFileName.empty())
+	{
+		return false;
+	}
+
+	// Replaying does not need a window or a GPU
+	NullRenderDevice renderDevice;
+	renderDevice.GetNullContext().SetRecordingEnabled(false);
+	TraceReplayer traceReplayer;
+	if (!traceReplayer.Replay(replayFileName, &renderDevice))
+	{
+		OutputDebugStringW((L"Unable to replay " + replayFileName + L"\n").c_str());
+		exitCode = -1;
+		return true;
+	}
+	wstring report = traceReplayer.GetReport();
+	OutputDebugStringW(report.c_str());
+	wofstream reportFile(replayFileName + L".txt");
+	reportFile << report;
+	exitCode = reportFile ? 0 : -1;
+	return true;
+}
+
 bool DirectXFramework::Initialise()
 {
 	// The call to CoInitializeEx is needed if we are using
 	// textures since the WIC library used requires it, so we
-	// take care of initialising it here
+	// take care of initialising it here. The software device
+	// decodes textures with WIC as well
 	if FAILED(CoInitializeEx(nullptr, COINIT_APARTMENTTHREADED))
 	{
 		return false;
 	}
-	if (!GetDeviceAndSwapChain())
+	if (_renderDevice == nullptr && _isSoftwareRendering)
 	{
-		return false;
+		_softwareDevice = make_shared<SoftwareRenderDevice>(GetWindowWidth(), GetWindowHeight());
+		_renderDevice = _softwareDevice;
+	}
+	if (_renderDevice == nullptr)
+	{
+		if (!GetDeviceAndSwapChain())
+		{
+			return false;
+		}
+		OnResize(WM_EXITSIZEMOVE);
+		_renderDevice = make_shared<D3D11RenderDevice>(_device, _deviceContext);
 	}
-	OnResize(WM_EXITSIZEMOVE);
+	// Capture has to start before the scene creates any resources, so that the trace can be replayed
+	if (!_captureFileName.empty())
+	{
+		_captureDevice = make_shared<CaptureRenderDevice>(_renderDevice);
+		if (!_captureDevice->Open(_captureFileName))
+		{
+			return false;
+		}
+		_renderDevice = _captureDevice;
+	}
+	_resourceCache.Initialise(_renderDevice.get());
+	_resourceCache.SetStatisticsReportingEnabled(_isStatisticsReportingEnabled);
 
 	// Create camera and projection matrices 
 	_projectionTransformation = XMMatrixPerspectiveFovLH(_camera.GetFOV(), static_cast<float>(GetWindowWidth()) / GetWindowHeight(), 1.0f, _camera.GetRenderDistance());
-	_sceneGraph = make_shared<SceneGraph>();
+	_sceneGraph = MakeNode<SceneGraph>();
+	// Large scene graphs are updated in parallel. Small ones stay on this thread
+	_threadPool = make_unique<ThreadPool>();
+	_sceneGraph->SetThreadPool(_threadPool.get());
+	// The draws of the frame are recorded into command lists on the same pool
+	_renderQueue.SetThreadPool(_threadPool.get());
+	// The software device rasterises its tiles on the same pool
+	if (_softwareDevice != nullptr)
+	{
+		_softwareDevice->SetThreadPool(_threadPool.get());
+	}
+
+	// Time the creation of the scene, which includes compiling (or loading) the shaders
+	LARGE_INTEGER counterFrequency;
+	LARGE_INTEGER startTime;
+	LARGE_INTEGER endTime;
+	QueryPerformanceFrequency(&counterFrequency);
+	QueryPerformanceCounter(&startTime);
 	CreateSceneGraph();
-	return _sceneGraph->Initialise();
+	bool isInitialised = _sceneGraph->Initialise();
+	QueryPerformanceCounter(&endTime);
+
+	// Keep any shaders that were compiled for the next run and report whether they were all found in the cache
+	_resourceCache.GetShaderCache().Save();
+	const ShaderCacheStatistics& shaderCacheStatistics = _resourceCache.GetShaderCache().GetStatistics();
+	if (_isStatisticsReportingEnabled)
+	{
+		double startupTime = static_cast<double>(endTime.QuadPart - startTime.QuadPart) * 1000.0 / counterFrequency.QuadPart;
+		wstring startupReport = L"Scene initialised in " + to_wstring(startupTime) + L" ms (" +
+			to_wstring(_resourceCache.GetEmbeddedShaderCount()) + L" embedded shaders, " +
+			(shaderCacheStatistics.MissCount == 0 ? L"warm" : L"cold") + L" shader cache: " +
+			to_wstring(shaderCacheStatistics.HitCount) + L" hits, " + to_wstring(shaderCacheStatistics.MissCount) + L" misses)\n";
+		OutputDebugStringW(startupReport.c_str());
+	}
+	return isInitialised;
+}
+
+void DirectXFramework::ReportStatistics()
+{
+	// Report how many of the state binding calls were redundant over the whole run
+	const DeviceStateStatistics& stateStatistics = _renderQueue.GetStateFilter().GetTotalStatistics();
+	wstring stateReport = L"Device state filter: " + to_wstring(stateStatistics.FilteredCallCount) + L" of " +
+		to_wstring(stateStatistics.IssuedCallCount + stateStatistics.FilteredCallCount) + L" calls eliminated (" +
+		to_wstring(_renderQueue.GetStateFilter().GetFilteredPercentage()) + L"%) over " + to_wstring(stateStatistics.DrawCount) + L" draws\n";
+	OutputDebugStringW(stateReport.c_str());
+
+	// The meshlets culled in the last frame, which is the only frame when rendering to a file
+	const MeshletCullingStatistics& meshletStatistics = _renderQueue.GetMeshletStatistics();
+	if (meshletStatistics.TriangleCount > 0)
+	{
+		wstring meshletReport = L"Meshlet culling: " + to_wstring(meshletStatistics.FrustumCulledTriangleCount + meshletStatistics.BackFaceCulledTriangleCount) + L" of " +
+			to_wstring(meshletStatistics.TriangleCount) + L" triangles culled (" + to_wstring(100.0 * (meshletStatistics.FrustumCulledTriangleCount + meshletStatistics.BackFaceCulledTriangleCount) / meshletStatistics.TriangleCount) +
+			L"%), " + to_wstring(meshletStatistics.FrustumCulledTriangleCount) + L" outside the frustum and " + to_wstring(meshletStatistics.BackFaceCulledTriangleCount) +
+			L" facing away, in " + to_wstring(meshletStatistics.FrustumCulledMeshletCount + meshletStatistics.BackFaceCulledMeshletCount) + L" of " + to_wstring(meshletStatistics.MeshletCount) +
+			L" meshlets. The rest were drawn in " + to_wstring(meshletStatistics.RangeCount) + L" ranges\n";
+		OutputDebugStringW(meshletReport.c_str());
+	}
+
+	if (_softwareDevice != nullptr)
+	{
+		// The statistics of the last frame, which is the only frame when rendering to a file
+		const SoftwareRasteriserStatistics& rasteriserStatistics = _softwareDevice->GetRasteriser().GetStatistics();
+		wstring softwareReport = L"Software rasteriser: " + to_wstring(rasteriserStatistics.TriangleCount) + L" triangles in " +
+			to_wstring(rasteriserStatistics.DrawCount) + L" draws, " + to_wstring(rasteriserStatistics.SetupTriangleCount) + L" set up, " +
+			to_wstring(rasteriserStatistics.BinnedTriangleCount) + L" binned, " + to_wstring(rasteriserStatistics.DepthCulledBlockCount) + L" blocks depth culled, " +
+			to_wstring(rasteriserStatistics.ShadedPixelCount) + L" pixels shaded, geometry " + to_wstring(rasteriserStatistics.GeometryTime) + L" ms, rasterisation " +
+			to_wstring(rasteriserStatistics.RasterisationTime) + L" ms\n";
+		OutputDebugStringW(softwareReport.c_str());
+	}
 }
 
 void DirectXFramework::Shutdown()
 {
+	if (_captureDevice != nullptr)
+	{
+		_captureDevice->Close();
+		wstring captureReport = L"Captured " + to_wstring(_captureDevice->GetCapturedFrameCount()) + L" frames (" +
+			to_wstring(_captureDevice->GetCapturedByteCount()) + L" bytes) to " + _captureFileName + L"\n";
+		OutputDebugStringW(captureReport.c_str());
+	}
+	if (_isStatisticsReportingEnabled)
+	{
+		ReportStatistics();
+	}
+
+	if (_sceneGraph != nullptr)
+	{
+		_sceneGraph->Shutdown();
+	}
 	// Required because we called CoInitialize above
-	_sceneGraph->Shutdown();
 	CoUninitialize();
 }
 
@@ -228,17 +510,65 @@ void DirectXFramework::Update()
 
 void DirectXFramework::Render()
 {
-	// Clear the render target and the depth stencil view
-	_deviceContext->ClearRenderTargetView(_renderTargetView.Get(), _backgroundColour);
-	_deviceContext->ClearDepthStencilView(_depthStencilView.Get(), D3D11_CLEAR_DEPTH | D3D11_CLEAR_STENCIL, 1.0f, 0);
+	// Clear the render target and the depth stencil view. There are none when rendering headless
+	if (_swapChain != nullptr)
+	{
+		_deviceContext->ClearRenderTargetView(_renderTargetView.Get(), _backgroundColour);
+		_deviceContext->ClearDepthStencilView(_depthStencilView.Get(), D3D11_CLEAR_DEPTH | D3D11_CLEAR_STENCIL, 1.0f, 0);
+	}
+	else if (_softwareDevice != nullptr)
+	{
+		_softwareDevice->Clear(_backgroundColour, 1.0f);
+	}
 	// Camera
 	_viewTransformation = XMMatrixLookAtLH(_camera.GetEyePosition(), _camera.GetFocalPointPosition(), _camera.GetUpVector());
 	_projectionTransformation = XMMatrixPerspectiveFovLH(_camera.GetFOV(), static_cast<float>(GetWindowWidth()) / GetWindowHeight(), 1.0f, _camera.GetRenderDistance());
 
-	// Now recurse through the scene graph, rendering each object
-	_sceneGraph->Render();
+	// Cull the scene graph against the view frustum and extract a draw packet for each
+	// visible object. The packets are then sorted and submitted in a single pass
+	BoundingFrustum viewFrustum(_projectionTransformation);
+	BoundingFrustum worldFrustum;
+	viewFrustum.Transform(worldFrustum, _viewTransformation.Invert());
+	_renderQueue.Begin(_viewTransformation * _projectionTransformation, _camera.GetEyePosition(), _camera.GetRenderDistance());
+	_sceneGraph->Cull(worldFrustum);
+	_sceneGraph->Extract(_renderQueue);
+	_renderQueue.Sort();
+	_renderQueue.Submit(_renderDevice.get());
+	if (_captureDevice != nullptr)
+	{
+		_captureDevice->EndFrame();
+	}
 	// Now display the scene
-	ThrowIfFailed(_swapChain->Present(0, 0));
+	if (_swapChain != nullptr)
+	{
+		ThrowIfFailed(_swapChain->Present(0, 0));
+	}
+	else if (_softwareDevice != nullptr)
+	{
+		_softwareDevice->EndFrame();
+		PresentSoftwareFrame();
+	}
+}
+
+void DirectXFramework::PresentSoftwareFrame()
+{
+	// There is no window when rendering to a file
+	if (GetHWnd() == nullptr)
+	{
+		return;
+	}
+	const SoftwareRasteriser& rasteriser = _softwareDevice->GetRasteriser();
+	// A negative height describes rows stored top first
+	BITMAPINFO bitmapInfo = { 0 };
+	bitmapInfo.bmiHeader.biSize = sizeof(bitmapInfo.bmiHeader);
+	bitmapInfo.bmiHeader.biWidth = static_cast<LONG>(rasteriser.GetWidth());
+	bitmapInfo.bmiHeader.biHeight = -static_cast<LONG>(rasteriser.GetHeight());
+	bitmapInfo.bmiHeader.biPlanes = 1;
+	bitmapInfo.bmiHeader.biBitCount = 32;
+	bitmapInfo.bmiHeader.biCompression = BI_RGB;
+	HDC deviceContext = GetDC(GetHWnd());
+	SetDIBitsToDevice(deviceContext, 0, 0, rasteriser.GetWidth(), rasteriser.GetHeight(), 0, 0, 0, rasteriser.GetHeight(), rasteriser.GetColourBuffer(), &bitmapInfo, DIB_RGB_COLORS);
+	ReleaseDC(GetHWnd(), deviceContext);
 }
 
 void DirectXFramework::OnResize(WPARAM wParam)
@@ -256,6 +586,16 @@ void DirectXFramework::OnResize(WPARAM wParam)
 	_viewTransformation = XMMatrixLookAtLH(_camera.GetEyePosition(), _camera.GetFocalPointPosition(), _camera.GetUpVector());
 	_projectionTransformation = XMMatrixPerspectiveFovLH(_camera.GetFOV(), static_cast<float>(GetWindowWidth()) / GetWindowHeight(), 1.0f, _camera.GetRenderDistance());
 
+	// The software device draws into memory of its own, and there is nothing to resize when rendering headless
+	if (_softwareDevice != nullptr)
+	{
+		_softwareDevice->Resize(GetWindowWidth(), GetWindowHeight());
+		return;
+	}
+	if (_swapChain == nullptr)
+	{
+		return;
+	}
 
 	// This will free any existing render and depth views (which
 	// would be the case if the window was being resized)
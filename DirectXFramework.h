@@ -4,6 +4,12 @@
 #include "Framework.h"
 #include "DirectXCore.h"
 #include "SceneGraph.h"
+#include "ThreadPool.h"
+#include "RenderQueue.h"
+#include "ResourceCache.h"
+#include "RenderDevice.h"
+#include "CaptureRenderDevice.h"
+#include "SoftwareRenderDevice.h"
 #include "Camera.h"
 
 class DirectXFramework : public Framework
@@ -15,6 +21,24 @@ public:
 	virtual void CreateSceneGraph();
 	virtual void UpdateSceneGraph();
 
+	// -capture <file> streams a trace of every call made on the render device to the file.
+	// -replay <file> replays a trace on the null device, writes a report next to it and exits.
+	// -software draws with the software device instead of Direct3D 11 and -render <file> draws a
+	// single frame with it, saves it as a bitmap and exits, without opening a window.
+	// -statistics writes the statistics of the geometry as it is created and of the whole run when
+	// it shuts down to the debugger output, which debug builds always do.
+	// -test runs the headless checks of the renderer on the null device, writes the report to
+	// TestReport.txt and exits, with an exit code of zero only if every check passed.
+	// -benchmarkhierarchy times updating the transformations of scene graphs by recursion and through
+	// the flattened hierarchy, writes the report to HierarchyBenchmark.txt and exits. -benchmarklookup
+	// does the same for looking nodes up by name, writing LookupBenchmark.txt, and -benchmarkculling for
+	// culling boxes against the view frustum, writing CullingBenchmark.txt. -benchmarkrasteriser times
+	// the software rasteriser without a thread pool and with pools of several sizes, writing
+	// RasteriserBenchmark.txt.
+	// -benchmarksimplification <triangles> times building the levels of detail of a mesh of that
+	// size, writes the report to SimplificationBenchmark.txt and exits. -benchmarkmeshlets <triangles>
+	// does the same for splitting a mesh into meshlets and culling them, writing MeshletBenchmark.txt
+	bool ProcessCommandLine(const wstring& commandLine, int& exitCode);
 	bool Initialise();
 	void Update();
 	void Render();
@@ -24,12 +48,23 @@ public:
 	static DirectXFramework *			GetDXFramework();
 
 	inline SceneGraphPointer			GetSceneGraph() { return _sceneGraph; }
-	inline ComPtr<ID3D11Device>			GetDevice() { return _device; }
-	inline ComPtr<ID3D11DeviceContext>	GetDeviceContext() { return _deviceContext; }
+	inline IRenderDevice *				GetRenderDevice() { return _renderDevice.get(); }
+	// A render device set before Initialise is used instead of creating a Direct3D 11 device and
+	// swap chain for the window. The null device lets the scene be updated and submitted headless
+	inline void							SetRenderDevice(shared_ptr<IRenderDevice> renderDevice) { _renderDevice = renderDevice; }
+	inline ThreadPool *					GetThreadPool() { return _threadPool.get(); }
+	inline const RenderQueue&			GetRenderQueue() const { return _renderQueue; }
+	inline ResourceCache&				GetResourceCache() { return _resourceCache; }
 
 	const Matrix&						GetViewTransformation() const;
 	const Matrix&						GetProjectionTransformation() const;
 
+	// The largest error, in the units of a mesh, that the mesh can be drawn with at the given world transformation without
+	// its surface moving by more than the level of detail pixel error on the screen. Distances are measured to the nearest
+	// point of the bounding sphere of the mesh
+	float								GetErrorTolerance(const Matrix& worldTransformation, const BoundingBox& bounds);
+	inline void							SetLevelOfDetailPixelError(float levelOfDetailPixelError) { _levelOfDetailPixelError = levelOfDetailPixelError; }
+
 	void								SetBackgroundColour(Vector4 backgroundColour);
 
 	//Vector3							GetEyePosition() const { return _eyePosition; };
@@ -47,6 +82,19 @@ private:
 	ComPtr<ID3D11Texture2D>				_depthStencilBuffer;
 	ComPtr<ID3D11RenderTargetView>		_renderTargetView;
 	ComPtr<ID3D11DepthStencilView>		_depthStencilView;
+	shared_ptr<IRenderDevice>			_renderDevice;
+	// Set when the calls are being captured, in which case it is also the render device
+	shared_ptr<CaptureRenderDevice>		_captureDevice;
+	wstring								_captureFileName;
+	// Set when drawing on the CPU, in which case it is also the render device (or the device being captured)
+	shared_ptr<SoftwareRenderDevice>	_softwareDevice;
+	bool								_isSoftwareRendering{ false };
+	// Statistics of the resources and of the whole run are written to the debugger output in debug builds, or with -statistics
+#if defined( _DEBUG )
+	bool								_isStatisticsReportingEnabled{ true };
+#else
+	bool								_isStatisticsReportingEnabled{ false };
+#endif
 
 	D3D11_VIEWPORT						_screenViewport{ 0 };
 	/*
@@ -56,8 +104,12 @@ private:
 	*/
 	Matrix								_viewTransformation;
 	Matrix								_projectionTransformation;
+	float								_levelOfDetailPixelError{ 1.0f };
 
 	SceneGraphPointer					_sceneGraph;
+	unique_ptr<ThreadPool>				_threadPool;
+	RenderQueue							_renderQueue;
+	ResourceCache						_resourceCache;
 
 	float							    _backgroundColour[4];
 
@@ -80,5 +132,8 @@ private:
 
 
 	bool GetDeviceAndSwapChain();
+	void PresentSoftwareFrame();
+	// Write the statistics of the whole run to the debugger output
+	void ReportStatistics();
 };
 
@@ -0,0 +1,89 @@
+#pragma once
+#include <immintrin.h>
+
+// Eight floats that are operated on together, used by the software rasteriser to test
+// and shade a row of eight pixels at a time. With AVX enabled each value is a single
+// register. Otherwise it is made up of two SSE registers, which every x64 processor has.
+//
+// Comparisons return masks, in which every bit of a lane that passed the test is set.
+
+#if defined(__AVX__)
+
+struct Float8
+{
+	__m256		Value;
+
+	Float8() {}
+	Float8(__m256 value) : Value(value) {}
+	Float8(float value) : Value(_mm256_set1_ps(value)) {}
+
+	static Float8 Load(const float* values) { return _mm256_loadu_ps(values); }
+	void Store(float* values) const { _mm256_storeu_ps(values, Value); }
+	// 0, 1, 2 ... 7
+	static Float8 Ramp() { return _mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f); }
+
+	friend Float8 operator+(Float8 a, Float8 b) { return _mm256_add_ps(a.Value, b.Value); }
+	friend Float8 operator-(Float8 a, Float8 b) { return _mm256_sub_ps(a.Value, b.Value); }
+	friend Float8 operator*(Float8 a, Float8 b) { return _mm256_mul_ps(a.Value, b.Value); }
+	friend Float8 operator/(Float8 a, Float8 b) { return _mm256_div_ps(a.Value, b.Value); }
+	friend Float8 operator&(Float8 a, Float8 b) { return _mm256_and_ps(a.Value, b.Value); }
+	friend Float8 operator|(Float8 a, Float8 b) { return _mm256_or_ps(a.Value, b.Value); }
+
+	friend Float8 operator<(Float8 a, Float8 b) { return _mm256_cmp_ps(a.Value, b.Value, _CMP_LT_OQ); }
+	friend Float8 operator<=(Float8 a, Float8 b) { return _mm256_cmp_ps(a.Value, b.Value, _CMP_LE_OQ); }
+	friend Float8 operator>(Float8 a, Float8 b) { return _mm256_cmp_ps(a.Value, b.Value, _CMP_GT_OQ); }
+	friend Float8 operator>=(Float8 a, Float8 b) { return _mm256_cmp_ps(a.Value, b.Value, _CMP_GE_OQ); }
+
+	friend Float8 Min(Float8 a, Float8 b) { return _mm256_min_ps(a.Value, b.Value); }
+	friend Float8 Max(Float8 a, Float8 b) { return _mm256_max_ps(a.Value, b.Value); }
+	friend Float8 Sqrt(Float8 a) { return _mm256_sqrt_ps(a.Value); }
+	// Lanes of a where the mask is set, otherwise lanes of b
+	friend Float8 Select(Float8 mask, Float8 a, Float8 b) { return _mm256_blendv_ps(b.Value, a.Value, mask.Value); }
+	// A bit for every lane of a mask, lane 0 in the lowest bit
+	friend int MoveMask(Float8 mask) { return _mm256_movemask_ps(mask.Value); }
+};
+
+#else
+
+struct Float8
+{
+	__m128		Low;
+	__m128		High;
+
+	Float8() {}
+	Float8(__m128 low, __m128 high) : Low(low), High(high) {}
+	Float8(float value) : Low(_mm_set1_ps(value)), High(_mm_set1_ps(value)) {}
+
+	static Float8 Load(const float* values) { return Float8(_mm_loadu_ps(values), _mm_loadu_ps(values + 4)); }
+	void Store(float* values) const { _mm_storeu_ps(values, Low); _mm_storeu_ps(values + 4, High); }
+	// 0, 1, 2 ... 7
+	static Float8 Ramp() { return Float8(_mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f), _mm_setr_ps(4.0f, 5.0f, 6.0f, 7.0f)); }
+
+	friend Float8 operator+(Float8 a, Float8 b) { return Float8(_mm_add_ps(a.Low, b.Low), _mm_add_ps(a.High, b.High)); }
+	friend Float8 operator-(Float8 a, Float8 b) { return Float8(_mm_sub_ps(a.Low, b.Low), _mm_sub_ps(a.High, b.High)); }
+	friend Float8 operator*(Float8 a, Float8 b) { return Float8(_mm_mul_ps(a.Low, b.Low), _mm_mul_ps(a.High, b.High)); }
+	friend Float8 operator/(Float8 a, Float8 b) { return Float8(_mm_div_ps(a.Low, b.Low), _mm_div_ps(a.High, b.High)); }
+	friend Float8 operator&(Float8 a, Float8 b) { return Float8(_mm_and_ps(a.Low, b.Low), _mm_and_ps(a.High, b.High)); }
+	friend Float8 operator|(Float8 a, Float8 b) { return Float8(_mm_or_ps(a.Low, b.Low), _mm_or_ps(a.High, b.High)); }
+
+	friend Float8 operator<(Float8 a, Float8 b) { return Float8(_mm_cmplt_ps(a.Low, b.Low), _mm_cmplt_ps(a.High, b.High)); }
+	friend Float8 operator<=(Float8 a, Float8 b) { return Float8(_mm_cmple_ps(a.Low, b.Low), _mm_cmple_ps(a.High, b.High)); }
+	friend Float8 operator>(Float8 a, Float8 b) { return Float8(_mm_cmpgt_ps(a.Low, b.Low), _mm_cmpgt_ps(a.High, b.High)); }
+	friend Float8 operator>=(Float8 a, Float8 b) { return Float8(_mm_cmpge_ps(a.Low, b.Low), _mm_cmpge_ps(a.High, b.High)); }
+
+	friend Float8 Min(Float8 a, Float8 b) { return Float8(_mm_min_ps(a.Low, b.Low), _mm_min_ps(a.High, b.High)); }
+	friend Float8 Max(Float8 a, Float8 b) { return Float8(_mm_max_ps(a.Low, b.Low), _mm_max_ps(a.High, b.High)); }
+	friend Float8 Sqrt(Float8 a) { return Float8(_mm_sqrt_ps(a.Low), _mm_sqrt_ps(a.High)); }
+	// Lanes of a where the mask is set, otherwise lanes of b
+	friend Float8 Select(Float8 mask, Float8 a, Float8 b)
+	{
+		return Float8(_mm_or_ps(_mm_and_ps(mask.Low, a.Low), _mm_andnot_ps(mask.Low, b.Low)),
+					  _mm_or_ps(_mm_and_ps(mask.High, a.High), _mm_andnot_ps(mask.High, b.High)));
+	}
+	// A bit for every lane of a mask, lane 0 in the lowest bit
+	friend int MoveMask(Float8 mask) { return _mm_movemask_ps(mask.Low) | (_mm_movemask_ps(mask.High) << 4); }
+};
+
+#endif
+
+inline Float8 Saturate(Float8 a) { return Min(Max(a, Float8(0.0f)), Float8(1.0f)); }
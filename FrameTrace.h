@@ -0,0 +1,62 @@
+#pragma once
+#include "core.h"
+#include "DirectXCore.h"
+#include "CommandList.h"
+
+// The layout of a frame trace file. A trace starts with a file header and is followed
+// by records, each made up of a record header and the number of bytes of payload given
+// in the header:
+//
+//  CreateObject	a TraceObjectCreation. Buffers are followed by their description and
+//					any initial data
+//  Command			a context call as a Command, whose object is the handle of the object
+//					it was called with. Buffer updates are followed by the uploaded data
+//  EndFrame		no payload
+//
+// Objects are identified by handles, which are the addresses the objects had during the
+// capture. Commands are stored as they are in memory, so a trace can only be replayed by
+// a build for the same architecture, which the command size in the header checks.
+
+#define FrameTraceMagic		0x43415254
+#define FrameTraceVersion	1
+
+enum class TraceRecordType : UINT32
+{
+	CreateObject,
+	Command,
+	EndFrame
+};
+
+enum class TraceObjectType : UINT32
+{
+	Buffer,
+	VertexShader,
+	PixelShader,
+	InputLayout,
+	RasteriserState,
+	BlendState,
+	DepthStencilState,
+	SamplerState,
+	Texture
+};
+
+struct FrameTraceHeader
+{
+	UINT32			Magic{ FrameTraceMagic };
+	UINT32			Version{ FrameTraceVersion };
+	UINT32			CommandSize{ sizeof(Command) };
+	UINT32			Reserved{ 0 };
+};
+
+struct TraceRecordHeader
+{
+	TraceRecordType	Type;
+	UINT32			Size;
+};
+
+struct TraceObjectCreation
+{
+	UINT64			Handle;
+	TraceObjectType	ObjectType;
+	UINT32			Reserved;
+};
@@ -20,12 +20,16 @@ int APIENTRY wWinMain(_In_	   HINSTANCE hInstance,
 					  _In_	   int       nCmdShow)
 {
 	UNREFERENCED_PARAMETER(hPrevInstance);
-	UNREFERENCED_PARAMETER(lpCmdLine);
 
 	// We can only run if an instance of a class that inherits from Framework
 	// has been created
 	if (_thisFramework)
 	{
+		int exitCode = 0;
+		if (_thisFramework->ProcessCommandLine(lpCmdLine, exitCode))
+		{
+			return exitCode;
+		}
 		return _thisFramework->Run(hInstance, nCmdShow);
 	}
 	return -1;
@@ -12,6 +12,10 @@ public:
 
 	int Run(HINSTANCE hInstance, int nCmdShow);
 
+	// Handle the command line before the window is created. Return true if everything the
+	// command line asked for has been done and the application should exit with exitCode
+	virtual bool ProcessCommandLine(const wstring& commandLine, int& exitCode) { return false; }
+
 	LRESULT MsgProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam);
 
 	inline unsigned int GetWindowWidth() { return _width; }
@@ -0,0 +1,847 @@
+#include <vector>
+#include <algorithm>
+#include <random>
+#include <fstream>
+#include "HeadlessTests.h"
+#include "NullRenderDevice.h"
+#include "ConstantBufferRing.h"
+#include "DeviceStateFilter.h"
+#include "ThreadPool.h"
+#include "RenderQueue.h"
+#include "ShaderCache.h"
+#include "ShaderPermutations.h"
+
+// The results of the checks made so far
+
+class TestReport
+{
+public:
+	void BeginSection(const wstring& name)
+	{
+		_text += (_text.empty() ? L"" : L"\n") + name + L"\n";
+	}
+
+	bool Check(bool isPassed, const wstring& description)
+	{
+		_text += (isPassed ? L"Passed: " : L"FAILED: ") + description + L"\n";
+		_checkCount++;
+		_failureCount += isPassed ? 0 : 1;
+		return isPassed;
+	}
+
+	const wstring& GetText() const { return _text; }
+	size_t GetCheckCount() const { return _checkCount; }
+	size_t GetFailureCount() const { return _failureCount; }
+
+private:
+	wstring		_text;
+	size_t		_checkCount{ 0 };
+	size_t		_failureCount{ 0 };
+};
+
+// Placeholder objects on the null device for the packets of the tests: two pipeline states, each
+// with its own shaders and an instanced version, and two textures, geometries and materials
+
+struct TestResources
+{
+	NullRenderDevice					Device;
+	PipelineState						Pipelines[2];
+	PipelineState						InstancedPipelines[2];
+	ComPtr<ID3D11VertexShader>			VertexShaders[4];
+	ComPtr<ID3D11PixelShader>			PixelShaders[2];
+	ComPtr<ID3D11ShaderResourceView>	Textures[2];
+	ComPtr<ID3D11Buffer>				VertexBuffers[2];
+	ComPtr<ID3D11Buffer>				IndexBuffers[2];
+	MaterialResource					Materials[2];
+
+	TestResources(bool isConstantBufferOffsettingSupported = true) : Device(isConstantBufferOffsettingSupported)
+	{
+		for (UINT i = 0; i < 2; i++)
+		{
+			ThrowIfFailed(Device.CreateVertexShader(nullptr, 0, VertexShaders[i * 2].GetAddressOf()));
+			ThrowIfFailed(Device.CreateVertexShader(nullptr, 0, VertexShaders[i * 2 + 1].GetAddressOf()));
+			ThrowIfFailed(Device.CreatePixelShader(nullptr, 0, PixelShaders[i].GetAddressOf()));
+			Pipelines[i].Id = i * 2 + 1;
+			Pipelines[i].VertexShader = VertexShaders[i * 2].Get();
+			Pipelines[i].PixelShader = PixelShaders[i].Get();
+			InstancedPipelines[i] = Pipelines[i];
+			InstancedPipelines[i].Id = i * 2 + 2;
+			InstancedPipelines[i].VertexShader = VertexShaders[i * 2 + 1].Get();
+
+			ThrowIfFailed(Device.CreateTextureFromFile(L"", Textures[i].GetAddressOf()));
+
+			D3D11_BUFFER_DESC bufferDesc = { 0 };
+			bufferDesc.Usage = D3D11_USAGE_IMMUTABLE;
+			bufferDesc.ByteWidth = 1024;
+			bufferDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+			ThrowIfFailed(Device.CreateBuffer(&bufferDesc, nullptr, VertexBuffers[i].GetAddressOf()));
+			bufferDesc.BindFlags = D3D11_BIND_INDEX_BUFFER;
+			ThrowIfFailed(Device.CreateBuffer(&bufferDesc, nullptr, IndexBuffers[i].GetAddressOf()));
+
+			// The materials differ in their lighting, so packets with different materials cannot be instanced together
+			bufferDesc.ByteWidth = sizeof(MaterialConstants);
+			bufferDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+			ThrowIfFailed(Device.CreateBuffer(&bufferDesc, nullptr, Materials[i].Buffer.GetAddressOf()));
+			Materials[i].Constants.AmbientLightColour = Vector4(0.25f, 0.25f, 0.25f, 1.0f);
+			Materials[i].Constants.DirectionalLightColour = Vector4(1.0f, 1.0f, 1.0f, 1.0f) * (i + 1.0f) * 0.5f;
+			Materials[i].Constants.DirectionalLightVector = Vector4(0.0f, -1.0f, 1.0f, 0.0f);
+		}
+	}
+
+	DrawPacket CreatePacket(UINT pipeline, UINT texture, UINT geometry) const
+	{
+		DrawPacket packet;
+		packet.Pipeline = &Pipelines[pipeline];
+		packet.InstancedPipeline = &InstancedPipelines[pipeline];
+		packet.Texture = Textures[texture].Get();
+		packet.VertexBuffer = VertexBuffers[geometry].Get();
+		packet.IndexBuffer = IndexBuffers[geometry].Get();
+		packet.Material = &Materials[0];
+		packet.VertexStride = 32;
+		packet.IndexCount = 36;
+		return packet;
+	}
+};
+
+// The number of times the given part of the state changes from one packet to the next, including the first
+template<typename T>
+static size_t CountChanges(const vector<DrawPacket>& packets, T DrawPacket::* state)
+{
+	size_t changeCount = 0;
+	for (size_t i = 0; i < packets.size(); i++)
+	{
+		changeCount += i == 0 || packets[i].*state != packets[i - 1].*state;
+	}
+	return changeCount;
+}
+
+static bool IsSameState(const DrawPacket& first, const DrawPacket& second)
+{
+	return first.Pipeline == second.Pipeline && first.Texture == second.Texture && first.VertexBuffer == second.VertexBuffer;
+}
+
+static void TestRenderQueueOrder(TestReport& report)
+{
+	report.BeginSection(L"Render queue order");
+	TestResources resources;
+	RenderQueue renderQueue;
+	renderQueue.SetInstancingEnabled(false);
+	renderQueue.Begin(Matrix::Identity, Vector3::Zero, 100.0f);
+
+	// Every packet is added with different state from the one before it, with the furthest
+	// first. The start index of each packet identifies it, so that its depth can be found
+	// once the queue has been sorted
+	vector<DrawPacket> packets;
+	vector<float> depths;
+	auto addPacket = [&](DrawPacket packet, float depth)
+		{
+			packet.StartIndex = static_cast<UINT>(packets.size());
+			renderQueue.Add(packet, ObjectConstants(), Vector3(0.0f, 0.0f, depth));
+			packets.push_back(packet);
+			depths.push_back(depth);
+		};
+	for (float depth : { 35.0f, 25.0f, 15.0f, 5.0f })
+	{
+		for (UINT pipeline = 0; pipeline < 2; pipeline++)
+		{
+			for (UINT texture = 0; texture < 2; texture++)
+			{
+				for (UINT geometry = 0; geometry < 2; geometry++)
+				{
+					addPacket(resources.CreatePacket(pipeline, texture, geometry), depth);
+				}
+			}
+		}
+	}
+	const size_t opaqueCount = packets.size();
+	for (float depth : { 10.0f, 40.0f, 20.0f, 30.0f })
+	{
+		DrawPacket packet = resources.CreatePacket(0, 0, 0);
+		packet.IsTransparent = true;
+		addPacket(packet, depth);
+	}
+	renderQueue.Sort();
+	size_t insertionStateChanges = 0;
+	for (size_t i = 0; i < packets.size(); i++)
+	{
+		insertionStateChanges += i == 0 || !IsSameState(packets[i], packets[i - 1]) || packets[i].IndexBuffer != packets[i - 1].IndexBuffer;
+	}
+
+	// The opaque packets must come first, in runs of the same state that are never broken up, and
+	// nearest first within each run. The transparent packets must follow, furthest first
+	bool isKeyOrdered = true;
+	bool isPassOrdered = true;
+	bool isGrouped = true;
+	bool isFrontToBack = true;
+	bool isBackToFront = true;
+	size_t groupCount = 0;
+	vector<DrawPacket> sortedPackets;
+	for (size_t i = 0; i < renderQueue.GetPacketCount(); i++)
+	{
+		const DrawPacket& packet = renderQueue.GetPacket(i);
+		float depth = depths[packet.StartIndex];
+		isPassOrdered = isPassOrdered && packet.IsTransparent == (i >= opaqueCount);
+		if (i > 0)
+		{
+			const DrawPacket& previous = renderQueue.GetPacket(i - 1);
+			float previousDepth = depths[previous.StartIndex];
+			isKeyOrdered = isKeyOrdered && renderQueue.GetSortKey(i - 1) <= renderQueue.GetSortKey(i);
+			if (packet.IsTransparent)
+			{
+				isBackToFront = isBackToFront && (!previous.IsTransparent || previousDepth >= depth);
+			}
+			else if (IsSameState(previous, packet))
+			{
+				isFrontToBack = isFrontToBack && previousDepth <= depth;
+			}
+		}
+		if (!packet.IsTransparent && (i == 0 || !IsSameState(renderQueue.GetPacket(i - 1), packet)))
+		{
+			// A run of opaque state that has been seen before means a group has been split
+			isGrouped = isGrouped && none_of(sortedPackets.begin(), sortedPackets.end(), [&packet](const DrawPacket& sortedPacket) { return IsSameState(sortedPacket, packet); });
+			groupCount++;
+		}
+		sortedPackets.push_back(packet);
+	}
+	report.Check(renderQueue.GetPacketCount() == packets.size(), L"every packet is in the sorted queue");
+	report.Check(isKeyOrdered, L"the sort keys ascend");
+	report.Check(isPassOrdered, L"the opaque packets come before the transparent packets");
+	report.Check(isGrouped && groupCount == 8, L"the opaque packets are in one run for each of the 8 combinations of pipeline state, material and geometry (" + to_wstring(groupCount) + L" runs)");
+	report.Check(isFrontToBack, L"the opaque packets of each run are nearest first");
+	report.Check(isBackToFront, L"the transparent packets are furthest first");
+
+	// Once sorted, the state changes once for every opaque run and once more for the transparent packets
+	size_t stateChanges = renderQueue.CountStateChanges();
+	report.Check(stateChanges == groupCount + 1 && stateChanges < insertionStateChanges, L"sorting reduces the state changes from " +
+		to_wstring(insertionStateChanges) + L" in the order the packets were added to " + to_wstring(stateChanges));
+
+	// The calls that reach the context must be the ones the sorted order needs
+	renderQueue.Submit(&resources.Device);
+	const NullRenderContext& context = resources.Device.GetNullContext();
+	report.Check(renderQueue.GetStatistics().StateChangeCount == stateChanges, L"the statistics give the state changes of the sorted order");
+	report.Check(context.GetCallCount(CommandType::DrawIndexed) == packets.size() && context.GetCallCount(CommandType::DrawIndexedInstanced) == 0,
+		L"every packet is drawn with a draw call of its own");
+	report.Check(context.GetCallCount(CommandType::SetVertexShader) == CountChanges(sortedPackets, &DrawPacket::Pipeline),
+		L"the vertex shader is set once for every change of pipeline state (" + to_wstring(context.GetCallCount(CommandType::SetVertexShader)) + L" calls)");
+	report.Check(context.GetCallCount(CommandType::SetShaderResource) == CountChanges(sortedPackets, &DrawPacket::Texture),
+		L"the texture is set once for every change of material (" + to_wstring(context.GetCallCount(CommandType::SetShaderResource)) + L" calls)");
+	report.Check(context.GetCallCount(CommandType::SetVertexBuffer) == CountChanges(sortedPackets, &DrawPacket::VertexBuffer),
+		L"the vertex buffer is set once for every change of geometry (" + to_wstring(context.GetCallCount(CommandType::SetVertexBuffer)) + L" calls)");
+}
+
+static void TestRenderQueueIdentifiers(TestReport& report)
+{
+	report.BeginSection(L"Render queue identifiers");
+	TestResources resources;
+	RenderQueue renderQueue;
+	renderQueue.SetInstancingEnabled(false);
+
+	// Textures that are created and destroyed frame after frame use up the material field of the sort key.
+	// The queue only stores the pointers while sorting, so placeholder addresses stand in for the textures
+	const UINT textureCount = 5000;
+	const UINT framePacketCount = 500;
+	uintptr_t nextTexture = 0x10000;
+	for (UINT frame = 0; frame < textureCount / framePacketCount; frame++)
+	{
+		renderQueue.Begin(Matrix::Identity, Vector3::Zero, 100.0f);
+		for (UINT i = 0; i < framePacketCount; i++)
+		{
+			DrawPacket packet = resources.CreatePacket(0, 0, 0);
+			packet.Texture = reinterpret_cast<ID3D11ShaderResourceView*>(nextTexture);
+			nextTexture += 0x100;
+			renderQueue.Add(packet, ObjectConstants(), Vector3(0.0f, 0.0f, 10.0f));
+		}
+		renderQueue.Sort();
+	}
+
+	// Two new textures in turn must still be told apart, so that the packets of each are drawn together
+	renderQueue.Begin(Matrix::Identity, Vector3::Zero, 100.0f);
+	for (UINT i = 0; i < 4; i++)
+	{
+		DrawPacket packet = resources.CreatePacket(0, i % 2, 0);
+		renderQueue.Add(packet, ObjectConstants(), Vector3(0.0f, 0.0f, 10.0f + i * 10.0f));
+	}
+	renderQueue.Sort();
+	report.Check(renderQueue.CountStateChanges() == 2, L"after " + to_wstring(textureCount) + L" textures have come and gone, packets of two new textures are still grouped by texture (" +
+		to_wstring(renderQueue.CountStateChanges()) + L" state changes)");
+}
+
+// Submit the packets as a frame of their own, each a little further away than the one before,
+// and return the context with the calls that reached it
+static const NullRenderContext& SubmitFrame(TestResources& resources, RenderQueue& renderQueue, const vector<DrawPacket>& packets)
+{
+	NullRenderContext& context = resources.Device.GetNullContext();
+	context.Reset();
+	renderQueue.Begin(Matrix::Identity, Vector3::Zero, 100.0f);
+	for (size_t i = 0; i < packets.size(); i++)
+	{
+		renderQueue.Add(packets[i], ObjectConstants(), Vector3(0.0f, 0.0f, 10.0f + i));
+	}
+	renderQueue.Sort();
+	renderQueue.Submit(&resources.Device);
+	return context;
+}
+
+// The number of instances the context was asked to draw by instanced draws
+static size_t CountDrawnInstances(const NullRenderContext& context)
+{
+	size_t instanceCount = 0;
+	const CommandList& commandList = context.GetCommandList();
+	for (size_t i = 0; i < commandList.GetCommandCount(); i++)
+	{
+		if (commandList.GetCommand(i).Type == CommandType::DrawIndexedInstanced)
+		{
+			instanceCount += commandList.GetCommand(i).Arguments[1];
+		}
+	}
+	return instanceCount;
+}
+
+// Whether the context was asked to set the given object
+static bool IsObjectSet(const NullRenderContext& context, CommandType type, const void* object)
+{
+	const CommandList& commandList = context.GetCommandList();
+	for (size_t i = 0; i < commandList.GetCommandCount(); i++)
+	{
+		if (commandList.GetCommand(i).Type == type && commandList.GetCommand(i).Object == object)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+static void TestRenderQueueInstancing(TestReport& report)
+{
+	report.BeginSection(L"Render queue instancing");
+	TestResources resources;
+	RenderQueue renderQueue;
+	const size_t packetCount = 16;
+
+	// Packets that share all of their state collapse into a single instanced draw with the instanced pipeline
+	vector<DrawPacket> packets(packetCount, resources.CreatePacket(0, 0, 0));
+	const NullRenderContext& context = SubmitFrame(resources, renderQueue, packets);
+	report.Check(context.GetCallCount(CommandType::DrawIndexedInstanced) == 1 && context.GetCallCount(CommandType::DrawIndexed) == 0 && CountDrawnInstances(context) == packetCount,
+		to_wstring(packetCount) + L" identical packets are drawn with one instanced draw of " + to_wstring(CountDrawnInstances(context)) + L" instances");
+	report.Check(renderQueue.GetStatistics().InstancedDrawCount == 1 && renderQueue.GetStatistics().InstanceCount == packetCount, L"the statistics count the instanced draw and its instances");
+	report.Check(context.GetCallCount(CommandType::SetVertexShader) == 1 && IsObjectSet(context, CommandType::SetVertexShader, resources.InstancedPipelines[0].VertexShader),
+		L"the instanced draw uses the instanced vertex shader");
+
+	// The colour of each instance is taken from the instance buffer, so materials that differ only in their ambient colour can share a draw
+	MaterialResource tintedMaterial = resources.Materials[0];
+	tintedMaterial.Constants.AmbientLightColour = Vector4(1.0f, 0.0f, 0.0f, 1.0f);
+	for (size_t i = 0; i < packetCount; i += 2)
+	{
+		packets[i].Material = &tintedMaterial;
+	}
+	SubmitFrame(resources, renderQueue, packets);
+	report.Check(context.GetCallCount(CommandType::DrawIndexedInstanced) == 1 && context.GetCallCount(CommandType::DrawIndexed) == 0 && CountDrawnInstances(context) == packetCount,
+		L"packets whose materials differ only in their ambient colour are still drawn with one instanced draw");
+
+	// Sorting brings the packets of each geometry together, so two geometries need two instanced draws
+	for (size_t i = 0; i < packetCount; i++)
+	{
+		packets[i] = resources.CreatePacket(0, 0, static_cast<UINT>(i % 2));
+	}
+	SubmitFrame(resources, renderQueue, packets);
+	report.Check(context.GetCallCount(CommandType::DrawIndexedInstanced) == 2 && context.GetCallCount(CommandType::DrawIndexed) == 0 && CountDrawnInstances(context) == packetCount,
+		L"packets of two geometries added in turn are drawn with two instanced draws");
+
+	// Packets that draw different indices of the same geometry, or are lit differently, have the same sort
+	// key apart from their depth, so they stay in turn and none of them can be instanced with its neighbour
+	for (size_t i = 0; i < packetCount; i++)
+	{
+		packets[i] = resources.CreatePacket(0, 0, 0);
+		packets[i].StartIndex = i % 2 == 0 ? 0 : 36;
+	}
+	SubmitFrame(resources, renderQueue, packets);
+	report.Check(context.GetCallCount(CommandType::DrawIndexed) == packetCount && context.GetCallCount(CommandType::DrawIndexedInstanced) == 0,
+		L"packets that draw different ranges of indices in turn are drawn one at a time");
+	for (size_t i = 0; i < packetCount; i++)
+	{
+		packets[i] = resources.CreatePacket(0, 0, 0);
+		packets[i].IndexCount = i % 2 == 0 ? 36 : 24;
+	}
+	SubmitFrame(resources, renderQueue, packets);
+	report.Check(context.GetCallCount(CommandType::DrawIndexed) == packetCount && context.GetCallCount(CommandType::DrawIndexedInstanced) == 0,
+		L"packets that draw different numbers of indices in turn are drawn one at a time");
+	for (size_t i = 0; i < packetCount; i++)
+	{
+		packets[i] = resources.CreatePacket(0, 0, 0);
+		packets[i].Material = &resources.Materials[i % 2];
+	}
+	SubmitFrame(resources, renderQueue, packets);
+	report.Check(context.GetCallCount(CommandType::DrawIndexed) == packetCount && context.GetCallCount(CommandType::DrawIndexedInstanced) == 0,
+		L"packets whose materials differ in their lighting are drawn one at a time");
+
+	// Transparent packets are drawn furthest first, so two that share their state are not merged across one that does not
+	packets.assign(3, resources.CreatePacket(0, 0, 0));
+	packets[1] = resources.CreatePacket(0, 0, 1);
+	for (DrawPacket& packet : packets)
+	{
+		packet.IsTransparent = true;
+	}
+	SubmitFrame(resources, renderQueue, packets);
+	report.Check(context.GetCallCount(CommandType::DrawIndexed) == 3 && context.GetCallCount(CommandType::DrawIndexedInstanced) == 0,
+		L"transparent packets that share their state but are not next to each other in depth are drawn one at a time");
+
+	// With instancing turned off every packet is drawn on its own
+	packets.assign(packetCount, resources.CreatePacket(0, 0, 0));
+	renderQueue.SetInstancingEnabled(false);
+	SubmitFrame(resources, renderQueue, packets);
+	report.Check(context.GetCallCount(CommandType::DrawIndexed) == packetCount && context.GetCallCount(CommandType::DrawIndexedInstanced) == 0,
+		L"with instancing turned off, " + to_wstring(packetCount) + L" identical packets are drawn with " + to_wstring(context.GetCallCount(CommandType::DrawIndexed)) + L" draws");
+}
+
+// The type of the last map the context was asked to make
+static D3D11_MAP GetLastMapType(const NullRenderContext& context)
+{
+	const CommandList& commandList = context.GetCommandList();
+	for (size_t i = commandList.GetCommandCount(); i > 0; i--)
+	{
+		if (commandList.GetCommand(i - 1).Type == CommandType::MapBuffer)
+		{
+			return static_cast<D3D11_MAP>(commandList.GetCommand(i - 1).Arguments[0]);
+		}
+	}
+	return static_cast<D3D11_MAP>(0);
+}
+
+static void TestConstantBufferRingAlignment(TestReport& report)
+{
+	report.BeginSection(L"Constant buffer ring alignment");
+	NullRenderDevice device;
+	ConstantBufferRing ring;
+	report.Check(ring.Initialise(&device, 1000) && ring.GetSize() == 1024, L"the size of the ring is rounded up to a whole number of 256 byte blocks");
+
+	// Every block must start on a 256 byte boundary of the buffer, and the pointer returned must be to the first block of the frame
+	bool isAligned = true;
+	bool isMappedAtOffset = true;
+	bool isBoundAtBlock = true;
+	for (UINT blockSize : { 128, 128, 300, 16, 256 })
+	{
+		BYTE* blocks = ring.Map(blockSize, 1);
+		BYTE* buffer = NullDeviceObject::FromInterface(ring.GetBuffer())->GetData();
+		isAligned = isAligned && ring.GetBlockStride() == ConstantBufferRing::Align(blockSize) && ring.GetBlockStride() % ConstantBufferAlignment == 0 &&
+			ring.GetMappedOffset() % ConstantBufferAlignment == 0;
+		isMappedAtOffset = isMappedAtOffset && blocks == buffer + ring.GetMappedOffset();
+		isBoundAtBlock = isBoundAtBlock && ring.GetFirstConstant(0) * 16 == ring.GetMappedOffset() && ring.GetConstantCount() * 16 == ring.GetBlockStride();
+		ring.Unmap();
+	}
+	report.Check(ConstantBufferRing::Align(128) == 256 && ConstantBufferRing::Align(256) == 256 && ConstantBufferRing::Align(300) == 512, L"block sizes are rounded up to 256 bytes");
+	report.Check(isAligned, L"every frame starts on a 256 byte boundary");
+	report.Check(isMappedAtOffset, L"the pointer returned by the map is to the offset of the frame in the buffer");
+	report.Check(isBoundAtBlock, L"the blocks are bound at their offset and size in shader constants");
+}
+
+static void TestConstantBufferRingWrapping(TestReport& report)
+{
+	report.BeginSection(L"Constant buffer ring wrapping");
+	NullRenderDevice device;
+	const NullRenderContext& context = device.GetNullContext();
+	ConstantBufferRing ring;
+	ring.Initialise(&device, 16 * ConstantBufferAlignment);
+
+	// A ring of 16 blocks. The first frame discards the new buffer, frames that fit after the
+	// previous one are not overwritten, and frames that do not fit wrap around with a discard.
+	// The last frame is larger than the whole ring, which must grow to hold it
+	const UINT frameBlocks[] = { 5, 5, 5, 5, 3, 12, 1, 16, 17 };
+	const D3D11_MAP expectedMapTypes[] = { D3D11_MAP_WRITE_DISCARD, D3D11_MAP_WRITE_NO_OVERWRITE, D3D11_MAP_WRITE_NO_OVERWRITE, D3D11_MAP_WRITE_DISCARD,
+		D3D11_MAP_WRITE_NO_OVERWRITE, D3D11_MAP_WRITE_DISCARD, D3D11_MAP_WRITE_NO_OVERWRITE, D3D11_MAP_WRITE_DISCARD, D3D11_MAP_WRITE_DISCARD };
+	const UINT expectedOffsets[] = { 0, 5, 10, 0, 5, 0, 12, 0, 0 };
+	bool isMapTypeExpected = true;
+	bool isOffsetExpected = true;
+	for (size_t frame = 0; frame < _countof(frameBlocks); frame++)
+	{
+		ring.Map(ConstantBufferAlignment, frameBlocks[frame]);
+		ring.Unmap();
+		isMapTypeExpected = isMapTypeExpected && GetLastMapType(context) == expectedMapTypes[frame];
+		isOffsetExpected = isOffsetExpected && ring.GetMappedOffset() == expectedOffsets[frame] * ConstantBufferAlignment;
+	}
+	report.Check(context.GetCallCount(CommandType::MapBuffer) == _countof(frameBlocks) && context.GetCallCount(CommandType::UnmapBuffer) == _countof(frameBlocks),
+		L"every frame is written through a single map");
+	report.Check(isMapTypeExpected, L"frames that fit after the previous frame are mapped without overwriting and the others discard the buffer");
+	report.Check(isOffsetExpected, L"frames are placed straight after the previous frame, or at the start once the ring wraps");
+	report.Check(ring.GetWrapCount() == 3, L"the ring wrapped 3 times (" + to_wstring(ring.GetWrapCount()) + L" counted)");
+	report.Check(ring.GetSize() == 32 * ConstantBufferAlignment, L"a frame larger than the ring grows it to twice its size (" + to_wstring(ring.GetSize()) + L" bytes)");
+}
+
+static void TestConstantBufferRingFencing(TestReport& report)
+{
+	report.BeginSection(L"Constant buffer ring fencing");
+	NullRenderDevice device;
+	const NullRenderContext& context = device.GetNullContext();
+	ConstantBufferRing ring;
+	ring.Initialise(&device, 16 * ConstantBufferAlignment);
+
+	// The GPU may still be reading any frame written since the buffer was last discarded. Each
+	// frame fills its blocks with its own number, so that a frame that overwrote the space of an
+	// earlier one would be found when the earlier frame's blocks are checked
+	struct WrittenFrame
+	{
+		UINT		Offset;
+		UINT		Size;
+		BYTE		Value;
+	};
+	vector<WrittenFrame> frames;
+	mt19937 random(1);
+	uniform_int_distribution<UINT> blockCounts(1, 6);
+	bool isOverlapFree = true;
+	bool isIntact = true;
+	for (UINT frameNumber = 1; frameNumber <= 200; frameNumber++)
+	{
+		UINT blockCount = blockCounts(random);
+		BYTE* blocks = ring.Map(sizeof(ObjectConstants), blockCount);
+		UINT size = blockCount * ring.GetBlockStride();
+		if (GetLastMapType(context) == D3D11_MAP_WRITE_DISCARD)
+		{
+			frames.clear();
+		}
+		for (const WrittenFrame& frame : frames)
+		{
+			isOverlapFree = isOverlapFree && (ring.GetMappedOffset() >= frame.Offset + frame.Size || ring.GetMappedOffset() + size <= frame.Offset);
+		}
+		memset(blocks, static_cast<BYTE>(frameNumber), size);
+		ring.Unmap();
+		frames.push_back({ ring.GetMappedOffset(), size, static_cast<BYTE>(frameNumber) });
+
+		const BYTE* buffer = NullDeviceObject::FromInterface(ring.GetBuffer())->GetData();
+		for (const WrittenFrame& frame : frames)
+		{
+			isIntact = isIntact && all_of(buffer + frame.Offset, buffer + frame.Offset + frame.Size, [&frame](BYTE value) { return value == frame.Value; });
+		}
+	}
+	report.Check(isOverlapFree, L"frames mapped without overwriting never overlap a frame written since the last discard");
+	report.Check(isIntact, L"the frames written since the last discard are left as they were written");
+	report.Check(ring.GetWrapCount() > 0 && ring.GetSize() == 16 * ConstantBufferAlignment, L"the ring wrapped " + to_wstring(ring.GetWrapCount()) + L" times without growing");
+
+	// Without WRITE_NO_OVERWRITE every frame must discard the buffer and start at the beginning of it
+	NullRenderDevice discardingDevice(true, false);
+	const NullRenderContext& discardingContext = discardingDevice.GetNullContext();
+	ConstantBufferRing discardingRing;
+	discardingRing.Initialise(&discardingDevice, 16 * ConstantBufferAlignment);
+	bool isAlwaysDiscarded = true;
+	for (UINT blockCount : { 1, 2, 3, 4 })
+	{
+		discardingRing.Map(sizeof(ObjectConstants), blockCount);
+		discardingRing.Unmap();
+		isAlwaysDiscarded = isAlwaysDiscarded && GetLastMapType(discardingContext) == D3D11_MAP_WRITE_DISCARD && discardingRing.GetMappedOffset() == 0;
+	}
+	report.Check(!discardingRing.IsNoOverwriteSupported() && isAlwaysDiscarded && discardingRing.GetWrapCount() == 0,
+		L"without support for mapping without overwriting, every frame discards the buffer and starts at its beginning");
+}
+
+static void TestDeviceStateFilter(TestReport& report)
+{
+	report.BeginSection(L"Device state filter");
+	TestResources resources;
+	NullRenderContext& context = resources.Device.GetNullContext();
+	ID3D11VertexShader* vertexShader = resources.VertexShaders[0].Get();
+	ID3D11Buffer* buffer = resources.VertexBuffers[0].Get();
+	DeviceStateFilter stateFilter;
+	stateFilter.Begin(&context);
+
+	// Binding the same state twice must only reach the context once, while binding it differently must reach it again
+	stateFilter.VSSetShader(vertexShader);
+	stateFilter.VSSetShader(vertexShader);
+	report.Check(context.GetCallCount(CommandType::SetVertexShader) == 1, L"a vertex shader that is already bound is not bound again");
+	report.Check(stateFilter.GetStatistics().IssuedCallCount == 1 && stateFilter.GetStatistics().FilteredCallCount == 1, L"the statistics count one call issued and one filtered");
+	stateFilter.IASetVertexBuffer(0, buffer, 32, 0);
+	stateFilter.IASetVertexBuffer(0, buffer, 32, 0);
+	stateFilter.IASetVertexBuffer(0, buffer, 32, 64);
+	report.Check(context.GetCallCount(CommandType::SetVertexBuffer) == 2, L"a vertex buffer bound again at a different offset is bound again");
+	stateFilter.VSSetConstantBuffer(1, buffer, 0, 16);
+	stateFilter.VSSetConstantBuffer(1, buffer, 0, 16);
+	stateFilter.VSSetConstantBuffer(1, buffer, 16, 16);
+	report.Check(context.GetCallCount(CommandType::SetVertexConstantBuffer) == 2, L"part of a constant buffer bound again from a different first constant is bound again");
+
+	// Slots beyond those that are shadowed must always be passed on
+	context.Reset();
+	for (UINT i = 0; i < 2; i++)
+	{
+		stateFilter.IASetVertexBuffer(TrackedVertexBufferSlots, buffer, 32, 0);
+		stateFilter.VSSetConstantBuffer(TrackedConstantBufferSlots, buffer);
+		stateFilter.PSSetShaderResource(TrackedShaderResourceSlots, resources.Textures[0].Get());
+	}
+	report.Check(context.GetCallCount(CommandType::SetVertexBuffer) == 2 && context.GetCallCount(CommandType::SetVertexConstantBuffer) == 2 &&
+		context.GetCallCount(CommandType::SetShaderResource) == 2, L"calls for slots that are not shadowed are always passed on");
+
+	// Beginning a frame on the same context keeps what is known about its state, while invalidating or
+	// beginning on a different context forgets it
+	context.Reset();
+	stateFilter.Begin(&context);
+	report.Check(stateFilter.GetStatistics().IssuedCallCount == 0 && stateFilter.GetStatistics().FilteredCallCount == 0 && stateFilter.GetTotalStatistics().FilteredCallCount > 0,
+		L"beginning a frame resets the statistics of the frame but not the totals");
+	stateFilter.VSSetShader(vertexShader);
+	report.Check(context.GetCallCount(CommandType::SetVertexShader) == 0, L"state bound in an earlier frame on the same context is not bound again");
+	stateFilter.Invalidate();
+	stateFilter.VSSetShader(vertexShader);
+	stateFilter.IASetVertexBuffer(0, buffer, 32, 64);
+	report.Check(context.GetCallCount(CommandType::SetVertexShader) == 1 && context.GetCallCount(CommandType::SetVertexBuffer) == 1, L"state is bound again once the filter has been invalidated");
+	NullRenderDevice otherDevice;
+	stateFilter.Begin(otherDevice.GetImmediateContext());
+	stateFilter.VSSetShader(vertexShader);
+	report.Check(otherDevice.GetNullContext().GetCallCount(CommandType::SetVertexShader) == 1, L"state is bound again when a frame is begun on a different context");
+
+	// A pipeline state that is already bound is dropped as a whole, and one that differs only in its vertex shader only binds the shader
+	stateFilter.Begin(&context);
+	stateFilter.SetPipelineState(&resources.Pipelines[0]);
+	context.Reset();
+	stateFilter.SetPipelineState(&resources.Pipelines[0]);
+	report.Check(context.GetTotalCallCount() == 0, L"a pipeline state that is already bound is not bound again");
+	stateFilter.SetPipelineState(&resources.InstancedPipelines[0]);
+	report.Check(context.GetTotalCallCount() == 1 && context.GetCallCount(CommandType::SetVertexShader) == 1, L"a pipeline state that differs only in its vertex shader only binds the vertex shader");
+	context.Reset();
+	stateFilter.VSSetShader(vertexShader);
+	stateFilter.SetPipelineState(&resources.InstancedPipelines[0]);
+	report.Check(context.GetCallCount(CommandType::SetVertexShader) == 2, L"binding part of a pipeline state on its own means the pipeline state is bound again");
+}
+
+// Fill the queue with a frame of packets of every combination of state, some transparent and some
+// drawing other ranges of indices or lit differently, at random positions, and sort it
+static void AddRandomPackets(TestResources& resources, RenderQueue& renderQueue, size_t packetCount, unsigned int seed)
+{
+	mt19937 random(seed);
+	uniform_int_distribution<UINT> states(0, 1);
+	uniform_int_distribution<UINT> ranges(0, 2);
+	uniform_int_distribution<UINT> percentages(0, 99);
+	uniform_real_distribution<float> positions(-50.0f, 50.0f);
+	renderQueue.Begin(Matrix::Identity, Vector3::Zero, 100.0f);
+	for (size_t i = 0; i < packetCount; i++)
+	{
+		DrawPacket packet = resources.CreatePacket(states(random), states(random), states(random));
+		packet.Material = &resources.Materials[states(random)];
+		packet.StartIndex = ranges(random) * packet.IndexCount;
+		packet.IsTransparent = percentages(random) < 20;
+		Vector3 position(positions(random), positions(random), positions(random));
+		ObjectConstants constants;
+		constants.WorldTransformation = Matrix::CreateTranslation(position);
+		constants.WorldViewProjection = constants.WorldTransformation;
+		renderQueue.Add(packet, constants, position);
+	}
+	renderQueue.Sort();
+}
+
+static void TestParallelRecording(TestReport& report)
+{
+	report.BeginSection(L"Parallel command list recording");
+	TestResources resources;
+	RenderQueue renderQueue;
+	AddRandomPackets(resources, renderQueue, 2000, 1);
+	renderQueue.Submit(&resources.Device);
+
+	// However the batches are split into chunks, and whichever threads record them, the lists
+	// taken in order must hold exactly the bytes of recording every batch into a single list
+	CommandList serialCommandList;
+	renderQueue.Record(serialCommandList);
+	ThreadPool threadPool(4);
+	for (ThreadPool* recordingThreadPool : { static_cast<ThreadPool*>(nullptr), &threadPool })
+	{
+		for (size_t chunkSize : { 1, 7, 256, 5000 })
+		{
+			renderQueue.SetThreadPool(recordingThreadPool);
+			renderQueue.SetRecordingChunkSize(chunkSize);
+			renderQueue.Record();
+			vector<BYTE> commands;
+			for (size_t i = 0; i < renderQueue.GetCommandListCount(); i++)
+			{
+				const CommandList& commandList = renderQueue.GetCommandList(i);
+				commands.insert(commands.end(), commandList.GetData(), commandList.GetData() + commandList.GetSize());
+			}
+			size_t expectedListCount = (renderQueue.GetBatchCount() + chunkSize - 1) / chunkSize;
+			report.Check(renderQueue.GetCommandListCount() == expectedListCount && commands.size() == serialCommandList.GetSize() &&
+				memcmp(commands.data(), serialCommandList.GetData(), commands.size()) == 0,
+				L"recording " + to_wstring(renderQueue.GetBatchCount()) + L" batches in chunks of " + to_wstring(chunkSize) +
+				(recordingThreadPool != nullptr ? L" on the thread pool" : L" on the calling thread") + L" into " + to_wstring(renderQueue.GetCommandListCount()) +
+				L" lists gives the same commands as recording them into one list");
+		}
+	}
+	renderQueue.SetThreadPool(nullptr);
+}
+
+static void TestRenderQueueSubmission(TestReport& report)
+{
+	report.BeginSection(L"Render queue submission");
+	for (bool isConstantBufferOffsettingSupported : { true, false })
+	{
+		TestResources resources(isConstantBufferOffsettingSupported);
+		NullRenderContext& context = resources.Device.GetNullContext();
+		RenderQueue renderQueue;
+		const wstring device = isConstantBufferOffsettingSupported ? L" with the constant buffer ring" : L" without the constant buffer ring";
+
+		// Every call that reaches the context must either have got through the state filter or be a draw or an upload
+		bool isEveryCallAccounted = true;
+		bool isEveryDrawMade = true;
+		bool isEveryUploadMade = true;
+		size_t filteredCallCount = 0;
+		for (unsigned int frame = 0; frame < 3; frame++)
+		{
+			context.Reset();
+			AddRandomPackets(resources, renderQueue, 500, frame + 1);
+			renderQueue.Submit(&resources.Device);
+			const RenderQueueStatistics& statistics = renderQueue.GetStatistics();
+			const DeviceStateStatistics& filterStatistics = renderQueue.GetStateFilter().GetStatistics();
+			size_t uploadCallCount = context.GetCallCount(CommandType::UpdateConstantBuffer) + context.GetCallCount(CommandType::MapBuffer) + context.GetCallCount(CommandType::UnmapBuffer);
+			size_t drawCallCount = context.GetCallCount(CommandType::DrawIndexed) + context.GetCallCount(CommandType::DrawIndexedInstanced);
+			isEveryCallAccounted = isEveryCallAccounted && context.GetTotalCallCount() == filterStatistics.IssuedCallCount + filterStatistics.DrawCount + uploadCallCount;
+			isEveryDrawMade = isEveryDrawMade && drawCallCount == statistics.DrawCount && filterStatistics.DrawCount == statistics.DrawCount &&
+				context.GetCallCount(CommandType::DrawIndexedInstanced) == statistics.InstancedDrawCount;
+
+			// The ring is written through one map a frame and the instances through another, so only the frame
+			// constants are updated. Without the ring the constants of every draw that is not instanced are updated
+			size_t singleDrawCount = statistics.DrawCount - statistics.InstancedDrawCount;
+			if (isConstantBufferOffsettingSupported)
+			{
+				isEveryUploadMade = isEveryUploadMade && context.GetCallCount(CommandType::UpdateConstantBuffer) == 1 &&
+					context.GetCallCount(CommandType::MapBuffer) == (singleDrawCount > 0 ? 1u : 0u) + (statistics.InstancedDrawCount > 0 ? 1u : 0u);
+			}
+			else
+			{
+				isEveryUploadMade = isEveryUploadMade && context.GetCallCount(CommandType::UpdateConstantBuffer) == 1 + singleDrawCount &&
+					context.GetUploadedByteCount() == statistics.UploadedByteCount;
+			}
+			filteredCallCount += filterStatistics.FilteredCallCount;
+		}
+		report.Check(isEveryCallAccounted, L"every call that reaches the context" + device + L" is a call the state filter issued, a draw or an upload");
+		report.Check(isEveryDrawMade, L"the draws that reach the context" + device + L" are the ones the statistics count");
+		report.Check(isEveryUploadMade, L"the constants" + device + L" are uploaded with the expected calls");
+		report.Check(filteredCallCount > 0, L"the state filter drops " + to_wstring(filteredCallCount) + L" calls over three frames" + device);
+	}
+}
+
+static void TestShaderPermutations(TestReport& report)
+{
+	report.BeginSection(L"Shader permutations");
+	const Vector4 white(1.0f, 1.0f, 1.0f, 1.0f);
+	const Vector4 black(0.0f, 0.0f, 0.0f, 1.0f);
+	const Vector4 negative(-1.0f, -1.0f, -1.0f, 1.0f);
+
+	// A lighting term may only be left out when the shader would add nothing for it
+	report.Check((SelectShaderPermutation(false, white, 10.0f, black, 8.0f) & ShaderPointLight) != 0, L"a white point light is lit");
+	report.Check((SelectShaderPermutation(false, white, -10.0f, black, 8.0f) & ShaderPointLight) != 0, L"a point light with a negative range is lit, since its attenuation saturates to one");
+	report.Check((SelectShaderPermutation(false, black, 10.0f, black, 8.0f) & ShaderPointLight) == 0, L"a black point light is left out");
+	report.Check((SelectShaderPermutation(false, negative, 10.0f, black, 8.0f) & ShaderPointLight) == 0, L"a point light with no positive channel is left out, since it is saturated to zero");
+	report.Check((SelectShaderPermutation(false, black, 0.0f, white, 8.0f) & ShaderSpecular) != 0, L"a white specular colour is lit");
+	report.Check((SelectShaderPermutation(false, black, 0.0f, white, 0.0f) & ShaderSpecular) != 0, L"a specular power of zero is lit, since the brightness is then one");
+	report.Check((SelectShaderPermutation(false, black, 0.0f, negative, 8.0f) & ShaderSpecular) != 0, L"a negative specular colour is kept, since it darkens the colour");
+	report.Check((SelectShaderPermutation(false, black, 0.0f, black, 0.0f) & ShaderSpecular) != 0, L"a black specular colour with a power of zero is kept, since the brightness can be infinite");
+	report.Check((SelectShaderPermutation(false, black, 0.0f, black, 8.0f) & ShaderSpecular) == 0, L"a black specular colour with a positive power is left out");
+	report.Check(SelectShaderPermutation(true, black, 0.0f, black, 8.0f) == ShaderHasTexture, L"a textured material with no point light or specular colour only has the texture flag");
+}
+
+static void WriteTestFile(const wstring& fileName, const string& contents)
+{
+	ofstream file(fileName, ios::binary | ios::trunc);
+	file << contents;
+}
+
+static void TestShaderCache(TestReport& report)
+{
+	report.BeginSection(L"Shader cache");
+	const wstring sourceFileName = L"HeadlessTestShader.hlsl";
+	const wstring includeFileName = L"HeadlessTestShader.hlsli";
+	const wstring cacheFileName = L"HeadlessTestShaders.cache";
+	WriteTestFile(sourceFileName, "#include \"HeadlessTestShader.hlsli\"\nfloat4 PS() : SV_Target { return Colour; }\n");
+	WriteTestFile(includeFileName, "float4 Colour;\n");
+	DeleteFileW(cacheFileName.c_str());
+
+	// The stand-in compiler counts its calls and returns byte code that spells out the request,
+	// so that a hit can be told apart from a compile and each request gets byte code of its own
+	size_t compileCount = 0;
+	ShaderCompiler compiler = [&compileCount](const ShaderCompileRequest& request, vector<BYTE>& byteCode, string&)
+	{
+		compileCount++;
+		string text = request.EntryPoint + " " + request.Target + " " + to_string(request.Flags) + " " + to_string(compileCount);
+		for (const ShaderDefine& define : request.Defines)
+		{
+			text += " " + define.Name + "=" + define.Value;
+		}
+		byteCode.assign(text.begin(), text.end());
+		return true;
+	};
+
+	struct Request
+	{
+		vector<ShaderDefine>	Defines;
+		string					EntryPoint;
+		UINT					Flags;
+		wstring					Description;
+	};
+	const vector<ShaderDefine> defines = { { "SPECULAR", "1" }, { "NUM_POINT_LIGHTS", "0" } };
+	const vector<Request> requests =
+	{
+		{ defines, "PS", 0, L"" },
+		{ { { "SPECULAR", "0" }, { "NUM_POINT_LIGHTS", "0" } }, "PS", 0, L"a define with another value" },
+		{ { { "SPECULAR", "1" }, { "HAS_TEXTURE", "0" } }, "PS", 0, L"a define with another name" },
+		{ defines, "VS", 0, L"another entry point" },
+		{ defines, "PS", 1, L"other compile flags" }
+	};
+	vector<vector<BYTE>> byteCodes(requests.size());
+
+	ShaderCache shaderCache;
+	shaderCache.SetCompiler(compiler);
+	shaderCache.Open(cacheFileName);
+	string messages;
+	for (size_t i = 0; i < requests.size(); i++)
+	{
+		size_t previousCompileCount = compileCount;
+		bool isCompiled = shaderCache.GetByteCode(sourceFileName, requests[i].Defines, requests[i].EntryPoint, "ps_5_0", requests[i].Flags, byteCodes[i], messages);
+		if (i > 0)
+		{
+			report.Check(isCompiled && compileCount == previousCompileCount + 1, L"a request with " + requests[i].Description + L" misses and is compiled");
+		}
+	}
+	vector<BYTE> byteCode;
+	size_t previousCompileCount = compileCount;
+	bool isFound = shaderCache.GetByteCode(sourceFileName, requests[0].Defines, requests[0].EntryPoint, "ps_5_0", requests[0].Flags, byteCode, messages);
+	report.Check(isFound && compileCount == previousCompileCount && byteCode == byteCodes[0], L"an identical request hits and returns the byte code of the first compile");
+	shaderCache.GetByteCode(sourceFileName, requests[0].Defines, requests[0].EntryPoint, "vs_5_0", requests[0].Flags, byteCode, messages);
+	report.Check(compileCount == previousCompileCount + 1, L"a request for another target misses and is compiled");
+
+	// A change to an included file changes the key even though the shader file itself is the same
+	WriteTestFile(includeFileName, "float4 Colour;\nfloat4 Tint;\n");
+	previousCompileCount = compileCount;
+	shaderCache.GetByteCode(sourceFileName, requests[0].Defines, requests[0].EntryPoint, "ps_5_0", requests[0].Flags, byteCode, messages);
+	report.Check(compileCount == previousCompileCount + 1 && byteCode != byteCodes[0], L"a request after the included file has changed misses and is compiled");
+	WriteTestFile(includeFileName, "float4 Colour;\n");
+	report.Check(shaderCache.GetStatistics().HitCount == 1 && shaderCache.GetStatistics().MissCount == compileCount,
+		L"the statistics count " + to_wstring(shaderCache.GetStatistics().HitCount) + L" hit and " + to_wstring(shaderCache.GetStatistics().MissCount) + L" misses");
+
+	// Everything that was compiled is found again by a cache that opens the saved file
+	report.Check(shaderCache.Save(), L"the cache is saved");
+	ShaderCache loadedShaderCache;
+	loadedShaderCache.SetCompiler(compiler);
+	loadedShaderCache.Open(cacheFileName);
+	previousCompileCount = compileCount;
+	bool isEveryRequestFound = true;
+	for (size_t i = 0; i < requests.size(); i++)
+	{
+		isEveryRequestFound = loadedShaderCache.GetByteCode(sourceFileName, requests[i].Defines, requests[i].EntryPoint, "ps_5_0", requests[i].Flags, byteCode, messages) &&
+			byteCode == byteCodes[i] && isEveryRequestFound;
+	}
+	report.Check(isEveryRequestFound && compileCount == previousCompileCount && loadedShaderCache.GetStatistics().HitCount == requests.size(),
+		L"a cache opened from the saved file hits on every request with the byte code that was compiled");
+
+	DeleteFileW(sourceFileName.c_str());
+	DeleteFileW(includeFileName.c_str());
+	DeleteFileW(cacheFileName.c_str());
+}
+
+wstring RunHeadlessTests(bool& isPassed)
+{
+	TestReport report;
+	TestRenderQueueOrder(report);
+	TestRenderQueueInstancing(report);
+	TestRenderQueueIdentifiers(report);
+	TestConstantBufferRingAlignment(report);
+	TestConstantBufferRingWrapping(report);
+	TestConstantBufferRingFencing(report);
+	TestDeviceStateFilter(report);
+	TestParallelRecording(report);
+	TestRenderQueueSubmission(report);
+	TestShaderPermutations(report);
+	TestShaderCache(report);
+
+	isPassed = report.GetFailureCount() == 0;
+	return report.GetText() + L"\n" + to_wstring(report.GetCheckCount() - report.GetFailureCount()) + L" of " + to_wstring(report.GetCheckCount()) + L" checks passed\n";
+}
@@ -0,0 +1,15 @@
+#pragma once
+#include <string>
+#include "core.h"
+
+using namespace std;
+
+// Checks of the renderer that run without a window or a GPU. The render queue and the
+// classes it submits through are driven against the null render device, and the calls
+// that reach its context are compared with what the queue is expected to make.
+//
+// Every check is written to the report as it is made, so a failure can be found in the
+// report without a debugger.
+
+// Run every check and return the report. isPassed is set to false if any check failed
+wstring RunHeadlessTests(bool& isPassed);
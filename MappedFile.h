@@ -0,0 +1,58 @@
+#pragma once
+#include "core.h"
+
+using namespace std;
+
+// A read-only view of a whole file, released when it goes out of scope
+
+class MappedFile
+{
+public:
+	MappedFile(const wstring& fileName)
+	{
+		_file = CreateFileW(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		if (_file == INVALID_HANDLE_VALUE)
+		{
+			return;
+		}
+		LARGE_INTEGER size;
+		if (!GetFileSizeEx(_file, &size) || size.QuadPart == 0)
+		{
+			return;
+		}
+		_mapping = CreateFileMappingW(_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (_mapping == nullptr)
+		{
+			return;
+		}
+		_data = static_cast<const BYTE*>(MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0));
+		if (_data != nullptr)
+		{
+			_size = static_cast<size_t>(size.QuadPart);
+		}
+	}
+	~MappedFile()
+	{
+		if (_data != nullptr)
+		{
+			UnmapViewOfFile(_data);
+		}
+		if (_mapping != nullptr)
+		{
+			CloseHandle(_mapping);
+		}
+		if (_file != INVALID_HANDLE_VALUE)
+		{
+			CloseHandle(_file);
+		}
+	}
+
+	const BYTE* GetData() const { return _data; }
+	size_t GetSize() const { return _size; }
+
+private:
+	HANDLE			_file{ INVALID_HANDLE_VALUE };
+	HANDLE			_mapping{ nullptr };
+	const BYTE*		_data{ nullptr };
+	size_t			_size{ 0 };
+};
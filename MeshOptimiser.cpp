@@ -0,0 +1,313 @@
+#include <algorithm>
+#include <climits>
+#include "MeshOptimiser.h"
+
+// A FIFO post-transform cache. A vertex is in the cache if fewer than VertexCacheSize
+// vertices have been transformed since it was
+class VertexCache
+{
+public:
+	VertexCache(UINT vertexCount) : _cacheTimes(vertexCount, 0) {};
+
+	// Returns true if the vertex had to be transformed
+	bool Use(UINT vertex)
+	{
+		if (_time - _cacheTimes[vertex] <= VertexCacheSize)
+		{
+			return false;
+		}
+		_cacheTimes[vertex] = _time++;
+		return true;
+	}
+
+	void Clear() { _time += VertexCacheSize + 1; }
+
+private:
+	vector<UINT>	_cacheTimes;
+	UINT			_time{ VertexCacheSize + 1 };
+};
+
+static const Vector3& GetPosition(const BYTE* vertices, UINT vertexStride, UINT vertex)
+{
+	return *reinterpret_cast<const Vector3*>(vertices + static_cast<size_t>(vertex) * vertexStride);
+}
+
+VertexCacheStatistics AnalyseVertexCache(const vector<UINT>& indices, UINT vertexCount)
+{
+	VertexCacheStatistics statistics;
+	VertexCache cache(vertexCount);
+	vector<bool> isUsed(vertexCount, false);
+	UINT usedVertexCount = 0;
+	for (UINT index : indices)
+	{
+		if (cache.Use(index))
+		{
+			statistics.TransformedVertexCount++;
+		}
+		if (!isUsed[index])
+		{
+			isUsed[index] = true;
+			usedVertexCount++;
+		}
+	}
+	if (!indices.empty())
+	{
+		statistics.ACMR = static_cast<float>(statistics.TransformedVertexCount) / (indices.size() / 3);
+		statistics.ATVR = static_cast<float>(statistics.TransformedVertexCount) / usedVertexCount;
+	}
+	return statistics;
+}
+
+void OptimiseVertexCache(vector<UINT>& indices, UINT vertexCount, vector<UINT>* clusters)
+{
+	size_t triangleCount = indices.size() / 3;
+
+	// The triangles that use each vertex, and how many of them have not been output yet
+	vector<UINT> liveCounts(vertexCount, 0);
+	for (UINT index : indices)
+	{
+		liveCounts[index]++;
+	}
+	vector<UINT> firstTriangles(vertexCount + 1, 0);
+	for (UINT vertex = 0; vertex < vertexCount; vertex++)
+	{
+		firstTriangles[vertex + 1] = firstTriangles[vertex] + liveCounts[vertex];
+	}
+	vector<UINT> vertexTriangles(indices.size());
+	vector<UINT> nextTriangles(firstTriangles.begin(), firstTriangles.end() - 1);
+	for (size_t i = 0; i < indices.size(); i++)
+	{
+		vertexTriangles[nextTriangles[indices[i]]++] = static_cast<UINT>(i / 3);
+	}
+
+	vector<UINT> cacheTimes(vertexCount, 0);
+	UINT time = VertexCacheSize + 1;
+	vector<bool> isEmitted(triangleCount, false);
+	// Vertices of recent triangles, to carry on from when the current vertex has no triangles left
+	vector<UINT> deadEnd;
+	vector<UINT> candidates;
+	vector<UINT> output;
+	output.reserve(indices.size());
+	if (clusters != nullptr)
+	{
+		clusters->clear();
+	}
+
+	UINT cursor = 0;
+	int fanningVertex = vertexCount > 0 ? 0 : -1;
+	bool isNewCluster = true;
+	while (fanningVertex >= 0)
+	{
+		// Output every remaining triangle around the fanning vertex
+		candidates.clear();
+		for (UINT i = firstTriangles[fanningVertex]; i < firstTriangles[fanningVertex + 1]; i++)
+		{
+			UINT triangle = vertexTriangles[i];
+			if (isEmitted[triangle])
+			{
+				continue;
+			}
+			if (isNewCluster && clusters != nullptr)
+			{
+				clusters->push_back(static_cast<UINT>(output.size() / 3));
+			}
+			isNewCluster = false;
+			for (UINT corner = 0; corner < 3; corner++)
+			{
+				UINT vertex = indices[triangle * 3 + corner];
+				output.push_back(vertex);
+				deadEnd.push_back(vertex);
+				candidates.push_back(vertex);
+				liveCounts[vertex]--;
+				if (time - cacheTimes[vertex] > VertexCacheSize)
+				{
+					cacheTimes[vertex] = time++;
+				}
+			}
+			isEmitted[triangle] = true;
+		}
+
+		// Fan around the vertex that will still be in the cache once all of its triangles have
+		// been output, preferring the one that has been in the cache longest
+		fanningVertex = -1;
+		int bestPriority = -1;
+		for (UINT vertex : candidates)
+		{
+			if (liveCounts[vertex] == 0)
+			{
+				continue;
+			}
+			int priority = 0;
+			if (time - cacheTimes[vertex] + 2 * liveCounts[vertex] <= VertexCacheSize)
+			{
+				priority = static_cast<int>(time - cacheTimes[vertex]);
+			}
+			if (priority > bestPriority)
+			{
+				bestPriority = priority;
+				fanningVertex = static_cast<int>(vertex);
+			}
+		}
+		if (fanningVertex < 0)
+		{
+			// A dead end. Go back to the most recent vertex that still has triangles, or to the next
+			// part of the mesh that has not been reached at all
+			while (!deadEnd.empty() && fanningVertex < 0)
+			{
+				UINT vertex = deadEnd.back();
+				deadEnd.pop_back();
+				if (liveCounts[vertex] > 0)
+				{
+					fanningVertex = static_cast<int>(vertex);
+				}
+			}
+			while (fanningVertex < 0 && cursor < vertexCount)
+			{
+				if (liveCounts[cursor] > 0)
+				{
+					fanningVertex = static_cast<int>(cursor);
+				}
+				cursor++;
+			}
+			isNewCluster = true;
+		}
+	}
+	indices.swap(output);
+}
+
+void OptimiseOverdraw(vector<UINT>& indices, const BYTE* vertices, UINT vertexStride, UINT vertexCount, const vector<UINT>& clusters, float threshold)
+{
+	UINT triangleCount = static_cast<UINT>(indices.size() / 3);
+	if (triangleCount == 0)
+	{
+		return;
+	}
+
+	// Split the clusters wherever the cache has already done as well as it does over the whole mesh,
+	// since starting again with an empty cache there costs little
+	float targetACMR = AnalyseVertexCache(indices, vertexCount).ACMR * threshold;
+	vector<UINT> splitClusters;
+	VertexCache cache(vertexCount);
+	for (size_t cluster = 0; cluster < clusters.size(); cluster++)
+	{
+		UINT start = clusters[cluster];
+		UINT end = cluster + 1 < clusters.size() ? clusters[cluster + 1] : triangleCount;
+		splitClusters.push_back(start);
+		cache.Clear();
+		UINT transformedCount = 0;
+		for (UINT triangle = start; triangle < end; triangle++)
+		{
+			for (UINT corner = 0; corner < 3; corner++)
+			{
+				transformedCount += cache.Use(indices[triangle * 3 + corner]) ? 1 : 0;
+			}
+			if (triangle + 1 < end && static_cast<float>(transformedCount) / (triangle + 1 - splitClusters.back()) <= targetACMR)
+			{
+				splitClusters.push_back(triangle + 1);
+				cache.Clear();
+				transformedCount = 0;
+			}
+		}
+	}
+
+	// Clusters that face away from the centre of the mesh are likely to be in front of the rest of it
+	Vector3 meshCentroid;
+	for (UINT index : indices)
+	{
+		meshCentroid += GetPosition(vertices, vertexStride, index);
+	}
+	meshCentroid = meshCentroid / static_cast<float>(indices.size());
+	vector<float> sortKeys(splitClusters.size());
+	for (size_t cluster = 0; cluster < splitClusters.size(); cluster++)
+	{
+		UINT start = splitClusters[cluster];
+		UINT end = cluster + 1 < splitClusters.size() ? splitClusters[cluster + 1] : triangleCount;
+		Vector3 centroid;
+		Vector3 normal;
+		for (UINT triangle = start; triangle < end; triangle++)
+		{
+			const Vector3& position0 = GetPosition(vertices, vertexStride, indices[triangle * 3]);
+			const Vector3& position1 = GetPosition(vertices, vertexStride, indices[triangle * 3 + 1]);
+			const Vector3& position2 = GetPosition(vertices, vertexStride, indices[triangle * 3 + 2]);
+			centroid += position0 + position1 + position2;
+			// Weighted by the area of the triangle
+			normal += (position1 - position0).Cross(position2 - position0);
+		}
+		centroid = centroid / (3.0f * (end - start));
+		normal.Normalize();
+		sortKeys[cluster] = (centroid - meshCentroid).Dot(normal);
+	}
+
+	vector<UINT> order(splitClusters.size());
+	for (UINT cluster = 0; cluster < order.size(); cluster++)
+	{
+		order[cluster] = cluster;
+	}
+	stable_sort(order.begin(), order.end(), [&](UINT cluster0, UINT cluster1) { return sortKeys[cluster0] > sortKeys[cluster1]; });
+
+	vector<UINT> output;
+	output.reserve(indices.size());
+	for (UINT cluster : order)
+	{
+		UINT start = splitClusters[cluster];
+		UINT end = cluster + 1 < splitClusters.size() ? splitClusters[cluster + 1] : triangleCount;
+		output.insert(output.end(), indices.begin() + start * 3, indices.begin() + end * 3);
+	}
+	// Splitting only bounds the cache miss ratio of each cluster. If the order as a whole has become
+	// worse than the threshold allows, the cache order is kept
+	if (AnalyseVertexCache(output, vertexCount).ACMR <= targetACMR)
+	{
+		indices.swap(output);
+	}
+}
+
+UINT OptimiseVertexFetch(vector<BYTE>& vertices, UINT vertexStride, vector<UINT>& indices)
+{
+	UINT vertexCount = static_cast<UINT>(vertices.size() / vertexStride);
+	vector<UINT> remap(vertexCount, UINT_MAX);
+	UINT usedVertexCount = 0;
+	for (UINT& index : indices)
+	{
+		if (remap[index] == UINT_MAX)
+		{
+			remap[index] = usedVertexCount++;
+		}
+		index = remap[index];
+	}
+	vector<BYTE> remappedVertices(static_cast<size_t>(usedVertexCount) * vertexStride);
+	for (UINT vertex = 0; vertex < vertexCount; vertex++)
+	{
+		if (remap[vertex] != UINT_MAX)
+		{
+			memcpy(&remappedVertices[static_cast<size_t>(remap[vertex]) * vertexStride], &vertices[static_cast<size_t>(vertex) * vertexStride], vertexStride);
+		}
+	}
+	vertices.swap(remappedVertices);
+	return usedVertexCount;
+}
+
+MeshOptimisationStatistics OptimiseMesh(vector<BYTE>& vertices, UINT vertexStride, vector<UINT>& indices)
+{
+	MeshOptimisationStatistics statistics;
+	UINT vertexCount = static_cast<UINT>(vertices.size() / vertexStride);
+	statistics.Before = AnalyseVertexCache(indices, vertexCount);
+
+	// Meshes that were built in a good order already, such as a grid of patches, are kept in it. The
+	// clusters of the overdraw order are then found by splitting the mesh as a whole
+	vector<UINT> clusters;
+	vector<UINT> cacheOrder = indices;
+	OptimiseVertexCache(cacheOrder, vertexCount, &clusters);
+	if (AnalyseVertexCache(cacheOrder, vertexCount).ACMR < statistics.Before.ACMR)
+	{
+		indices.swap(cacheOrder);
+	}
+	else
+	{
+		clusters.assign(1, 0);
+	}
+	OptimiseOverdraw(indices, vertices.data(), vertexStride, vertexCount, clusters);
+	vertexCount = OptimiseVertexFetch(vertices, vertexStride, indices);
+
+	statistics.After = AnalyseVertexCache(indices, vertexCount);
+	return statistics;
+}
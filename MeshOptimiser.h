@@ -0,0 +1,55 @@
+#pragma once
+#include <vector>
+#include "core.h"
+#include "DirectXCore.h"
+
+using namespace std;
+
+// Reordering of mesh indices and vertices for the GPU.
+//
+// The triangles are first reordered so that the vertices they share are still in the
+// post-transform cache when they are used again (Tipsify, Sander, Nehab and Barczak 2007).
+// The clusters of triangles this produces are then sorted so that those facing outwards
+// are drawn first, which reduces overdraw, without giving up more than a little of the
+// cache efficiency. Finally the vertices are stored in the order they are first used,
+// so that vertex fetch reads memory in order.
+//
+// Every vertex format must start with its position, as a Vector3.
+
+// The size of the cache that is optimised for and simulated. Most GPUs have at least this many entries
+#define VertexCacheSize		16
+// How much worse than the cache order the overdraw order may make the average cache miss ratio
+#define OverdrawThreshold	1.05f
+
+struct VertexCacheStatistics
+{
+	// The average number of vertices transformed per triangle (ACMR) and per vertex (ATVR), for a
+	// FIFO cache of VertexCacheSize entries. The best a mesh can do is about 0.5 and exactly 1
+	float		ACMR{ 0 };
+	float		ATVR{ 0 };
+	size_t		TransformedVertexCount{ 0 };
+};
+
+struct MeshOptimisationStatistics
+{
+	VertexCacheStatistics	Before;
+	VertexCacheStatistics	After;
+};
+
+// Simulate the post-transform cache on a triangle list
+VertexCacheStatistics AnalyseVertexCache(const vector<UINT>& indices, UINT vertexCount);
+
+// Reorder the triangles for the post-transform cache. The first triangle of every cluster, where the
+// order had to jump to an unconnected part of the mesh, is added to clusters if it is given
+void OptimiseVertexCache(vector<UINT>& indices, UINT vertexCount, vector<UINT>* clusters = nullptr);
+
+// Sort the clusters of a cache optimised triangle list so that triangles facing outwards are drawn first.
+// Clusters are split further as long as the cache miss ratio stays within the threshold
+void OptimiseOverdraw(vector<UINT>& indices, const BYTE* vertices, UINT vertexStride, UINT vertexCount, const vector<UINT>& clusters, float threshold = OverdrawThreshold);
+
+// Store the vertices in the order they are first used and update the indices to match. Vertices that
+// are not used are removed. Returns the number of vertices that are left
+UINT OptimiseVertexFetch(vector<BYTE>& vertices, UINT vertexStride, vector<UINT>& indices);
+
+// All of the above, in order
+MeshOptimisationStatistics OptimiseMesh(vector<BYTE>& vertices, UINT vertexStride, vector<UINT>& indices);
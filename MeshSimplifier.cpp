@@ -0,0 +1,960 @@
+#include <algorithm>
+#include <chrono>
+#include <cfloat>
+#include <climits>
+#include <cmath>
+#include <functional>
+#include "MeshSimplifier.h"
+#include "MeshOptimiser.h"
+#include "NormalGeneration.h"
+
+// The offset of the normal in every vertex format, which the texture coordinates follow from this stride on
+#define NormalOffset				12
+#define TexturedVertexStride		32
+#define MaxAttributeCount			5
+// A collapse is not made if it would turn the normal of a triangle through more than about 75 degrees
+#define SimplificationFlipCosine	0.25f
+
+enum class VertexKind : BYTE
+{
+	Manifold,
+	Border,
+	Seam,
+	Locked
+};
+
+// The sum of the squared distances from a set of planes, weighted by the areas of the faces they came from
+struct Quadric
+{
+	float		A00{ 0 }, A11{ 0 }, A22{ 0 };
+	float		A01{ 0 }, A02{ 0 }, A12{ 0 };
+	float		B0{ 0 }, B1{ 0 }, B2{ 0 };
+	float		C{ 0 };
+	// The area of the faces, which turns the sum into a mean
+	float		Weight{ 0 };
+};
+
+// The sum of the squared differences from a set of attribute values, weighted in the same way
+struct AttributeQuadric
+{
+	float		Sum[MaxAttributeCount]{ 0 };
+	float		SumOfSquares{ 0 };
+	float		Weight{ 0 };
+};
+
+// A corner of a triangle, with the vertices that follow it and come before it in the triangle
+struct Corner
+{
+	UINT		Vertex;
+	UINT		Next;
+	UINT		Previous;
+};
+
+struct Collapse
+{
+	UINT		From;
+	UINT		To;
+	// The error used to order the collapses includes the attributes, while the geometric error does not
+	float		Error;
+	float		GeometricError;
+};
+
+static void AddPlane(Quadric& quadric, const Vector3& normal, float distance, float weight)
+{
+	quadric.A00 += weight * normal.x * normal.x;
+	quadric.A11 += weight * normal.y * normal.y;
+	quadric.A22 += weight * normal.z * normal.z;
+	quadric.A01 += weight * normal.x * normal.y;
+	quadric.A02 += weight * normal.x * normal.z;
+	quadric.A12 += weight * normal.y * normal.z;
+	quadric.B0 += weight * normal.x * distance;
+	quadric.B1 += weight * normal.y * distance;
+	quadric.B2 += weight * normal.z * distance;
+	quadric.C += weight * distance * distance;
+}
+
+static void AddQuadric(Quadric& quadric, const Quadric& other)
+{
+	quadric.A00 += other.A00;
+	quadric.A11 += other.A11;
+	quadric.A22 += other.A22;
+	quadric.A01 += other.A01;
+	quadric.A02 += other.A02;
+	quadric.A12 += other.A12;
+	quadric.B0 += other.B0;
+	quadric.B1 += other.B1;
+	quadric.B2 += other.B2;
+	quadric.C += other.C;
+	quadric.Weight += other.Weight;
+}
+
+static float EvaluateQuadric(const Quadric& quadric, const Vector3& position)
+{
+	const float x = position.x;
+	const float y = position.y;
+	const float z = position.z;
+	float error = quadric.A00 * x * x + quadric.A11 * y * y + quadric.A22 * z * z +
+		2.0f * (quadric.A01 * x * y + quadric.A02 * x * z + quadric.A12 * y * z) +
+		2.0f * (quadric.B0 * x + quadric.B1 * y + quadric.B2 * z) + quadric.C;
+	// Rounding can take the sum just below zero
+	return fabsf(error);
+}
+
+static void AddAttributes(AttributeQuadric& quadric, const float* attributes, UINT attributeCount, float weight)
+{
+	for (UINT attribute = 0; attribute < attributeCount; attribute++)
+	{
+		quadric.Sum[attribute] += weight * attributes[attribute];
+		quadric.SumOfSquares += weight * attributes[attribute] * attributes[attribute];
+	}
+	quadric.Weight += weight;
+}
+
+static void AddAttributeQuadric(AttributeQuadric& quadric, const AttributeQuadric& other)
+{
+	for (UINT attribute = 0; attribute < MaxAttributeCount; attribute++)
+	{
+		quadric.Sum[attribute] += other.Sum[attribute];
+	}
+	quadric.SumOfSquares += other.SumOfSquares;
+	quadric.Weight += other.Weight;
+}
+
+static float EvaluateAttributeQuadric(const AttributeQuadric& quadric, const float* attributes, UINT attributeCount)
+{
+	float error = quadric.SumOfSquares;
+	for (UINT attribute = 0; attribute < attributeCount; attribute++)
+	{
+		error += attributes[attribute] * (quadric.Weight * attributes[attribute] - 2.0f * quadric.Sum[attribute]);
+	}
+	return fabsf(error);
+}
+
+// Collapses edges of a mesh, one pass at a time. In each pass the edges that can be collapsed are
+// ordered by their error and collapsed in that order, skipping any that would move a position that
+// has already been moved or collapsed into in the pass, or collapse into one that has been moved.
+// The indices are then updated and the triangles that have lost their area are removed. The quadrics are kept from one call of Simplify to the next, so a
+// chain of levels can be built by simplifying the same mesh further each time.
+//
+// Positions are scaled to fit a unit cube, so that the errors do not depend on the size of the mesh.
+// The position of a vertex is identified by the first vertex with the same position.
+class Simplifier
+{
+public:
+	Simplifier(const BYTE* vertices, UINT vertexStride, UINT vertexCount, const vector<UINT>& indices);
+
+	void Simplify(size_t targetIndexCount, float errorLimit);
+
+	const vector<UINT>& GetIndices() const { return _indices; }
+	// The largest estimated error of any collapse so far, in the units of the mesh
+	float GetError() const { return sqrtf(_error) * _scale; }
+
+private:
+	UINT						_vertexCount;
+	UINT						_attributeCount;
+	float						_scale{ 1.0f };
+	vector<Vector3>				_positions;
+	vector<float>				_attributes;
+	vector<UINT>				_indices;
+	// The first vertex with the same position, and the next vertex in a ring of those that share it
+	vector<UINT>				_remap;
+	vector<UINT>				_wedges;
+	vector<VertexKind>			_kinds;
+	// The position quadrics are held by the first vertex with each position
+	vector<Quadric>				_quadrics;
+	vector<AttributeQuadric>	_attributeQuadrics;
+	float						_error{ 0 };
+
+	// The corners of the triangles at each position, rebuilt for every pass
+	vector<UINT>				_cornerOffsets;
+	vector<Corner>				_corners;
+
+	vector<Collapse>			_collapses;
+	vector<Collapse>			_rankedCollapses;
+	vector<UINT>				_collapseRemap;
+	// Positions that have been moved or collapsed into in this pass must not be moved again, and those that
+	// have been moved must not be collapsed into
+	vector<bool>				_isCollapseLocked;
+	vector<bool>				_isCollapsed;
+
+	void BuildPositionRemap();
+	void BuildAdjacency();
+	bool HasEdge(UINT from, UINT to) const;
+	bool HasPositionEdge(UINT from, UINT to) const;
+	void ClassifyVertices();
+	void BuildQuadrics();
+	bool CanCollapse(UINT from, UINT to, bool isOpenEdge, bool isSeamEdge) const;
+	void EvaluateCollapse(Collapse& collapse) const;
+	void PickCollapses();
+	void RankCollapses();
+	size_t PerformCollapses(size_t triangleCollapseGoal, float errorGoal);
+	bool HasTriangleFlip(UINT from, UINT to) const;
+	void RemapIndices();
+
+	const float* GetAttributes(UINT vertex) const { return _attributes.data() + static_cast<size_t>(vertex) * _attributeCount; }
+};
+
+Simplifier::Simplifier(const BYTE* vertices, UINT vertexStride, UINT vertexCount, const vector<UINT>& indices) :
+	_vertexCount(vertexCount), _attributeCount(vertexStride >= TexturedVertexStride ? 5 : 3), _indices(indices)
+{
+	// Scale the positions to fit a unit cube
+	_positions.resize(vertexCount);
+	Vector3 minimum(FLT_MAX);
+	Vector3 maximum(-FLT_MAX);
+	for (UINT vertex = 0; vertex < vertexCount; vertex++)
+	{
+		_positions[vertex] = *reinterpret_cast<const Vector3*>(vertices + static_cast<size_t>(vertex) * vertexStride);
+		minimum = Vector3::Min(minimum, _positions[vertex]);
+		maximum = Vector3::Max(maximum, _positions[vertex]);
+	}
+	// Positions are matched before they are scaled, which could make different positions equal
+	BuildPositionRemap();
+	Vector3 extent = maximum - minimum;
+	_scale = max(max(extent.x, extent.y), max(extent.z, FLT_MIN));
+	for (Vector3& position : _positions)
+	{
+		position = (position - minimum) / _scale;
+	}
+
+	// The attributes are weighted so that their differences can be added to distances
+	_attributes.resize(static_cast<size_t>(vertexCount) * _attributeCount);
+	for (UINT vertex = 0; vertex < vertexCount; vertex++)
+	{
+		const float* normal = reinterpret_cast<const float*>(vertices + static_cast<size_t>(vertex) * vertexStride + NormalOffset);
+		float* attributes = _attributes.data() + static_cast<size_t>(vertex) * _attributeCount;
+		for (UINT attribute = 0; attribute < _attributeCount; attribute++)
+		{
+			// The texture coordinates follow straight after the normal
+			attributes[attribute] = normal[attribute] * SimplificationAttributeWeight;
+		}
+	}
+
+	BuildAdjacency();
+	ClassifyVertices();
+	BuildQuadrics();
+	_collapseRemap.resize(vertexCount);
+	for (UINT vertex = 0; vertex < vertexCount; vertex++)
+	{
+		_collapseRemap[vertex] = vertex;
+	}
+}
+
+void Simplifier::BuildPositionRemap()
+{
+	// An open addressed hash table of the first vertex with each position
+	size_t tableSize = 1;
+	while (tableSize < static_cast<size_t>(_vertexCount) * 2)
+	{
+		tableSize *= 2;
+	}
+	vector<UINT> table(tableSize, UINT_MAX);
+	_remap.resize(_vertexCount);
+	_wedges.resize(_vertexCount);
+	for (UINT vertex = 0; vertex < _vertexCount; vertex++)
+	{
+		const UINT* bits = reinterpret_cast<const UINT*>(&_positions[vertex]);
+		size_t slot = ((bits[0] * 73856093u) ^ (bits[1] * 19349663u) ^ (bits[2] * 83492791u)) & (tableSize - 1);
+		while (table[slot] != UINT_MAX && _positions[table[slot]] != _positions[vertex])
+		{
+			slot = (slot + 1) & (tableSize - 1);
+		}
+		if (table[slot] == UINT_MAX)
+		{
+			table[slot] = vertex;
+			_remap[vertex] = vertex;
+			_wedges[vertex] = vertex;
+		}
+		else
+		{
+			// Insert the vertex into the ring of the vertices with the same position
+			UINT first = table[slot];
+			_remap[vertex] = first;
+			_wedges[vertex] = _wedges[first];
+			_wedges[first] = vertex;
+		}
+	}
+}
+
+void Simplifier::BuildAdjacency()
+{
+	_cornerOffsets.assign(static_cast<size_t>(_vertexCount) + 1, 0);
+	for (UINT index : _indices)
+	{
+		_cornerOffsets[_remap[index] + 1]++;
+	}
+	for (UINT vertex = 0; vertex < _vertexCount; vertex++)
+	{
+		_cornerOffsets[vertex + 1] += _cornerOffsets[vertex];
+	}
+	// The corners hold the whole triangle, so that the triangles around a position can be
+	// read without going back to the indices
+	_corners.resize(_indices.size());
+	vector<UINT> fill(_cornerOffsets.begin(), _cornerOffsets.end() - 1);
+	for (size_t triangle = 0; triangle < _indices.size(); triangle += 3)
+	{
+		for (UINT corner = 0; corner < 3; corner++)
+		{
+			UINT vertex = _indices[triangle + corner];
+			_corners[fill[_remap[vertex]]++] = { vertex, _indices[triangle + (corner + 1) % 3], _indices[triangle + (corner + 2) % 3] };
+		}
+	}
+}
+
+// Whether a triangle has an edge from one vertex to the other
+bool Simplifier::HasEdge(UINT from, UINT to) const
+{
+	UINT position = _remap[from];
+	for (UINT corner = _cornerOffsets[position]; corner < _cornerOffsets[position + 1]; corner++)
+	{
+		if (_corners[corner].Vertex == from && _corners[corner].Next == to)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+// Whether a triangle has an edge from one position to the other, whichever vertices it uses at them
+bool Simplifier::HasPositionEdge(UINT from, UINT to) const
+{
+	for (UINT corner = _cornerOffsets[from]; corner < _cornerOffsets[from + 1]; corner++)
+	{
+		if (_remap[_corners[corner].Next] == to)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+void Simplifier::ClassifyVertices()
+{
+	_kinds.assign(_vertexCount, VertexKind::Locked);
+	for (UINT position = 0; position < _vertexCount; position++)
+	{
+		if (_remap[position] != position)
+		{
+			continue;
+		}
+		UINT wedgeCount = 1;
+		for (UINT wedge = _wedges[position]; wedge != position; wedge = _wedges[wedge])
+		{
+			wedgeCount++;
+		}
+
+		// Count the edges leaving the position that no triangle comes back along, and those
+		// that come back along them to a different vertex
+		UINT openEdgeCount = 0;
+		UINT seamEdgeCount = 0;
+		for (UINT corner = _cornerOffsets[position]; corner < _cornerOffsets[position + 1]; corner++)
+		{
+			UINT from = _corners[corner].Vertex;
+			UINT to = _corners[corner].Next;
+			if (!HasPositionEdge(_remap[to], position))
+			{
+				openEdgeCount++;
+			}
+			else if (!HasEdge(to, from))
+			{
+				seamEdgeCount++;
+			}
+		}
+
+		VertexKind kind = VertexKind::Locked;
+		if (wedgeCount == 1 && openEdgeCount == 0 && seamEdgeCount == 0)
+		{
+			kind = VertexKind::Manifold;
+		}
+		else if (wedgeCount == 1 && openEdgeCount == 1 && seamEdgeCount == 0)
+		{
+			kind = VertexKind::Border;
+		}
+		else if (wedgeCount == 2 && openEdgeCount == 0 && seamEdgeCount == 2)
+		{
+			// One edge along the seam on each side of it
+			kind = VertexKind::Seam;
+		}
+		UINT wedge = position;
+		do
+		{
+			_kinds[wedge] = kind;
+			wedge = _wedges[wedge];
+		} while (wedge != position);
+	}
+}
+
+void Simplifier::BuildQuadrics()
+{
+	_quadrics.assign(_vertexCount, Quadric());
+	_attributeQuadrics.assign(_vertexCount, AttributeQuadric());
+	for (size_t triangle = 0; triangle < _indices.size(); triangle += 3)
+	{
+		const UINT* corners = &_indices[triangle];
+		const Vector3& position0 = _positions[corners[0]];
+		Vector3 normal = (_positions[corners[1]] - position0).Cross(_positions[corners[2]] - position0);
+		float length = normal.Length();
+		if (length == 0.0f)
+		{
+			continue;
+		}
+		normal /= length;
+		float area = length * 0.5f;
+		float distance = -normal.Dot(position0);
+		for (UINT corner = 0; corner < 3; corner++)
+		{
+			Quadric& quadric = _quadrics[_remap[corners[corner]]];
+			AddPlane(quadric, normal, distance, area);
+			quadric.Weight += area;
+			AddAttributes(_attributeQuadrics[corners[corner]], GetAttributes(corners[corner]), _attributeCount, area);
+		}
+
+		// Open edges add a plane through the edge at right angles to the face. The plane does not add to the
+		// weight, so moving away from the edge costs more than moving away from the face by the same distance
+		for (UINT corner = 0; corner < 3; corner++)
+		{
+			UINT from = _remap[corners[corner]];
+			UINT to = _remap[corners[(corner + 1) % 3]];
+			if (_kinds[from] == VertexKind::Manifold || _kinds[from] == VertexKind::Seam || HasPositionEdge(to, from))
+			{
+				continue;
+			}
+			Vector3 edge = _positions[to] - _positions[from];
+			Vector3 edgeNormal = edge.Cross(normal);
+			float edgeLength = edgeNormal.Length();
+			if (edgeLength == 0.0f)
+			{
+				continue;
+			}
+			edgeNormal /= edgeLength;
+			float edgeDistance = -edgeNormal.Dot(_positions[from]);
+			AddPlane(_quadrics[from], edgeNormal, edgeDistance, edge.LengthSquared() * SimplificationBorderWeight);
+			AddPlane(_quadrics[to], edgeNormal, edgeDistance, edge.LengthSquared() * SimplificationBorderWeight);
+		}
+	}
+}
+
+bool Simplifier::CanCollapse(UINT from, UINT to, bool isOpenEdge, bool isSeamEdge) const
+{
+	switch (_kinds[from])
+	{
+		case VertexKind::Manifold:
+			return true;
+
+		case VertexKind::Border:
+			return isOpenEdge && _kinds[to] == VertexKind::Border;
+
+		case VertexKind::Seam:
+			// The other vertices at both ends must share an edge on the other side of the seam
+			return isSeamEdge && _kinds[to] == VertexKind::Seam && (HasEdge(_wedges[from], _wedges[to]) || HasEdge(_wedges[to], _wedges[from]));
+
+		default:
+			return false;
+	}
+}
+
+void Simplifier::EvaluateCollapse(Collapse& collapse) const
+{
+	const Quadric& quadric = _quadrics[_remap[collapse.From]];
+	float weight = max(quadric.Weight, FLT_MIN);
+	float geometricError = EvaluateQuadric(quadric, _positions[collapse.To]);
+	float attributeError = EvaluateAttributeQuadric(_attributeQuadrics[collapse.From], GetAttributes(collapse.To), _attributeCount);
+	if (_kinds[collapse.From] == VertexKind::Seam)
+	{
+		attributeError += EvaluateAttributeQuadric(_attributeQuadrics[_wedges[collapse.From]], GetAttributes(_wedges[collapse.To]), _attributeCount);
+	}
+	collapse.GeometricError = geometricError / weight;
+	collapse.Error = (geometricError + attributeError) / weight;
+}
+
+void Simplifier::PickCollapses()
+{
+	_collapses.clear();
+	for (size_t triangle = 0; triangle < _indices.size(); triangle += 3)
+	{
+		const UINT* corners = &_indices[triangle];
+		for (UINT corner = 0; corner < 3; corner++)
+		{
+			UINT vertex0 = corners[corner];
+			UINT vertex1 = corners[(corner + 1) % 3];
+			UINT position0 = _remap[vertex0];
+			UINT position1 = _remap[vertex1];
+			if (position0 == position1)
+			{
+				continue;
+			}
+			// Only border and locked vertices have open edges, and only seam and locked vertices have edges along
+			// a seam, so the edges of most vertices do not have to be looked for
+			bool canBeOpenEdge = (_kinds[vertex0] == VertexKind::Border || _kinds[vertex0] == VertexKind::Locked) &&
+				(_kinds[vertex1] == VertexKind::Border || _kinds[vertex1] == VertexKind::Locked);
+			bool canBeSeamEdge = (_kinds[vertex0] == VertexKind::Seam || _kinds[vertex0] == VertexKind::Locked) &&
+				(_kinds[vertex1] == VertexKind::Seam || _kinds[vertex1] == VertexKind::Locked);
+			bool isOpenEdge = canBeOpenEdge && !HasPositionEdge(position1, position0);
+			// Edges inside the mesh are seen from the triangles on both sides of them, and are only picked from one
+			if (position0 > position1 && !isOpenEdge)
+			{
+				continue;
+			}
+			bool isSeamEdge = canBeSeamEdge && !isOpenEdge && !HasEdge(vertex1, vertex0);
+
+			// Pick the cheaper direction that is allowed
+			Collapse forward{ vertex0, vertex1, FLT_MAX, FLT_MAX };
+			Collapse backward{ vertex1, vertex0, FLT_MAX, FLT_MAX };
+			if (CanCollapse(vertex0, vertex1, isOpenEdge, isSeamEdge))
+			{
+				EvaluateCollapse(forward);
+			}
+			if (CanCollapse(vertex1, vertex0, isOpenEdge, isSeamEdge))
+			{
+				EvaluateCollapse(backward);
+			}
+			const Collapse& cheaper = backward.Error < forward.Error ? backward : forward;
+			if (cheaper.Error != FLT_MAX)
+			{
+				_collapses.push_back(cheaper);
+			}
+		}
+	}
+}
+
+void Simplifier::RankCollapses()
+{
+	// A counting sort on the top 16 bits of the errors, which orders positive floats
+	// to within about one percent
+	const UINT bucketCount = 1 << 16;
+	vector<UINT> bucketOffsets(bucketCount + 1, 0);
+	for (const Collapse& collapse : _collapses)
+	{
+		bucketOffsets[(*reinterpret_cast<const UINT*>(&collapse.Error) >> 16) + 1]++;
+	}
+	for (UINT bucket = 0; bucket < bucketCount; bucket++)
+	{
+		bucketOffsets[bucket + 1] += bucketOffsets[bucket];
+	}
+	// The collapses are copied rather than indexed, so that they are read in order when they are made
+	_rankedCollapses.resize(_collapses.size());
+	for (const Collapse& collapse : _collapses)
+	{
+		_rankedCollapses[bucketOffsets[*reinterpret_cast<const UINT*>(&collapse.Error) >> 16]++] = collapse;
+	}
+}
+
+// Whether moving a position onto that of another vertex would turn over any of its triangles
+bool Simplifier::HasTriangleFlip(UINT from, UINT to) const
+{
+	UINT position = _remap[from];
+	const Vector3& newPosition = _positions[to];
+	const Vector3& oldPosition = _positions[from];
+	for (UINT corner = _cornerOffsets[position]; corner < _cornerOffsets[position + 1]; corner++)
+	{
+		// Take the collapses made earlier in this pass into account. The position being moved has not been collapsed
+		UINT next = _collapseRemap[_corners[corner].Next];
+		UINT previous = _collapseRemap[_corners[corner].Previous];
+		// Triangles on the edge that is collapsed are removed
+		if (_remap[next] == _remap[to] || _remap[previous] == _remap[to])
+		{
+			continue;
+		}
+		Vector3 oldNormal = (_positions[next] - oldPosition).Cross(_positions[previous] - oldPosition);
+		Vector3 newNormal = (_positions[next] - newPosition).Cross(_positions[previous] - newPosition);
+		// The cosine of the angle between the normals is compared squared, to avoid the square root
+		float dot = oldNormal.Dot(newNormal);
+		if (dot <= 0.0f || dot * dot <= SimplificationFlipCosine * SimplificationFlipCosine * oldNormal.LengthSquared() * newNormal.LengthSquared())
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+size_t Simplifier::PerformCollapses(size_t triangleCollapseGoal, float errorGoal)
+{
+	_isCollapseLocked.assign(_vertexCount, false);
+	_isCollapsed.assign(_vertexCount, false);
+	size_t triangleCollapseCount = 0;
+	for (const Collapse& collapse : _rankedCollapses)
+	{
+		if (collapse.Error > errorGoal)
+		{
+			break;
+		}
+		UINT position0 = _remap[collapse.From];
+		UINT position1 = _remap[collapse.To];
+		// The error of a collapse only depends on the quadric of the position that is moved and on the position
+		// it is moved to, so several positions can be collapsed into the same one in a pass
+		if (_isCollapseLocked[position0] || _isCollapsed[position1] || HasTriangleFlip(collapse.From, collapse.To))
+		{
+			continue;
+		}
+
+		_collapseRemap[collapse.From] = collapse.To;
+		AddAttributeQuadric(_attributeQuadrics[collapse.To], _attributeQuadrics[collapse.From]);
+		if (_kinds[collapse.From] == VertexKind::Seam)
+		{
+			// The other side of the seam moves along with it
+			_collapseRemap[_wedges[collapse.From]] = _wedges[collapse.To];
+			AddAttributeQuadric(_attributeQuadrics[_wedges[collapse.To]], _attributeQuadrics[_wedges[collapse.From]]);
+		}
+		AddQuadric(_quadrics[position1], _quadrics[position0]);
+		_isCollapseLocked[position0] = true;
+		_isCollapseLocked[position1] = true;
+		_isCollapsed[position0] = true;
+		_error = max(_error, collapse.GeometricError);
+
+		// A collapse inside the mesh removes two triangles and one on an open edge removes one
+		triangleCollapseCount += _kinds[collapse.From] == VertexKind::Border ? 1 : 2;
+		if (triangleCollapseCount >= triangleCollapseGoal)
+		{
+			break;
+		}
+	}
+	return triangleCollapseCount;
+}
+
+void Simplifier::RemapIndices()
+{
+	size_t writeIndex = 0;
+	for (size_t triangle = 0; triangle < _indices.size(); triangle += 3)
+	{
+		UINT corner0 = _collapseRemap[_indices[triangle]];
+		UINT corner1 = _collapseRemap[_indices[triangle + 1]];
+		UINT corner2 = _collapseRemap[_indices[triangle + 2]];
+		// Triangles with two corners at the same position have no area left
+		if (_remap[corner0] != _remap[corner1] && _remap[corner0] != _remap[corner2] && _remap[corner1] != _remap[corner2])
+		{
+			_indices[writeIndex++] = corner0;
+			_indices[writeIndex++] = corner1;
+			_indices[writeIndex++] = corner2;
+		}
+	}
+	_indices.resize(writeIndex);
+}
+
+void Simplifier::Simplify(size_t targetIndexCount, float errorLimit)
+{
+	// The error limit is a distance in the units of the mesh, and the errors are squared distances in the unit cube
+	float scaledErrorLimit = errorLimit < FLT_MAX ? (errorLimit / _scale) * (errorLimit / _scale) : FLT_MAX;
+	while (_indices.size() > targetIndexCount)
+	{
+		BuildAdjacency();
+		PickCollapses();
+		if (_collapses.empty())
+		{
+			break;
+		}
+		RankCollapses();
+
+		// Most collapses remove two triangles, but some are always turned down because they would turn a triangle
+		// over, so twice as many are allowed for. Collapses of much greater error than those are left for a later
+		// pass, when the ones around them have been made and their errors are known
+		size_t triangleCollapseGoal = max((_indices.size() - targetIndexCount) / 3, static_cast<size_t>(1));
+		float errorGoal = triangleCollapseGoal < _rankedCollapses.size() ? min(_rankedCollapses[triangleCollapseGoal].Error * 1.5f, scaledErrorLimit) : scaledErrorLimit;
+		size_t triangleCollapseCount = PerformCollapses(triangleCollapseGoal, errorGoal);
+		if (triangleCollapseCount == 0 && errorGoal < scaledErrorLimit)
+		{
+			// Every collapse within the goal was turned down
+			triangleCollapseCount = PerformCollapses(triangleCollapseGoal, scaledErrorLimit);
+		}
+		if (triangleCollapseCount == 0)
+		{
+			break;
+		}
+		RemapIndices();
+	}
+}
+
+float SimplifyMesh(const BYTE* vertices, UINT vertexStride, UINT vertexCount, const vector<UINT>& indices, size_t targetIndexCount, float errorLimit, vector<UINT>& simplifiedIndices)
+{
+	Simplifier simplifier(vertices, vertexStride, vertexCount, indices);
+	simplifier.Simplify(targetIndexCount, errorLimit);
+	simplifiedIndices = simplifier.GetIndices();
+	return simplifier.GetError();
+}
+
+vector<LevelOfDetail> BuildLevelsOfDetail(const BYTE* vertices, UINT vertexStride, UINT vertexCount, vector<UINT>& indices)
+{
+	vector<LevelOfDetail> levels(1);
+	levels[0].IndexCount = static_cast<UINT>(indices.size());
+	size_t triangleCount = indices.size() / 3;
+	if (triangleCount * LevelOfDetailReduction < LevelOfDetailMinTriangles)
+	{
+		return levels;
+	}
+
+	// Each level is simplified further from the one before it, and its errors are measured against the original mesh
+	Simplifier simplifier(vertices, vertexStride, vertexCount, indices);
+	size_t originalIndexCount = indices.size();
+	while (levels.size() < LevelOfDetailMaxLevels)
+	{
+		size_t targetTriangleCount = static_cast<size_t>(triangleCount * LevelOfDetailReduction);
+		if (targetTriangleCount < LevelOfDetailMinTriangles)
+		{
+			break;
+		}
+		simplifier.Simplify(targetTriangleCount * 3, FLT_MAX);
+		vector<UINT> levelIndices = simplifier.GetIndices();
+		size_t levelTriangleCount = levelIndices.size() / 3;
+		if (levelTriangleCount > triangleCount * (1.0f - LevelOfDetailMinReduction))
+		{
+			break;
+		}
+		OptimiseVertexCache(levelIndices, vertexCount);
+
+		LevelOfDetail level;
+		level.StartIndex = static_cast<UINT>(indices.size());
+		level.IndexCount = static_cast<UINT>(levelIndices.size());
+		level.EstimatedError = simplifier.GetError();
+		level.MeasuredError = MeasureSimplificationError(vertices, vertexStride, indices.data(), originalIndexCount, levelIndices.data(), levelIndices.size());
+		// The quadrics give a mean distance rather than the largest one, so the measured error is used
+		// where it is greater. Coarser levels never have a smaller error than finer ones
+		level.Error = max(max(level.EstimatedError, level.MeasuredError), levels.back().Error);
+		levels.push_back(level);
+		indices.insert(indices.end(), levelIndices.begin(), levelIndices.end());
+		triangleCount = levelTriangleCount;
+	}
+	return levels;
+}
+
+// The squared distance from a point to the nearest point of a triangle (Ericson, Real-Time Collision Detection 5.1.5)
+static float TriangleDistanceSquared(const Vector3& point, const Vector3& a, const Vector3& b, const Vector3& c)
+{
+	Vector3 ab = b - a;
+	Vector3 ac = c - a;
+	Vector3 ap = point - a;
+	float d1 = ab.Dot(ap);
+	float d2 = ac.Dot(ap);
+	if (d1 <= 0.0f && d2 <= 0.0f)
+	{
+		return ap.LengthSquared();
+	}
+	Vector3 bp = point - b;
+	float d3 = ab.Dot(bp);
+	float d4 = ac.Dot(bp);
+	if (d3 >= 0.0f && d4 <= d3)
+	{
+		return bp.LengthSquared();
+	}
+	float vc = d1 * d4 - d3 * d2;
+	if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f)
+	{
+		return (ap - ab * (d1 / (d1 - d3))).LengthSquared();
+	}
+	Vector3 cp = point - c;
+	float d5 = ab.Dot(cp);
+	float d6 = ac.Dot(cp);
+	if (d6 >= 0.0f && d5 <= d6)
+	{
+		return cp.LengthSquared();
+	}
+	float vb = d5 * d2 - d1 * d6;
+	if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f)
+	{
+		return (ap - ac * (d2 / (d2 - d6))).LengthSquared();
+	}
+	float va = d3 * d6 - d5 * d4;
+	if (va <= 0.0f && (d4 - d3) >= 0.0f && (d5 - d6) >= 0.0f)
+	{
+		return (bp - (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)))).LengthSquared();
+	}
+	float denominator = 1.0f / (va + vb + vc);
+	return (ap - ab * (vb * denominator) - ac * (vc * denominator)).LengthSquared();
+}
+
+float MeasureSimplificationError(const BYTE* vertices, UINT vertexStride, const UINT* indices, size_t indexCount, const UINT* simplifiedIndices, size_t simplifiedIndexCount)
+{
+	if (indexCount == 0)
+	{
+		return 0.0f;
+	}
+	if (simplifiedIndexCount == 0)
+	{
+		return FLT_MAX;
+	}
+	auto position = [&](UINT vertex) -> const Vector3& { return *reinterpret_cast<const Vector3*>(vertices + static_cast<size_t>(vertex) * vertexStride); };
+
+	// The simplified triangles are put into a uniform grid of cells about as large as their edges
+	Vector3 minimum(FLT_MAX);
+	Vector3 maximum(-FLT_MAX);
+	UINT vertexCount = 0;
+	for (size_t index = 0; index < indexCount; index++)
+	{
+		minimum = Vector3::Min(minimum, position(indices[index]));
+		maximum = Vector3::Max(maximum, position(indices[index]));
+		vertexCount = max(vertexCount, indices[index] + 1);
+	}
+	float edgeLength = 0.0f;
+	for (size_t index = 0; index < simplifiedIndexCount; index++)
+	{
+		minimum = Vector3::Min(minimum, position(simplifiedIndices[index]));
+		maximum = Vector3::Max(maximum, position(simplifiedIndices[index]));
+		vertexCount = max(vertexCount, simplifiedIndices[index] + 1);
+		edgeLength += Vector3::Distance(position(simplifiedIndices[index]), position(simplifiedIndices[index - index % 3 + (index + 1) % 3]));
+	}
+	size_t triangleCount = simplifiedIndexCount / 3;
+	Vector3 extent = maximum - minimum;
+	float cellSize = max(max(edgeLength / simplifiedIndexCount, max(max(extent.x, extent.y), extent.z) / 1024.0f), FLT_MIN);
+	int cellCounts[3];
+	for (;;)
+	{
+		cellCounts[0] = static_cast<int>(extent.x / cellSize) + 1;
+		cellCounts[1] = static_cast<int>(extent.y / cellSize) + 1;
+		cellCounts[2] = static_cast<int>(extent.z / cellSize) + 1;
+		if (static_cast<size_t>(cellCounts[0]) * cellCounts[1] * cellCounts[2] <= triangleCount * 4 + 64)
+		{
+			break;
+		}
+		cellSize *= 1.25f;
+	}
+	auto cellOf = [&](const Vector3& point, int axis) { return min(static_cast<int>(((&point.x)[axis] - (&minimum.x)[axis]) / cellSize), cellCounts[axis] - 1); };
+	auto cellIndex = [&](int x, int y, int z) { return (static_cast<size_t>(z) * cellCounts[1] + y) * cellCounts[0] + x; };
+
+	// Every triangle is added to every cell its bounding box touches
+	auto forEachCell = [&](size_t triangle, const function<void(size_t)>& visit)
+	{
+		const UINT* corners = simplifiedIndices + triangle * 3;
+		Vector3 triangleMinimum = Vector3::Min(Vector3::Min(position(corners[0]), position(corners[1])), position(corners[2]));
+		Vector3 triangleMaximum = Vector3::Max(Vector3::Max(position(corners[0]), position(corners[1])), position(corners[2]));
+		for (int z = cellOf(triangleMinimum, 2); z <= cellOf(triangleMaximum, 2); z++)
+		{
+			for (int y = cellOf(triangleMinimum, 1); y <= cellOf(triangleMaximum, 1); y++)
+			{
+				for (int x = cellOf(triangleMinimum, 0); x <= cellOf(triangleMaximum, 0); x++)
+				{
+					visit(cellIndex(x, y, z));
+				}
+			}
+		}
+	};
+	size_t cellCount = static_cast<size_t>(cellCounts[0]) * cellCounts[1] * cellCounts[2];
+	vector<UINT> cellOffsets(cellCount + 1, 0);
+	for (size_t triangle = 0; triangle < triangleCount; triangle++)
+	{
+		forEachCell(triangle, [&](size_t cell) { cellOffsets[cell + 1]++; });
+	}
+	for (size_t cell = 0; cell < cellCount; cell++)
+	{
+		cellOffsets[cell + 1] += cellOffsets[cell];
+	}
+	vector<UINT> cellTriangles(cellOffsets[cellCount]);
+	vector<UINT> cellFill(cellOffsets.begin(), cellOffsets.end() - 1);
+	for (size_t triangle = 0; triangle < triangleCount; triangle++)
+	{
+		forEachCell(triangle, [&](size_t cell) { cellTriangles[cellFill[cell]++] = static_cast<UINT>(triangle); });
+	}
+
+	// Search outwards from the cell of every vertex, one shell of cells at a time. Once the nearest
+	// triangle found is closer than the inside of the next shell, no other triangle can be nearer
+	vector<bool> isMeasured(vertexCount, false);
+	float largestDistanceSquared = 0.0f;
+	int maxShell = max(max(cellCounts[0], cellCounts[1]), cellCounts[2]);
+	for (size_t index = 0; index < indexCount; index++)
+	{
+		UINT vertex = indices[index];
+		if (isMeasured[vertex])
+		{
+			continue;
+		}
+		isMeasured[vertex] = true;
+		const Vector3& point = position(vertex);
+		int cell[3] = { cellOf(point, 0), cellOf(point, 1), cellOf(point, 2) };
+		float nearestDistanceSquared = FLT_MAX;
+		for (int shell = 0; shell <= maxShell; shell++)
+		{
+			for (int z = max(cell[2] - shell, 0); z <= min(cell[2] + shell, cellCounts[2] - 1); z++)
+			{
+				for (int y = max(cell[1] - shell, 0); y <= min(cell[1] + shell, cellCounts[1] - 1); y++)
+				{
+					for (int x = max(cell[0] - shell, 0); x <= min(cell[0] + shell, cellCounts[0] - 1); x++)
+					{
+						if (max(max(abs(x - cell[0]), abs(y - cell[1])), abs(z - cell[2])) != shell)
+						{
+							continue;
+						}
+						size_t searchCell = cellIndex(x, y, z);
+						for (UINT entry = cellOffsets[searchCell]; entry < cellOffsets[searchCell + 1]; entry++)
+						{
+							const UINT* corners = simplifiedIndices + static_cast<size_t>(cellTriangles[entry]) * 3;
+							nearestDistanceSquared = min(nearestDistanceSquared, TriangleDistanceSquared(point, position(corners[0]), position(corners[1]), position(corners[2])));
+						}
+					}
+				}
+			}
+			// The distance to the nearest wall of the cells searched so far. There is nothing beyond the walls of the grid
+			float wallDistance = FLT_MAX;
+			for (int axis = 0; axis < 3; axis++)
+			{
+				float offset = (&point.x)[axis] - (&minimum.x)[axis];
+				if (cell[axis] - shell > 0)
+				{
+					wallDistance = min(wallDistance, offset - (cell[axis] - shell) * cellSize);
+				}
+				if (cell[axis] + shell < cellCounts[axis] - 1)
+				{
+					wallDistance = min(wallDistance, (cell[axis] + shell + 1) * cellSize - offset);
+				}
+			}
+			if (nearestDistanceSquared <= wallDistance * wallDistance)
+			{
+				break;
+			}
+		}
+		largestDistanceSquared = max(largestDistanceSquared, nearestDistanceSquared);
+	}
+	return sqrtf(largestDistanceSquared);
+}
+
+wstring BenchmarkSimplification(size_t triangleCount)
+{
+	struct BenchmarkVertex
+	{
+		Vector3		Position;
+		Vector3		Normal;
+	};
+
+	// A rolling grid with open edges all round
+	UINT side = max(2u, static_cast<UINT>(ceil(sqrt(triangleCount / 2.0)))) + 1;
+	vector<BenchmarkVertex> vertices(static_cast<size_t>(side) * side);
+	for (UINT row = 0; row < side; row++)
+	{
+		for (UINT column = 0; column < side; column++)
+		{
+			float x = static_cast<float>(column) / side;
+			float z = static_cast<float>(row) / side;
+			vertices[static_cast<size_t>(row) * side + column].Position = Vector3(x, 0.05f * sinf(x * 10.0f) * cosf(z * 8.0f), z);
+		}
+	}
+	vector<UINT> indices;
+	indices.reserve(static_cast<size_t>(side - 1) * (side - 1) * 6);
+	for (UINT row = 0; row + 1 < side; row++)
+	{
+		for (UINT column = 0; column + 1 < side; column++)
+		{
+			UINT corner = row * side + column;
+			indices.insert(indices.end(), { corner, corner + side, corner + 1, corner + 1, corner + side, corner + side + 1 });
+		}
+	}
+	GenerateNormals(vertices, indices);
+	const BYTE* vertexData = reinterpret_cast<const BYTE*>(vertices.data());
+	UINT vertexCount = static_cast<UINT>(vertices.size());
+
+	// Simplification alone, down to one percent of the triangles
+	vector<UINT> simplifiedIndices;
+	auto startTime = chrono::high_resolution_clock::now();
+	float error = SimplifyMesh(vertexData, sizeof(BenchmarkVertex), vertexCount, indices, indices.size() / 100, FLT_MAX, simplifiedIndices);
+	double simplificationTime = chrono::duration<double, milli>(chrono::high_resolution_clock::now() - startTime).count();
+	float measuredError = MeasureSimplificationError(vertexData, sizeof(BenchmarkVertex), indices.data(), indices.size(), simplifiedIndices.data(), simplifiedIndices.size());
+	wstring report = L"Simplification of " + to_wstring(indices.size() / 3) + L" triangles to " + to_wstring(simplifiedIndices.size() / 3) + L": " +
+		to_wstring(simplificationTime) + L" ms, " + to_wstring(indices.size() / 3 / simplificationTime / 1000.0) + L" million triangles per second, error " +
+		to_wstring(error) + L" estimated, " + to_wstring(measuredError) + L" measured\n";
+
+	// The whole chain, including the cache optimisation and the measurement of every level
+	startTime = chrono::high_resolution_clock::now();
+	vector<LevelOfDetail> levels = BuildLevelsOfDetail(vertexData, sizeof(BenchmarkVertex), vertexCount, indices);
+	double chainTime = chrono::duration<double, milli>(chrono::high_resolution_clock::now() - startTime).count();
+	report += L"Levels of detail built in " + to_wstring(chainTime) + L" ms\n";
+	for (size_t level = 0; level < levels.size(); level++)
+	{
+		report += L"Level " + to_wstring(level) + L": " + to_wstring(levels[level].IndexCount / 3) + L" triangles, error " + to_wstring(levels[level].EstimatedError) +
+			L" estimated, " + to_wstring(levels[level].MeasuredError) + L" measured\n";
+	}
+	return report;
+}
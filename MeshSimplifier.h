@@ -0,0 +1,76 @@
+#pragma once
+#include <vector>
+#include "core.h"
+#include "DirectXCore.h"
+
+using namespace std;
+
+// Simplification of meshes into a chain of levels of detail.
+//
+// Edges are collapsed in order of their quadric error (Garland and Heckbert 1997). Each
+// vertex keeps the sum of the planes of the faces around it, weighted by their area, and
+// the error of moving it is the mean squared distance of its new position from those planes.
+// The planes are carried along as vertices are merged, so the error of every level is measured
+// against the original surface. The attributes of a vertex add an error of their own: the
+// squared difference between the attributes that are kept and those of every vertex that has
+// been merged into it, weighted in the same way.
+//
+// Vertices are only ever removed, so every level uses the vertices of the original mesh and
+// only the indices differ. To keep the outline of open meshes and the seams between vertices
+// with different attributes, vertices are classified before any are removed:
+//
+//   Manifold	May be collapsed into any vertex it shares an edge with
+//   Border		On an open edge. Only collapsed along that edge into another border vertex, and the
+//				planes through the open edges, at right angles to the faces, are weighted heavily
+//   Seam		Shares its position with exactly one other vertex. Only collapsed along the seam, with
+//				the other vertex collapsed along the other side of it
+//   Locked		Anything else, such as the corners of a seam or a vertex on several open edges. Never removed
+//
+// Collapses that would turn any triangle over are not made.
+//
+// Every vertex format must start with its position and its normal, as Vector3, which may be
+// followed by the texture coordinates, as a Vector2.
+
+// Each level has at most this fraction of the triangles of the one before it
+#define LevelOfDetailReduction		0.5f
+// Levels are not made with fewer triangles than this, or when a level could not be reduced by at
+// least the minimum reduction
+#define LevelOfDetailMinTriangles	128
+#define LevelOfDetailMinReduction	0.1f
+#define LevelOfDetailMaxLevels		8
+// How much more moving away from an open edge costs than moving away from a face
+#define SimplificationBorderWeight	16.0f
+// A difference of one in the normal or the texture coordinates costs as much as moving this fraction of the size of the mesh
+#define SimplificationAttributeWeight	0.05f
+
+// A range of the concatenated indices of every level. The error is the largest distance of a surface
+// from the original one, in the units of the mesh. The estimated error is the one given by the
+// quadrics, while the measured error is the largest distance of a vertex of the original mesh
+// from the simplified surface
+struct LevelOfDetail
+{
+	UINT		StartIndex{ 0 };
+	UINT		IndexCount{ 0 };
+	float		EstimatedError{ 0 };
+	float		MeasuredError{ 0 };
+	float		Error{ 0 };
+	// The meshlets the indices of the level were split into (see Meshlets.h), if they have been
+	UINT		FirstMeshlet{ 0 };
+	UINT		MeshletCount{ 0 };
+};
+
+// Simplify a triangle list until it has no more than the target number of indices or no edge can be
+// collapsed without the error going over the limit. Returns the estimated error of the result
+float SimplifyMesh(const BYTE* vertices, UINT vertexStride, UINT vertexCount, const vector<UINT>& indices, size_t targetIndexCount, float errorLimit, vector<UINT>& simplifiedIndices);
+
+// Build the chain of levels of detail for a mesh. The indices of the first level are those given, and
+// the indices of each following level are added to the end of them. Each level is optimised for the
+// post-transform cache. Returns the levels, starting with the original mesh
+vector<LevelOfDetail> BuildLevelsOfDetail(const BYTE* vertices, UINT vertexStride, UINT vertexCount, vector<UINT>& indices);
+
+// The largest distance of a vertex used by the original triangles from the nearest of the simplified ones
+float MeasureSimplificationError(const BYTE* vertices, UINT vertexStride, const UINT* indices, size_t indexCount, const UINT* simplifiedIndices, size_t simplifiedIndexCount);
+
+// Time building the levels of detail of a grid of the given number of triangles, and return a report of
+// the time and the errors of every level
+wstring BenchmarkSimplification(size_t triangleCount);
@@ -0,0 +1,512 @@
+#include <algorithm>
+#include <chrono>
+#include <cfloat>
+#include <climits>
+#include <cmath>
+#include "Meshlets.h"
+#include "MeshOptimiser.h"
+
+// Marks a vertex that is not in the meshlet being grown
+#define NoMeshletSlot		0xFF
+#define NoTriangle			0xFFFFFFFF
+
+static const Vector3& GetPosition(const BYTE* vertices, UINT vertexStride, UINT vertex)
+{
+	return *reinterpret_cast<const Vector3*>(vertices + static_cast<size_t>(vertex) * vertexStride);
+}
+
+class MeshletBuilder
+{
+public:
+	MeshletBuilder(const BYTE* vertices, UINT vertexStride, UINT vertexCount, const UINT* indices, UINT triangleCount);
+
+	// Grow the meshlets, writing their triangles to orderedIndices in the order of the meshlets. The
+	// ranges of the meshlets start at startIndex
+	void Build(UINT startIndex, UINT* orderedIndices, vector<Meshlet>& meshlets);
+
+private:
+	const BYTE*				_vertices;
+	UINT					_vertexStride;
+	const UINT*				_indices;
+	UINT					_triangleCount;
+	vector<Vector3>			_centroids;
+	// The unit normal of every triangle, which is zero for triangles without any area
+	vector<Vector3>			_normals;
+	float					_expectedRadius{ 1.0f };
+
+	// The triangles around each vertex. The first of them are those that are not yet in a meshlet,
+	// and the live count of the vertex is how many of them there are
+	vector<UINT>			_triangleOffsets;
+	vector<UINT>			_vertexTriangles;
+	vector<UINT>			_liveCounts;
+	vector<bool>			_isEmitted;
+	UINT					_nextSeed{ 0 };
+
+	// The meshlet being grown. The slot of a vertex is its place in the meshlet, if it is in it
+	vector<BYTE>			_meshletSlots;
+	vector<UINT>			_meshletVertices;
+	vector<UINT>			_lastMeshletVertices;
+	vector<UINT>			_localIndices;
+	UINT					_meshletTriangleCount{ 0 };
+	Vector3					_centroidSum;
+	Vector3					_normalSum;
+
+	UINT FindSeed() const;
+	UINT FindCandidate() const;
+	void AddTriangle(UINT triangle, UINT* orderedIndices);
+	Meshlet FinishMeshlet(UINT startIndex, UINT* meshletIndices);
+	UINT CountNewVertices(UINT triangle) const;
+};
+
+MeshletBuilder::MeshletBuilder(const BYTE* vertices, UINT vertexStride, UINT vertexCount, const UINT* indices, UINT triangleCount) :
+	_vertices(vertices), _vertexStride(vertexStride), _indices(indices), _triangleCount(triangleCount),
+	_centroids(triangleCount), _normals(triangleCount), _triangleOffsets(static_cast<size_t>(vertexCount) + 1, 0), _liveCounts(vertexCount, 0),
+	_isEmitted(triangleCount, false), _meshletSlots(vertexCount, NoMeshletSlot)
+{
+	float area = 0.0f;
+	for (UINT triangle = 0; triangle < triangleCount; triangle++)
+	{
+		const UINT* corners = indices + static_cast<size_t>(triangle) * 3;
+		const Vector3& a = GetPosition(vertices, vertexStride, corners[0]);
+		const Vector3& b = GetPosition(vertices, vertexStride, corners[1]);
+		const Vector3& c = GetPosition(vertices, vertexStride, corners[2]);
+		_centroids[triangle] = (a + b + c) / 3.0f;
+		// Clockwise triangles face the way of this normal
+		Vector3 normal = (b - a).Cross(c - a);
+		float length = normal.Length();
+		_normals[triangle] = length > 0.0f ? normal / length : Vector3::Zero;
+		area += length * 0.5f;
+		for (int corner = 0; corner < 3; corner++)
+		{
+			_liveCounts[corners[corner]]++;
+		}
+	}
+	// Distances from the centre of a meshlet are measured against the radius of a full meshlet of average triangles
+	if (triangleCount > 0)
+	{
+		_expectedRadius = max(sqrtf(area / triangleCount * MeshletMaxTriangles / XM_PI), FLT_MIN);
+	}
+
+	for (UINT vertex = 0; vertex < vertexCount; vertex++)
+	{
+		_triangleOffsets[vertex + 1] = _triangleOffsets[vertex] + _liveCounts[vertex];
+	}
+	_vertexTriangles.resize(static_cast<size_t>(triangleCount) * 3);
+	vector<UINT> fill(_triangleOffsets.begin(), _triangleOffsets.end() - 1);
+	for (UINT triangle = 0; triangle < triangleCount; triangle++)
+	{
+		for (int corner = 0; corner < 3; corner++)
+		{
+			_vertexTriangles[fill[indices[triangle * 3 + corner]]++] = triangle;
+		}
+	}
+	_meshletVertices.reserve(MeshletMaxVertices);
+	_lastMeshletVertices.reserve(MeshletMaxVertices);
+}
+
+void MeshletBuilder::Build(UINT startIndex, UINT* orderedIndices, vector<Meshlet>& meshlets)
+{
+	UINT emittedTriangleCount = 0;
+	while (emittedTriangleCount < _triangleCount)
+	{
+		// Start each meshlet next to the last one, where there is anything left there
+		UINT* meshletIndices = orderedIndices + static_cast<size_t>(emittedTriangleCount) * 3;
+		UINT triangle = FindSeed();
+		while (triangle != NoTriangle)
+		{
+			AddTriangle(triangle, meshletIndices);
+			triangle = _meshletTriangleCount < MeshletMaxTriangles ? FindCandidate() : NoTriangle;
+		}
+		meshlets.push_back(FinishMeshlet(startIndex + emittedTriangleCount * 3, meshletIndices));
+		emittedTriangleCount += meshlets.back().IndexCount / 3;
+	}
+}
+
+UINT MeshletBuilder::FindSeed() const
+{
+	// Of the triangles next to the last meshlet, the one whose vertices have the fewest triangles left
+	// around them, which stops small islands of triangles from being left behind
+	UINT seed = NoTriangle;
+	UINT seedLiveCount = UINT_MAX;
+	for (UINT vertex : _lastMeshletVertices)
+	{
+		for (UINT i = 0; i < _liveCounts[vertex]; i++)
+		{
+			UINT triangle = _vertexTriangles[_triangleOffsets[vertex] + i];
+			const UINT* corners = _indices + static_cast<size_t>(triangle) * 3;
+			UINT liveCount = _liveCounts[corners[0]] + _liveCounts[corners[1]] + _liveCounts[corners[2]];
+			if (liveCount < seedLiveCount)
+			{
+				seed = triangle;
+				seedLiveCount = liveCount;
+			}
+		}
+	}
+	if (seed != NoTriangle)
+	{
+		return seed;
+	}
+	// Otherwise the next triangle in the order they were given in, which for a cache optimised mesh is near the last
+	return _nextSeed < _triangleCount ? _nextSeed : NoTriangle;
+}
+
+UINT MeshletBuilder::CountNewVertices(UINT triangle) const
+{
+	const UINT* corners = _indices + static_cast<size_t>(triangle) * 3;
+	return (_meshletSlots[corners[0]] == NoMeshletSlot) + (_meshletSlots[corners[1]] == NoMeshletSlot) + (_meshletSlots[corners[2]] == NoMeshletSlot);
+}
+
+UINT MeshletBuilder::FindCandidate() const
+{
+	// Only the triangles that share a vertex with the meshlet are considered. Those that add the fewest
+	// vertices come first, then those nearest the centre of the meshlet and facing the same way as it
+	// (Kapoulkine, meshoptimizer)
+	Vector3 centre = _centroidSum / static_cast<float>(_meshletTriangleCount);
+	Vector3 axis = _normalSum;
+	axis.Normalize();
+	UINT candidate = NoTriangle;
+	UINT candidatePriority = UINT_MAX;
+	float candidateCost = FLT_MAX;
+	for (UINT vertex : _meshletVertices)
+	{
+		for (UINT i = 0; i < _liveCounts[vertex]; i++)
+		{
+			UINT triangle = _vertexTriangles[_triangleOffsets[vertex] + i];
+			UINT newVertexCount = CountNewVertices(triangle);
+			if (_meshletVertices.size() + newVertexCount > MeshletMaxVertices)
+			{
+				continue;
+			}
+			// A triangle that is the last one left around one of its vertices would otherwise be left behind
+			// on its own, so it goes before any other that adds vertices
+			UINT priority = newVertexCount;
+			if (newVertexCount != 0)
+			{
+				const UINT* corners = _indices + static_cast<size_t>(triangle) * 3;
+				priority = (_liveCounts[corners[0]] == 1 || _liveCounts[corners[1]] == 1 || _liveCounts[corners[2]] == 1) ? 1 : newVertexCount + 1;
+			}
+			if (priority > candidatePriority)
+			{
+				continue;
+			}
+			float distance = Vector3::Distance(_centroids[triangle], centre) / _expectedRadius;
+			float cost = distance + MeshletConeWeight * (1.0f - _normals[triangle].Dot(axis));
+			if (priority < candidatePriority || cost < candidateCost)
+			{
+				candidate = triangle;
+				candidatePriority = priority;
+				candidateCost = cost;
+			}
+		}
+	}
+	return candidate;
+}
+
+void MeshletBuilder::AddTriangle(UINT triangle, UINT* meshletIndices)
+{
+	const UINT* corners = _indices + static_cast<size_t>(triangle) * 3;
+	for (int corner = 0; corner < 3; corner++)
+	{
+		UINT vertex = corners[corner];
+		if (_meshletSlots[vertex] == NoMeshletSlot)
+		{
+			_meshletSlots[vertex] = static_cast<BYTE>(_meshletVertices.size());
+			_meshletVertices.push_back(vertex);
+		}
+		meshletIndices[_meshletTriangleCount * 3 + corner] = vertex;
+
+		// Move the triangle past the live triangles around the vertex
+		UINT* vertexTriangles = &_vertexTriangles[_triangleOffsets[vertex]];
+		UINT liveCount = --_liveCounts[vertex];
+		for (UINT i = 0; i <= liveCount; i++)
+		{
+			if (vertexTriangles[i] == triangle)
+			{
+				swap(vertexTriangles[i], vertexTriangles[liveCount]);
+				break;
+			}
+		}
+	}
+	_isEmitted[triangle] = true;
+	_centroidSum += _centroids[triangle];
+	_normalSum += _normals[triangle];
+	_meshletTriangleCount++;
+}
+
+Meshlet MeshletBuilder::FinishMeshlet(UINT startIndex, UINT* meshletIndices)
+{
+	Meshlet meshlet;
+	meshlet.StartIndex = startIndex;
+	meshlet.IndexCount = _meshletTriangleCount * 3;
+	meshlet.VertexCount = static_cast<UINT>(_meshletVertices.size());
+
+	// The bounding sphere is centred on the bounding box of the vertices
+	Vector3 minimum(FLT_MAX, FLT_MAX, FLT_MAX);
+	Vector3 maximum(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+	for (UINT vertex : _meshletVertices)
+	{
+		const Vector3& position = GetPosition(_vertices, _vertexStride, vertex);
+		minimum = Vector3::Min(minimum, position);
+		maximum = Vector3::Max(maximum, position);
+	}
+	meshlet.Centre = (minimum + maximum) * 0.5f;
+	for (UINT vertex : _meshletVertices)
+	{
+		meshlet.Radius = max(meshlet.Radius, Vector3::Distance(meshlet.Centre, GetPosition(_vertices, _vertexStride, vertex)));
+	}
+
+	// The axis of the cone is the average of the normals and its angle is the largest angle of any normal from it
+	Vector3 axis = _normalSum;
+	axis.Normalize();
+	float minimumCosine = 1.0f;
+	for (UINT triangle = 0; triangle < _meshletTriangleCount; triangle++)
+	{
+		const Vector3& a = GetPosition(_vertices, _vertexStride, meshletIndices[triangle * 3]);
+		Vector3 normal = (GetPosition(_vertices, _vertexStride, meshletIndices[triangle * 3 + 1]) - a).Cross(GetPosition(_vertices, _vertexStride, meshletIndices[triangle * 3 + 2]) - a);
+		if (normal != Vector3::Zero)
+		{
+			normal.Normalize();
+			minimumCosine = min(minimumCosine, normal.Dot(axis));
+		}
+	}
+	meshlet.ConeAxis = axis;
+	meshlet.ConeApex = meshlet.Centre;
+	if (axis != Vector3::Zero && minimumCosine > MeshletMinConeCosine)
+	{
+		// The apex is moved back along the axis until it is behind the plane of every triangle, so that
+		// an eye outside the cone from the apex is in front of none of them
+		float apexDistance = 0.0f;
+		for (UINT triangle = 0; triangle < _meshletTriangleCount; triangle++)
+		{
+			const Vector3& a = GetPosition(_vertices, _vertexStride, meshletIndices[triangle * 3]);
+			Vector3 normal = (GetPosition(_vertices, _vertexStride, meshletIndices[triangle * 3 + 1]) - a).Cross(GetPosition(_vertices, _vertexStride, meshletIndices[triangle * 3 + 2]) - a);
+			float alignment = normal.Dot(axis);
+			if (alignment > 0.0f)
+			{
+				apexDistance = max(apexDistance, (meshlet.Centre - a).Dot(normal) / alignment);
+			}
+		}
+		meshlet.ConeApex = meshlet.Centre - axis * apexDistance;
+		meshlet.ConeCutoff = sqrtf(1.0f - minimumCosine * minimumCosine);
+	}
+
+	// Growing the meshlet from its middle outwards leaves its triangles in a poor order for the post-transform
+	// cache, so they are put in a better one, using the places of the vertices in the meshlet
+	_localIndices.resize(meshlet.IndexCount);
+	for (UINT i = 0; i < meshlet.IndexCount; i++)
+	{
+		_localIndices[i] = _meshletSlots[meshletIndices[i]];
+	}
+	OptimiseVertexCache(_localIndices, meshlet.VertexCount);
+	for (UINT i = 0; i < meshlet.IndexCount; i++)
+	{
+		meshletIndices[i] = _meshletVertices[_localIndices[i]];
+	}
+
+	// Clear the meshlet for the next one. The seed order carries on from the first triangle not yet in a meshlet
+	for (UINT vertex : _meshletVertices)
+	{
+		_meshletSlots[vertex] = NoMeshletSlot;
+	}
+	_lastMeshletVertices.swap(_meshletVertices);
+	_meshletVertices.clear();
+	_meshletTriangleCount = 0;
+	_centroidSum = Vector3::Zero;
+	_normalSum = Vector3::Zero;
+	while (_nextSeed < _triangleCount && _isEmitted[_nextSeed])
+	{
+		_nextSeed++;
+	}
+	return meshlet;
+}
+
+void BuildMeshlets(const BYTE* vertices, UINT vertexStride, UINT vertexCount, vector<UINT>& indices, UINT startIndex, UINT indexCount, vector<Meshlet>& meshlets)
+{
+	if (indexCount == 0)
+	{
+		return;
+	}
+	vector<UINT> orderedIndices(indexCount);
+	MeshletBuilder builder(vertices, vertexStride, vertexCount, indices.data() + startIndex, indexCount / 3);
+	builder.Build(startIndex, orderedIndices.data(), meshlets);
+	copy(orderedIndices.begin(), orderedIndices.end(), indices.begin() + startIndex);
+}
+
+void TransformMeshlets(vector<Meshlet>& meshlets, const Matrix& transformation)
+{
+	float scale = transformation.Right().Length();
+	for (Meshlet& meshlet : meshlets)
+	{
+		meshlet.Centre = Vector3::Transform(meshlet.Centre, transformation);
+		meshlet.Radius *= scale;
+		meshlet.ConeApex = Vector3::Transform(meshlet.ConeApex, transformation);
+	}
+}
+
+MeshletCullingView CreateMeshletCullingView(const Matrix& worldTransformation, const Matrix& worldViewProjection, const Vector3& eyePosition, bool isBackFaceCullingEnabled)
+{
+	// The planes of the frustum are found from the columns of the complete transformation, and so come
+	// out in the space of the mesh (Gribb and Hartmann 2001). Clip space depth runs from zero to w
+	Vector4 columns[4];
+	for (int column = 0; column < 4; column++)
+	{
+		columns[column] = Vector4(worldViewProjection.m[0][column], worldViewProjection.m[1][column], worldViewProjection.m[2][column], worldViewProjection.m[3][column]);
+	}
+	MeshletCullingView view;
+	view.Planes[0] = columns[3] + columns[0];
+	view.Planes[1] = columns[3] - columns[0];
+	view.Planes[2] = columns[3] + columns[1];
+	view.Planes[3] = columns[3] - columns[1];
+	view.Planes[4] = columns[2];
+	view.Planes[5] = columns[3] - columns[2];
+	for (Vector4& plane : view.Planes)
+	{
+		float length = Vector3(plane.x, plane.y, plane.z).Length();
+		plane = plane * (1.0f / max(length, FLT_MIN));
+	}
+	view.EyePosition = Vector3::Transform(eyePosition, worldTransformation.Invert());
+	// A mirrored mesh has its clockwise triangles turned anticlockwise
+	view.IsBackFaceCullingEnabled = isBackFaceCullingEnabled && worldTransformation.Determinant() > 0.0f;
+	return view;
+}
+
+size_t CullMeshlets(const Meshlet* meshlets, size_t meshletCount, const MeshletCullingView& view, vector<IndexRange>& ranges, MeshletCullingStatistics& statistics)
+{
+	size_t firstRange = ranges.size();
+	size_t visibleIndexCount = 0;
+	for (size_t i = 0; i < meshletCount; i++)
+	{
+		const Meshlet& meshlet = meshlets[i];
+		size_t triangleCount = meshlet.IndexCount / 3;
+		statistics.MeshletCount++;
+		statistics.TriangleCount += triangleCount;
+
+		bool isOutside = false;
+		for (const Vector4& plane : view.Planes)
+		{
+			isOutside |= plane.x * meshlet.Centre.x + plane.y * meshlet.Centre.y + plane.z * meshlet.Centre.z + plane.w < -meshlet.Radius;
+		}
+		if (isOutside)
+		{
+			statistics.FrustumCulledMeshletCount++;
+			statistics.FrustumCulledTriangleCount += triangleCount;
+			continue;
+		}
+		if (view.IsBackFaceCullingEnabled && meshlet.ConeCutoff < 1.0f)
+		{
+			Vector3 direction = meshlet.ConeApex - view.EyePosition;
+			if (direction.Dot(meshlet.ConeAxis) >= meshlet.ConeCutoff * direction.Length())
+			{
+				statistics.BackFaceCulledMeshletCount++;
+				statistics.BackFaceCulledTriangleCount += triangleCount;
+				continue;
+			}
+		}
+
+		if (ranges.size() > firstRange && ranges.back().StartIndex + ranges.back().IndexCount == meshlet.StartIndex)
+		{
+			ranges.back().IndexCount += meshlet.IndexCount;
+		}
+		else
+		{
+			ranges.push_back({ meshlet.StartIndex, meshlet.IndexCount });
+		}
+		visibleIndexCount += meshlet.IndexCount;
+	}
+	statistics.RangeCount += ranges.size() - firstRange;
+	return visibleIndexCount;
+}
+
+wstring BenchmarkMeshletCulling(size_t triangleCount)
+{
+	// A bumpy sphere, made by pushing the grid on each face of a cube out onto it. The edges of the
+	// faces are not joined, so the meshlets do not cross them
+	UINT side = max(1u, static_cast<UINT>(ceil(sqrt(triangleCount / 12.0))));
+	UINT faceVertexCount = (side + 1) * (side + 1);
+	vector<Vector3> vertices;
+	vector<UINT> indices;
+	vertices.reserve(static_cast<size_t>(faceVertexCount) * 6);
+	indices.reserve(static_cast<size_t>(side) * side * 36);
+	const Vector3 faceNormals[6] = { Vector3(1, 0, 0), Vector3(-1, 0, 0), Vector3(0, 1, 0), Vector3(0, -1, 0), Vector3(0, 0, 1), Vector3(0, 0, -1) };
+	for (const Vector3& normal : faceNormals)
+	{
+		// Two axes across the face, chosen so that the triangles below are clockwise seen from outside
+		Vector3 across = normal.Cross(abs(normal.y) < 0.5f ? Vector3(0, 1, 0) : Vector3(1, 0, 0));
+		Vector3 up = across.Cross(normal);
+		UINT firstVertex = static_cast<UINT>(vertices.size());
+		for (UINT row = 0; row <= side; row++)
+		{
+			for (UINT column = 0; column <= side; column++)
+			{
+				Vector3 direction = normal + across * (2.0f * column / side - 1.0f) + up * (2.0f * row / side - 1.0f);
+				direction.Normalize();
+				float radius = 1.0f + 0.05f * sinf(direction.x * 12.0f) * sinf(direction.y * 12.0f) * sinf(direction.z * 12.0f);
+				vertices.push_back(direction * radius);
+			}
+		}
+		for (UINT row = 0; row < side; row++)
+		{
+			for (UINT column = 0; column < side; column++)
+			{
+				UINT corner = firstVertex + row * (side + 1) + column;
+				indices.insert(indices.end(), { corner, corner + side + 1, corner + 1, corner + 1, corner + side + 1, corner + side + 2 });
+			}
+		}
+	}
+	const BYTE* vertexData = reinterpret_cast<const BYTE*>(vertices.data());
+	UINT vertexCount = static_cast<UINT>(vertices.size());
+
+	// Meshlets are built from cache optimised meshes, as they are by the resource cache
+	OptimiseVertexCache(indices, vertexCount);
+	VertexCacheStatistics cacheBefore = AnalyseVertexCache(indices, vertexCount);
+	vector<Meshlet> meshlets;
+	auto startTime = chrono::high_resolution_clock::now();
+	BuildMeshlets(vertexData, sizeof(Vector3), vertexCount, indices, 0, static_cast<UINT>(indices.size()), meshlets);
+	double buildTime = chrono::duration<double, milli>(chrono::high_resolution_clock::now() - startTime).count();
+	VertexCacheStatistics cacheAfter = AnalyseVertexCache(indices, vertexCount);
+	size_t meshletVertexCount = 0;
+	size_t coneMeshletCount = 0;
+	for (const Meshlet& meshlet : meshlets)
+	{
+		meshletVertexCount += meshlet.VertexCount;
+		coneMeshletCount += meshlet.ConeCutoff < 1.0f;
+	}
+	wstring report = L"Meshlets of " + to_wstring(indices.size() / 3) + L" triangles: " + to_wstring(meshlets.size()) + L" meshlets in " + to_wstring(buildTime) +
+		L" ms, " + to_wstring(static_cast<float>(meshletVertexCount) / meshlets.size()) + L" vertices and " +
+		to_wstring(static_cast<float>(indices.size()) / 3 / meshlets.size()) + L" triangles on average, " + to_wstring(coneMeshletCount) +
+		L" with a usable cone, ACMR " + to_wstring(cacheBefore.ACMR) + L" -> " + to_wstring(cacheAfter.ACMR) + L"\n";
+
+	// Views from all round the mesh. From far away the whole mesh is in view, so only the back faces are culled.
+	// From near the surface, the view frustum also cuts off the sides
+	const int viewCount = 32;
+	const float distances[2] = { 3.0f, 1.6f };
+	const wchar_t* viewNames[2] = { L"Distant", L"Near" };
+	vector<IndexRange> ranges;
+	for (int distanceIndex = 0; distanceIndex < 2; distanceIndex++)
+	{
+		MeshletCullingStatistics statistics;
+		double cullTime = 0.0;
+		for (int viewIndex = 0; viewIndex < viewCount; viewIndex++)
+		{
+			// The eyes are spread evenly over a sphere around the mesh, looking at its centre
+			float height = 1.0f - (viewIndex + 0.5f) * 2.0f / viewCount;
+			float angle = viewIndex * XM_PI * (3.0f - sqrtf(5.0f));
+			float ringRadius = sqrtf(1.0f - height * height);
+			Vector3 eyePosition = Vector3(ringRadius * cosf(angle), height, ringRadius * sinf(angle)) * distances[distanceIndex];
+			Vector3 upVector = abs(height) < 0.9f ? Vector3(0, 1, 0) : Vector3(1, 0, 0);
+			Matrix viewProjection = Matrix(XMMatrixLookAtLH(eyePosition, Vector3::Zero, upVector)) * Matrix(XMMatrixPerspectiveFovLH(XM_PIDIV4, 16.0f / 9.0f, 0.1f, 100.0f));
+
+			startTime = chrono::high_resolution_clock::now();
+			ranges.clear();
+			MeshletCullingView view = CreateMeshletCullingView(Matrix::Identity, viewProjection, eyePosition, true);
+			CullMeshlets(meshlets.data(), meshlets.size(), view, ranges, statistics);
+			cullTime += chrono::duration<double, milli>(chrono::high_resolution_clock::now() - startTime).count();
+		}
+		float frustumCulled = 100.0f * statistics.FrustumCulledTriangleCount / statistics.TriangleCount;
+		float backFaceCulled = 100.0f * statistics.BackFaceCulledTriangleCount / statistics.TriangleCount;
+		report += wstring(viewNames[distanceIndex]) + L" views: " + to_wstring(frustumCulled + backFaceCulled) + L"% of the triangles culled (" + to_wstring(frustumCulled) +
+			L"% outside the frustum, " + to_wstring(backFaceCulled) + L"% facing away), " + to_wstring(static_cast<float>(statistics.RangeCount) / viewCount) +
+			L" ranges and " + to_wstring(cullTime * 1000.0 / viewCount) + L" microseconds per view\n";
+	}
+	return report;
+}
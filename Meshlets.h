@@ -0,0 +1,94 @@
+#pragma once
+#include <vector>
+#include "core.h"
+#include "DirectXCore.h"
+
+using namespace std;
+
+// Splitting of meshes into meshlets, small clusters of triangles that can be culled on their own.
+//
+// A node that is partly visible still draws every triangle of its mesh. Splitting the mesh into
+// meshlets of neighbouring triangles that face much the same way lets the render queue leave out
+// the meshlets that are outside the view frustum or face away from the eye, and draw only the
+// ranges of indices of the rest.
+//
+// Meshlets are grown one triangle at a time from the triangles that share a vertex with the
+// meshlet, preferring those that add the fewest vertices, then those nearest the centre of the
+// meshlet and facing most nearly the same way. The triangles of each meshlet are stored one
+// after the other, so every meshlet is a single range of indices.
+//
+// Each meshlet has a bounding sphere and a cone that holds the normals of all of its triangles
+// (Kapoulkine, meshoptimizer). If the eye is outside the cone, every triangle of the meshlet faces
+// away from it. Triangles are front facing when they are clockwise, as they are for Direct3D, and
+// the cone of a meshlet whose triangles face too many ways is never culled.
+//
+// Every vertex format must start with its position, as a Vector3.
+
+#define MeshletMaxVertices		64
+#define MeshletMaxTriangles		124
+// How much facing the same way counts for against being near the centre when meshlets are grown
+#define MeshletConeWeight		0.5f
+// The cone of a meshlet is not used if the normals spread further than this from its axis (about 84 degrees)
+#define MeshletMinConeCosine	0.1f
+
+// A range of the indices in the index buffer
+
+struct IndexRange
+{
+	UINT		StartIndex{ 0 };
+	UINT		IndexCount{ 0 };
+};
+
+struct Meshlet
+{
+	UINT		StartIndex{ 0 };
+	UINT		IndexCount{ 0 };
+	UINT		VertexCount{ 0 };
+	Vector3		Centre;
+	float		Radius{ 0 };
+	// Every triangle of the meshlet faces away from an eye for which the dot product of the axis
+	// with the direction from the eye to the apex is at least the cutoff. A cutoff of one or more
+	// means the meshlet is never culled this way
+	Vector3		ConeApex;
+	Vector3		ConeAxis;
+	float		ConeCutoff{ 1.0f };
+};
+
+// The planes of the view frustum and the eye position in the space of the meshlets. The planes
+// face inwards and are normalised
+struct MeshletCullingView
+{
+	Vector4		Planes[6];
+	Vector3		EyePosition;
+	// Meshlets are only culled by their cones if the pipeline culls back faces and the world transformation does not mirror them
+	bool		IsBackFaceCullingEnabled{ true };
+};
+
+struct MeshletCullingStatistics
+{
+	size_t		MeshletCount{ 0 };
+	size_t		TriangleCount{ 0 };
+	size_t		FrustumCulledMeshletCount{ 0 };
+	size_t		FrustumCulledTriangleCount{ 0 };
+	size_t		BackFaceCulledMeshletCount{ 0 };
+	size_t		BackFaceCulledTriangleCount{ 0 };
+	// The number of ranges of indices the meshlets that were left were drawn with
+	size_t		RangeCount{ 0 };
+};
+
+// Reorder the triangles of a range of the indices into meshlets, which are added to the end of meshlets
+void BuildMeshlets(const BYTE* vertices, UINT vertexStride, UINT vertexCount, vector<UINT>& indices, UINT startIndex, UINT indexCount, vector<Meshlet>& meshlets);
+
+// Move the meshlets into another space, such as that of the compressed positions. The transformation must scale every axis the same
+void TransformMeshlets(vector<Meshlet>& meshlets, const Matrix& transformation);
+
+// Find the view frustum and the eye in the space of a mesh with the given world and complete transformations
+MeshletCullingView CreateMeshletCullingView(const Matrix& worldTransformation, const Matrix& worldViewProjection, const Vector3& eyePosition, bool isBackFaceCullingEnabled);
+
+// Add the ranges of indices of the meshlets that may be visible to ranges, merging those of meshlets that
+// follow one another. Returns the number of indices in the ranges that were added
+size_t CullMeshlets(const Meshlet* meshlets, size_t meshletCount, const MeshletCullingView& view, vector<IndexRange>& ranges, MeshletCullingStatistics& statistics);
+
+// Build the meshlets of a closed mesh of the given number of triangles and cull them from a number of views
+// around it, and return a report of the time taken and the proportion of the triangles that were culled
+wstring BenchmarkMeshletCulling(size_t triangleCount);
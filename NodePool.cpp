@@ -0,0 +1,38 @@
+#include "NodePool.h"
+
+BlockPool::BlockPool(size_t blockSize, size_t blocksPerChunk)
+{
+	// Every block must be able to hold the free list link and keep the
+	// blocks that follow it suitably aligned
+	size_t alignment = alignof(max_align_t);
+	blockSize = max(blockSize, sizeof(void*));
+	_blockSize = (blockSize + alignment - 1) / alignment * alignment;
+	_blocksPerChunk = blocksPerChunk;
+}
+
+void* BlockPool::Allocate()
+{
+	lock_guard<mutex> lock(_lock);
+	if (_freeList == nullptr)
+	{
+		// Allocate a new chunk and thread all of its blocks onto the free list
+		_chunks.push_back(unique_ptr<char[]>(new char[_blockSize * _blocksPerChunk]));
+		char* chunk = _chunks.back().get();
+		for (size_t i = _blocksPerChunk; i-- > 0;)
+		{
+			void* block = chunk + i * _blockSize;
+			*static_cast<void**>(block) = _freeList;
+			_freeList = block;
+		}
+	}
+	void* block = _freeList;
+	_freeList = *static_cast<void**>(block);
+	return block;
+}
+
+void BlockPool::Deallocate(void* block)
+{
+	lock_guard<mutex> lock(_lock);
+	*static_cast<void**>(block) = _freeList;
+	_freeList = block;
+}
@@ -0,0 +1,82 @@
+#pragma once
+#include <vector>
+#include <memory>
+#include <mutex>
+#include "core.h"
+
+using namespace std;
+
+// A fixed-size block allocator. Blocks are carved out of large chunks and
+// released blocks are kept on a free list for reuse, so blocks that are
+// allocated together sit next to each other in memory.
+
+class BlockPool
+{
+public:
+	BlockPool(size_t blockSize, size_t blocksPerChunk = 256);
+	~BlockPool() {};
+
+	void* Allocate();
+	void Deallocate(void* block);
+
+private:
+	size_t						_blockSize;
+	size_t						_blocksPerChunk;
+	vector<unique_ptr<char[]>>	_chunks;
+	void*						_freeList{ nullptr };
+	mutex						_lock;
+};
+
+// An allocator that gives every type its own BlockPool. Passing it to allocate_shared
+// places the node and its reference count in a single block, and nodes of the same
+// type are allocated contiguously from the same pool.
+
+template<class T>
+class NodeAllocator
+{
+public:
+	typedef T value_type;
+
+	NodeAllocator() {};
+	template<class U> NodeAllocator(const NodeAllocator<U>&) {};
+
+	T* allocate(size_t count)
+	{
+		if (count != 1)
+		{
+			return static_cast<T*>(::operator new(count * sizeof(T)));
+		}
+		return static_cast<T*>(GetPool().Allocate());
+	}
+
+	void deallocate(T* pointer, size_t count)
+	{
+		if (count != 1)
+		{
+			::operator delete(pointer);
+			return;
+		}
+		GetPool().Deallocate(pointer);
+	}
+
+	template<class U> bool operator==(const NodeAllocator<U>&) const { return true; }
+	template<class U> bool operator!=(const NodeAllocator<U>&) const { return false; }
+
+private:
+	static_assert(alignof(T) <= alignof(max_align_t), "NodeAllocator does not support over-aligned types");
+
+	// The pool is never destroyed, since nodes may still be released by other
+	// static objects (such as the application) during shutdown
+	static BlockPool& GetPool()
+	{
+		static BlockPool* pool = new BlockPool(sizeof(T));
+		return *pool;
+	}
+};
+
+// Create a scene graph node from its type's pool
+template<class T, class... Args>
+shared_ptr<T> MakeNode(Args&&... args)
+{
+	return allocate_shared<T>(NodeAllocator<T>(), forward<Args>(args)...);
+}
@@ -0,0 +1,173 @@
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cfloat>
+#include "NodeRegistry.h"
+#include "SceneNode.h"
+
+NodeHandle NodeRegistry::Register(SceneNode* node, NameId nameId)
+{
+	// Reuse a released slot if there is one. The generation of the slot was
+	// advanced when it was released, so old handles to it remain invalid
+	NodeHandle handle;
+	if (!_freeSlots.empty())
+	{
+		handle.Index = _freeSlots.back();
+		_freeSlots.pop_back();
+	}
+	else
+	{
+		handle.Index = static_cast<unsigned int>(_slots.size());
+		_slots.push_back(Slot());
+	}
+	_slots[handle.Index].Node = node;
+	handle.Generation = _slots[handle.Index].Generation;
+
+	// Nodes may share a name, but two different names must never share an interned name
+	vector<unsigned int>& namedSlots = _nameIndex[nameId];
+	assert(namedSlots.empty() || _slots[namedSlots.front()].Node->GetName() == node->GetName());
+	namedSlots.push_back(handle.Index);
+	return handle;
+}
+
+void NodeRegistry::Unregister(NodeHandle handle, NameId nameId)
+{
+	if (Resolve(handle) == nullptr)
+	{
+		return;
+	}
+	_slots[handle.Index].Node = nullptr;
+	_slots[handle.Index].Generation++;
+	_freeSlots.push_back(handle.Index);
+
+	auto entry = _nameIndex.find(nameId);
+	if (entry != _nameIndex.end())
+	{
+		vector<unsigned int>& slots = entry->second;
+		slots.erase(find(slots.begin(), slots.end(), handle.Index));
+		if (slots.empty())
+		{
+			_nameIndex.erase(entry);
+		}
+	}
+}
+
+SceneNode* NodeRegistry::Resolve(NodeHandle handle) const
+{
+	if (handle.Index >= _slots.size() || _slots[handle.Index].Generation != handle.Generation)
+	{
+		return nullptr;
+	}
+	return _slots[handle.Index].Node;
+}
+
+NodeHandle NodeRegistry::Find(NameId nameId) const
+{
+	NodeHandle handle;
+	auto entry = _nameIndex.find(nameId);
+	if (entry != _nameIndex.end())
+	{
+		handle.Index = entry->second.front();
+		handle.Generation = _slots[handle.Index].Generation;
+	}
+	return handle;
+}
+
+NodeHandle NodeRegistry::Find(NameId nameId, const wstring& name) const
+{
+	NodeHandle handle;
+	auto entry = _nameIndex.find(nameId);
+	if (entry != _nameIndex.end())
+	{
+		for (unsigned int index : entry->second)
+		{
+			if (_slots[index].Node->GetName() == name)
+			{
+				handle.Index = index;
+				handle.Generation = _slots[index].Generation;
+				break;
+			}
+		}
+	}
+	return handle;
+}
+
+wstring BenchmarkNodeLookup()
+{
+	// The lookups only need the names of the nodes
+	class BenchmarkNode : public SceneNode
+	{
+	public:
+		BenchmarkNode(wstring name) : SceneNode(name) {};
+
+		virtual bool Initialise() { return true; }
+		virtual void Extract(RenderQueue& renderQueue) {}
+		virtual void Shutdown() {}
+	};
+
+	wstring report;
+	for (size_t nodeCount : { 1000, 10000, 100000 })
+	{
+		vector<SceneNodePointer> nodes;
+		nodes.reserve(nodeCount);
+		NodeRegistry registry;
+		for (size_t i = 0; i < nodeCount; i++)
+		{
+			nodes.push_back(MakeNode<BenchmarkNode>(L"Node " + to_wstring(i)));
+			registry.Register(nodes.back().get(), nodes.back()->GetNameId());
+		}
+
+		// Look up a spread of names that are found and a name that is not there
+		const size_t lookupCount = 1000;
+		vector<wstring> names;
+		vector<NameId> nameIds;
+		for (size_t i = 0; i < lookupCount; i++)
+		{
+			names.push_back(i + 1 < lookupCount ? nodes[i * 7919 % nodeCount]->GetName() : L"Missing");
+			nameIds.push_back(HashName(names.back().c_str()));
+		}
+
+		double searchTime = DBL_MAX;
+		double hashedTime = DBL_MAX;
+		double internedTime = DBL_MAX;
+		size_t foundCount = 0;
+		bool isConsistent = true;
+		for (UINT run = 0; run < 5; run++)
+		{
+			size_t searchFoundCount = 0;
+			auto startTime = chrono::high_resolution_clock::now();
+			for (const wstring& name : names)
+			{
+				searchFoundCount += find_if(nodes.begin(), nodes.end(), [&name](const SceneNodePointer& node) { return node->GetName() == name; }) != nodes.end();
+			}
+			searchTime = min(searchTime, chrono::duration<double, milli>(chrono::high_resolution_clock::now() - startTime).count());
+
+			// Hashing the name at run time and checking it against the name of the node found
+			size_t hashedFoundCount = 0;
+			startTime = chrono::high_resolution_clock::now();
+			for (const wstring& name : names)
+			{
+				hashedFoundCount += registry.Find(HashName(name.c_str()), name).IsValid();
+			}
+			hashedTime = min(hashedTime, chrono::duration<double, milli>(chrono::high_resolution_clock::now() - startTime).count());
+
+			// Names that were interned at compile time
+			size_t internedFoundCount = 0;
+			startTime = chrono::high_resolution_clock::now();
+			for (NameId nameId : nameIds)
+			{
+				internedFoundCount += registry.Find(nameId).IsValid();
+			}
+			internedTime = min(internedTime, chrono::duration<double, milli>(chrono::high_resolution_clock::now() - startTime).count());
+
+			// Every way of looking the names up must find the same nodes
+			foundCount = searchFoundCount;
+			isConsistent = isConsistent && hashedFoundCount == searchFoundCount && internedFoundCount == searchFoundCount;
+		}
+		report += L"Node lookup, " + to_wstring(nodeCount) + L" nodes, " + to_wstring(lookupCount) + L" lookups: search " + to_wstring(searchTime) +
+			L" ms, hashed name " + to_wstring(hashedTime) + L" ms (" + to_wstring(searchTime / hashedTime) + L" times as fast), interned name " +
+			to_wstring(internedTime) + L" ms (" + to_wstring(searchTime / internedTime) + L" times as fast), " + to_wstring(foundCount) + L" found" +
+			(isConsistent ? L"\n" : L", but the lookups did not find the same nodes\n");
+	}
+	return report;
+}
@@ -0,0 +1,73 @@
+#pragma once
+#include <vector>
+#include <unordered_map>
+#include "core.h"
+
+using namespace std;
+
+class SceneNode;
+
+// Node names are interned as 64-bit FNV-1a hashes. HashName is constexpr so that
+// names given as string literals are hashed at compile time, e.g.
+//
+//		constexpr NameId cubeName = HashName(L"Cube");
+
+typedef unsigned long long NameId;
+
+constexpr NameId HashName(const wchar_t* name, NameId hash = 14695981039346656037ull)
+{
+	return (*name == L'\0') ? hash : HashName(name + 1, (hash ^ static_cast<NameId>(*name)) * 1099511628211ull);
+}
+
+// A stable reference to a node that can be cached by the application. The
+// generation is incremented whenever a slot is released, so a handle to a
+// node that has since been removed from the graph no longer resolves.
+
+struct NodeHandle
+{
+	static const unsigned int InvalidIndex = 0xFFFFFFFF;
+
+	unsigned int	Index{ InvalidIndex };
+	unsigned int	Generation{ 0 };
+
+	bool IsValid() const { return Index != InvalidIndex; }
+};
+
+// Maps handles and interned names to the nodes of a scene graph in constant time.
+// Nodes are registered when they are added to a graph and released when removed.
+
+class NodeRegistry
+{
+public:
+	NodeRegistry() {};
+	~NodeRegistry() {};
+
+	NodeHandle Register(SceneNode* node, NameId nameId);
+	void Unregister(NodeHandle handle, NameId nameId);
+
+	SceneNode* Resolve(NodeHandle handle) const;
+
+	// If several nodes share a name, the one registered first is returned. Only the
+	// interned name is compared, so two names whose hashes collide cannot be told
+	// apart. Register asserts that this never happens in a debug build
+	NodeHandle Find(NameId nameId) const;
+	// The same lookup, which also compares the names themselves, so a collision
+	// never returns a node with another name
+	NodeHandle Find(NameId nameId, const wstring& name) const;
+
+private:
+	struct Slot
+	{
+		SceneNode*		Node{ nullptr };
+		unsigned int	Generation{ 0 };
+	};
+
+	vector<Slot>								_slots;
+	vector<unsigned int>						_freeSlots;
+	unordered_map<NameId, vector<unsigned int>>	_nameIndex;
+};
+
+// Time looking up nodes by name in registries of 1,000, 10,000 and 100,000 nodes against
+// searching every node for the name, as the scene graph did before names were interned,
+// and return a report of the times
+wstring BenchmarkNodeLookup();
@@ -0,0 +1,265 @@
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cfloat>
+#include <cmath>
+#include "NormalGeneration.h"
+#include "Float8.h"
+
+// The offset of the normal in every vertex format
+#define NormalOffset				12
+// The partial sums are added together in blocks of vertices, several for every thread so that
+// the threads can balance the work between them, but never fewer vertices than this in a block
+#define NormalReductionBlocksPerThread		4
+#define NormalReductionMinimumBlockSize		4096
+
+// The normals summed by one thread, for the vertices from FirstVertex on
+struct PartialNormals
+{
+	UINT				FirstVertex{ 0 };
+	vector<Vector3>		Normals;
+};
+
+// acos of values between -1 and 1, to within 7e-5 radians (Abramowitz and Stegun 4.4.45)
+static Float8 ArcCos(Float8 x)
+{
+	Float8 isNegative = x < Float8(0.0f);
+	Float8 magnitude = Min(Select(isNegative, Float8(0.0f) - x, x), Float8(1.0f));
+	Float8 polynomial = ((Float8(-0.0187293f) * magnitude + Float8(0.0742610f)) * magnitude - Float8(0.2121144f)) * magnitude + Float8(1.5707288f);
+	Float8 angle = Sqrt(Float8(1.0f) - magnitude) * polynomial;
+	return Select(isNegative, Float8(XM_PI) - angle, angle);
+}
+
+// Clamp a cosine to [-1, 1]. The cosine of a degenerate corner is NaN, which becomes -1
+static Float8 ClampCosine(Float8 cosine)
+{
+	return Min(Max(cosine, Float8(-1.0f)), Float8(1.0f));
+}
+
+// Sum the weighted normals of a range of triangles into normals, which starts with the normal of firstVertex
+static void AccumulateNormals(const BYTE* vertices, UINT vertexStride, const UINT* indices, size_t firstTriangle, size_t endTriangle, NormalWeighting weighting, BYTE* normals, UINT normalStride, UINT firstVertex)
+{
+	// The positions of the corners of eight triangles, one component of one corner per row,
+	// and what each corner adds to its vertex
+	alignas(32) float positions[9][8];
+	alignas(32) float contributions[9][8];
+	for (size_t batch = firstTriangle; batch < endTriangle; batch += 8)
+	{
+		UINT laneCount = static_cast<UINT>(min<size_t>(8, endTriangle - batch));
+		for (UINT lane = 0; lane < 8; lane++)
+		{
+			// Lanes past the end repeat the last triangle, and are not added in
+			size_t triangle = batch + min(lane, laneCount - 1);
+			for (UINT corner = 0; corner < 3; corner++)
+			{
+				const Vector3& position = *reinterpret_cast<const Vector3*>(vertices + static_cast<size_t>(indices[triangle * 3 + corner]) * vertexStride);
+				positions[corner * 3][lane] = position.x;
+				positions[corner * 3 + 1][lane] = position.y;
+				positions[corner * 3 + 2][lane] = position.z;
+			}
+		}
+
+		Float8 x0 = Float8::Load(positions[0]);
+		Float8 y0 = Float8::Load(positions[1]);
+		Float8 z0 = Float8::Load(positions[2]);
+		// The edges from the first corner to the other two
+		Float8 ax = Float8::Load(positions[3]) - x0;
+		Float8 ay = Float8::Load(positions[4]) - y0;
+		Float8 az = Float8::Load(positions[5]) - z0;
+		Float8 bx = Float8::Load(positions[6]) - x0;
+		Float8 by = Float8::Load(positions[7]) - y0;
+		Float8 bz = Float8::Load(positions[8]) - z0;
+		// The length of the cross product is twice the area of the triangle
+		Float8 nx = ay * bz - az * by;
+		Float8 ny = az * bx - ax * bz;
+		Float8 nz = ax * by - ay * bx;
+
+		Float8 weights[3] = { Float8(1.0f), Float8(1.0f), Float8(1.0f) };
+		if (weighting == NormalWeighting::Angle)
+		{
+			Float8 length = Sqrt(nx * nx + ny * ny + nz * nz);
+			Float8 inverseLength = Select(length > Float8(0.0f), Float8(1.0f) / length, Float8(0.0f));
+			nx = nx * inverseLength;
+			ny = ny * inverseLength;
+			nz = nz * inverseLength;
+
+			// The edge opposite the first corner
+			Float8 cx = bx - ax;
+			Float8 cy = by - ay;
+			Float8 cz = bz - az;
+			Float8 aLength = Sqrt(ax * ax + ay * ay + az * az);
+			Float8 bLength = Sqrt(bx * bx + by * by + bz * bz);
+			Float8 cLength = Sqrt(cx * cx + cy * cy + cz * cz);
+			weights[0] = ArcCos(ClampCosine((ax * bx + ay * by + az * bz) / (aLength * bLength)));
+			weights[1] = ArcCos(ClampCosine(Float8(0.0f) - (ax * cx + ay * cy + az * cz) / (aLength * cLength)));
+			weights[2] = ArcCos(ClampCosine((bx * cx + by * cy + bz * cz) / (bLength * cLength)));
+		}
+		// Area weighted corners all add the same normal, which is only stored once
+		UINT cornerCount = weighting == NormalWeighting::Angle ? 3 : 1;
+		for (UINT corner = 0; corner < cornerCount; corner++)
+		{
+			(nx * weights[corner]).Store(contributions[corner * 3]);
+			(ny * weights[corner]).Store(contributions[corner * 3 + 1]);
+			(nz * weights[corner]).Store(contributions[corner * 3 + 2]);
+		}
+
+		UINT cornerRowStride = weighting == NormalWeighting::Angle ? 3 : 0;
+		for (UINT lane = 0; lane < laneCount; lane++)
+		{
+			size_t triangle = batch + lane;
+			for (UINT corner = 0; corner < 3; corner++)
+			{
+				Vector3& normal = *reinterpret_cast<Vector3*>(normals + static_cast<size_t>(indices[triangle * 3 + corner] - firstVertex) * normalStride);
+				normal.x += contributions[corner * cornerRowStride][lane];
+				normal.y += contributions[corner * cornerRowStride + 1][lane];
+				normal.z += contributions[corner * cornerRowStride + 2][lane];
+			}
+		}
+	}
+}
+
+static Vector3& GetNormal(BYTE* vertices, UINT vertexStride, UINT vertex)
+{
+	return *reinterpret_cast<Vector3*>(vertices + static_cast<size_t>(vertex) * vertexStride + NormalOffset);
+}
+
+void GenerateNormals(BYTE* vertices, UINT vertexStride, UINT vertexCount, const UINT* indices, size_t indexCount, NormalWeighting weighting, ThreadPool* threadPool)
+{
+	size_t triangleCount = indexCount / 3;
+	if (threadPool == nullptr || triangleCount < NormalGenerationParallelThreshold)
+	{
+		// A single thread sums straight into the vertices
+		for (UINT vertex = 0; vertex < vertexCount; vertex++)
+		{
+			GetNormal(vertices, vertexStride, vertex) = Vector3(0.0f, 0.0f, 0.0f);
+		}
+		AccumulateNormals(vertices, vertexStride, indices, 0, triangleCount, weighting, vertices + NormalOffset, vertexStride, 0);
+		for (UINT vertex = 0; vertex < vertexCount; vertex++)
+		{
+			GetNormal(vertices, vertexStride, vertex).Normalize();
+		}
+		return;
+	}
+
+	size_t taskCount = threadPool->GetConcurrency();
+	vector<PartialNormals> partials(taskCount);
+	threadPool->Run(taskCount, [&](size_t task)
+	{
+		size_t firstTriangle = triangleCount * task / taskCount;
+		size_t endTriangle = triangleCount * (task + 1) / taskCount;
+		UINT firstVertex = UINT_MAX;
+		UINT lastVertex = 0;
+		for (size_t i = firstTriangle * 3; i < endTriangle * 3; i++)
+		{
+			firstVertex = min(firstVertex, indices[i]);
+			lastVertex = max(lastVertex, indices[i]);
+		}
+		if (firstVertex <= lastVertex)
+		{
+			PartialNormals& partial = partials[task];
+			partial.FirstVertex = firstVertex;
+			partial.Normals.assign(lastVertex - firstVertex + 1, Vector3(0.0f, 0.0f, 0.0f));
+			AccumulateNormals(vertices, vertexStride, indices, firstTriangle, endTriangle, weighting, reinterpret_cast<BYTE*>(partial.Normals.data()), sizeof(Vector3), firstVertex);
+		}
+	});
+
+	// Every block of vertices adds up the partial sums that cover it in the same order. Each
+	// vertex is written once, with its normal already normalised
+	size_t blockSize = max<size_t>(NormalReductionMinimumBlockSize, (vertexCount + taskCount * NormalReductionBlocksPerThread - 1) / (taskCount * NormalReductionBlocksPerThread));
+	size_t blockCount = (vertexCount + blockSize - 1) / blockSize;
+	threadPool->Run(blockCount, [&](size_t block)
+	{
+		UINT firstVertex = static_cast<UINT>(block * blockSize);
+		UINT endVertex = static_cast<UINT>(min<size_t>(firstVertex + blockSize, vertexCount));
+		vector<const PartialNormals*> blockPartials;
+		for (const PartialNormals& partial : partials)
+		{
+			if (partial.FirstVertex < endVertex && partial.FirstVertex + partial.Normals.size() > firstVertex)
+			{
+				blockPartials.push_back(&partial);
+			}
+		}
+		for (UINT vertex = firstVertex; vertex < endVertex; vertex++)
+		{
+			Vector3 normal(0.0f, 0.0f, 0.0f);
+			for (const PartialNormals* partial : blockPartials)
+			{
+				if (vertex >= partial->FirstVertex && vertex - partial->FirstVertex < partial->Normals.size())
+				{
+					normal += partial->Normals[vertex - partial->FirstVertex];
+				}
+			}
+			normal.Normalize();
+			GetNormal(vertices, vertexStride, vertex) = normal;
+		}
+	});
+}
+
+wstring BenchmarkNormalGeneration(size_t triangleCount, NormalWeighting weighting)
+{
+	struct BenchmarkVertex
+	{
+		Vector3		Position;
+		Vector3		Normal;
+	};
+
+	// A rolling grid, with its vertices in rows so that each thread uses a band of them
+	UINT side = max(2u, static_cast<UINT>(ceil(sqrt(triangleCount / 2.0)))) + 1;
+	vector<BenchmarkVertex> vertices(static_cast<size_t>(side) * side);
+	for (UINT row = 0; row < side; row++)
+	{
+		for (UINT column = 0; column < side; column++)
+		{
+			float x = static_cast<float>(column) / side;
+			float z = static_cast<float>(row) / side;
+			vertices[static_cast<size_t>(row) * side + column].Position = Vector3(x, 0.05f * sinf(x * 40.0f) * cosf(z * 30.0f), z);
+		}
+	}
+	vector<UINT> indices;
+	indices.reserve(static_cast<size_t>(side - 1) * (side - 1) * 6);
+	for (UINT row = 0; row + 1 < side; row++)
+	{
+		for (UINT column = 0; column + 1 < side; column++)
+		{
+			UINT corner = row * side + column;
+			indices.insert(indices.end(), { corner, corner + side, corner + 1, corner + 1, corner + side, corner + side + 1 });
+		}
+	}
+
+	wstring report = L"Normal generation, " + wstring(weighting == NormalWeighting::Area ? L"area" : L"angle") + L" weighted, " + to_wstring(indices.size() / 3) +
+		L" triangles, " + to_wstring(vertices.size()) + L" vertices\n";
+	vector<Vector3> singleThreadedNormals;
+	double singleThreadedTime = 0.0;
+	unsigned int hardwareConcurrency = max(1u, thread::hardware_concurrency());
+	for (unsigned int threadCount = 1; threadCount <= hardwareConcurrency; threadCount++)
+	{
+		// The calling thread takes part, so the pool has one thread fewer
+		unique_ptr<ThreadPool> threadPool = threadCount > 1 ? make_unique<ThreadPool>(threadCount - 1) : nullptr;
+		double bestTime = DBL_MAX;
+		for (UINT run = 0; run < 3; run++)
+		{
+			auto startTime = chrono::high_resolution_clock::now();
+			GenerateNormals(vertices, indices, weighting, threadPool.get());
+			bestTime = min(bestTime, chrono::duration<double, milli>(chrono::high_resolution_clock::now() - startTime).count());
+		}
+
+		// The result must not depend on the number of threads
+		float largestDifference = 0.0f;
+		if (threadCount == 1)
+		{
+			singleThreadedTime = bestTime;
+			singleThreadedNormals.resize(vertices.size());
+			transform(vertices.begin(), vertices.end(), singleThreadedNormals.begin(), [](const BenchmarkVertex& vertex) { return vertex.Normal; });
+		}
+		else
+		{
+			for (size_t vertex = 0; vertex < vertices.size(); vertex++)
+			{
+				largestDifference = max(largestDifference, (vertices[vertex].Normal - singleThreadedNormals[vertex]).Length());
+			}
+		}
+		report += to_wstring(threadCount) + L" threads: " + to_wstring(bestTime) + L" ms, " + to_wstring(singleThreadedTime / bestTime) +
+			L" times as fast as one thread, largest difference " + to_wstring(largestDifference) + L"\n";
+	}
+	return report;
+}
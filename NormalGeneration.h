@@ -0,0 +1,43 @@
+#pragma once
+#include <vector>
+#include "core.h"
+#include "DirectXCore.h"
+#include "ThreadPool.h"
+
+using namespace std;
+
+// Generation of smooth vertex normals from the faces of a triangle list.
+//
+// The normals of the faces are calculated eight at a time and summed into the vertices
+// they use. With a thread pool, the triangles are split into one contiguous range per
+// thread, and each thread sums into normals of its own that only cover the vertices its
+// range uses. The partial sums are then added together in vertex order, again in parallel.
+// No locks or atomics are needed, and the result is the same every time for the same number
+// of threads. For a mesh whose vertices are stored in the order they are used, the partial
+// sums take little more memory than a single copy of the normals.
+//
+// Every vertex format must start with its position and its normal, as Vector3.
+
+// Meshes with fewer triangles than this are not worth splitting between threads
+#define NormalGenerationParallelThreshold	65536
+
+enum class NormalWeighting
+{
+	// Each face contributes in proportion to its area
+	Area,
+	// Each face contributes in proportion to its angle at the vertex, so that the normal
+	// does not depend on how a surface has been split into triangles
+	Angle
+};
+
+void GenerateNormals(BYTE* vertices, UINT vertexStride, UINT vertexCount, const UINT* indices, size_t indexCount, NormalWeighting weighting, ThreadPool* threadPool = nullptr);
+
+template<typename VertexType>
+void GenerateNormals(vector<VertexType>& vertices, const vector<UINT>& indices, NormalWeighting weighting = NormalWeighting::Area, ThreadPool* threadPool = nullptr)
+{
+	GenerateNormals(reinterpret_cast<BYTE*>(vertices.data()), sizeof(VertexType), static_cast<UINT>(vertices.size()), indices.data(), indices.size(), weighting, threadPool);
+}
+
+// Time the generation of normals for a grid of the given number of triangles with every
+// thread count up to the concurrency of the hardware, and return a report of the times
+wstring BenchmarkNormalGeneration(size_t triangleCount, NormalWeighting weighting);
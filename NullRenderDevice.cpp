@@ -0,0 +1,243 @@
+#include "NullRenderDevice.h"
+
+HRESULT STDMETHODCALLTYPE NullDeviceObject::QueryInterface(REFIID, void** object)
+{
+	// Placeholder objects do not implement any Direct3D interface
+	*object = nullptr;
+	return E_NOINTERFACE;
+}
+
+ULONG STDMETHODCALLTYPE NullDeviceObject::AddRef()
+{
+	return ++_referenceCount;
+}
+
+ULONG STDMETHODCALLTYPE NullDeviceObject::Release()
+{
+	ULONG referenceCount = --_referenceCount;
+	if (referenceCount == 0)
+	{
+		delete this;
+	}
+	return referenceCount;
+}
+
+void NullRenderContext::IASetInputLayout(ID3D11InputLayout* inputLayout)
+{
+	if (Count(CommandType::SetInputLayout))
+	{
+		_commandList.SetInputLayout(inputLayout);
+	}
+}
+
+void NullRenderContext::IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY topology)
+{
+	if (Count(CommandType::SetPrimitiveTopology))
+	{
+		_commandList.SetPrimitiveTopology(topology);
+	}
+}
+
+void NullRenderContext::IASetVertexBuffer(UINT slot, ID3D11Buffer* vertexBuffer, UINT stride, UINT offset)
+{
+	if (Count(CommandType::SetVertexBuffer))
+	{
+		_commandList.SetVertexBuffer(slot, vertexBuffer, stride, offset);
+	}
+}
+
+void NullRenderContext::IASetIndexBuffer(ID3D11Buffer* indexBuffer, DXGI_FORMAT format, UINT offset)
+{
+	if (Count(CommandType::SetIndexBuffer))
+	{
+		_commandList.SetIndexBuffer(indexBuffer, format, offset);
+	}
+}
+
+void NullRenderContext::VSSetShader(ID3D11VertexShader* vertexShader)
+{
+	if (Count(CommandType::SetVertexShader))
+	{
+		_commandList.SetVertexShader(vertexShader);
+	}
+}
+
+void NullRenderContext::PSSetShader(ID3D11PixelShader* pixelShader)
+{
+	if (Count(CommandType::SetPixelShader))
+	{
+		_commandList.SetPixelShader(pixelShader);
+	}
+}
+
+void NullRenderContext::VSSetConstantBuffer(UINT slot, ID3D11Buffer* constantBuffer)
+{
+	if (Count(CommandType::SetVertexConstantBuffer))
+	{
+		_commandList.SetVertexConstantBuffer(slot, constantBuffer);
+	}
+}
+
+void NullRenderContext::PSSetConstantBuffer(UINT slot, ID3D11Buffer* constantBuffer)
+{
+	if (Count(CommandType::SetPixelConstantBuffer))
+	{
+		_commandList.SetPixelConstantBuffer(slot, constantBuffer);
+	}
+}
+
+void NullRenderContext::VSSetConstantBuffer(UINT slot, ID3D11Buffer* constantBuffer, UINT firstConstant, UINT constantCount)
+{
+	if (Count(CommandType::SetVertexConstantBuffer))
+	{
+		_commandList.SetVertexConstantBuffer(slot, constantBuffer, firstConstant, constantCount);
+	}
+}
+
+void NullRenderContext::PSSetShaderResource(UINT slot, ID3D11ShaderResourceView* shaderResource)
+{
+	if (Count(CommandType::SetShaderResource))
+	{
+		_commandList.SetShaderResource(slot, shaderResource);
+	}
+}
+
+void NullRenderContext::PSSetSampler(UINT slot, ID3D11SamplerState* sampler)
+{
+	if (Count(CommandType::SetSampler))
+	{
+		_commandList.SetSampler(slot, sampler);
+	}
+}
+
+void NullRenderContext::RSSetState(ID3D11RasterizerState* rasteriserState)
+{
+	if (Count(CommandType::SetRasteriserState))
+	{
+		_commandList.SetRasteriserState(rasteriserState);
+	}
+}
+
+void NullRenderContext::OMSetBlendState(ID3D11BlendState* blendState)
+{
+	if (Count(CommandType::SetBlendState))
+	{
+		_commandList.SetBlendState(blendState);
+	}
+}
+
+void NullRenderContext::OMSetDepthStencilState(ID3D11DepthStencilState* depthStencilState)
+{
+	if (Count(CommandType::SetDepthStencilState))
+	{
+		_commandList.SetDepthStencilState(depthStencilState);
+	}
+}
+
+void NullRenderContext::UpdateBuffer(ID3D11Buffer* buffer, const void* data)
+{
+	_uploadedByteCount += NullDeviceObject::FromInterface(buffer)->GetByteWidth();
+	if (Count(CommandType::UpdateConstantBuffer))
+	{
+		_commandList.UpdateConstantBuffer(buffer, data);
+	}
+}
+
+void* NullRenderContext::Map(ID3D11Buffer* buffer, D3D11_MAP mapType)
+{
+	if (Count(CommandType::MapBuffer))
+	{
+		_commandList.MapBuffer(buffer, mapType);
+	}
+	return NullDeviceObject::FromInterface(buffer)->GetData();
+}
+
+void NullRenderContext::Unmap(ID3D11Buffer* buffer)
+{
+	if (Count(CommandType::UnmapBuffer))
+	{
+		_commandList.UnmapBuffer(buffer);
+	}
+}
+
+void NullRenderContext::DrawIndexed(UINT indexCount, UINT startIndex, INT baseVertex)
+{
+	if (Count(CommandType::DrawIndexed))
+	{
+		_commandList.DrawIndexed(indexCount, startIndex, baseVertex);
+	}
+}
+
+void NullRenderContext::DrawIndexedInstanced(UINT indexCount, UINT instanceCount, UINT startIndex, INT baseVertex, UINT startInstance)
+{
+	if (Count(CommandType::DrawIndexedInstanced))
+	{
+		_commandList.DrawIndexedInstanced(indexCount, instanceCount, startIndex, baseVertex, startInstance);
+	}
+}
+
+void NullRenderContext::Reset()
+{
+	for (size_t& callCount : _callCounts)
+	{
+		callCount = 0;
+	}
+	_uploadedByteCount = 0;
+	_commandList.Clear();
+}
+
+size_t NullRenderContext::GetTotalCallCount() const
+{
+	size_t totalCallCount = 0;
+	for (size_t callCount : _callCounts)
+	{
+		totalCallCount += callCount;
+	}
+	return totalCallCount;
+}
+
+HRESULT NullRenderDevice::CreateBuffer(const D3D11_BUFFER_DESC* bufferDesc, const D3D11_SUBRESOURCE_DATA*, ID3D11Buffer** buffer)
+{
+	// Only buffers the CPU can write to can be mapped, so only they need any memory
+	return CreateObject(buffer, bufferDesc->ByteWidth, (bufferDesc->CPUAccessFlags & D3D11_CPU_ACCESS_WRITE) != 0);
+}
+
+HRESULT NullRenderDevice::CreateVertexShader(const void*, SIZE_T, ID3D11VertexShader** vertexShader)
+{
+	return CreateObject(vertexShader);
+}
+
+HRESULT NullRenderDevice::CreatePixelShader(const void*, SIZE_T, ID3D11PixelShader** pixelShader)
+{
+	return CreateObject(pixelShader);
+}
+
+HRESULT NullRenderDevice::CreateInputLayout(const D3D11_INPUT_ELEMENT_DESC*, UINT, const void*, SIZE_T, ID3D11InputLayout** inputLayout)
+{
+	return CreateObject(inputLayout);
+}
+
+HRESULT NullRenderDevice::CreateRasterizerState(const D3D11_RASTERIZER_DESC*, ID3D11RasterizerState** rasteriserState)
+{
+	return CreateObject(rasteriserState);
+}
+
+HRESULT NullRenderDevice::CreateBlendState(const D3D11_BLEND_DESC*, ID3D11BlendState** blendState)
+{
+	return CreateObject(blendState);
+}
+
+HRESULT NullRenderDevice::CreateDepthStencilState(const D3D11_DEPTH_STENCIL_DESC*, ID3D11DepthStencilState** depthStencilState)
+{
+	return CreateObject(depthStencilState);
+}
+
+HRESULT NullRenderDevice::CreateSamplerState(const D3D11_SAMPLER_DESC*, ID3D11SamplerState** samplerState)
+{
+	return CreateObject(samplerState);
+}
+
+HRESULT NullRenderDevice::CreateTextureFromFile(const wchar_t*, ID3D11ShaderResourceView** texture)
+{
+	return CreateObject(texture);
+}
@@ -0,0 +1,144 @@
+#pragma once
+#include <vector>
+#include <atomic>
+#include "core.h"
+#include "DirectXCore.h"
+#include "RenderDevice.h"
+#include "CommandList.h"
+
+using namespace std;
+
+// An object created by the null device. It only implements IUnknown, so that it can be
+// held in a ComPtr like a real device object, and must never be passed to Direct3D.
+// Buffers that can be mapped keep a block of memory for the map to return.
+
+class NullDeviceObject : public IUnknown
+{
+public:
+	NullDeviceObject(UINT byteWidth, bool isMappable) : _byteWidth(byteWidth), _data(isMappable ? byteWidth : 0) {};
+	virtual ~NullDeviceObject() {};
+
+	HRESULT STDMETHODCALLTYPE QueryInterface(REFIID, void** object) override;
+	ULONG STDMETHODCALLTYPE AddRef() override;
+	ULONG STDMETHODCALLTYPE Release() override;
+
+	UINT GetByteWidth() const { return _byteWidth; }
+	BYTE* GetData() { return _data.data(); }
+
+	// Create an object with a reference count of one, returned as the interface the caller asked for
+	template<typename T>
+	static HRESULT Create(T** object, UINT byteWidth = 0, bool isMappable = false)
+	{
+		*object = reinterpret_cast<T*>(static_cast<IUnknown*>(new NullDeviceObject(byteWidth, isMappable)));
+		return S_OK;
+	}
+
+	template<typename T>
+	static NullDeviceObject* FromInterface(T* object) { return static_cast<NullDeviceObject*>(reinterpret_cast<IUnknown*>(object)); }
+
+private:
+	atomic<ULONG>		_referenceCount{ 1 };
+	UINT				_byteWidth;
+	vector<BYTE>		_data;
+};
+
+// A render context that draws nothing. Every call is counted and, unless recording has
+// been turned off, recorded into a command list, so that the calls the renderer makes can
+// be measured and checked without a GPU. Nothing is filtered here: the calls are the ones
+// that got through the device state filter.
+
+class NullRenderContext : public IRenderContext
+{
+public:
+	NullRenderContext() {};
+	~NullRenderContext() {};
+
+	void IASetInputLayout(ID3D11InputLayout* inputLayout) override;
+	void IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY topology) override;
+	void IASetVertexBuffer(UINT slot, ID3D11Buffer* vertexBuffer, UINT stride, UINT offset) override;
+	void IASetIndexBuffer(ID3D11Buffer* indexBuffer, DXGI_FORMAT format, UINT offset) override;
+	void VSSetShader(ID3D11VertexShader* vertexShader) override;
+	void PSSetShader(ID3D11PixelShader* pixelShader) override;
+	void VSSetConstantBuffer(UINT slot, ID3D11Buffer* constantBuffer) override;
+	void PSSetConstantBuffer(UINT slot, ID3D11Buffer* constantBuffer) override;
+	void VSSetConstantBuffer(UINT slot, ID3D11Buffer* constantBuffer, UINT firstConstant, UINT constantCount) override;
+	void PSSetShaderResource(UINT slot, ID3D11ShaderResourceView* shaderResource) override;
+	void PSSetSampler(UINT slot, ID3D11SamplerState* sampler) override;
+	void RSSetState(ID3D11RasterizerState* rasteriserState) override;
+	void OMSetBlendState(ID3D11BlendState* blendState) override;
+	void OMSetDepthStencilState(ID3D11DepthStencilState* depthStencilState) override;
+
+	void UpdateBuffer(ID3D11Buffer* buffer, const void* data) override;
+	void* Map(ID3D11Buffer* buffer, D3D11_MAP mapType) override;
+	void Unmap(ID3D11Buffer* buffer) override;
+
+	void DrawIndexed(UINT indexCount, UINT startIndex, INT baseVertex) override;
+	void DrawIndexedInstanced(UINT indexCount, UINT instanceCount, UINT startIndex, INT baseVertex, UINT startInstance) override;
+
+	// Clear the counts and the recorded commands, for instance at the start of every frame
+	void Reset();
+	// With recording turned off the calls are only counted
+	void SetRecordingEnabled(bool isRecordingEnabled) { _isRecordingEnabled = isRecordingEnabled; }
+
+	size_t GetCallCount(CommandType type) const { return _callCounts[static_cast<size_t>(type)]; }
+	size_t GetTotalCallCount() const;
+	size_t GetUploadedByteCount() const { return _uploadedByteCount; }
+	const CommandList& GetCommandList() const { return _commandList; }
+
+private:
+	size_t				_callCounts[CommandTypeCount] = { 0 };
+	size_t				_uploadedByteCount{ 0 };
+	CommandList			_commandList;
+	bool				_isRecordingEnabled{ true };
+
+	// Returns true if the call should be recorded
+	bool Count(CommandType type)
+	{
+		_callCounts[static_cast<size_t>(type)]++;
+		return _isRecordingEnabled;
+	}
+};
+
+// A render device that creates placeholder objects instead of device objects. Shader byte
+// code is not looked at and textures are not loaded. Both optional constant buffer features
+// are reported as supported unless the device is told otherwise, so the render queue takes
+// the same path as it does on current hardware.
+
+class NullRenderDevice : public IRenderDevice
+{
+public:
+	NullRenderDevice(bool isConstantBufferOffsettingSupported = true, bool isConstantBufferNoOverwriteSupported = true) :
+		_isConstantBufferOffsettingSupported(isConstantBufferOffsettingSupported), _isConstantBufferNoOverwriteSupported(isConstantBufferNoOverwriteSupported) {};
+	~NullRenderDevice() {};
+
+	IRenderContext* GetImmediateContext() override { return &_immediateContext; }
+	NullRenderContext& GetNullContext() { return _immediateContext; }
+
+	bool IsConstantBufferOffsettingSupported() const override { return _isConstantBufferOffsettingSupported; }
+	bool IsConstantBufferNoOverwriteSupported() const override { return _isConstantBufferNoOverwriteSupported; }
+
+	HRESULT CreateBuffer(const D3D11_BUFFER_DESC* bufferDesc, const D3D11_SUBRESOURCE_DATA* initialData, ID3D11Buffer** buffer) override;
+	HRESULT CreateVertexShader(const void* byteCode, SIZE_T byteCodeLength, ID3D11VertexShader** vertexShader) override;
+	HRESULT CreatePixelShader(const void* byteCode, SIZE_T byteCodeLength, ID3D11PixelShader** pixelShader) override;
+	HRESULT CreateInputLayout(const D3D11_INPUT_ELEMENT_DESC* elements, UINT elementCount, const void* byteCode, SIZE_T byteCodeLength, ID3D11InputLayout** inputLayout) override;
+	HRESULT CreateRasterizerState(const D3D11_RASTERIZER_DESC* rasteriserDesc, ID3D11RasterizerState** rasteriserState) override;
+	HRESULT CreateBlendState(const D3D11_BLEND_DESC* blendDesc, ID3D11BlendState** blendState) override;
+	HRESULT CreateDepthStencilState(const D3D11_DEPTH_STENCIL_DESC* depthStencilDesc, ID3D11DepthStencilState** depthStencilState) override;
+	HRESULT CreateSamplerState(const D3D11_SAMPLER_DESC* samplerDesc, ID3D11SamplerState** samplerState) override;
+	HRESULT CreateTextureFromFile(const wchar_t* fileName, ID3D11ShaderResourceView** texture) override;
+
+	size_t GetCreatedObjectCount() const { return _createdObjectCount; }
+
+private:
+	NullRenderContext		_immediateContext;
+	bool					_isConstantBufferOffsettingSupported;
+	bool					_isConstantBufferNoOverwriteSupported;
+	size_t					_createdObjectCount{ 0 };
+
+	template<typename T>
+	HRESULT CreateObject(T** object, UINT byteWidth = 0, bool isMappable = false)
+	{
+		_createdObjectCount++;
+		return NullDeviceObject::Create(object, byteWidth, isMappable);
+	}
+};
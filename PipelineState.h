@@ -0,0 +1,24 @@
+#pragma once
+#include "core.h"
+#include "DirectXCore.h"
+
+// A pipeline state object: the shaders, input layout, fixed-function state and
+// primitive topology that a draw is processed with, bound together with a single
+// call. Pipeline states are created and shared by the resource cache, which gives
+// every state a unique identifier, so two states can be compared by identifier
+// alone. The device objects are owned by the cache's pipeline state resource.
+
+struct PipelineState
+{
+	UINT64						Id{ 0 };
+	ID3D11VertexShader*			VertexShader{ nullptr };
+	ID3D11PixelShader*			PixelShader{ nullptr };
+	ID3D11InputLayout*			InputLayout{ nullptr };
+	ID3D11RasterizerState*		RasteriserState{ nullptr };
+	ID3D11BlendState*			BlendState{ nullptr };
+	ID3D11DepthStencilState*	DepthStencilState{ nullptr };
+	ID3D11SamplerState*			SamplerState{ nullptr };
+	D3D11_PRIMITIVE_TOPOLOGY	Topology{ D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST };
+	// Whether the rasteriser state culls anticlockwise triangles, so that meshlets facing away from the eye can be left out
+	bool						IsBackFaceCulled{ false };
+};
@@ -0,0 +1,66 @@
+#pragma once
+#include "core.h"
+#include "DirectXCore.h"
+
+// The narrow interface that the renderer creates and binds resources through. Nodes,
+// the resource cache and the render queue only talk to these interfaces, so the same
+// update, cull and submit path can run on Direct3D 11 or on the null device, which
+// counts and records the calls without a GPU.
+//
+// Resources are still identified by their Direct3D 11 interface pointers, but only the
+// backend that created them looks inside them.
+
+class IRenderContext
+{
+public:
+	virtual ~IRenderContext() {};
+
+	virtual void IASetInputLayout(ID3D11InputLayout* inputLayout) = 0;
+	virtual void IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY topology) = 0;
+	virtual void IASetVertexBuffer(UINT slot, ID3D11Buffer* vertexBuffer, UINT stride, UINT offset) = 0;
+	virtual void IASetIndexBuffer(ID3D11Buffer* indexBuffer, DXGI_FORMAT format, UINT offset) = 0;
+	virtual void VSSetShader(ID3D11VertexShader* vertexShader) = 0;
+	virtual void PSSetShader(ID3D11PixelShader* pixelShader) = 0;
+	virtual void VSSetConstantBuffer(UINT slot, ID3D11Buffer* constantBuffer) = 0;
+	virtual void PSSetConstantBuffer(UINT slot, ID3D11Buffer* constantBuffer) = 0;
+	// Binds part of a constant buffer. Only called if the device supports constant buffer offsetting
+	virtual void VSSetConstantBuffer(UINT slot, ID3D11Buffer* constantBuffer, UINT firstConstant, UINT constantCount) = 0;
+	virtual void PSSetShaderResource(UINT slot, ID3D11ShaderResourceView* shaderResource) = 0;
+	virtual void PSSetSampler(UINT slot, ID3D11SamplerState* sampler) = 0;
+	virtual void RSSetState(ID3D11RasterizerState* rasteriserState) = 0;
+	virtual void OMSetBlendState(ID3D11BlendState* blendState) = 0;
+	virtual void OMSetDepthStencilState(ID3D11DepthStencilState* depthStencilState) = 0;
+
+	// Replaces the whole contents of a buffer that was not created for CPU access
+	virtual void UpdateBuffer(ID3D11Buffer* buffer, const void* data) = 0;
+	// Only dynamic buffers can be mapped. The returned pointer is valid until the buffer is unmapped
+	virtual void* Map(ID3D11Buffer* buffer, D3D11_MAP mapType) = 0;
+	virtual void Unmap(ID3D11Buffer* buffer) = 0;
+
+	virtual void DrawIndexed(UINT indexCount, UINT startIndex, INT baseVertex) = 0;
+	virtual void DrawIndexedInstanced(UINT indexCount, UINT instanceCount, UINT startIndex, INT baseVertex, UINT startInstance) = 0;
+};
+
+class IRenderDevice
+{
+public:
+	virtual ~IRenderDevice() {};
+
+	virtual IRenderContext* GetImmediateContext() = 0;
+
+	// Binding part of a constant buffer needs Direct3D 11.1. Not every driver that can do so can
+	// also map a dynamic constant buffer without overwriting the parts that are in use
+	virtual bool IsConstantBufferOffsettingSupported() const = 0;
+	virtual bool IsConstantBufferNoOverwriteSupported() const = 0;
+
+	// The creation functions follow the Direct3D 11 functions of the same name and return their result
+	virtual HRESULT CreateBuffer(const D3D11_BUFFER_DESC* bufferDesc, const D3D11_SUBRESOURCE_DATA* initialData, ID3D11Buffer** buffer) = 0;
+	virtual HRESULT CreateVertexShader(const void* byteCode, SIZE_T byteCodeLength, ID3D11VertexShader** vertexShader) = 0;
+	virtual HRESULT CreatePixelShader(const void* byteCode, SIZE_T byteCodeLength, ID3D11PixelShader** pixelShader) = 0;
+	virtual HRESULT CreateInputLayout(const D3D11_INPUT_ELEMENT_DESC* elements, UINT elementCount, const void* byteCode, SIZE_T byteCodeLength, ID3D11InputLayout** inputLayout) = 0;
+	virtual HRESULT CreateRasterizerState(const D3D11_RASTERIZER_DESC* rasteriserDesc, ID3D11RasterizerState** rasteriserState) = 0;
+	virtual HRESULT CreateBlendState(const D3D11_BLEND_DESC* blendDesc, ID3D11BlendState** blendState) = 0;
+	virtual HRESULT CreateDepthStencilState(const D3D11_DEPTH_STENCIL_DESC* depthStencilDesc, ID3D11DepthStencilState** depthStencilState) = 0;
+	virtual HRESULT CreateSamplerState(const D3D11_SAMPLER_DESC* samplerDesc, ID3D11SamplerState** samplerState) = 0;
+	virtual HRESULT CreateTextureFromFile(const wchar_t* fileName, ID3D11ShaderResourceView** texture) = 0;
+};
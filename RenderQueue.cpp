@@ -0,0 +1,509 @@
+#include "RenderQueue.h"
+
+// Widths of the fields of the sort key
+#define PassBits		2
+#define PipelineBits	14
+#define MaterialBits	12
+#define GeometryBits	12
+#define DepthBits		24
+
+void RenderQueue::Begin(const Matrix& viewProjection, const Vector3& eyePosition, float renderDistance)
+{
+	_packets.clear();
+	_constants.clear();
+	_keys.clear();
+	_batches.clear();
+	_instances.clear();
+	_drawRanges.clear();
+	_ranges.clear();
+	_meshletStatistics = MeshletCullingStatistics();
+
+	// Identifiers are never taken back from objects that have been destroyed, so a field that has
+	// filled up is started again from the objects of this frame on. Until then the objects that
+	// overflowed share an identifier, which only makes the sort group them less well
+	ResetIdsIfFull(_pipelineStateIds, 1 << PipelineBits);
+	ResetIdsIfFull(_materialIds, 1 << MaterialBits);
+	ResetIdsIfFull(_geometryIds, 1 << GeometryBits);
+
+	_viewProjection = viewProjection;
+	_eyePosition = eyePosition;
+	_renderDistance = renderDistance;
+	_frameConstants.ViewProjection = viewProjection;
+	_frameConstants.EyePosition = eyePosition;
+}
+
+void RenderQueue::Add(const DrawPacket& packet, const ObjectConstants& constants, const Vector3& worldPosition)
+{
+	DrawRanges drawRanges;
+	if (_isMeshletCullingEnabled && packet.MeshletCount > 0)
+	{
+		// The frustum and the eye are moved into the space of the meshlets rather than moving every meshlet
+		MeshletCullingView view = CreateMeshletCullingView(constants.WorldTransformation, constants.WorldViewProjection, _eyePosition, packet.Pipeline->IsBackFaceCulled);
+		drawRanges.First = static_cast<UINT>(_ranges.size());
+		size_t indexCount = CullMeshlets(packet.Meshlets, packet.MeshletCount, view, _ranges, _meshletStatistics);
+		if (indexCount == 0)
+		{
+			return;
+		}
+		// A packet that has kept all of its meshlets is drawn whole, so that it can still be instanced
+		if (indexCount == packet.IndexCount)
+		{
+			_ranges.resize(drawRanges.First);
+		}
+		else
+		{
+			drawRanges.Count = static_cast<UINT>(_ranges.size()) - drawRanges.First;
+		}
+	}
+	_drawRanges.push_back(drawRanges);
+	_packets.push_back(packet);
+	_constants.push_back(constants);
+	_keys.push_back(BuildSortKey(packet, worldPosition));
+}
+
+UINT64 RenderQueue::BuildSortKey(const DrawPacket& packet, const Vector3& worldPosition)
+{
+	// Quantise the distance from the eye into the depth field
+	const UINT64 depthLimit = (1ull << DepthBits) - 1;
+	float depth = min(max(Vector3::Distance(_eyePosition, worldPosition) / _renderDistance, 0.0f), 1.0f);
+	UINT64 quantisedDepth = static_cast<UINT64>(depth * depthLimit);
+
+	UINT64 pipelineState = GetId(_pipelineStateIds, packet.Pipeline, 1 << PipelineBits);
+	UINT64 material = GetId(_materialIds, packet.Texture, 1 << MaterialBits);
+	UINT64 geometry = GetId(_geometryIds, packet.VertexBuffer, 1 << GeometryBits);
+	UINT64 state = (((pipelineState << MaterialBits) | material) << GeometryBits) | geometry;
+
+	if (packet.IsTransparent)
+	{
+		UINT64 key = 1ull << (64 - PassBits);
+		key |= (depthLimit - quantisedDepth) << (PipelineBits + MaterialBits + GeometryBits);
+		return key | state;
+	}
+	return (state << DepthBits) | quantisedDepth;
+}
+
+UINT RenderQueue::GetId(unordered_map<const void*, UINT>& ids, const void* object, UINT limit)
+{
+	// Identifiers are handed out in the order objects are first seen and kept until the field
+	// fills up. Should it overflow during a frame, objects share the last identifier
+	auto entry = ids.find(object);
+	if (entry != ids.end())
+	{
+		return entry->second;
+	}
+	UINT id = min(static_cast<UINT>(ids.size()), limit - 1);
+	ids[object] = id;
+	return id;
+}
+
+void RenderQueue::ResetIdsIfFull(unordered_map<const void*, UINT>& ids, UINT limit)
+{
+	if (ids.size() >= limit)
+	{
+		ids.clear();
+	}
+}
+
+void RenderQueue::Sort()
+{
+	// Least significant digit radix sort of the packet indices, eight bits at a time.
+	// Digits that are the same for every key are skipped
+	size_t count = _keys.size();
+	_order.resize(count);
+	_sortBuffer.resize(count);
+	for (size_t i = 0; i < count; i++)
+	{
+		_order[i] = static_cast<UINT>(i);
+	}
+
+	for (int shift = 0; shift < 64; shift += 8)
+	{
+		size_t histogram[256] = { 0 };
+		for (size_t i = 0; i < count; i++)
+		{
+			histogram[(_keys[i] >> shift) & 0xFF]++;
+		}
+		if (count == 0 || histogram[(_keys[0] >> shift) & 0xFF] == count)
+		{
+			continue;
+		}
+
+		size_t offset = 0;
+		for (size_t& bucket : histogram)
+		{
+			size_t bucketCount = bucket;
+			bucket = offset;
+			offset += bucketCount;
+		}
+		for (size_t i = 0; i < count; i++)
+		{
+			UINT index = _order[i];
+			_sortBuffer[histogram[(_keys[index] >> shift) & 0xFF]++] = index;
+		}
+		_order.swap(_sortBuffer);
+	}
+
+	BuildBatches();
+}
+
+void RenderQueue::BuildBatches()
+{
+	_batches.clear();
+	_instances.clear();
+	UINT count = static_cast<UINT>(_order.size());
+	UINT first = 0;
+	while (first < count)
+	{
+		// Extend the batch over the following packets for as long as they can be instanced with the first.
+		// Packets that only draw some of their meshlets are drawn on their own
+		const DrawPacket& packet = _packets[_order[first]];
+		bool isWhole = _drawRanges[_order[first]].Count == 0;
+		UINT last = first + 1;
+		while (_isInstancingEnabled && isWhole && last < count && _drawRanges[_order[last]].Count == 0 && CanInstance(packet, _packets[_order[last]]))
+		{
+			last++;
+		}
+
+		DrawBatch batch;
+		batch.First = first;
+		batch.Count = last - first;
+		batch.FirstInstance = static_cast<UINT>(_instances.size());
+		if (batch.Count > 1)
+		{
+			for (UINT i = first; i < last; i++)
+			{
+				InstanceData instance;
+				instance.WorldTransformation = _constants[_order[i]].WorldTransformation;
+				instance.Colour = _packets[_order[i]].Material->Constants.AmbientLightColour;
+				_instances.push_back(instance);
+			}
+		}
+		_batches.push_back(batch);
+		first = last;
+	}
+}
+
+void RenderQueue::Submit(IRenderDevice* renderDevice)
+{
+	_statistics = RenderQueueStatistics();
+	_stateFilter.Begin(renderDevice->GetImmediateContext());
+	UploadInstances(renderDevice);
+	UploadConstants(renderDevice);
+	Record();
+
+	// The command lists are executed in the order of the batches. The state filter drops the
+	// commands that would bind the state that is already bound
+	for (size_t i = 0; i < _commandListCount; i++)
+	{
+		_commandLists[i].Execute(_stateFilter);
+	}
+
+	_statistics.StateChangeCount = CountStateChanges();
+	for (const DrawBatch& batch : _batches)
+	{
+		if (batch.Count > 1)
+		{
+			_statistics.InstancedDrawCount++;
+			_statistics.InstanceCount += batch.Count;
+		}
+		_statistics.DrawCount += max(_drawRanges[_order[batch.First]].Count, 1u);
+	}
+}
+
+void RenderQueue::Record()
+{
+	// The chunks have the same size however many threads there are, and every chunk is
+	// recorded into a list of its own, so the result does not depend on the thread pool
+	size_t batchCount = _batches.size();
+	_commandListCount = (batchCount + _recordingChunkSize - 1) / _recordingChunkSize;
+	if (_commandLists.size() < _commandListCount)
+	{
+		_commandLists.resize(_commandListCount);
+	}
+
+	auto recordChunk = [this, batchCount](size_t chunk)
+		{
+			CommandList& commandList = _commandLists[chunk];
+			commandList.Clear();
+			size_t last = min((chunk + 1) * _recordingChunkSize, batchCount);
+			for (size_t batchIndex = chunk * _recordingChunkSize; batchIndex < last; batchIndex++)
+			{
+				RecordBatch(commandList, batchIndex);
+			}
+		};
+	if (_threadPool != nullptr && _commandListCount > 1)
+	{
+		_threadPool->Run(_commandListCount, recordChunk);
+	}
+	else
+	{
+		for (size_t chunk = 0; chunk < _commandListCount; chunk++)
+		{
+			recordChunk(chunk);
+		}
+	}
+}
+
+void RenderQueue::Record(CommandList& commandList) const
+{
+	for (size_t batchIndex = 0; batchIndex < _batches.size(); batchIndex++)
+	{
+		RecordBatch(commandList, batchIndex);
+	}
+}
+
+void RenderQueue::RecordBatch(CommandList& commandList, size_t batchIndex) const
+{
+	// Every piece of state is recorded for every draw. Recording only reads the queue,
+	// so batches can be recorded on several threads at once
+	const DrawBatch& batch = _batches[batchIndex];
+	bool isInstanced = batch.Count > 1;
+	DrawPacket packet = GetBatchPacket(batch);
+
+	// Bind the constants. Note the layout of the constant buffers must match that in the shader
+	commandList.SetVertexConstantBuffer(MaterialConstantBufferSlot, packet.Material->Buffer.Get());
+	commandList.SetPixelConstantBuffer(MaterialConstantBufferSlot, packet.Material->Buffer.Get());
+	// Instanced draws take the world transformations from the instance buffer and the view
+	// and projection transformations from the frame constants, so they need no object constants
+	if (!isInstanced)
+	{
+		RecordObjectConstants(commandList, batchIndex, packet);
+	}
+
+	// Set the vertex buffer and index buffer
+	commandList.SetVertexBuffer(0, packet.VertexBuffer, packet.VertexStride, 0);
+	commandList.SetIndexBuffer(packet.IndexBuffer, packet.IndexFormat, 0);
+
+	// Set the pipeline state and the texture
+	commandList.SetPipelineState(packet.Pipeline);
+	if (packet.Texture != nullptr)
+	{
+		commandList.SetShaderResource(0, packet.Texture);
+	}
+
+	if (isInstanced)
+	{
+		commandList.DrawIndexedInstanced(packet.IndexCount, batch.Count, packet.StartIndex, 0, batch.FirstInstance);
+	}
+	else if (_drawRanges[_order[batch.First]].Count == 0)
+	{
+		commandList.DrawIndexed(packet.IndexCount, packet.StartIndex, 0);
+	}
+	else
+	{
+		// The meshlets that were left are drawn with a draw call for each range of them
+		const DrawRanges& drawRanges = _drawRanges[_order[batch.First]];
+		for (UINT i = drawRanges.First; i < drawRanges.First + drawRanges.Count; i++)
+		{
+			commandList.DrawIndexed(_ranges[i].IndexCount, _ranges[i].StartIndex, 0);
+		}
+	}
+}
+
+void RenderQueue::RecordObjectConstants(CommandList& commandList, size_t batchIndex, const DrawPacket& packet) const
+{
+	if (packet.PersistentConstants != nullptr)
+	{
+		// The persistent constants were brought up to date before the draws were recorded
+		commandList.SetVertexConstantBuffer(ObjectConstantBufferSlot, packet.PersistentConstants->Buffer.Get());
+	}
+	else if (_isConstantBufferRingSupported)
+	{
+		// The constants were written to the ring before the draws were recorded
+		UINT block = _constantBlocks[batchIndex];
+		commandList.SetVertexConstantBuffer(ObjectConstantBufferSlot, _constantBufferRing.GetBuffer(), _constantBufferRing.GetFirstConstant(block), _constantBufferRing.GetConstantCount());
+	}
+	else
+	{
+		// Every draw shares the same buffer, so its constants are copied in just before the draw
+		commandList.UpdateConstantBuffer(_objectConstantBuffer.Get(), &_constants[_order[_batches[batchIndex].First]]);
+		commandList.SetVertexConstantBuffer(ObjectConstantBufferSlot, _objectConstantBuffer.Get());
+	}
+}
+
+void RenderQueue::UploadPersistentConstants(IRenderContext* renderContext, PersistentConstantBuffer* persistentConstants, const ObjectConstants& constants)
+{
+	// The constants of a node that has not moved are only uploaded if they have changed,
+	// for instance because the camera has moved
+	if (!persistentConstants->IsUploaded || memcmp(&persistentConstants->UploadedConstants, &constants, sizeof(ObjectConstants)) != 0)
+	{
+		renderContext->UpdateBuffer(persistentConstants->Buffer.Get(), &constants);
+		persistentConstants->UploadedConstants = constants;
+		persistentConstants->IsUploaded = true;
+		_statistics.ConstantUploadCount++;
+		_statistics.UploadedByteCount += sizeof(ObjectConstants);
+	}
+	else
+	{
+		_statistics.SkippedConstantUploadCount++;
+	}
+}
+
+void RenderQueue::UploadInstances(IRenderDevice* renderDevice)
+{
+	if (_instances.size() == 0)
+	{
+		return;
+	}
+
+	// Grow the instance buffer if this frame has more instances than it can hold
+	UINT instanceCount = static_cast<UINT>(_instances.size());
+	if (instanceCount > _instanceCapacity)
+	{
+		_instanceCapacity = max(instanceCount, _instanceCapacity * 2);
+
+		D3D11_BUFFER_DESC instanceBufferDescriptor = { 0 };
+		instanceBufferDescriptor.Usage = D3D11_USAGE_DYNAMIC;
+		instanceBufferDescriptor.ByteWidth = sizeof(InstanceData) * _instanceCapacity;
+		instanceBufferDescriptor.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+		instanceBufferDescriptor.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+		ThrowIfFailed(renderDevice->CreateBuffer(&instanceBufferDescriptor, nullptr, _instanceBuffer.ReleaseAndGetAddressOf()));
+	}
+
+	IRenderContext* renderContext = renderDevice->GetImmediateContext();
+	void* mappedInstances = renderContext->Map(_instanceBuffer.Get(), D3D11_MAP_WRITE_DISCARD);
+	memcpy(mappedInstances, _instances.data(), sizeof(InstanceData) * instanceCount);
+	renderContext->Unmap(_instanceBuffer.Get());
+
+	// The instance data is always read from the second vertex buffer slot
+	_stateFilter.IASetVertexBuffer(1, _instanceBuffer.Get(), sizeof(InstanceData), 0);
+}
+
+void RenderQueue::UploadConstants(IRenderDevice* renderDevice)
+{
+	IRenderContext* renderContext = renderDevice->GetImmediateContext();
+	if (_frameConstantBuffer == nullptr)
+	{
+		D3D11_BUFFER_DESC bufferDesc = { 0 };
+		bufferDesc.Usage = D3D11_USAGE_DEFAULT;
+		bufferDesc.ByteWidth = sizeof(FrameConstants);
+		bufferDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+		ThrowIfFailed(renderDevice->CreateBuffer(&bufferDesc, NULL, _frameConstantBuffer.GetAddressOf()));
+
+		// If the device cannot bind part of a constant buffer, the object constants of each draw are uploaded to a single buffer instead of the ring
+		_isConstantBufferRingSupported = _constantBufferRing.Initialise(renderDevice);
+		if (!_isConstantBufferRingSupported)
+		{
+			bufferDesc.ByteWidth = sizeof(ObjectConstants);
+			ThrowIfFailed(renderDevice->CreateBuffer(&bufferDesc, NULL, _objectConstantBuffer.GetAddressOf()));
+		}
+	}
+
+	// The frame constants are uploaded once and stay bound for the whole frame
+	renderContext->UpdateBuffer(_frameConstantBuffer.Get(), &_frameConstants);
+	_stateFilter.VSSetConstantBuffer(FrameConstantBufferSlot, _frameConstantBuffer.Get());
+	_stateFilter.PSSetConstantBuffer(FrameConstantBufferSlot, _frameConstantBuffer.Get());
+	_statistics.ConstantUploadCount++;
+	_statistics.UploadedByteCount += sizeof(FrameConstants);
+
+	// Bring the persistent constants up to date and give every other draw that needs object
+	// constants a block of the ring. Without the ring, the command lists upload the constants
+	UINT blockCount = 0;
+	_constantBlocks.resize(_batches.size());
+	for (size_t i = 0; i < _batches.size(); i++)
+	{
+		const DrawPacket& packet = _packets[_order[_batches[i].First]];
+		if (_batches[i].Count > 1)
+		{
+			continue;
+		}
+		if (packet.PersistentConstants != nullptr)
+		{
+			UploadPersistentConstants(renderContext, packet.PersistentConstants, _constants[_order[_batches[i].First]]);
+		}
+		else if (_isConstantBufferRingSupported)
+		{
+			_constantBlocks[i] = blockCount++;
+		}
+		else
+		{
+			_statistics.ConstantUploadCount++;
+			_statistics.UploadedByteCount += sizeof(ObjectConstants);
+		}
+	}
+	if (blockCount == 0)
+	{
+		return;
+	}
+
+	// Write the object constants of the whole frame through a single map
+	BYTE* blocks = _constantBufferRing.Map(sizeof(ObjectConstants), blockCount);
+	UINT blockStride = _constantBufferRing.GetBlockStride();
+	for (size_t i = 0; i < _batches.size(); i++)
+	{
+		if (UsesConstantBufferRing(_batches[i], _packets[_order[_batches[i].First]]))
+		{
+			memcpy(blocks + _constantBlocks[i] * blockStride, &_constants[_order[_batches[i].First]], sizeof(ObjectConstants));
+		}
+	}
+	_constantBufferRing.Unmap();
+	_statistics.ConstantUploadCount += blockCount;
+	_statistics.UploadedByteCount += blockCount * sizeof(ObjectConstants);
+}
+
+DrawPacket RenderQueue::GetBatchPacket(const DrawBatch& batch) const
+{
+	DrawPacket packet = _packets[_order[batch.First]];
+	if (batch.Count > 1)
+	{
+		packet.Pipeline = packet.InstancedPipeline;
+	}
+	return packet;
+}
+
+size_t RenderQueue::CountStateChanges() const
+{
+	size_t stateChanges = 0;
+	DrawPacket previous;
+	bool isFirst = true;
+	for (const DrawBatch& batch : _batches)
+	{
+		DrawPacket packet = GetBatchPacket(batch);
+		if (isFirst || IsStateChanged(previous, packet))
+		{
+			stateChanges++;
+		}
+		previous = packet;
+		isFirst = false;
+	}
+	return stateChanges;
+}
+
+bool RenderQueue::IsStateChanged(const DrawPacket& previous, const DrawPacket& next)
+{
+	// Changes of constant buffer are not counted, since every draw has its own constants
+	return previous.Pipeline != next.Pipeline ||
+		previous.Texture != next.Texture ||
+		previous.VertexBuffer != next.VertexBuffer ||
+		previous.IndexBuffer != next.IndexBuffer;
+}
+
+bool RenderQueue::CanInstance(const DrawPacket& first, const DrawPacket& next)
+{
+	// Only the world transformation and the colour can differ between instances. Instanced
+	// batches do not use object constants, so persistent constants do not matter. Instances
+	// of the same geometry at different levels of detail draw different indices
+	if (first.InstancedPipeline == nullptr ||
+		first.InstancedPipeline != next.InstancedPipeline ||
+		first.VertexStride != next.VertexStride ||
+		first.IndexCount != next.IndexCount ||
+		first.StartIndex != next.StartIndex ||
+		first.IsTransparent != next.IsTransparent ||
+		IsStateChanged(first, next))
+	{
+		return false;
+	}
+	if (first.Material == next.Material)
+	{
+		return true;
+	}
+	const MaterialConstants& firstMaterial = first.Material->Constants;
+	const MaterialConstants& nextMaterial = next.Material->Constants;
+	return firstMaterial.DirectionalLightColour == nextMaterial.DirectionalLightColour &&
+		firstMaterial.DirectionalLightVector == nextMaterial.DirectionalLightVector &&
+		firstMaterial.PointLightColour == nextMaterial.PointLightColour &&
+		firstMaterial.PointLightPosition == nextMaterial.PointLightPosition &&
+		firstMaterial.PointLightRange == nextMaterial.PointLightRange &&
+		firstMaterial.SpecularColour == nextMaterial.SpecularColour &&
+		firstMaterial.SpecularPower == nextMaterial.SpecularPower;
+}
@@ -0,0 +1,231 @@
+#pragma once
+#include <vector>
+#include <unordered_map>
+#include "core.h"
+#include "DirectXCore.h"
+#include "ConstantBuffer.h"
+#include "ConstantBufferRing.h"
+#include "PipelineState.h"
+#include "RenderDevice.h"
+#include "DeviceStateFilter.h"
+#include "CommandList.h"
+#include "ThreadPool.h"
+#include "Meshlets.h"
+
+using namespace std;
+
+// An object constant buffer owned by a node that is not moving. The queue only
+// uploads the constants when they differ from the ones that were uploaded last
+
+struct PersistentConstantBuffer
+{
+	ComPtr<ID3D11Buffer>		Buffer;
+	ObjectConstants				UploadedConstants;
+	bool						IsUploaded{ false };
+};
+
+// Everything needed to issue a single draw. Nodes emit draw packets during
+// extraction instead of binding state and drawing straight away.
+//
+// If the node provides an instanced pipeline (the same pipeline state with the instanced
+// vertex shader and input layout), packets that share all of their state can be
+// collapsed into a single instanced draw.
+//
+// The object constants of a packet are written to the queue's per-frame constant
+// buffer ring, unless the packet provides a persistent constant buffer of its own.
+// The material constants are held in the material's own immutable buffer.
+//
+// If the packet gives the meshlets of the indices it draws, the queue culls them against
+// the view frustum and the eye position, and draws only the ranges of indices of those that
+// are left. A packet whose meshlets are all culled is not drawn at all.
+
+struct DrawPacket
+{
+	const PipelineState*		Pipeline{ nullptr };
+	const PipelineState*		InstancedPipeline{ nullptr };
+	ID3D11ShaderResourceView*	Texture{ nullptr };
+	ID3D11Buffer*				VertexBuffer{ nullptr };
+	ID3D11Buffer*				IndexBuffer{ nullptr };
+	const MaterialResource*		Material{ nullptr };
+	PersistentConstantBuffer*	PersistentConstants{ nullptr };
+	UINT						VertexStride{ 0 };
+	UINT						IndexCount{ 0 };
+	// The index buffer may hold several levels of detail, so the draw reads from this index on
+	UINT						StartIndex{ 0 };
+	// The meshlets of the indices, whose bounds are in the space the world transformation of the constants starts from
+	const Meshlet*				Meshlets{ nullptr };
+	UINT						MeshletCount{ 0 };
+	DXGI_FORMAT					IndexFormat{ DXGI_FORMAT_R32_UINT };
+	bool						IsTransparent{ false };
+};
+
+// Format of the per-instance data in the instance buffer. This must match the
+// format of the instance input in the instanced vertex shaders
+
+struct InstanceData
+{
+	Matrix		WorldTransformation;
+	Vector4		Colour;
+};
+
+// The ranges of indices a packet draws once its meshlets have been culled. A packet without
+// any draws all of its indices
+
+struct DrawRanges
+{
+	UINT		First{ 0 };
+	UINT		Count{ 0 };
+};
+
+// A run of sorted packets that is submitted with a single draw call, or with one for each
+// range of a packet whose meshlets have been culled
+
+struct DrawBatch
+{
+	UINT		First{ 0 };
+	UINT		Count{ 0 };
+	UINT		FirstInstance{ 0 };
+};
+
+struct RenderQueueStatistics
+{
+	size_t		DrawCount{ 0 };
+	size_t		InstancedDrawCount{ 0 };
+	size_t		InstanceCount{ 0 };
+	size_t		StateChangeCount{ 0 };
+	size_t		ConstantUploadCount{ 0 };
+	size_t		SkippedConstantUploadCount{ 0 };
+	size_t		UploadedByteCount{ 0 };
+};
+
+// Collects the draw packets for a frame, sorts them by a 64-bit key and submits
+// them in order. State is bound through a device state filter, so only state
+// that differs from the state already bound reaches the render context.
+//
+// Opaque keys hold, from the most significant bits down: the pass, the pipeline
+// state, the material (texture), the geometry and the front-to-back depth, so
+// opaque draws are grouped by state and drawn nearest first within each group.
+// Transparent keys place the inverted depth directly after the pass, so that
+// transparent draws are always drawn back to front.
+//
+// Submission happens in three steps. The instances and constants of the frame are uploaded,
+// the batches are recorded into command lists, one list for every chunk of batches, and the
+// lists are executed in order on the render context. If a thread pool has been provided the
+// chunks are recorded in parallel. Recording a batch does not depend on any other batch, so
+// the lists hold exactly the same commands as recording the whole frame into a single list.
+//
+// The frame constants are uploaded once per frame. Material constants are held in
+// immutable buffers that are only bound when the material changes, and the object
+// constants of every draw are written to the constant buffer ring.
+//
+// After sorting, adjacent packets that share their state and lighting are merged
+// into batches. A batch of more than one packet is drawn with DrawIndexedInstanced,
+// taking the world transformation and colour of each packet from the instance buffer.
+// Since the batches are built from the sorted order, instancing never changes the
+// order in which the packets are drawn.
+
+class RenderQueue
+{
+public:
+	static const size_t DefaultRecordingChunkSize = 256;
+
+	RenderQueue() {};
+	~RenderQueue() {};
+
+	// Start a new frame. Depths are measured from the eye position and scaled by the render distance
+	void Begin(const Matrix& viewProjection, const Vector3& eyePosition, float renderDistance);
+	void Add(const DrawPacket& packet, const ObjectConstants& constants, const Vector3& worldPosition);
+
+	// Sort the packets and merge them into batches
+	void Sort();
+	void Submit(IRenderDevice* renderDevice);
+
+	// Record the sorted batches into one command list per chunk. This does not touch the device,
+	// so it can be called without one once the queue has been sorted
+	void Record();
+	// Record every batch into a single list on the calling thread
+	void Record(CommandList& commandList) const;
+
+	// Passing nullptr as the thread pool keeps the recording on the calling thread
+	void SetThreadPool(ThreadPool* threadPool) { _threadPool = threadPool; }
+	void SetRecordingChunkSize(size_t recordingChunkSize) { _recordingChunkSize = max(recordingChunkSize, static_cast<size_t>(1)); }
+
+	// Instancing can be turned off, in which case every packet is drawn on its own
+	void SetInstancingEnabled(bool isInstancingEnabled) { _isInstancingEnabled = isInstancingEnabled; }
+	// Meshlet culling can be turned off, in which case every packet draws all of its indices
+	void SetMeshletCullingEnabled(bool isMeshletCullingEnabled) { _isMeshletCullingEnabled = isMeshletCullingEnabled; }
+
+	// The number of state changes that submitting the queue in its current order would make
+	size_t CountStateChanges() const;
+
+	size_t GetPacketCount() const { return _packets.size(); }
+	const DrawPacket& GetPacket(size_t index) const { return _packets[_order[index]]; }
+	UINT64 GetSortKey(size_t index) const { return _keys[_order[index]]; }
+
+	// The number of batches, each of which is drawn with one draw call for every range it has
+	size_t GetBatchCount() const { return _batches.size(); }
+	const DrawBatch& GetBatch(size_t index) const { return _batches[index]; }
+	const RenderQueueStatistics& GetStatistics() const { return _statistics; }
+	// The meshlets culled since the queue was last begun
+	const MeshletCullingStatistics& GetMeshletStatistics() const { return _meshletStatistics; }
+	const DeviceStateFilter& GetStateFilter() const { return _stateFilter; }
+	size_t GetCommandListCount() const { return _commandListCount; }
+	const CommandList& GetCommandList(size_t index) const { return _commandLists[index]; }
+
+private:
+	vector<DrawPacket>				_packets;
+	vector<ObjectConstants>			_constants;
+	vector<UINT64>					_keys;
+	vector<UINT>					_order;
+	vector<UINT>					_sortBuffer;
+	vector<DrawBatch>				_batches;
+	vector<InstanceData>			_instances;
+	// The ranges left by meshlet culling, held by packet
+	vector<DrawRanges>				_drawRanges;
+	vector<IndexRange>				_ranges;
+	MeshletCullingStatistics		_meshletStatistics;
+
+	// Dense identifiers for the state objects, used to build the sort keys. They are handed out
+	// again from the start of a frame once a field has been used up
+	unordered_map<const void*, UINT>	_pipelineStateIds;
+	unordered_map<const void*, UINT>	_materialIds;
+	unordered_map<const void*, UINT>	_geometryIds;
+
+	Matrix							_viewProjection;
+	Vector3							_eyePosition;
+	float							_renderDistance{ 1.0f };
+	bool							_isInstancingEnabled{ true };
+	bool							_isMeshletCullingEnabled{ true };
+	RenderQueueStatistics			_statistics;
+	DeviceStateFilter				_stateFilter;
+
+	// The command lists are kept from one frame to the next so that their memory is reused
+	vector<CommandList>				_commandLists;
+	size_t							_commandListCount{ 0 };
+	size_t							_recordingChunkSize{ DefaultRecordingChunkSize };
+	ThreadPool*						_threadPool{ nullptr };
+
+	ComPtr<ID3D11Buffer>			_instanceBuffer;
+	UINT							_instanceCapacity{ 0 };
+
+	FrameConstants					_frameConstants;
+	ComPtr<ID3D11Buffer>			_frameConstantBuffer;
+	ConstantBufferRing				_constantBufferRing;
+	bool							_isConstantBufferRingSupported{ false };
+	ComPtr<ID3D11Buffer>			_objectConstantBuffer;
+	vector<UINT>					_constantBlocks;
+
+	UINT64 BuildSortKey(const DrawPacket& packet, const Vector3& worldPosition);
+	void BuildBatches();
+	void UploadInstances(IRenderDevice* renderDevice);
+	void UploadConstants(IRenderDevice* renderDevice);
+	void UploadPersistentConstants(IRenderContext* renderContext, PersistentConstantBuffer* persistentConstants, const ObjectConstants& constants);
+	void RecordBatch(CommandList& commandList, size_t batchIndex) const;
+	void RecordObjectConstants(CommandList& commandList, size_t batchIndex, const DrawPacket& packet) const;
+	DrawPacket GetBatchPacket(const DrawBatch& batch) const;
+	static bool UsesConstantBufferRing(const DrawBatch& batch, const DrawPacket& packet) { return batch.Count == 1 && packet.PersistentConstants == nullptr; }
+	static UINT GetId(unordered_map<const void*, UINT>& ids, const void* object, UINT limit);
+	static void ResetIdsIfFull(unordered_map<const void*, UINT>& ids, UINT limit);
+	static bool IsStateChanged(const DrawPacket& previous, const DrawPacket& next);
+	static bool CanInstance(const DrawPacket& first, const DrawPacket& next);
+};
@@ -0,0 +1,416 @@
+#include "ResourceCache.h"
+
+// Build a key from the bytes of a description structure
+static wstring DescriptionKey(const void* description, size_t size)
+{
+	static const wchar_t hexDigits[] = L"0123456789abcdef";
+	const BYTE* bytes = static_cast<const BYTE*>(description);
+	wstring key;
+	key.reserve(size * 2);
+	for (size_t i = 0; i < size; i++)
+	{
+		key.push_back(hexDigits[bytes[i] >> 4]);
+		key.push_back(hexDigits[bytes[i] & 0xF]);
+	}
+	return key;
+}
+
+PipelineStateDesc::PipelineStateDesc()
+{
+	// The descriptions are cleared first so that any padding does not affect their keys
+	ZeroMemory(&RasteriserDesc, sizeof(RasteriserDesc));
+	RasteriserDesc.FillMode = D3D11_FILL_SOLID;
+	RasteriserDesc.CullMode = D3D11_CULL_BACK;
+	RasteriserDesc.DepthClipEnable = true;
+
+	ZeroMemory(&BlendDesc, sizeof(BlendDesc));
+	for (D3D11_RENDER_TARGET_BLEND_DESC& renderTargetDesc : BlendDesc.RenderTarget)
+	{
+		renderTargetDesc.SrcBlend = D3D11_BLEND_ONE;
+		renderTargetDesc.DestBlend = D3D11_BLEND_ZERO;
+		renderTargetDesc.BlendOp = D3D11_BLEND_OP_ADD;
+		renderTargetDesc.SrcBlendAlpha = D3D11_BLEND_ONE;
+		renderTargetDesc.DestBlendAlpha = D3D11_BLEND_ZERO;
+		renderTargetDesc.BlendOpAlpha = D3D11_BLEND_OP_ADD;
+		renderTargetDesc.RenderTargetWriteMask = D3D11_COLOR_WRITE_ENABLE_ALL;
+	}
+
+	ZeroMemory(&DepthStencilDesc, sizeof(DepthStencilDesc));
+	DepthStencilDesc.DepthEnable = true;
+	DepthStencilDesc.DepthWriteMask = D3D11_DEPTH_WRITE_MASK_ALL;
+	DepthStencilDesc.DepthFunc = D3D11_COMPARISON_LESS;
+	DepthStencilDesc.StencilReadMask = D3D11_DEFAULT_STENCIL_READ_MASK;
+	DepthStencilDesc.StencilWriteMask = D3D11_DEFAULT_STENCIL_WRITE_MASK;
+	DepthStencilDesc.FrontFace.StencilFailOp = D3D11_STENCIL_OP_KEEP;
+	DepthStencilDesc.FrontFace.StencilDepthFailOp = D3D11_STENCIL_OP_KEEP;
+	DepthStencilDesc.FrontFace.StencilPassOp = D3D11_STENCIL_OP_KEEP;
+	DepthStencilDesc.FrontFace.StencilFunc = D3D11_COMPARISON_ALWAYS;
+	DepthStencilDesc.BackFace = DepthStencilDesc.FrontFace;
+
+	ZeroMemory(&SamplerDesc, sizeof(SamplerDesc));
+	SamplerDesc.Filter = D3D11_FILTER_MIN_MAG_MIP_LINEAR;
+	SamplerDesc.AddressU = D3D11_TEXTURE_ADDRESS_CLAMP;
+	SamplerDesc.AddressV = D3D11_TEXTURE_ADDRESS_CLAMP;
+	SamplerDesc.AddressW = D3D11_TEXTURE_ADDRESS_CLAMP;
+	SamplerDesc.MaxAnisotropy = 1;
+	SamplerDesc.ComparisonFunc = D3D11_COMPARISON_NEVER;
+	SamplerDesc.BorderColor[0] = SamplerDesc.BorderColor[1] = SamplerDesc.BorderColor[2] = SamplerDesc.BorderColor[3] = 1.0f;
+	SamplerDesc.MinLOD = -D3D11_FLOAT32_MAX;
+	SamplerDesc.MaxLOD = D3D11_FLOAT32_MAX;
+}
+
+void PipelineStateDesc::SetAlphaBlending()
+{
+	D3D11_RENDER_TARGET_BLEND_DESC& renderTargetDesc = BlendDesc.RenderTarget[0];
+	renderTargetDesc.BlendEnable = true;
+	renderTargetDesc.SrcBlend = D3D11_BLEND_SRC_ALPHA;
+	renderTargetDesc.DestBlend = D3D11_BLEND_INV_SRC_ALPHA;
+	renderTargetDesc.SrcBlendAlpha = D3D11_BLEND_ONE;
+	renderTargetDesc.DestBlendAlpha = D3D11_BLEND_INV_SRC_ALPHA;
+
+	DepthStencilDesc.DepthWriteMask = D3D11_DEPTH_WRITE_MASK_ZERO;
+}
+
+const LevelOfDetail& GeometryResource::SelectLevel(float maxError) const
+{
+	// The errors grow from one level to the next
+	size_t level = 0;
+	while (level + 1 < Levels.size() && Levels[level + 1].Error <= maxError)
+	{
+		level++;
+	}
+	return Levels[level];
+}
+
+void ResourceCache::Initialise(IRenderDevice* renderDevice)
+{
+	_renderDevice = renderDevice;
+	_shaderCache.Open(DefaultShaderCacheFileName);
+}
+
+shared_ptr<GeometryResource> ResourceCache::CreateGeometry(const wstring& geometryId, const void* vertices, UINT vertexStride, UINT vertexCount, const vector<UINT>& indices)
+{
+	shared_ptr<GeometryResource> geometry = make_shared<GeometryResource>();
+	geometry->Vertices.assign(static_cast<const BYTE*>(vertices), static_cast<const BYTE*>(vertices) + vertexStride * vertexCount);
+	geometry->Indices = indices;
+	if (_isMeshOptimisationEnabled)
+	{
+		// Reorder the triangles and vertices once, before they are uploaded. Unused vertices are dropped
+		geometry->Optimisation = OptimiseMesh(geometry->Vertices, vertexStride, geometry->Indices);
+		vertexCount = static_cast<UINT>(geometry->Vertices.size() / vertexStride);
+		if (_isStatisticsReportingEnabled)
+		{
+			wstring optimisationReport = L"Geometry " + geometryId + L" optimised: ACMR " + to_wstring(geometry->Optimisation.Before.ACMR) + L" -> " +
+				to_wstring(geometry->Optimisation.After.ACMR) + L", ATVR " + to_wstring(geometry->Optimisation.Before.ATVR) + L" -> " +
+				to_wstring(geometry->Optimisation.After.ATVR) + L"\n";
+			OutputDebugStringW(optimisationReport.c_str());
+		}
+	}
+	geometry->VertexStride = vertexStride;
+	geometry->VertexCount = vertexCount;
+	geometry->IndexCount = static_cast<UINT>(geometry->Indices.size());
+
+	// Every vertex format starts with the position
+	BoundingBox::CreateFromPoints(geometry->Bounds, vertexCount, reinterpret_cast<const XMFLOAT3*>(geometry->Vertices.data()), vertexStride);
+
+	// The indices of the simplified levels are added after those of the full mesh
+	if (_isLevelOfDetailEnabled)
+	{
+		geometry->Levels = BuildLevelsOfDetail(geometry->Vertices.data(), vertexStride, vertexCount, geometry->Indices);
+		if (_isStatisticsReportingEnabled)
+		{
+			wstring levelReport = L"Geometry " + geometryId + L" levels of detail:";
+			for (const LevelOfDetail& level : geometry->Levels)
+			{
+				levelReport += L" " + to_wstring(level.IndexCount / 3) + L" triangles (error " + to_wstring(level.EstimatedError) + L" estimated, " +
+					to_wstring(level.MeasuredError) + L" measured)";
+			}
+			levelReport += L"\n";
+			OutputDebugStringW(levelReport.c_str());
+		}
+	}
+	else
+	{
+		geometry->Levels.resize(1);
+		geometry->Levels[0].IndexCount = geometry->IndexCount;
+	}
+
+	// The triangles of every level are split into meshlets, which reorders them within the level
+	for (LevelOfDetail& level : geometry->Levels)
+	{
+		level.FirstMeshlet = static_cast<UINT>(geometry->Meshlets.size());
+		BuildMeshlets(geometry->Vertices.data(), vertexStride, vertexCount, geometry->Indices, level.StartIndex, level.IndexCount, geometry->Meshlets);
+		level.MeshletCount = static_cast<UINT>(geometry->Meshlets.size()) - level.FirstMeshlet;
+	}
+	if (_isStatisticsReportingEnabled)
+	{
+		vector<UINT> fullMeshIndices(geometry->Indices.begin(), geometry->Indices.begin() + geometry->IndexCount);
+		wstring meshletReport = L"Geometry " + geometryId + L" split into " + to_wstring(geometry->Meshlets.size()) + L" meshlets (" +
+			to_wstring(geometry->Levels[0].MeshletCount) + L" for the full mesh), ACMR " + to_wstring(AnalyseVertexCache(fullMeshIndices, vertexCount).ACMR) + L"\n";
+		OutputDebugStringW(meshletReport.c_str());
+	}
+
+	// Only the buffers hold the compressed geometry
+	CompressedGeometry compressedGeometry;
+	geometry->Compression = CompressGeometry(geometry->Vertices, vertexStride, geometry->Indices, compressedGeometry);
+	geometry->BufferVertexStride = compressedGeometry.VertexStride;
+	geometry->IndexFormat = compressedGeometry.IndexFormat;
+	geometry->PositionDecode = compressedGeometry.PositionDecode;
+	// The meshlets are culled in the space of the compressed positions
+	TransformMeshlets(geometry->Meshlets, compressedGeometry.PositionDecode.Invert());
+	if (_isStatisticsReportingEnabled)
+	{
+		const VertexCompressionStatistics& compression = geometry->Compression;
+		wstring compressionReport = L"Geometry " + geometryId + L" compressed: vertices " + to_wstring(compression.VertexStride) + L" -> " +
+			to_wstring(compression.CompressedVertexStride) + L" bytes, indices " + to_wstring(compression.IndexSize) + L" -> " +
+			to_wstring(compression.CompressedIndexSize) + L" bytes, " + to_wstring(compression.ByteCount) + L" -> " + to_wstring(compression.CompressedByteCount) +
+			L" bytes in all. Largest errors: position " + to_wstring(compression.MaxPositionError) + L", normal " + to_wstring(compression.MaxNormalError) +
+			L" degrees, texture coordinates " + to_wstring(compression.MaxTexCoordError) + L"\n";
+		OutputDebugStringW(compressionReport.c_str());
+	}
+
+	// Setup the structure that specifies how big the vertex 
+	// buffer should be
+	D3D11_BUFFER_DESC vertexBufferDescriptor = { 0 };
+	vertexBufferDescriptor.Usage = D3D11_USAGE_IMMUTABLE;
+	vertexBufferDescriptor.ByteWidth = static_cast<UINT>(compressedGeometry.Vertices.size());
+	vertexBufferDescriptor.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+	vertexBufferDescriptor.CPUAccessFlags = 0;
+	vertexBufferDescriptor.MiscFlags = 0;
+	vertexBufferDescriptor.StructureByteStride = 0;
+
+	// Now set up a structure that tells DirectX where to get the
+	// data for the vertices from
+	D3D11_SUBRESOURCE_DATA vertexInitialisationData = { 0 };
+	vertexInitialisationData.pSysMem = compressedGeometry.Vertices.data();
+
+	// and create the vertex buffer
+	ThrowIfFailed(_renderDevice->CreateBuffer(&vertexBufferDescriptor, &vertexInitialisationData, geometry->VertexBuffer.GetAddressOf()));
+
+	// Setup the structure that specifies how big the index 
+	// buffer should be
+	D3D11_BUFFER_DESC indexBufferDescriptor = { 0 };
+	indexBufferDescriptor.Usage = D3D11_USAGE_IMMUTABLE;
+	indexBufferDescriptor.ByteWidth = static_cast<UINT>(compressedGeometry.Indices.size());
+	indexBufferDescriptor.BindFlags = D3D11_BIND_INDEX_BUFFER;
+	indexBufferDescriptor.CPUAccessFlags = 0;
+	indexBufferDescriptor.MiscFlags = 0;
+	indexBufferDescriptor.StructureByteStride = 0;
+
+	// Now set up a structure that tells DirectX where to get the
+	// data for the indices from
+	D3D11_SUBRESOURCE_DATA indexInitialisationData = { 0 };
+	indexInitialisationData.pSysMem = compressedGeometry.Indices.data();
+
+	// and create the index buffer
+	ThrowIfFailed(_renderDevice->CreateBuffer(&indexBufferDescriptor, &indexInitialisationData, geometry->IndexBuffer.GetAddressOf()));
+	return geometry;
+}
+
+VertexShaderPointer ResourceCache::GetVertexShader(const string& entryPoint, UINT permutation)
+{
+	// Vertex shaders do not depend on every permutation flag, so materials that only differ in
+	// their lighting share the same vertex shader
+	permutation &= VertexShaderPermutationMask;
+	wstring key = wstring(entryPoint.begin(), entryPoint.end()) + L"|" + to_wstring(permutation);
+	VertexShaderPointer vertexShader = Find(_vertexShaders, key);
+	if (vertexShader == nullptr)
+	{
+		shared_ptr<VertexShaderResource> resource = make_shared<VertexShaderResource>();
+		resource->ByteCode = GetShaderByteCode(entryPoint, permutation, "vs_5_0");
+		ThrowIfFailed(_renderDevice->CreateVertexShader(resource->ByteCode.data(), resource->ByteCode.size(), resource->Shader.GetAddressOf()));
+		vertexShader = Store(_vertexShaders, key, VertexShaderPointer(resource));
+	}
+	return vertexShader;
+}
+
+PixelShaderPointer ResourceCache::GetPixelShader(const string& entryPoint, UINT permutation)
+{
+	wstring key = wstring(entryPoint.begin(), entryPoint.end()) + L"|" + to_wstring(permutation);
+	PixelShaderPointer pixelShader = Find(_pixelShaders, key);
+	if (pixelShader == nullptr)
+	{
+		// The byte code of a pixel shader is not needed once the shader has been created
+		shared_ptr<DeviceObjectResource<ID3D11PixelShader>> resource = make_shared<DeviceObjectResource<ID3D11PixelShader>>();
+		vector<BYTE> byteCode = GetShaderByteCode(entryPoint, permutation, "ps_5_0");
+		ThrowIfFailed(_renderDevice->CreatePixelShader(byteCode.data(), byteCode.size(), resource->Object.GetAddressOf()));
+		pixelShader = Store(_pixelShaders, key, PixelShaderPointer(resource));
+	}
+	return pixelShader;
+}
+
+vector<BYTE> ResourceCache::GetShaderByteCode(const string& entryPoint, UINT permutation, const string& target)
+{
+	const EmbeddedShader* embeddedShader = FindEmbeddedShader(entryPoint, permutation);
+	if (embeddedShader != nullptr)
+	{
+		_embeddedShaderCount++;
+		return vector<BYTE>(embeddedShader->ByteCode, embeddedShader->ByteCode + embeddedShader->ByteCodeSize);
+	}
+
+	DWORD shaderCompileFlags = 0;
+#if defined( _DEBUG )
+	shaderCompileFlags = D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION;
+#endif
+
+	// The shader is only compiled if the shader cache does not already hold its byte code
+	vector<BYTE> byteCode;
+	string compilationMessages;
+	bool isCompiled = _shaderCache.GetByteCode(PermutationShaderFileName, GetShaderPermutationDefines(permutation), entryPoint, target, shaderCompileFlags, byteCode, compilationMessages);
+	if (!compilationMessages.empty())
+	{
+		// If there were any compilation messages, display them
+		MessageBoxA(0, compilationMessages.c_str(), 0, 0);
+	}
+	// Even if there are no compiler messages, check to make sure there were no other errors.
+	if (!isCompiled)
+	{
+		ThrowIfFailed(E_FAIL);
+	}
+	return byteCode;
+}
+
+InputLayoutPointer ResourceCache::GetInputLayout(const wstring& layoutId, const D3D11_INPUT_ELEMENT_DESC* elements, UINT elementCount, const VertexShaderPointer& vertexShader)
+{
+	InputLayoutPointer inputLayout = Find(_inputLayouts, layoutId);
+	if (inputLayout == nullptr)
+	{
+		shared_ptr<DeviceObjectResource<ID3D11InputLayout>> resource = make_shared<DeviceObjectResource<ID3D11InputLayout>>();
+		ThrowIfFailed(_renderDevice->CreateInputLayout(elements, elementCount, vertexShader->ByteCode.data(), vertexShader->ByteCode.size(), resource->Object.GetAddressOf()));
+		inputLayout = Store(_inputLayouts, layoutId, InputLayoutPointer(resource));
+	}
+	return inputLayout;
+}
+
+RasteriserStatePointer ResourceCache::GetRasteriserState(const D3D11_RASTERIZER_DESC& rasteriserDesc)
+{
+	wstring key = DescriptionKey(&rasteriserDesc, sizeof(rasteriserDesc));
+	RasteriserStatePointer rasteriserState = Find(_rasteriserStates, key);
+	if (rasteriserState == nullptr)
+	{
+		shared_ptr<DeviceObjectResource<ID3D11RasterizerState>> resource = make_shared<DeviceObjectResource<ID3D11RasterizerState>>();
+		ThrowIfFailed(_renderDevice->CreateRasterizerState(&rasteriserDesc, resource->Object.GetAddressOf()));
+		rasteriserState = Store(_rasteriserStates, key, RasteriserStatePointer(resource));
+	}
+	return rasteriserState;
+}
+
+BlendStatePointer ResourceCache::GetBlendState(const D3D11_BLEND_DESC& blendDesc)
+{
+	wstring key = DescriptionKey(&blendDesc, sizeof(blendDesc));
+	BlendStatePointer blendState = Find(_blendStates, key);
+	if (blendState == nullptr)
+	{
+		shared_ptr<DeviceObjectResource<ID3D11BlendState>> resource = make_shared<DeviceObjectResource<ID3D11BlendState>>();
+		ThrowIfFailed(_renderDevice->CreateBlendState(&blendDesc, resource->Object.GetAddressOf()));
+		blendState = Store(_blendStates, key, BlendStatePointer(resource));
+	}
+	return blendState;
+}
+
+DepthStencilStatePointer ResourceCache::GetDepthStencilState(const D3D11_DEPTH_STENCIL_DESC& depthStencilDesc)
+{
+	wstring key = DescriptionKey(&depthStencilDesc, sizeof(depthStencilDesc));
+	DepthStencilStatePointer depthStencilState = Find(_depthStencilStates, key);
+	if (depthStencilState == nullptr)
+	{
+		shared_ptr<DeviceObjectResource<ID3D11DepthStencilState>> resource = make_shared<DeviceObjectResource<ID3D11DepthStencilState>>();
+		ThrowIfFailed(_renderDevice->CreateDepthStencilState(&depthStencilDesc, resource->Object.GetAddressOf()));
+		depthStencilState = Store(_depthStencilStates, key, DepthStencilStatePointer(resource));
+	}
+	return depthStencilState;
+}
+
+SamplerStatePointer ResourceCache::GetSamplerState(const D3D11_SAMPLER_DESC& samplerDesc)
+{
+	wstring key = DescriptionKey(&samplerDesc, sizeof(samplerDesc));
+	SamplerStatePointer samplerState = Find(_samplerStates, key);
+	if (samplerState == nullptr)
+	{
+		shared_ptr<DeviceObjectResource<ID3D11SamplerState>> resource = make_shared<DeviceObjectResource<ID3D11SamplerState>>();
+		ThrowIfFailed(_renderDevice->CreateSamplerState(&samplerDesc, resource->Object.GetAddressOf()));
+		samplerState = Store(_samplerStates, key, SamplerStatePointer(resource));
+	}
+	return samplerState;
+}
+
+PipelineStatePointer ResourceCache::GetPipelineState(const PipelineStateDesc& pipelineStateDesc)
+{
+	// The shaders and layout are already shared, so they are identified by their addresses. The
+	// description holds on to them, so an address cannot be reused while the pipeline state is alive
+	const void* objects[] = { pipelineStateDesc.VertexShader.get(), pipelineStateDesc.PixelShader.get(), pipelineStateDesc.InputLayout.get() };
+	const void* samplerDesc = pipelineStateDesc.HasSampler ? &pipelineStateDesc.SamplerDesc : nullptr;
+	wstring key = DescriptionKey(objects, sizeof(objects)) + L"|" +
+		DescriptionKey(&pipelineStateDesc.RasteriserDesc, sizeof(pipelineStateDesc.RasteriserDesc)) + L"|" +
+		DescriptionKey(&pipelineStateDesc.BlendDesc, sizeof(pipelineStateDesc.BlendDesc)) + L"|" +
+		DescriptionKey(&pipelineStateDesc.DepthStencilDesc, sizeof(pipelineStateDesc.DepthStencilDesc)) + L"|" +
+		(samplerDesc != nullptr ? DescriptionKey(samplerDesc, sizeof(pipelineStateDesc.SamplerDesc)) : L"") + L"|" +
+		to_wstring(pipelineStateDesc.Topology);
+	PipelineStatePointer pipelineState = Find(_pipelineStates, key);
+	if (pipelineState == nullptr)
+	{
+		shared_ptr<PipelineStateResource> resource = make_shared<PipelineStateResource>();
+		resource->VertexShaderResource = pipelineStateDesc.VertexShader;
+		resource->PixelShaderResource = pipelineStateDesc.PixelShader;
+		resource->InputLayoutResource = pipelineStateDesc.InputLayout;
+		resource->RasteriserStateResource = GetRasteriserState(pipelineStateDesc.RasteriserDesc);
+		resource->BlendStateResource = GetBlendState(pipelineStateDesc.BlendDesc);
+		resource->DepthStencilStateResource = GetDepthStencilState(pipelineStateDesc.DepthStencilDesc);
+		if (pipelineStateDesc.HasSampler)
+		{
+			resource->SamplerStateResource = GetSamplerState(pipelineStateDesc.SamplerDesc);
+			resource->SamplerState = resource->SamplerStateResource->Object.Get();
+		}
+
+		resource->Id = _nextPipelineStateId++;
+		resource->VertexShader = pipelineStateDesc.VertexShader->Shader.Get();
+		resource->PixelShader = pipelineStateDesc.PixelShader->Object.Get();
+		resource->InputLayout = pipelineStateDesc.InputLayout->Object.Get();
+		resource->RasteriserState = resource->RasteriserStateResource->Object.Get();
+		resource->BlendState = resource->BlendStateResource->Object.Get();
+		resource->DepthStencilState = resource->DepthStencilStateResource->Object.Get();
+		resource->Topology = pipelineStateDesc.Topology;
+		resource->IsBackFaceCulled = pipelineStateDesc.RasteriserDesc.CullMode == D3D11_CULL_BACK && !pipelineStateDesc.RasteriserDesc.FrontCounterClockwise;
+		pipelineState = Store(_pipelineStates, key, PipelineStatePointer(resource));
+	}
+	return pipelineState;
+}
+
+TexturePointer ResourceCache::GetTexture(const wstring& textureFileName)
+{
+	TexturePointer texture = Find(_textures, textureFileName);
+	if (texture == nullptr)
+	{
+		shared_ptr<DeviceObjectResource<ID3D11ShaderResourceView>> resource = make_shared<DeviceObjectResource<ID3D11ShaderResourceView>>();
+		ThrowIfFailed(_renderDevice->CreateTextureFromFile(textureFileName.c_str(), resource->Object.GetAddressOf()));
+		texture = Store(_textures, textureFileName, TexturePointer(resource));
+	}
+	return texture;
+}
+
+MaterialPointer ResourceCache::GetMaterial(const MaterialConstants& materialConstants)
+{
+	// The key is built from the bytes of the constants, padding included. Vector3 already starts
+	// out as zero, but the padding is set here so that the key does not depend on it
+	MaterialConstants constants = materialConstants;
+	constants.Pad = Vector3::Zero;
+	wstring key = DescriptionKey(&constants, sizeof(constants));
+	MaterialPointer material = Find(_materials, key);
+	if (material == nullptr)
+	{
+		shared_ptr<MaterialResource> resource = make_shared<MaterialResource>();
+		resource->Constants = constants;
+
+		D3D11_BUFFER_DESC bufferDesc;
+		ZeroMemory(&bufferDesc, sizeof(bufferDesc));
+		bufferDesc.Usage = D3D11_USAGE_IMMUTABLE;
+		bufferDesc.ByteWidth = sizeof(MaterialConstants);
+		bufferDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+		D3D11_SUBRESOURCE_DATA initialisationData;
+		ZeroMemory(&initialisationData, sizeof(initialisationData));
+		initialisationData.pSysMem = &resource->Constants;
+		ThrowIfFailed(_renderDevice->CreateBuffer(&bufferDesc, &initialisationData, resource->Buffer.GetAddressOf()));
+		material = Store(_materials, key, MaterialPointer(resource));
+	}
+	return material;
+}
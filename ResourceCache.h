@@ -0,0 +1,237 @@
+#pragma once
+#include <vector>
+#include <unordered_map>
+#include <functional>
+#include "core.h"
+#include "DirectXCore.h"
+#include "ConstantBuffer.h"
+#include "PipelineState.h"
+#include "RenderDevice.h"
+#include "ShaderCache.h"
+#include "ShaderPermutations.h"
+#include "MeshOptimiser.h"
+#include "MeshSimplifier.h"
+#include "Meshlets.h"
+#include "VertexCompression.h"
+
+using namespace std;
+
+// Geometry shared by every node that uses the same mesh. The vertex and index data
+// are kept on the CPU as well, so that they can be processed without reading back
+// the GPU buffers. Neither is modified once the geometry has been created, but both
+// may have been reordered by the mesh optimiser before the buffers were created.
+//
+// The buffers hold the compressed vertices and indices (see VertexCompression.h),
+// while the CPU copies keep the full precision the geometry was built with. Nodes
+// must apply PositionDecode before their world transformation.
+//
+// The indices of every level of detail are held one after the other, starting with
+// those of the full mesh, and all of the levels use the same vertices (see MeshSimplifier.h).
+// IndexCount is the number of indices of the full mesh. The triangles of every level are
+// split into meshlets (see Meshlets.h), whose bounds are in the space of the compressed positions.
+
+struct GeometryResource
+{
+	ComPtr<ID3D11Buffer>		VertexBuffer;
+	ComPtr<ID3D11Buffer>		IndexBuffer;
+	vector<BYTE>				Vertices;
+	vector<UINT>				Indices;
+	UINT						VertexStride{ 0 };
+	UINT						VertexCount{ 0 };
+	UINT						IndexCount{ 0 };
+	UINT						BufferVertexStride{ 0 };
+	DXGI_FORMAT					IndexFormat{ DXGI_FORMAT_R32_UINT };
+	Matrix						PositionDecode;
+	BoundingBox					Bounds;
+	// The post-transform cache efficiency of the indices as they were built and as they were uploaded
+	MeshOptimisationStatistics	Optimisation;
+	VertexCompressionStatistics	Compression;
+	vector<LevelOfDetail>		Levels;
+	vector<Meshlet>				Meshlets;
+
+	// The coarsest level whose error is no greater than the given distance, in the units of the mesh
+	const LevelOfDetail& SelectLevel(float maxError) const;
+};
+
+struct VertexShaderResource
+{
+	ComPtr<ID3D11VertexShader>	Shader;
+	vector<BYTE>				ByteCode;
+};
+
+// Any other device object that is shared as it is
+template<typename T>
+struct DeviceObjectResource
+{
+	ComPtr<T>					Object;
+};
+
+typedef shared_ptr<const GeometryResource>							GeometryPointer;
+typedef shared_ptr<const VertexShaderResource>						VertexShaderPointer;
+typedef shared_ptr<const DeviceObjectResource<ID3D11PixelShader>>		PixelShaderPointer;
+typedef shared_ptr<const DeviceObjectResource<ID3D11InputLayout>>		InputLayoutPointer;
+typedef shared_ptr<const DeviceObjectResource<ID3D11RasterizerState>>	RasteriserStatePointer;
+typedef shared_ptr<const DeviceObjectResource<ID3D11BlendState>>		BlendStatePointer;
+typedef shared_ptr<const DeviceObjectResource<ID3D11DepthStencilState>>	DepthStencilStatePointer;
+typedef shared_ptr<const DeviceObjectResource<ID3D11SamplerState>>		SamplerStatePointer;
+typedef shared_ptr<const DeviceObjectResource<ID3D11ShaderResourceView>>	TexturePointer;
+typedef shared_ptr<const MaterialResource>							MaterialPointer;
+
+// Description of a pipeline state. The fixed-function descriptions start out with
+// the Direct3D defaults, so only the state that differs has to be filled in
+
+struct PipelineStateDesc
+{
+	VertexShaderPointer			VertexShader;
+	PixelShaderPointer			PixelShader;
+	InputLayoutPointer			InputLayout;
+	D3D11_RASTERIZER_DESC		RasteriserDesc;
+	D3D11_BLEND_DESC			BlendDesc;
+	D3D11_DEPTH_STENCIL_DESC	DepthStencilDesc;
+	D3D11_SAMPLER_DESC			SamplerDesc;
+	bool						HasSampler{ false };
+	D3D11_PRIMITIVE_TOPOLOGY	Topology{ D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST };
+
+	PipelineStateDesc();
+
+	// Blend the draw over what is behind it by its alpha. The depth buffer is still tested
+	// but no longer written, so that transparent draws do not hide each other
+	void SetAlphaBlending();
+};
+
+// A pipeline state together with the shared device objects it binds, which are kept
+// alive for as long as the pipeline state is
+
+struct PipelineStateResource : public PipelineState
+{
+	VertexShaderPointer			VertexShaderResource;
+	PixelShaderPointer			PixelShaderResource;
+	InputLayoutPointer			InputLayoutResource;
+	RasteriserStatePointer		RasteriserStateResource;
+	BlendStatePointer			BlendStateResource;
+	DepthStencilStatePointer	DepthStencilStateResource;
+	SamplerStatePointer			SamplerStateResource;
+};
+
+typedef shared_ptr<const PipelineStateResource>						PipelineStatePointer;
+
+// Creates the GPU resources used by the nodes and shares them between every node
+// that asks for the same one. Geometry is keyed by an identifier chosen by the node
+// type, shaders by the file name and entry point, textures by the file name and the
+// remaining device objects by their descriptions.
+//
+// The cache only holds weak references. Nodes hold the returned pointers, and a
+// resource is released as soon as the last node using it has been destroyed.
+
+class ResourceCache
+{
+public:
+	ResourceCache() {};
+	~ResourceCache() {};
+
+	void Initialise(IRenderDevice* renderDevice);
+
+	// The build function is only called the first time the geometry is requested. It fills
+	// in the vertices and indices, which are then optimised, simplified into levels of detail,
+	// split into meshlets, compressed and copied into immutable buffers
+	template<typename VertexType>
+	GeometryPointer GetGeometry(const wstring& geometryId, const function<void(vector<VertexType>&, vector<UINT>&)>& buildGeometry)
+	{
+		GeometryPointer geometry = Find(_geometries, geometryId);
+		if (geometry == nullptr)
+		{
+			vector<VertexType> vertices;
+			vector<UINT> indices;
+			buildGeometry(vertices, indices);
+			geometry = Store(_geometries, geometryId, GeometryPointer(CreateGeometry(geometryId, vertices.data(), sizeof(VertexType), static_cast<UINT>(vertices.size()), indices)));
+		}
+		return geometry;
+	}
+
+	// Shaders are permutations of the lighting shader (see ShaderPermutations.h). The precompiled
+	// byte code embedded in the executable is used if it is available
+	VertexShaderPointer GetVertexShader(const string& entryPoint, UINT permutation);
+	PixelShaderPointer GetPixelShader(const string& entryPoint, UINT permutation);
+
+	// Input layouts are shared between vertex shaders with the same input signature, so
+	// the layout identifier should name the vertex format rather than the shader
+	InputLayoutPointer GetInputLayout(const wstring& layoutId, const D3D11_INPUT_ELEMENT_DESC* elements, UINT elementCount, const VertexShaderPointer& vertexShader);
+	RasteriserStatePointer GetRasteriserState(const D3D11_RASTERIZER_DESC& rasteriserDesc);
+	BlendStatePointer GetBlendState(const D3D11_BLEND_DESC& blendDesc);
+	DepthStencilStatePointer GetDepthStencilState(const D3D11_DEPTH_STENCIL_DESC& depthStencilDesc);
+	SamplerStatePointer GetSamplerState(const D3D11_SAMPLER_DESC& samplerDesc);
+	// Nodes with the same shaders, layout and fixed-function state share one pipeline state
+	PipelineStatePointer GetPipelineState(const PipelineStateDesc& pipelineStateDesc);
+	TexturePointer GetTexture(const wstring& textureFileName);
+	// Material constants never change once the material has been created, so they are held in an immutable buffer
+	MaterialPointer GetMaterial(const MaterialConstants& materialConstants);
+
+	// Permutations that are not embedded are compiled through the shader cache, which must be
+	// saved once the scene has been initialised
+	ShaderCache& GetShaderCache() { return _shaderCache; }
+	size_t GetEmbeddedShaderCount() const { return _embeddedShaderCount; }
+
+	// Geometry is optimised for the post-transform cache, overdraw and vertex fetch unless this is turned off
+	void SetMeshOptimisationEnabled(bool isMeshOptimisationEnabled) { _isMeshOptimisationEnabled = isMeshOptimisationEnabled; }
+	// Geometry only has the full mesh if this is turned off
+	void SetLevelOfDetailEnabled(bool isLevelOfDetailEnabled) { _isLevelOfDetailEnabled = isLevelOfDetailEnabled; }
+	// The statistics of every geometry that is created are written to the debugger output if this is turned on
+	void SetStatisticsReportingEnabled(bool isStatisticsReportingEnabled) { _isStatisticsReportingEnabled = isStatisticsReportingEnabled; }
+
+	size_t GetGeometryCount() const { return CountLive(_geometries); }
+	size_t GetShaderCount() const { return CountLive(_vertexShaders) + CountLive(_pixelShaders); }
+	size_t GetTextureCount() const { return CountLive(_textures); }
+	size_t GetPipelineStateCount() const { return CountLive(_pipelineStates); }
+
+private:
+	IRenderDevice*					_renderDevice{ nullptr };
+	ShaderCache						_shaderCache;
+	size_t							_embeddedShaderCount{ 0 };
+	bool							_isMeshOptimisationEnabled{ true };
+	bool							_isLevelOfDetailEnabled{ true };
+	bool							_isStatisticsReportingEnabled{ false };
+
+	unordered_map<wstring, weak_ptr<const GeometryResource>>							_geometries;
+	unordered_map<wstring, weak_ptr<const VertexShaderResource>>						_vertexShaders;
+	unordered_map<wstring, weak_ptr<const DeviceObjectResource<ID3D11PixelShader>>>		_pixelShaders;
+	unordered_map<wstring, weak_ptr<const DeviceObjectResource<ID3D11InputLayout>>>		_inputLayouts;
+	unordered_map<wstring, weak_ptr<const DeviceObjectResource<ID3D11RasterizerState>>>	_rasteriserStates;
+	unordered_map<wstring, weak_ptr<const DeviceObjectResource<ID3D11BlendState>>>		_blendStates;
+	unordered_map<wstring, weak_ptr<const DeviceObjectResource<ID3D11DepthStencilState>>>	_depthStencilStates;
+	unordered_map<wstring, weak_ptr<const DeviceObjectResource<ID3D11SamplerState>>>		_samplerStates;
+	unordered_map<wstring, weak_ptr<const PipelineStateResource>>						_pipelineStates;
+	UINT64							_nextPipelineStateId{ 1 };
+	unordered_map<wstring, weak_ptr<const DeviceObjectResource<ID3D11ShaderResourceView>>>	_textures;
+	unordered_map<wstring, weak_ptr<const MaterialResource>>							_materials;
+
+	shared_ptr<GeometryResource> CreateGeometry(const wstring& geometryId, const void* vertices, UINT vertexStride, UINT vertexCount, const vector<UINT>& indices);
+	vector<BYTE> GetShaderByteCode(const string& entryPoint, UINT permutation, const string& target);
+
+	template<typename T>
+	static shared_ptr<const T> Find(unordered_map<wstring, weak_ptr<const T>>& resources, const wstring& key)
+	{
+		auto entry = resources.find(key);
+		return (entry != resources.end()) ? entry->second.lock() : nullptr;
+	}
+
+	template<typename T>
+	static shared_ptr<const T> Store(unordered_map<wstring, weak_ptr<const T>>& resources, const wstring& key, const shared_ptr<const T>& resource)
+	{
+		resources[key] = resource;
+		return resource;
+	}
+
+	template<typename T>
+	static size_t CountLive(const unordered_map<wstring, weak_ptr<const T>>& resources)
+	{
+		size_t count = 0;
+		for (const auto& entry : resources)
+		{
+			if (!entry.second.expired())
+			{
+				count++;
+			}
+		}
+		return count;
+	}
+};
@@ -0,0 +1,163 @@
+#include <fstream>
+#include "SceneFile.h"
+#include "CubeNode.h"
+#include "TeapotNode.h"
+#include "TexturedCubeNode.h"
+#include "MappedFile.h"
+
+bool SceneFile::Load(const wstring& fileName, SceneGraph& sceneGraph)
+{
+	MappedFile file(fileName);
+	const BYTE* data = file.GetData();
+	if (data == nullptr || file.GetSize() < sizeof(SceneFileHeader))
+	{
+		return false;
+	}
+
+	// Validate the header and make sure every table lies inside the file
+	const SceneFileHeader& header = *reinterpret_cast<const SceneFileHeader*>(data);
+	UINT64 nodeEnd = header.NodeOffset + static_cast<UINT64>(header.NodeCount) * sizeof(SceneFileNode);
+	UINT64 stringEnd = header.StringTableOffset + static_cast<UINT64>(header.StringTableLength) * sizeof(wchar_t);
+	if (header.Magic != SceneFileMagic || header.Version != SceneFileVersion || header.NodeCount == 0 ||
+		header.NodeOffset % alignof(SceneFileNode) != 0 || header.StringTableOffset % sizeof(wchar_t) != 0 ||
+		nodeEnd > file.GetSize() || stringEnd > file.GetSize())
+	{
+		return false;
+	}
+	const SceneFileNode* records = reinterpret_cast<const SceneFileNode*>(data + header.NodeOffset);
+	const wchar_t* strings = reinterpret_cast<const wchar_t*>(data + header.StringTableOffset);
+	for (UINT32 i = 0; i < header.NodeCount; i++)
+	{
+		const SceneFileNode& record = records[i];
+		bool isParentValid = (i == 0) ? record.ParentIndex == SceneFileNode::NoParent : record.ParentIndex < i && records[record.ParentIndex].Type == SceneFileNodeType::Graph;
+		if (!isParentValid || record.Type > SceneFileNodeType::TexturedCube || (i == 0 && record.Type != SceneFileNodeType::Graph) ||
+			static_cast<UINT64>(record.NameOffset) + record.NameLength > header.StringTableLength ||
+			static_cast<UINT64>(record.AssetOffset) + record.AssetLength > header.StringTableLength)
+		{
+			return false;
+		}
+	}
+
+	// The first record describes the scene graph itself. None of the nodes has been flattened into
+	// the new layout yet, so the transformations are only stored on the nodes. Clearing the graph
+	// invalidates its layout, and the next update flattens them into the hierarchy
+	sceneGraph.Clear();
+	sceneGraph.SetName(wstring(strings + records[0].NameOffset, records[0].NameLength));
+	sceneGraph._thisWorldTransformation = records[0].LocalTransformation;
+
+	vector<SceneNodePointer> nodes(header.NodeCount);
+	for (UINT32 i = 1; i < header.NodeCount; i++)
+	{
+		nodes[i] = CreateNode(records[i], strings);
+		nodes[i]->_thisWorldTransformation = records[i].LocalTransformation;
+		if (records[i].ParentIndex == 0)
+		{
+			sceneGraph.Add(nodes[i]);
+		}
+		else
+		{
+			nodes[records[i].ParentIndex]->Add(nodes[i]);
+		}
+	}
+	return true;
+}
+
+SceneNodePointer SceneFile::CreateNode(const SceneFileNode& record, const wchar_t* strings)
+{
+	wstring name(strings + record.NameOffset, record.NameLength);
+	switch (record.Type)
+	{
+	case SceneFileNodeType::Cube:
+		return MakeNode<CubeNode>(name, record.Colour, record.DirectionalLightColour, record.DirectionalLightVector,
+			record.PointLightColour, record.PointLightPosition, record.PointLightRange, record.SpecularColour, record.SpecularPower);
+
+	case SceneFileNodeType::Teapot:
+		return MakeNode<TeapotNode>(name, record.Colour, record.DirectionalLightColour, record.DirectionalLightVector,
+			record.PointLightColour, record.PointLightPosition, record.PointLightRange, record.SpecularColour, record.SpecularPower);
+
+	case SceneFileNodeType::TexturedCube:
+		return MakeNode<TexturedCubeNode>(name, record.Colour, record.DirectionalLightColour, record.DirectionalLightVector,
+			record.PointLightColour, record.PointLightPosition, record.PointLightRange, record.SpecularColour, record.SpecularPower,
+			wstring(strings + record.AssetOffset, record.AssetLength));
+
+	default:
+		return MakeNode<SceneGraph>(name);
+	}
+}
+
+bool SceneFile::Save(const wstring& fileName, const SceneGraph& sceneGraph)
+{
+	vector<SceneFileNode> nodes;
+	wstring strings;
+	ExportNode(sceneGraph, SceneFileNode::NoParent, nodes, strings);
+
+	SceneFileHeader header = { 0 };
+	header.Magic = SceneFileMagic;
+	header.Version = SceneFileVersion;
+	header.NodeCount = static_cast<UINT32>(nodes.size());
+	header.NodeOffset = static_cast<UINT32>((sizeof(SceneFileHeader) + alignof(SceneFileNode) - 1) / alignof(SceneFileNode) * alignof(SceneFileNode));
+	header.StringTableOffset = header.NodeOffset + header.NodeCount * sizeof(SceneFileNode);
+	header.StringTableLength = static_cast<UINT32>(strings.size());
+
+	ofstream file(fileName, ios::binary | ios::trunc);
+	if (!file)
+	{
+		return false;
+	}
+	char padding[alignof(SceneFileNode)] = { 0 };
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	file.write(padding, header.NodeOffset - sizeof(header));
+	file.write(reinterpret_cast<const char*>(nodes.data()), nodes.size() * sizeof(SceneFileNode));
+	file.write(reinterpret_cast<const char*>(strings.data()), strings.size() * sizeof(wchar_t));
+	return file.good();
+}
+
+void SceneFile::ExportNode(const SceneNode& node, UINT32 parentIndex, vector<SceneFileNode>& nodes, wstring& strings)
+{
+	SceneFileNode record = {};
+	record.ParentIndex = parentIndex;
+	record.NameOffset = static_cast<UINT32>(strings.size());
+	record.NameLength = static_cast<UINT32>(node._name.size());
+	strings += node._name;
+	record.LocalTransformation = node._thisWorldTransformation;
+	record.Colour = node._colour;
+	record.DirectionalLightColour = node._directionalLightColour;
+	record.DirectionalLightVector = node._directionalLightVector;
+	record.PointLightColour = node._pointLightColour;
+	record.PointLightPosition = node._pointLightPosition;
+	record.PointLightRange = node._pointLightRange;
+	record.SpecularColour = node._specularColour;
+	record.SpecularPower = node._specularPower;
+
+	if (dynamic_cast<const CubeNode*>(&node) != nullptr)
+	{
+		record.Type = SceneFileNodeType::Cube;
+	}
+	else if (dynamic_cast<const TeapotNode*>(&node) != nullptr)
+	{
+		record.Type = SceneFileNodeType::Teapot;
+	}
+	else if (const TexturedCubeNode* texturedCube = dynamic_cast<const TexturedCubeNode*>(&node))
+	{
+		record.Type = SceneFileNodeType::TexturedCube;
+		record.AssetOffset = static_cast<UINT32>(strings.size());
+		record.AssetLength = static_cast<UINT32>(texturedCube->GetTextureFileName().size());
+		strings += texturedCube->GetTextureFileName();
+	}
+	else
+	{
+		// Any other kind of node is stored as a graph so that its children are kept
+		record.Type = SceneFileNodeType::Graph;
+	}
+
+	UINT32 index = static_cast<UINT32>(nodes.size());
+	nodes.push_back(record);
+
+	if (const SceneGraph* graph = dynamic_cast<const SceneGraph*>(&node))
+	{
+		for (const SceneNodePointer& child : graph->_children)
+		{
+			ExportNode(*child, index, nodes, strings);
+		}
+	}
+}
@@ -0,0 +1,73 @@
+#pragma once
+#include "SceneGraph.h"
+
+using namespace std;
+
+// Binary scene file format.
+//
+// A scene file is a header followed by a fixed-size record for every node and
+// a table of the (wide character) strings they reference. Records are stored
+// in depth-first order, so a node's parent always appears before it, and every
+// field is naturally aligned. A file can therefore be memory-mapped and the
+// nodes created directly from the records without any parsing.
+
+#define SceneFileMagic		0x454E4353		// "SCNE"
+#define SceneFileVersion	1
+
+enum class SceneFileNodeType : UINT32
+{
+	Graph = 0,
+	Cube = 1,
+	Teapot = 2,
+	TexturedCube = 3
+};
+
+struct SceneFileHeader
+{
+	UINT32		Magic;
+	UINT32		Version;
+	UINT32		NodeCount;
+	UINT32		NodeOffset;
+	UINT32		StringTableOffset;
+	UINT32		StringTableLength;		// In characters
+};
+
+struct SceneFileNode
+{
+	SceneFileNodeType	Type;
+	UINT32				ParentIndex;	// The root has no parent and stores NoParent
+	UINT32				NameOffset;		// Offsets and lengths are in characters
+	UINT32				NameLength;
+	UINT32				AssetOffset;	// Texture file name of textured nodes
+	UINT32				AssetLength;
+	Matrix				LocalTransformation;
+	Vector4				Colour;
+	Vector4				DirectionalLightColour;
+	Vector4				DirectionalLightVector;
+	Vector4				PointLightColour;
+	Vector3				PointLightPosition;
+	float				PointLightRange;
+	Vector4				SpecularColour;
+	float				SpecularPower;
+	UINT32				Reserved[3];
+
+	static const UINT32 NoParent = 0xFFFFFFFF;
+};
+
+static_assert(sizeof(SceneFileHeader) == 24, "SceneFileHeader must match the file layout");
+static_assert(sizeof(SceneFileNode) == 200, "SceneFileNode must match the file layout");
+
+class SceneFile
+{
+public:
+	// Replace the contents of the scene graph with the scene held in the file.
+	// Returns false if the file could not be opened or is not a valid scene file
+	static bool Load(const wstring& fileName, SceneGraph& sceneGraph);
+
+	// Write the scene graph and all of its nodes to a file
+	static bool Save(const wstring& fileName, const SceneGraph& sceneGraph);
+
+private:
+	static void ExportNode(const SceneNode& node, UINT32 parentIndex, vector<SceneFileNode>& nodes, wstring& strings);
+	static SceneNodePointer CreateNode(const SceneFileNode& record, const wchar_t* strings);
+};
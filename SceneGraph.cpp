@@ -2,71 +2,232 @@
 
 bool SceneGraph::Initialise()
 {
-	for (SceneNodePointer child : _children)
+	for (const SceneNodePointer& child : _children)
 	{
 		if (!child->Initialise())
 		{
 			return false;
 		}
 	}
+	// The nodes now know their bounds, so the layout has to be rebuilt to pick them up
+	InvalidateLayout();
 	return true;
 }
 
 void SceneGraph::Update(const Matrix& worldTransformation)
 {
-	_cumulativeWorldTransformation = _thisWorldTransformation * worldTransformation;
-	for (SceneNodePointer child : _children)
+	// Rebuild the flattened layout if nodes have been added or removed since the
+	// last update, then compute every world transformation in a single pass
+	bool isLayoutRebuilt = !_transformHierarchy.IsLayoutValid();
+	if (isLayoutRebuilt)
 	{
-		child->Update(_cumulativeWorldTransformation);
+		_transformHierarchy.Clear();
+		Flatten(_transformHierarchy, TransformHierarchy::NoParent);
+	}
+	_transformHierarchy.Update(worldTransformation);
+
+	// Refit the bounds of the nodes that have moved
+	if (isLayoutRebuilt || _boundingVolumes.IsRebuildRecommended())
+	{
+		BuildBoundingVolumes();
+	}
+	else
+	{
+		RefitBoundingVolumes();
 	}
 }
 
-void SceneGraph::Render()
+void SceneGraph::Cull(const BoundingFrustum& frustum)
 {
-	for (SceneNodePointer child : _children)
+	_visibleItems.clear();
+	_boundingVolumes.Cull(frustum, _visibleItems);
+	_visibleCount = _visibleItems.size() + _unboundedNodes.size();
+	_culledCount = _boundingVolumes.GetItemCount() - _visibleItems.size();
+	_isCulled = true;
+}
+
+void SceneGraph::Extract(RenderQueue& renderQueue)
+{
+	if (_isCulled)
 	{
-		child->Render();
+		// Extract the visible nodes of the whole graph straight from the flattened layout
+		for (size_t item : _visibleItems)
+		{
+			_transformHierarchy.GetNode(_itemNodeIndices[item])->Extract(renderQueue);
+		}
+		for (SceneNode* node : _unboundedNodes)
+		{
+			node->Extract(renderQueue);
+		}
+		_isCulled = false;
+		return;
+	}
+
+	for (const SceneNodePointer& child : _children)
+	{
+		child->Extract(renderQueue);
 	}
 }
 
 void SceneGraph::Shutdown()
 {
-	for (SceneNodePointer child : _children)
+	for (const SceneNodePointer& child : _children)
 	{
 		child->Shutdown();
 	}
 }
 
-void SceneGraph::Add(SceneNodePointer node)
+void SceneGraph::Add(const SceneNodePointer& node)
 {
 	_children.push_back(node);
+	node->Attach(*_registry);
+	InvalidateLayout();
 }
 
-void SceneGraph::Remove(SceneNodePointer node)
+void SceneGraph::Remove(const SceneNodePointer& node)
 {
-	for (SceneNodePointer child : _children)
+	for (const SceneNodePointer& child : _children)
 	{
 		child->Remove(node);
 		if (child == node)
 		{
+			child->Detach();
 			_children.erase(find(_children.begin(), _children.end(), child));
+			InvalidateLayout();
 			break;
 		}
 	}
 }
 
-SceneNodePointer SceneGraph::Find(wstring name)
+void SceneGraph::Clear()
 {
+	for (const SceneNodePointer& child : _children)
+	{
+		child->Detach();
+	}
+	_children.clear();
+	InvalidateLayout();
+}
+
+SceneNodePointer SceneGraph::Find(const wstring& name)
+{
+	if (IsRoot())
+	{
+		SceneNode* node = Resolve(_registry->Find(HashName(name.c_str()), name));
+		return (node != nullptr) ? node->shared_from_this() : nullptr;
+	}
+
+	// The registry of a graph that has been added to another graph covers the
+	// whole scene, so a search restricted to this subtree has to walk it
 	if (_name == name)
 	{
-		return static_cast<SceneNodePointer>(this);
+		return shared_from_this();
 	}
-	for (SceneNodePointer child : _children)
+	for (const SceneNodePointer& child : _children)
 	{
-		if (child->Find(name) != nullptr)
+		SceneNodePointer node = child->Find(name);
+		if (node != nullptr)
 		{
-			return child;
+			return node;
 		}
 	}
 	return nullptr;
 }
+
+SceneNodePointer SceneGraph::Find(NameId nameId)
+{
+	SceneNode* node = Resolve(FindHandle(nameId));
+	return (node != nullptr) ? node->shared_from_this() : nullptr;
+}
+
+void SceneGraph::Flatten(TransformHierarchy& hierarchy, size_t parentIndex)
+{
+	// Children are added after their parent, so the hierarchy stays in topological order
+	// and the subtree of this graph ends at the last node added by its children
+	SceneNode::Flatten(hierarchy, parentIndex);
+	for (const SceneNodePointer& child : _children)
+	{
+		child->Flatten(hierarchy, _transformIndex);
+	}
+	hierarchy.SetSubtreeEnd(_transformIndex, hierarchy.GetCount());
+}
+
+void SceneGraph::Attach(NodeRegistry& registry)
+{
+	SceneNode::Attach(registry);
+	for (const SceneNodePointer& child : _children)
+	{
+		child->Attach(registry);
+	}
+}
+
+void SceneGraph::Detach()
+{
+	// A detached graph becomes the root of its own registry again. It has no place in a
+	// hierarchy until its next update flattens it into its own
+	SceneNode::Detach();
+	for (const SceneNodePointer& child : _children)
+	{
+		child->Detach();
+	}
+	_transformHierarchy.Invalidate();
+	Attach(_nodeRegistry);
+}
+
+void SceneGraph::InvalidateLayout()
+{
+	// A graph that has not been flattened yet has no hierarchy of its own. Its own store is
+	// invalidated instead, which is the one used if it is updated as a root
+	if (_hierarchy != nullptr)
+	{
+		_hierarchy->Invalidate();
+	}
+	_transformHierarchy.Invalidate();
+}
+
+void SceneGraph::BuildBoundingVolumes()
+{
+	size_t nodeCount = _transformHierarchy.GetCount();
+	vector<BoundingBox> itemBounds;
+	_itemNodeIndices.clear();
+	_nodeItems.assign(nodeCount, NoItem);
+	_unboundedNodes.clear();
+	_isCulled = false;
+
+	for (size_t i = 0; i < nodeCount; i++)
+	{
+		SceneNode* node = _transformHierarchy.GetNode(i);
+		if (node->IsComposite())
+		{
+			continue;
+		}
+		if (node->HasBounds())
+		{
+			BoundingBox worldBounds;
+			node->GetLocalBounds().Transform(worldBounds, _transformHierarchy.GetWorldTransform(i));
+			_nodeItems[i] = static_cast<unsigned int>(itemBounds.size());
+			_itemNodeIndices.push_back(i);
+			itemBounds.push_back(worldBounds);
+		}
+		else
+		{
+			_unboundedNodes.push_back(node);
+		}
+	}
+	_boundingVolumes.Build(itemBounds);
+}
+
+void SceneGraph::RefitBoundingVolumes()
+{
+	for (size_t index : _transformHierarchy.GetChangedIndices())
+	{
+		unsigned int item = _nodeItems[index];
+		if (item != NoItem)
+		{
+			BoundingBox worldBounds;
+			_transformHierarchy.GetNode(index)->GetLocalBounds().Transform(worldBounds, _transformHierarchy.GetWorldTransform(index));
+			_boundingVolumes.SetItemBounds(item, worldBounds);
+		}
+	}
+	_boundingVolumes.Refit();
+}
@@ -1,27 +1,86 @@
 #pragma once
 #include <vector>
 #include "SceneNode.h"
+#include "BoundingVolumeHierarchy.h"
 
 using namespace std;
 
 class SceneGraph : public SceneNode
 {
+	friend class SceneFile;
+
 public:
-	SceneGraph() : SceneNode(L"Root") {};
-	SceneGraph(wstring name) : SceneNode(name) {};
+	SceneGraph() : SceneGraph(L"Root") {};
+	SceneGraph(wstring name) : SceneNode(name)
+	{
+		SceneNode::Attach(_nodeRegistry);
+	};
 	~SceneGraph(void) {};
 
 	virtual bool Initialise(void);
-	virtual void Update(const Matrix& worldTransformation);
-	virtual void Render(void);
+	void Update(const Matrix& worldTransformation);
+	virtual void Extract(RenderQueue& renderQueue);
 	virtual void Shutdown(void);
 
-	void Add(SceneNodePointer node);
-	void Remove(SceneNodePointer node);
-	SceneNodePointer Find(wstring name);
+	// Test the world bounds of every node against the view frustum. The next call to
+	// Extract only extracts the nodes that are at least partly inside it
+	void Cull(const BoundingFrustum& frustum);
+	size_t GetVisibleCount() const { return _visibleCount; }
+	size_t GetCulledCount() const { return _culledCount; }
+
+	virtual bool IsComposite() const { return true; }
+	void Add(const SceneNodePointer& node);
+	void Remove(const SceneNodePointer& node);
+	void Clear();
+	SceneNodePointer Find(const wstring& name);
+	// Lookup by interned name goes through the registry of the whole scene
+	SceneNodePointer Find(NameId nameId);
+
+	// Handles can be cached by the application and resolved in constant time.
+	// Resolve returns nullptr if the node has since been removed from the graph
+	NodeHandle FindHandle(NameId nameId) const { return (_registry != nullptr) ? _registry->Find(nameId) : NodeHandle(); }
+	SceneNode* Resolve(NodeHandle handle) const { return (_registry != nullptr) ? _registry->Resolve(handle) : nullptr; }
+
+	// Gives access to the nodes whose world transformation changed during the last
+	// update, so that consumers can skip static content
+	const TransformHierarchy& GetTransformHierarchy() const { return _transformHierarchy; }
+
+	// Large graphs can be updated in parallel on a thread pool. Graphs with fewer
+	// nodes than the threshold are always updated on the calling thread
+	void SetThreadPool(ThreadPool* threadPool, size_t parallelThreshold = TransformHierarchy::DefaultParallelThreshold)
+	{
+		_transformHierarchy.SetThreadPool(threadPool);
+		_transformHierarchy.SetParallelThreshold(parallelThreshold);
+	}
+
+	virtual void Flatten(TransformHierarchy& hierarchy, size_t parentIndex);
+	virtual void Attach(NodeRegistry& registry);
+	virtual void Detach();
 
 private:
 	vector<SceneNodePointer>		_children;
+
+	// Only used when this graph is the root. Graphs that have been added to
+	// another graph share the hierarchy and registry of the root they are attached to
+	TransformHierarchy				_transformHierarchy;
+	NodeRegistry					_nodeRegistry;
+
+	// The world bounds of the renderable nodes, indexed by item. Nodes without
+	// bounds are rendered whenever the graph is
+	static constexpr unsigned int NoItem = 0xFFFFFFFF;
+	BoundingVolumeHierarchy			_boundingVolumes;
+	vector<size_t>					_itemNodeIndices;
+	vector<unsigned int>			_nodeItems;
+	vector<SceneNode*>				_unboundedNodes;
+	vector<size_t>					_visibleItems;
+	bool							_isCulled{ false };
+	size_t							_visibleCount{ 0 };
+	size_t							_culledCount{ 0 };
+
+	bool IsRoot() const { return _registry == &_nodeRegistry; }
+	void InvalidateLayout();
+	void BuildBoundingVolumes();
+	void RefitBoundingVolumes();
 };
 
 typedef shared_ptr<SceneGraph>			 SceneGraphPointer;
@@ -2,11 +2,19 @@
 #include "core.h"
 #include "DirectXCore.h"
 #include "Camera.h"
+#include "TransformHierarchy.h"
+#include "NodeRegistry.h"
+#include "NodePool.h"
+#include "RenderQueue.h"
 
 using namespace std;
 
 // Abstract base class for all nodes of the scene graph.  
 // This scene graph implements the Composite Design Pattern
+//
+// Nodes should be created with MakeNode so that nodes of the same type are
+// allocated from the same pool. Traversals hold children by reference and
+// never copy a SceneNodePointer.
 
 class SceneNode;
 
@@ -14,10 +22,13 @@ typedef shared_ptr<SceneNode>	SceneNodePointer;
 
 class SceneNode : public enable_shared_from_this<SceneNode>
 {
+	friend class SceneFile;
+
 public:
 	SceneNode(wstring name)
 	{
 		_name = name;
+		_nameId = HashName(name.c_str());
 		_colour = Vector4(Colors::Gray);
 		_directionalLightColour = Vector4(Colors::Gray);
 		_directionalLightVector = Vector4(-2.0f, 0.0f, 1.0f, 0.0f);
@@ -30,6 +41,7 @@ public:
 	SceneNode(wstring name, Vector4 colour, Vector4 dlc, Vector4 dlv, Vector4 plc, Vector3 plp, float plr, Vector4 sc, float sp)
 	{
 		_name = name;
+		_nameId = HashName(name.c_str());
 		_colour = colour;
 		_directionalLightColour = dlc;
 		_directionalLightVector = dlv;
@@ -43,23 +55,101 @@ public:
 
 	// Core methods
 	virtual bool Initialise() = 0;
-	virtual void Update(const Matrix& worldTransformation) { _cumulativeWorldTransformation = _thisWorldTransformation * worldTransformation; }	
-	virtual void Render() = 0;
+	// Nodes do not draw themselves. Instead they add draw packets to the render queue
+	virtual void Extract(RenderQueue& renderQueue) = 0;
 	virtual void Shutdown() = 0;
 
-	void SetWorldTransform(const Matrix& worldTransformation) { _thisWorldTransformation = worldTransformation; }
-		
+	// The transformations themselves are stored in the flattened hierarchy owned by the
+	// root of the scene graph. The node only keeps its local transformation so that the
+	// hierarchy can be rebuilt when the structure of the graph changes. Until a node has
+	// been flattened into a hierarchy it has no index in one, and its own transformation
+	// is used instead
+	void SetWorldTransform(const Matrix& worldTransformation)
+	{
+		_thisWorldTransformation = worldTransformation;
+		if (_hierarchy != nullptr)
+		{
+			_hierarchy->SetLocalTransform(_transformIndex, worldTransformation);
+		}
+	}
+	const Matrix& GetWorldTransform() const { return _thisWorldTransformation; }
+	const Matrix& GetCumulativeWorldTransform() const { return (_hierarchy != nullptr) ? _hierarchy->GetWorldTransform(_transformIndex) : _thisWorldTransformation; }
+
+	// True if the cumulative world transformation was recomputed by the last update
+	bool HasChanged() const { return (_hierarchy != nullptr) ? _hierarchy->HasChanged(_transformIndex) : true; }
+
+	// Register this node (and any children) with a flattened hierarchy
+	virtual void Flatten(TransformHierarchy& hierarchy, size_t parentIndex)
+	{
+		_hierarchy = &hierarchy;
+		_transformIndex = hierarchy.Add(parentIndex, _thisWorldTransformation, this);
+	}
+
+	// Register this node (and any children) with the registry of the graph it has been
+	// added to, or release it again when it is removed
+	virtual void Attach(NodeRegistry& registry)
+	{
+		if (_registry != nullptr)
+		{
+			_registry->Unregister(_handle, _nameId);
+		}
+		_registry = &registry;
+		_handle = registry.Register(this, _nameId);
+	}
+	virtual void Detach()
+	{
+		if (_registry != nullptr)
+		{
+			_registry->Unregister(_handle, _nameId);
+		}
+		_registry = nullptr;
+		_handle = NodeHandle();
+		_hierarchy = nullptr;
+	}
+
+	// Bounds of the node's geometry in its own coordinate space. Nodes without
+	// bounds are never culled
+	bool HasBounds() const { return _hasBounds; }
+	const BoundingBox& GetLocalBounds() const { return _localBounds; }
+
+	const wstring& GetName() const { return _name; }
+	// A node that is attached to a registry is filed again under its new name
+	void SetName(const wstring& name)
+	{
+		if (_registry != nullptr)
+		{
+			_registry->Unregister(_handle, _nameId);
+		}
+		_name = name;
+		_nameId = HashName(name.c_str());
+		if (_registry != nullptr)
+		{
+			_handle = _registry->Register(this, _nameId);
+		}
+	}
+	NameId GetNameId() const { return _nameId; }
+	NodeHandle GetHandle() const { return _handle; }
+
 	// Although only required in the composite class, these are provided
 	// in order to simplify the code base for recursive operations
 
-	virtual void Add(SceneNodePointer node) {}
-	virtual void Remove(SceneNodePointer node) {};
-	virtual	SceneNodePointer Find(wstring name) { return (_name == name) ? shared_from_this() : nullptr; }
+	virtual bool IsComposite() const { return false; }
+	virtual void Add(const SceneNodePointer& node) {}
+	virtual void Remove(const SceneNodePointer& node) {};
+	virtual	SceneNodePointer Find(const wstring& name) { return (_name == name) ? shared_from_this() : nullptr; }
 
 protected:
+	void SetLocalBounds(const BoundingBox& localBounds) { _localBounds = localBounds; _hasBounds = true; }
+
 	Matrix				_thisWorldTransformation;
-	Matrix				_cumulativeWorldTransformation;
+	TransformHierarchy*	_hierarchy{ nullptr };
+	size_t				_transformIndex{ 0 };
+	NodeRegistry*		_registry{ nullptr };
+	NodeHandle			_handle;
 	wstring				_name;
+	NameId				_nameId{ 0 };
+	BoundingBox			_localBounds;
+	bool				_hasBounds{ false };
 
 	Vector4				_colour;
 	Vector4				_directionalLightColour;
@@ -0,0 +1,257 @@
+#include <fstream>
+#include <sstream>
+#include "ShaderCache.h"
+
+// Nested includes are followed this many levels deep when hashing a shader
+#define MaximumIncludeDepth		16
+
+// 64-bit FNV-1a, continued from a previous hash
+static UINT64 HashBytes(const void* data, size_t size, UINT64 hash)
+{
+	const BYTE* bytes = static_cast<const BYTE*>(data);
+	for (size_t i = 0; i < size; i++)
+	{
+		hash ^= bytes[i];
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+static UINT64 HashString(const string& text, UINT64 hash)
+{
+	// Hash the length as well, so that adjacent fields cannot run into each other
+	UINT64 length = text.size();
+	hash = HashBytes(&length, sizeof(length), hash);
+	return HashBytes(text.data(), text.size(), hash);
+}
+
+ShaderCache::ShaderCache()
+{
+	_compiler = CompileWithD3D;
+}
+
+void ShaderCache::Open(const wstring& cacheFileName)
+{
+	_cacheFileName = cacheFileName;
+	_mappedEntries.clear();
+	_cacheFile = make_unique<MappedFile>(cacheFileName);
+	const BYTE* data = _cacheFile->GetData();
+	if (data == nullptr || _cacheFile->GetSize() < sizeof(ShaderCacheHeader))
+	{
+		return;
+	}
+
+	// Validate the header and make sure every entry lies inside the file
+	const ShaderCacheHeader& header = *reinterpret_cast<const ShaderCacheHeader*>(data);
+	UINT64 entryEnd = header.EntryOffset + static_cast<UINT64>(header.EntryCount) * sizeof(ShaderCacheEntry);
+	if (header.Magic != ShaderCacheMagic || header.Version != ShaderCacheVersion ||
+		header.EntryOffset % alignof(ShaderCacheEntry) != 0 || entryEnd > _cacheFile->GetSize())
+	{
+		return;
+	}
+	const ShaderCacheEntry* entries = reinterpret_cast<const ShaderCacheEntry*>(data + header.EntryOffset);
+	for (UINT32 i = 0; i < header.EntryCount; i++)
+	{
+		if (static_cast<UINT64>(entries[i].Offset) + entries[i].Size > _cacheFile->GetSize())
+		{
+			_mappedEntries.clear();
+			return;
+		}
+		_mappedEntries[entries[i].Key] = make_pair(data + entries[i].Offset, static_cast<size_t>(entries[i].Size));
+	}
+}
+
+bool ShaderCache::Save()
+{
+	if (_compiledEntries.size() == 0 || _cacheFileName.empty())
+	{
+		return true;
+	}
+
+	// Copy the entries out of the mapped file, which has to be closed before it can be replaced
+	for (const auto& entry : _mappedEntries)
+	{
+		if (_compiledEntries.find(entry.first) == _compiledEntries.end())
+		{
+			_compiledEntries[entry.first].assign(entry.second.first, entry.second.first + entry.second.second);
+		}
+	}
+	_mappedEntries.clear();
+	_cacheFile.reset();
+
+	ShaderCacheHeader header = { 0 };
+	header.Magic = ShaderCacheMagic;
+	header.Version = ShaderCacheVersion;
+	header.EntryCount = static_cast<UINT32>(_compiledEntries.size());
+	header.EntryOffset = sizeof(ShaderCacheHeader);
+
+	vector<ShaderCacheEntry> entries;
+	UINT32 offset = header.EntryOffset + header.EntryCount * sizeof(ShaderCacheEntry);
+	for (const auto& compiledEntry : _compiledEntries)
+	{
+		ShaderCacheEntry entry = { compiledEntry.first, offset, static_cast<UINT32>(compiledEntry.second.size()) };
+		entries.push_back(entry);
+		offset += entry.Size;
+	}
+
+	ofstream file(_cacheFileName, ios::binary | ios::trunc);
+	if (!file)
+	{
+		return false;
+	}
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	file.write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(ShaderCacheEntry));
+	for (const auto& compiledEntry : _compiledEntries)
+	{
+		file.write(reinterpret_cast<const char*>(compiledEntry.second.data()), compiledEntry.second.size());
+	}
+	file.close();
+	if (!file.good())
+	{
+		return false;
+	}
+
+	// Everything that was compiled is now in the file, so map it again
+	_compiledEntries.clear();
+	Open(_cacheFileName);
+	return true;
+}
+
+bool ShaderCache::GetByteCode(const wstring& fileName, const vector<ShaderDefine>& defines, const string& entryPoint, const string& target, UINT flags,
+							  vector<BYTE>& byteCode, string& messages)
+{
+	ShaderCompileRequest request;
+	request.FileName = fileName;
+	request.Defines = defines;
+	request.EntryPoint = entryPoint;
+	request.Target = target;
+	request.Flags = flags;
+	if (!ReadSource(fileName, request.Source))
+	{
+		messages = "Unable to read shader source file";
+		return false;
+	}
+
+	// Included files are looked up relative to the shader file
+	size_t separator = fileName.find_last_of(L"\\/");
+	wstring directory = (separator == wstring::npos) ? L"" : fileName.substr(0, separator + 1);
+	string includedSource;
+	ReadIncludedSource(request.Source, directory, includedSource, 0);
+	UINT64 key = HashRequest(request, includedSource);
+
+	auto mappedEntry = _mappedEntries.find(key);
+	if (mappedEntry != _mappedEntries.end())
+	{
+		byteCode.assign(mappedEntry->second.first, mappedEntry->second.first + mappedEntry->second.second);
+		_statistics.HitCount++;
+		return true;
+	}
+	auto compiledEntry = _compiledEntries.find(key);
+	if (compiledEntry != _compiledEntries.end())
+	{
+		byteCode = compiledEntry->second;
+		_statistics.HitCount++;
+		return true;
+	}
+
+	_statistics.MissCount++;
+	if (!_compiler(request, byteCode, messages))
+	{
+		return false;
+	}
+	_compiledEntries[key] = byteCode;
+	return true;
+}
+
+UINT64 ShaderCache::HashRequest(const ShaderCompileRequest& request, const string& includedSource)
+{
+	UINT64 hash = 14695981039346656037ull;
+	hash = HashString(request.Source, hash);
+	hash = HashString(includedSource, hash);
+	for (const ShaderDefine& define : request.Defines)
+	{
+		hash = HashString(define.Name, hash);
+		hash = HashString(define.Value, hash);
+	}
+	hash = HashString(request.EntryPoint, hash);
+	hash = HashString(request.Target, hash);
+	return HashBytes(&request.Flags, sizeof(request.Flags), hash);
+}
+
+bool ShaderCache::CompileWithD3D(const ShaderCompileRequest& request, vector<BYTE>& byteCode, string& messages)
+{
+	vector<D3D_SHADER_MACRO> macros;
+	for (const ShaderDefine& define : request.Defines)
+	{
+		macros.push_back({ define.Name.c_str(), define.Value.c_str() });
+	}
+	macros.push_back({ nullptr, nullptr });
+
+	// The source name is used to find included files
+	string sourceName(request.FileName.begin(), request.FileName.end());
+	ComPtr<ID3DBlob> compiledShader = nullptr;
+	ComPtr<ID3DBlob> compilationMessages = nullptr;
+	HRESULT hr = D3DCompile(request.Source.data(), request.Source.size(), sourceName.c_str(),
+		macros.data(), D3D_COMPILE_STANDARD_FILE_INCLUDE,
+		request.EntryPoint.c_str(), request.Target.c_str(),
+		request.Flags, 0,
+		compiledShader.GetAddressOf(),
+		compilationMessages.GetAddressOf());
+
+	if (compilationMessages.Get() != nullptr)
+	{
+		messages.assign(static_cast<const char*>(compilationMessages->GetBufferPointer()), compilationMessages->GetBufferSize());
+	}
+	if (FAILED(hr))
+	{
+		return false;
+	}
+	const BYTE* data = static_cast<const BYTE*>(compiledShader->GetBufferPointer());
+	byteCode.assign(data, data + compiledShader->GetBufferSize());
+	return true;
+}
+
+bool ShaderCache::ReadSource(const wstring& fileName, string& source)
+{
+	ifstream file(fileName, ios::binary);
+	if (!file)
+	{
+		return false;
+	}
+	stringstream contents;
+	contents << file.rdbuf();
+	source = contents.str();
+	return true;
+}
+
+void ShaderCache::ReadIncludedSource(const string& source, const wstring& directory, string& includedSource, int depth)
+{
+	if (depth >= MaximumIncludeDepth)
+	{
+		return;
+	}
+
+	// Only quoted includes are followed. Files that cannot be read are left to the compiler to report
+	const string includeDirective = "#include";
+	size_t position = source.find(includeDirective);
+	while (position != string::npos)
+	{
+		size_t nameStart = source.find('"', position + includeDirective.size());
+		size_t lineEnd = source.find('\n', position);
+		if (nameStart != string::npos && nameStart < lineEnd)
+		{
+			size_t nameEnd = source.find('"', nameStart + 1);
+			if (nameEnd != string::npos && nameEnd < lineEnd)
+			{
+				string name = source.substr(nameStart + 1, nameEnd - nameStart - 1);
+				string include;
+				if (ReadSource(directory + wstring(name.begin(), name.end()), include))
+				{
+					includedSource += include;
+					ReadIncludedSource(include, directory, includedSource, depth + 1);
+				}
+			}
+		}
+		position = source.find(includeDirective, position + includeDirective.size());
+	}
+}
@@ -0,0 +1,103 @@
+#pragma once
+#include <vector>
+#include <unordered_map>
+#include <functional>
+#include "core.h"
+#include "DirectXCore.h"
+#include "MappedFile.h"
+
+using namespace std;
+
+// On-disk cache of compiled shader byte code.
+//
+// Every shader is identified by a 64-bit hash of everything that affects its byte
+// code: the source, the source of any files it includes, the defines, the entry
+// point, the target and the compile flags. The cache file is a header, a table of
+// entries and the byte code of every entry. It is memory-mapped when opened, so a
+// hit only costs a hash of the source and a table lookup.
+//
+// The compiler is called on a miss. It can be replaced, so that the cache can be
+// used with a stand-in compiler where the D3D compiler is not available.
+
+#define DefaultShaderCacheFileName	L"Shaders.cache"
+#define ShaderCacheMagic			0x43444853		// "SHDC"
+#define ShaderCacheVersion			1
+
+struct ShaderCacheHeader
+{
+	UINT32		Magic;
+	UINT32		Version;
+	UINT32		EntryCount;
+	UINT32		EntryOffset;
+};
+
+struct ShaderCacheEntry
+{
+	UINT64		Key;
+	UINT32		Offset;
+	UINT32		Size;
+};
+
+static_assert(sizeof(ShaderCacheHeader) == 16, "ShaderCacheHeader must match the file layout");
+static_assert(sizeof(ShaderCacheEntry) == 16, "ShaderCacheEntry must match the file layout");
+
+struct ShaderDefine
+{
+	string		Name;
+	string		Value;
+};
+
+// Everything the compiler needs to compile a shader. The source has already been read from the file
+struct ShaderCompileRequest
+{
+	wstring					FileName;
+	string					Source;
+	vector<ShaderDefine>	Defines;
+	string					EntryPoint;
+	string					Target;
+	UINT					Flags{ 0 };
+};
+
+// Returns false if the shader failed to compile. Any compiler output is returned in the messages
+typedef function<bool(const ShaderCompileRequest& request, vector<BYTE>& byteCode, string& messages)> ShaderCompiler;
+
+struct ShaderCacheStatistics
+{
+	size_t		HitCount{ 0 };
+	size_t		MissCount{ 0 };
+};
+
+class ShaderCache
+{
+public:
+	ShaderCache();
+	~ShaderCache() {};
+
+	// Map the cache file. A missing or invalid file simply results in an empty cache
+	void Open(const wstring& cacheFileName);
+	// Write the cache file if any shaders have been compiled since it was opened
+	bool Save();
+
+	void SetCompiler(const ShaderCompiler& compiler) { _compiler = compiler; }
+
+	// Returns the byte code of the shader, compiling it on a miss. Returns false if the
+	// source file could not be read or the shader failed to compile
+	bool GetByteCode(const wstring& fileName, const vector<ShaderDefine>& defines, const string& entryPoint, const string& target, UINT flags,
+					 vector<BYTE>& byteCode, string& messages);
+
+	const ShaderCacheStatistics& GetStatistics() const { return _statistics; }
+
+	static UINT64 HashRequest(const ShaderCompileRequest& request, const string& includedSource);
+	static bool CompileWithD3D(const ShaderCompileRequest& request, vector<BYTE>& byteCode, string& messages);
+
+private:
+	wstring							_cacheFileName;
+	unique_ptr<MappedFile>			_cacheFile;
+	unordered_map<UINT64, pair<const BYTE*, size_t>>	_mappedEntries;
+	unordered_map<UINT64, vector<BYTE>>	_compiledEntries;
+	ShaderCompiler					_compiler;
+	ShaderCacheStatistics			_statistics;
+
+	static bool ReadSource(const wstring& fileName, string& source);
+	static void ReadIncludedSource(const string& source, const wstring& directory, string& includedSource, int depth);
+};
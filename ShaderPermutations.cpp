@@ -0,0 +1,55 @@
+#include "ShaderPermutations.h"
+
+// The table of precompiled permutations is generated by CompileShaders.bat, which
+// runs before every build. It is optional, so that the project still builds (and
+// compiles the permutations at runtime) without the shader compiler.
+
+#if __has_include("CompiledShaders/CompiledShaders.h")
+#include "CompiledShaders/CompiledShaders.h"
+#else
+static const EmbeddedShader embeddedShaders[] = { { nullptr, 0, nullptr, 0 } };
+#endif
+
+UINT SelectShaderPermutation(bool hasTexture, const Vector4& pointLightColour, float pointLightRange, const Vector4& specularColour, float specularPower)
+{
+	UINT permutation = 0;
+	if (hasTexture)
+	{
+		permutation |= ShaderHasTexture;
+	}
+	// The point light is saturated before it is attenuated, so a colour with no positive channel
+	// adds nothing. The range is not looked at, since the attenuation is only zero for some ranges
+	if (pointLightColour.x > 0.0f || pointLightColour.y > 0.0f || pointLightColour.z > 0.0f)
+	{
+		permutation |= ShaderPointLight;
+	}
+	// The specular colour is added without being saturated, so any channel that is not zero
+	// counts. A power that is not positive can raise zero to an infinite brightness, which is
+	// left to the shader
+	if (specularPower <= 0.0f || specularColour.x != 0.0f || specularColour.y != 0.0f || specularColour.z != 0.0f)
+	{
+		permutation |= ShaderSpecular;
+	}
+	return permutation;
+}
+
+vector<ShaderDefine> GetShaderPermutationDefines(UINT permutation)
+{
+	vector<ShaderDefine> defines;
+	defines.push_back({ "HAS_TEXTURE", (permutation & ShaderHasTexture) ? "1" : "0" });
+	defines.push_back({ "SPECULAR", (permutation & ShaderSpecular) ? "1" : "0" });
+	defines.push_back({ "NUM_POINT_LIGHTS", (permutation & ShaderPointLight) ? "1" : "0" });
+	return defines;
+}
+
+const EmbeddedShader* FindEmbeddedShader(const string& entryPoint, UINT permutation)
+{
+	for (const EmbeddedShader& embeddedShader : embeddedShaders)
+	{
+		if (embeddedShader.EntryPoint != nullptr && embeddedShader.Permutation == permutation && entryPoint == embeddedShader.EntryPoint)
+		{
+			return &embeddedShader;
+		}
+	}
+	return nullptr;
+}
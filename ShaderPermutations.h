@@ -0,0 +1,49 @@
+#pragma once
+#include <vector>
+#include "core.h"
+#include "DirectXCore.h"
+#include "ShaderCache.h"
+
+using namespace std;
+
+// Permutations of the lighting shader (shader.hlsl).
+//
+// A permutation is a set of flags, each of which corresponds to a define in the
+// shader. CompileShaders.bat compiles every permutation ahead of time into arrays
+// of byte code that are embedded in the executable, so that no shader has to be
+// compiled at startup. If the embedded table has not been generated, permutations
+// are compiled from shader.hlsl through the shader cache instead.
+
+#define PermutationShaderFileName	L"shader.hlsl"
+#define VertexShaderName			"VS"
+#define InstancedVertexShaderName	"VSInstanced"
+#define PixelShaderName				"PS"
+
+enum ShaderPermutationFlags : UINT
+{
+	ShaderHasTexture		= 1,		// HAS_TEXTURE
+	ShaderSpecular			= 2,		// SPECULAR
+	ShaderPointLight		= 4,		// NUM_POINT_LIGHTS = 1
+	ShaderPermutationCount	= 8
+};
+
+// The vertex shaders only depend on these flags
+#define VertexShaderPermutationMask	ShaderHasTexture
+
+struct EmbeddedShader
+{
+	const char*		EntryPoint;
+	UINT			Permutation;
+	const BYTE*		ByteCode;
+	size_t			ByteCodeSize;
+};
+
+// Select the cheapest permutation that produces the same result for a material. Lighting
+// terms that cannot contribute anything are left out
+UINT SelectShaderPermutation(bool hasTexture, const Vector4& pointLightColour, float pointLightRange, const Vector4& specularColour, float specularPower);
+
+// The defines that select a permutation when it is compiled from source
+vector<ShaderDefine> GetShaderPermutationDefines(UINT permutation);
+
+// Returns nullptr if the permutation is not in the embedded table
+const EmbeddedShader* FindEmbeddedShader(const string& entryPoint, UINT permutation);
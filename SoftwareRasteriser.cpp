@@ -0,0 +1,807 @@
+#include <fstream>
+#include <chrono>
+#include <cmath>
+#include <cfloat>
+#include <random>
+#include <thread>
+#include "SoftwareRasteriser.h"
+#include "ShaderPermutations.h"
+#include "Float8.h"
+
+// Triangles are only clipped against the sides of the screen if they reach this many screen
+// widths or heights beyond it. Closer than that the rasteriser simply skips the pixels that
+// are off screen, which is cheaper than clipping and keeps the edge functions precise enough
+#define GuardBandScale		8.0f
+#define ClipPlaneCount		6
+#define MaxClippedVertices	(3 + ClipPlaneCount)
+
+// The distance of a clip space position inside a clipping plane. The sides are the guard band
+static float ClipDistance(const Vector4& position, UINT plane, float sideScale)
+{
+	switch (plane)
+	{
+	case 0:
+		return position.z;
+	case 1:
+		return position.w - position.z;
+	case 2:
+		return position.x + sideScale * position.w;
+	case 3:
+		return sideScale * position.w - position.x;
+	case 4:
+		return position.y + sideScale * position.w;
+	default:
+		return sideScale * position.w - position.y;
+	}
+}
+
+static SoftwareVertex LerpVertex(const SoftwareVertex& vertex0, const SoftwareVertex& vertex1, float amount)
+{
+	SoftwareVertex vertex;
+	vertex.Position = vertex0.Position + (vertex1.Position - vertex0.Position) * amount;
+	for (UINT attribute = 0; attribute < SoftwareAttributeCount; attribute++)
+	{
+		vertex.Attributes[attribute] = vertex0.Attributes[attribute] + (vertex1.Attributes[attribute] - vertex0.Attributes[attribute]) * amount;
+	}
+	return vertex;
+}
+
+static UINT PackColour(float red, float green, float blue, float alpha)
+{
+	// The render target is BGRA, the layout of a 32 bit bitmap
+	return static_cast<UINT>(blue * 255.0f + 0.5f) | (static_cast<UINT>(green * 255.0f + 0.5f) << 8) |
+		   (static_cast<UINT>(red * 255.0f + 0.5f) << 16) | (static_cast<UINT>(alpha * 255.0f + 0.5f) << 24);
+}
+
+static float Clamp(float value, float minimum, float maximum)
+{
+	return value < minimum ? minimum : (value > maximum ? maximum : value);
+}
+
+static int AddressTexel(int coordinate, int size, bool isWrapped)
+{
+	if (isWrapped)
+	{
+		coordinate %= size;
+		return coordinate < 0 ? coordinate + size : coordinate;
+	}
+	return coordinate < 0 ? 0 : (coordinate >= size ? size - 1 : coordinate);
+}
+
+// Sample a texture level as the lighting shader does, returning RGBA
+static void SampleTexture(const SoftwareTextureLevel& level, float u, float v, bool isPointSampled, bool isWrapped, float* colour)
+{
+	int width = static_cast<int>(level.Width);
+	int height = static_cast<int>(level.Height);
+	float x = u * width - 0.5f;
+	float y = v * height - 0.5f;
+	float left = floorf(x);
+	float top = floorf(y);
+	if (isPointSampled)
+	{
+		UINT texel = level.Texels[AddressTexel(static_cast<int>(floorf(u * width)), width, isWrapped) + AddressTexel(static_cast<int>(floorf(v * height)), height, isWrapped) * width];
+		for (UINT channel = 0; channel < 4; channel++)
+		{
+			colour[channel] = ((texel >> (channel * 8)) & 0xFF) / 255.0f;
+		}
+		return;
+	}
+
+	float fractionX = x - left;
+	float fractionY = y - top;
+	int x0 = AddressTexel(static_cast<int>(left), width, isWrapped);
+	int x1 = AddressTexel(static_cast<int>(left) + 1, width, isWrapped);
+	int y0 = AddressTexel(static_cast<int>(top), height, isWrapped) * width;
+	int y1 = AddressTexel(static_cast<int>(top) + 1, height, isWrapped) * width;
+	UINT texel00 = level.Texels[x0 + y0];
+	UINT texel10 = level.Texels[x1 + y0];
+	UINT texel01 = level.Texels[x0 + y1];
+	UINT texel11 = level.Texels[x1 + y1];
+	for (UINT channel = 0; channel < 4; channel++)
+	{
+		UINT shift = channel * 8;
+		float upper = ((texel00 >> shift) & 0xFF) + (((texel10 >> shift) & 0xFF) - static_cast<float>((texel00 >> shift) & 0xFF)) * fractionX;
+		float lower = ((texel01 >> shift) & 0xFF) + (((texel11 >> shift) & 0xFF) - static_cast<float>((texel01 >> shift) & 0xFF)) * fractionX;
+		colour[channel] = (upper + (lower - upper) * fractionY) / 255.0f;
+	}
+}
+
+static Float8 DepthTest(D3D11_COMPARISON_FUNC depthFunc, Float8 depth, Float8 storedDepth)
+{
+	switch (depthFunc)
+	{
+	case D3D11_COMPARISON_NEVER:
+		return Float8(0.0f) < Float8(0.0f);
+	case D3D11_COMPARISON_LESS:
+		return depth < storedDepth;
+	case D3D11_COMPARISON_EQUAL:
+		return (depth <= storedDepth) & (depth >= storedDepth);
+	case D3D11_COMPARISON_LESS_EQUAL:
+		return depth <= storedDepth;
+	case D3D11_COMPARISON_GREATER:
+		return depth > storedDepth;
+	case D3D11_COMPARISON_NOT_EQUAL:
+		return (depth < storedDepth) | (depth > storedDepth);
+	case D3D11_COMPARISON_GREATER_EQUAL:
+		return depth >= storedDepth;
+	default:
+		return Float8(0.0f) <= Float8(0.0f);
+	}
+}
+
+void SoftwareRasteriser::Resize(UINT width, UINT height)
+{
+	if (width == _width && height == _height)
+	{
+		return;
+	}
+	_width = width;
+	_height = height;
+	_tileColumns = (width + SoftwareTileSize - 1) / SoftwareTileSize;
+	_tileRows = (height + SoftwareTileSize - 1) / SoftwareTileSize;
+	UINT tileCount = _tileColumns * _tileRows;
+	_tileColours.assign(tileCount * SoftwareTileSize * SoftwareTileSize, 0);
+	_tileDepths.assign(tileCount * SoftwareTileSize * SoftwareTileSize, 1.0f);
+	_blockMaxDepths.assign(tileCount * SoftwareBlocksPerTile * SoftwareBlocksPerTile, 1.0f);
+	_colourBuffer.assign(width * height, 0);
+	_bins.assign(tileCount, vector<UINT>());
+	_triangles.clear();
+	_draws.clear();
+	_isClearPending = true;
+}
+
+void SoftwareRasteriser::Clear(const float colour[4], float depth)
+{
+	// A clear replaces anything drawn before it in the frame, so it can wait for the tiles
+	_clearColour = PackColour(Clamp(colour[0], 0.0f, 1.0f), Clamp(colour[1], 0.0f, 1.0f), Clamp(colour[2], 0.0f, 1.0f), Clamp(colour[3], 0.0f, 1.0f));
+	_clearDepth = depth;
+	_isClearPending = true;
+	for (vector<UINT>& bin : _bins)
+	{
+		bin.clear();
+	}
+	_triangles.clear();
+	_draws.clear();
+}
+
+UINT SoftwareRasteriser::AddDraw(const SoftwareDrawState& drawState)
+{
+	_frameStatistics.DrawCount++;
+	_draws.push_back(drawState);
+	return static_cast<UINT>(_draws.size() - 1);
+}
+
+void SoftwareRasteriser::AddTriangle(UINT drawIndex, const SoftwareVertex& vertex0, const SoftwareVertex& vertex1, const SoftwareVertex& vertex2)
+{
+	_frameStatistics.TriangleCount++;
+	const SoftwareVertex* vertices[3] = { &vertex0, &vertex1, &vertex2 };
+
+	// Reject triangles that are entirely outside one side of the view volume, and pass
+	// those that are inside every plane of the guard band straight on
+	bool isInsideGuardBand = true;
+	for (UINT plane = 0; plane < ClipPlaneCount; plane++)
+	{
+		UINT outsideCount = 0;
+		for (const SoftwareVertex* vertex : vertices)
+		{
+			if (ClipDistance(vertex->Position, plane, 1.0f) < 0.0f)
+			{
+				outsideCount++;
+			}
+			if (ClipDistance(vertex->Position, plane, GuardBandScale) < 0.0f)
+			{
+				isInsideGuardBand = false;
+			}
+		}
+		if (outsideCount == 3)
+		{
+			return;
+		}
+	}
+	if (isInsideGuardBand)
+	{
+		SetupTriangle(drawIndex, vertex0, vertex1, vertex2);
+		return;
+	}
+	SoftwareVertex polygon[3] = { vertex0, vertex1, vertex2 };
+	ClipAndSetup(drawIndex, polygon, 3);
+}
+
+void SoftwareRasteriser::ClipAndSetup(UINT drawIndex, const SoftwareVertex* vertices, UINT vertexCount)
+{
+	// Clip the polygon against each plane in turn and then draw it as a fan of triangles
+	SoftwareVertex polygons[2][MaxClippedVertices];
+	UINT polygonSize = vertexCount;
+	for (UINT vertex = 0; vertex < vertexCount; vertex++)
+	{
+		polygons[0][vertex] = vertices[vertex];
+	}
+	UINT current = 0;
+	for (UINT plane = 0; plane < ClipPlaneCount && polygonSize >= 3; plane++)
+	{
+		const SoftwareVertex* input = polygons[current];
+		SoftwareVertex* output = polygons[1 - current];
+		UINT outputSize = 0;
+		for (UINT vertex = 0; vertex < polygonSize; vertex++)
+		{
+			const SoftwareVertex& start = input[vertex];
+			const SoftwareVertex& end = input[(vertex + 1) % polygonSize];
+			float startDistance = ClipDistance(start.Position, plane, GuardBandScale);
+			float endDistance = ClipDistance(end.Position, plane, GuardBandScale);
+			if (startDistance >= 0.0f)
+			{
+				output[outputSize++] = start;
+			}
+			if ((startDistance >= 0.0f) != (endDistance >= 0.0f))
+			{
+				output[outputSize++] = LerpVertex(start, end, startDistance / (startDistance - endDistance));
+			}
+		}
+		polygonSize = outputSize;
+		current = 1 - current;
+	}
+	for (UINT vertex = 2; vertex < polygonSize; vertex++)
+	{
+		SetupTriangle(drawIndex, polygons[current][0], polygons[current][vertex - 1], polygons[current][vertex]);
+	}
+}
+
+void SoftwareRasteriser::SetupTriangle(UINT drawIndex, const SoftwareVertex& vertex0, const SoftwareVertex& vertex1, const SoftwareVertex& vertex2)
+{
+	const SoftwareDrawState& draw = _draws[drawIndex];
+	const SoftwareVertex* vertices[3] = { &vertex0, &vertex1, &vertex2 };
+
+	// Project the vertices onto the screen, with y pointing down as it does in Direct3D
+	float x[3];
+	float y[3];
+	float z[3];
+	float inverseW[3];
+	for (UINT vertex = 0; vertex < 3; vertex++)
+	{
+		const Vector4& position = vertices[vertex]->Position;
+		inverseW[vertex] = 1.0f / position.w;
+		x[vertex] = (position.x * inverseW[vertex] * 0.5f + 0.5f) * _width;
+		y[vertex] = (0.5f - position.y * inverseW[vertex] * 0.5f) * _height;
+		z[vertex] = position.z * inverseW[vertex];
+	}
+
+	// A positive area is clockwise on the screen
+	float area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+	if (area == 0.0f)
+	{
+		return;
+	}
+	bool isFrontFacing = draw.IsFrontCounterClockwise ? area < 0.0f : area > 0.0f;
+	if ((draw.CullMode == D3D11_CULL_BACK && !isFrontFacing) || (draw.CullMode == D3D11_CULL_FRONT && isFrontFacing))
+	{
+		return;
+	}
+
+	// Every triangle is made clockwise, so that its edge functions are positive inside it
+	UINT order[3] = { 0, 1, 2 };
+	if (area < 0.0f)
+	{
+		order[1] = 2;
+		order[2] = 1;
+		area = -area;
+	}
+
+	Triangle triangle;
+	float minX = FLT_MAX;
+	float minY = FLT_MAX;
+	float maxX = -FLT_MAX;
+	float maxY = -FLT_MAX;
+	triangle.MinDepth = FLT_MAX;
+	triangle.MaxDepth = -FLT_MAX;
+	for (UINT edge = 0; edge < 3; edge++)
+	{
+		// Edge i is opposite vertex i, so it is zero at the other two vertices and equal to the area at vertex i
+		UINT start = order[(edge + 1) % 3];
+		UINT end = order[(edge + 2) % 3];
+		Plane& edgeFunction = triangle.Edges[edge];
+		edgeFunction.X = y[start] - y[end];
+		edgeFunction.Y = x[end] - x[start];
+		edgeFunction.Z = -(edgeFunction.X * x[start] + edgeFunction.Y * y[start]);
+		// Pixels exactly on an edge belong to the triangle if the edge is a top or a left edge
+		triangle.IsTopLeft[edge] = edgeFunction.X > 0.0f || (edgeFunction.X == 0.0f && edgeFunction.Y > 0.0f);
+
+		minX = min(minX, x[edge]);
+		minY = min(minY, y[edge]);
+		maxX = max(maxX, x[edge]);
+		maxY = max(maxY, y[edge]);
+		triangle.MinDepth = min(triangle.MinDepth, z[edge]);
+		triangle.MaxDepth = max(triangle.MaxDepth, z[edge]);
+	}
+
+	// Pixels are sampled at their centres
+	triangle.MinX = max(0, static_cast<int>(ceilf(minX - 0.5f)));
+	triangle.MinY = max(0, static_cast<int>(ceilf(minY - 0.5f)));
+	triangle.MaxX = min(static_cast<int>(_width) - 1, static_cast<int>(floorf(maxX - 0.5f)));
+	triangle.MaxY = min(static_cast<int>(_height) - 1, static_cast<int>(floorf(maxY - 0.5f)));
+	if (triangle.MinX > triangle.MaxX || triangle.MinY > triangle.MaxY)
+	{
+		return;
+	}
+
+	// A value at the vertices is interpolated with the barycentric coordinates, which are the
+	// edge functions divided by the area
+	auto makePlane = [&](float value0, float value1, float value2) -> Plane
+	{
+		float values[3] = { value0, value1, value2 };
+		float value = values[order[0]];
+		float delta1 = values[order[1]] - value;
+		float delta2 = values[order[2]] - value;
+		Plane plane;
+		plane.X = (delta1 * triangle.Edges[1].X + delta2 * triangle.Edges[2].X) / area;
+		plane.Y = (delta1 * triangle.Edges[1].Y + delta2 * triangle.Edges[2].Y) / area;
+		plane.Z = value + (delta1 * triangle.Edges[1].Z + delta2 * triangle.Edges[2].Z) / area;
+		return plane;
+	};
+	triangle.Depth = makePlane(z[0], z[1], z[2]);
+	triangle.InverseW = makePlane(inverseW[0], inverseW[1], inverseW[2]);
+	for (UINT attribute = 0; attribute < SoftwareAttributeCount; attribute++)
+	{
+		triangle.Attributes[attribute] = makePlane(vertex0.Attributes[attribute] * inverseW[0], vertex1.Attributes[attribute] * inverseW[1], vertex2.Attributes[attribute] * inverseW[2]);
+	}
+
+	// Choose the texture level whose texels are closest to the size of a pixel over the triangle
+	triangle.TextureLevel = 0;
+	if (draw.Texture != nullptr && !draw.Texture->empty())
+	{
+		const SoftwareTextureLevel& level = draw.Texture->front();
+		const float* u = &vertex0.Attributes[SoftwareTexCoordAttribute];
+		float texCoordArea = fabsf((vertex1.Attributes[SoftwareTexCoordAttribute] - u[0]) * (vertex2.Attributes[SoftwareTexCoordAttribute + 1] - u[1]) -
+								   (vertex2.Attributes[SoftwareTexCoordAttribute] - u[0]) * (vertex1.Attributes[SoftwareTexCoordAttribute + 1] - u[1]));
+		float texelArea = texCoordArea * level.Width * level.Height;
+		if (texelArea > area)
+		{
+			float levelOfDetail = 0.5f * log2f(texelArea / area);
+			triangle.TextureLevel = min(static_cast<UINT>(levelOfDetail + 0.5f), static_cast<UINT>(draw.Texture->size() - 1));
+		}
+	}
+	triangle.DrawIndex = drawIndex;
+
+	_frameStatistics.SetupTriangleCount++;
+	_triangles.push_back(triangle);
+	Bin(_triangles.back(), static_cast<UINT>(_triangles.size() - 1));
+}
+
+void SoftwareRasteriser::Bin(const Triangle& triangle, UINT triangleIndex)
+{
+	int firstColumn = triangle.MinX / SoftwareTileSize;
+	int lastColumn = triangle.MaxX / SoftwareTileSize;
+	int firstRow = triangle.MinY / SoftwareTileSize;
+	int lastRow = triangle.MaxY / SoftwareTileSize;
+	for (int row = firstRow; row <= lastRow; row++)
+	{
+		for (int column = firstColumn; column <= lastColumn; column++)
+		{
+			// Large triangles cover many tiles of their bounding box only partly or not at all. A tile is
+			// skipped if it is entirely outside any edge, tested at the corner that is furthest inside it
+			float left = column * SoftwareTileSize + 0.5f;
+			float top = row * SoftwareTileSize + 0.5f;
+			bool isOutside = false;
+			for (const Plane& edge : triangle.Edges)
+			{
+				float x = edge.X >= 0.0f ? left + SoftwareTileSize - 1 : left;
+				float y = edge.Y >= 0.0f ? top + SoftwareTileSize - 1 : top;
+				if (edge.X * x + edge.Y * y + edge.Z < 0.0f)
+				{
+					isOutside = true;
+					break;
+				}
+			}
+			if (!isOutside)
+			{
+				_bins[row * _tileColumns + column].push_back(triangleIndex);
+				_frameStatistics.BinnedTriangleCount++;
+			}
+		}
+	}
+}
+
+void SoftwareRasteriser::Resolve(ThreadPool* threadPool)
+{
+	auto startTime = chrono::high_resolution_clock::now();
+
+	UINT tileCount = _tileColumns * _tileRows;
+	vector<size_t> depthCulledBlockCounts(tileCount, 0);
+	vector<size_t> shadedPixelCounts(tileCount, 0);
+	auto drawTile = [&](size_t tile)
+	{
+		DrawTile(static_cast<UINT>(tile), depthCulledBlockCounts[tile], shadedPixelCounts[tile]);
+	};
+	if (threadPool != nullptr)
+	{
+		threadPool->Run(tileCount, drawTile);
+	}
+	else
+	{
+		for (size_t tile = 0; tile < tileCount; tile++)
+		{
+			drawTile(tile);
+		}
+	}
+
+	for (UINT tile = 0; tile < tileCount; tile++)
+	{
+		_frameStatistics.DepthCulledBlockCount += depthCulledBlockCounts[tile];
+		_frameStatistics.ShadedPixelCount += shadedPixelCounts[tile];
+		_bins[tile].clear();
+	}
+	_triangles.clear();
+	_draws.clear();
+	_isClearPending = false;
+
+	_frameStatistics.RasterisationTime = chrono::duration<double, milli>(chrono::high_resolution_clock::now() - startTime).count();
+	_statistics = _frameStatistics;
+	_frameStatistics = SoftwareRasteriserStatistics();
+}
+
+void SoftwareRasteriser::DrawTile(UINT tile, size_t& depthCulledBlockCount, size_t& shadedPixelCount)
+{
+	if (_isClearPending)
+	{
+		size_t firstPixel = static_cast<size_t>(tile) * SoftwareTileSize * SoftwareTileSize;
+		fill_n(_tileColours.begin() + firstPixel, SoftwareTileSize * SoftwareTileSize, _clearColour);
+		fill_n(_tileDepths.begin() + firstPixel, SoftwareTileSize * SoftwareTileSize, _clearDepth);
+		fill_n(_blockMaxDepths.begin() + static_cast<size_t>(tile) * SoftwareBlocksPerTile * SoftwareBlocksPerTile, SoftwareBlocksPerTile * SoftwareBlocksPerTile, _clearDepth);
+	}
+	for (UINT triangleIndex : _bins[tile])
+	{
+		DrawTriangle(tile, _triangles[triangleIndex], depthCulledBlockCount, shadedPixelCount);
+	}
+	CopyTile(tile);
+}
+
+void SoftwareRasteriser::DrawTriangle(UINT tile, const Triangle& triangle, size_t& depthCulledBlockCount, size_t& shadedPixelCount)
+{
+	const SoftwareDrawState& draw = _draws[triangle.DrawIndex];
+	int tileX = (tile % _tileColumns) * SoftwareTileSize;
+	int tileY = (tile / _tileColumns) * SoftwareTileSize;
+	int minX = max(triangle.MinX, tileX);
+	int minY = max(triangle.MinY, tileY);
+	int maxX = min(triangle.MaxX, tileX + SoftwareTileSize - 1);
+	int maxY = min(triangle.MaxY, tileY + SoftwareTileSize - 1);
+	if (minX > maxX || minY > maxY)
+	{
+		return;
+	}
+
+	// Only depth tests that pass for nearer pixels can skip a block that is entirely in front of the triangle
+	bool isHierarchicalDepthTested = draw.IsDepthEnabled && (draw.DepthFunc == D3D11_COMPARISON_LESS || draw.DepthFunc == D3D11_COMPARISON_LESS_EQUAL);
+	bool hasTexture = (draw.Permutation & ShaderHasTexture) != 0 && draw.Texture != nullptr && !draw.Texture->empty();
+	const SoftwareTextureLevel* textureLevel = hasTexture ? &(*draw.Texture)[triangle.TextureLevel] : nullptr;
+	const MaterialConstants& material = draw.Material;
+	Float8 lightVector[3] = { -material.DirectionalLightVector.x, -material.DirectionalLightVector.y, -material.DirectionalLightVector.z };
+
+	UINT* tileColours = &_tileColours[static_cast<size_t>(tile) * SoftwareTileSize * SoftwareTileSize];
+	float* tileDepths = &_tileDepths[static_cast<size_t>(tile) * SoftwareTileSize * SoftwareTileSize];
+	float* blockMaxDepths = &_blockMaxDepths[static_cast<size_t>(tile) * SoftwareBlocksPerTile * SoftwareBlocksPerTile];
+	Float8 ramp = Float8::Ramp();
+
+	for (int blockRow = (minY - tileY) / SoftwareBlockSize; blockRow <= (maxY - tileY) / SoftwareBlockSize; blockRow++)
+	{
+		for (int blockColumn = (minX - tileX) / SoftwareBlockSize; blockColumn <= (maxX - tileX) / SoftwareBlockSize; blockColumn++)
+		{
+			float& blockMaxDepth = blockMaxDepths[blockRow * SoftwareBlocksPerTile + blockColumn];
+			if (isHierarchicalDepthTested && (triangle.MinDepth > blockMaxDepth || (triangle.MinDepth == blockMaxDepth && draw.DepthFunc == D3D11_COMPARISON_LESS)))
+			{
+				depthCulledBlockCount++;
+				continue;
+			}
+
+			int blockX = tileX + blockColumn * SoftwareBlockSize;
+			int blockY = tileY + blockRow * SoftwareBlockSize;
+			bool isOutside = false;
+			for (const Plane& edge : triangle.Edges)
+			{
+				float x = blockX + (edge.X >= 0.0f ? SoftwareBlockSize - 0.5f : 0.5f);
+				float y = blockY + (edge.Y >= 0.0f ? SoftwareBlockSize - 0.5f : 0.5f);
+				if (edge.X * x + edge.Y * y + edge.Z < 0.0f)
+				{
+					isOutside = true;
+					break;
+				}
+			}
+			if (isOutside)
+			{
+				continue;
+			}
+
+			Float8 pixelX = Float8(blockX + 0.5f) + ramp;
+			Float8 columnMask = (pixelX >= Float8(minX + 0.5f)) & (pixelX <= Float8(maxX + 0.5f));
+			bool isBlockWritten = false;
+			for (int y = max(minY, blockY); y <= min(maxY, blockY + SoftwareBlockSize - 1); y++)
+			{
+				float pixelY = y + 0.5f;
+				Float8 coverage = columnMask;
+				for (UINT edge = 0; edge < 3; edge++)
+				{
+					const Plane& edgeFunction = triangle.Edges[edge];
+					Float8 value = Float8(edgeFunction.X) * pixelX + Float8(edgeFunction.Y * pixelY + edgeFunction.Z);
+					coverage = coverage & (triangle.IsTopLeft[edge] ? value >= Float8(0.0f) : value > Float8(0.0f));
+				}
+				if (MoveMask(coverage) == 0)
+				{
+					continue;
+				}
+
+				size_t pixel = static_cast<size_t>(y - tileY) * SoftwareTileSize + (blockX - tileX);
+				Float8 depth = Float8(triangle.Depth.X) * pixelX + Float8(triangle.Depth.Y * pixelY + triangle.Depth.Z);
+				Float8 storedDepth = Float8::Load(tileDepths + pixel);
+				if (draw.IsDepthEnabled)
+				{
+					coverage = coverage & DepthTest(draw.DepthFunc, depth, storedDepth);
+				}
+				int laneMask = MoveMask(coverage);
+				if (laneMask == 0)
+				{
+					continue;
+				}
+				if (draw.IsDepthEnabled && draw.IsDepthWritten)
+				{
+					Select(coverage, depth, storedDepth).Store(tileDepths + pixel);
+					isBlockWritten = true;
+				}
+
+				// Interpolate the attributes with perspective correction
+				Float8 w = Float8(1.0f) / (Float8(triangle.InverseW.X) * pixelX + Float8(triangle.InverseW.Y * pixelY + triangle.InverseW.Z));
+				Float8 attributes[SoftwareAttributeCount];
+				for (UINT attribute = 0; attribute < SoftwareAttributeCount; attribute++)
+				{
+					const Plane& plane = triangle.Attributes[attribute];
+					attributes[attribute] = (Float8(plane.X) * pixelX + Float8(plane.Y * pixelY + plane.Z)) * w;
+				}
+				const Float8* normal = &attributes[SoftwareNormalAttribute];
+				const Float8* worldPosition = &attributes[SoftwareWorldPositionAttribute];
+				const Float8* vertexColour = &attributes[SoftwareColourAttribute];
+
+				// The pixel shader of shader.hlsl. The diffuse light
+				Float8 diffuseBrightness = Saturate(normal[0] * lightVector[0] + normal[1] * lightVector[1] + normal[2] * lightVector[2]);
+				Float8 colour[4];
+				for (UINT channel = 0; channel < 4; channel++)
+				{
+					colour[channel] = Saturate(vertexColour[channel] + diffuseBrightness * Float8((&material.DirectionalLightColour.x)[channel]));
+				}
+
+				if (draw.Permutation & ShaderPointLight)
+				{
+					// The point light. The distance is taken from the normalised vector, as it is in the shader
+					Float8 pointVector[3] = { Float8(material.PointLightPosition.x) - worldPosition[0], Float8(material.PointLightPosition.y) - worldPosition[1], Float8(material.PointLightPosition.z) - worldPosition[2] };
+					Float8 inverseLength = Float8(1.0f) / Sqrt(pointVector[0] * pointVector[0] + pointVector[1] * pointVector[1] + pointVector[2] * pointVector[2]);
+					for (Float8& component : pointVector)
+					{
+						component = component * inverseLength;
+					}
+					Float8 pointDistance = Sqrt(pointVector[0] * pointVector[0] + pointVector[1] * pointVector[1] + pointVector[2] * pointVector[2]);
+					Float8 pointBrightness = Saturate(normal[0] * pointVector[0] + normal[1] * pointVector[1] + normal[2] * pointVector[2]);
+					Float8 pointAttenuation = Saturate(Float8(1.0f) - pointDistance / Float8(material.PointLightRange));
+					for (UINT channel = 0; channel < 4; channel++)
+					{
+						colour[channel] = colour[channel] + Saturate(pointBrightness * Float8((&material.PointLightColour.x)[channel])) * pointAttenuation;
+					}
+				}
+
+				if (draw.Permutation & ShaderSpecular)
+				{
+					// The specular light, reflecting the light vector about the normal
+					Float8 viewVector[3] = { Float8(draw.EyePosition.x) - worldPosition[0], Float8(draw.EyePosition.y) - worldPosition[1], Float8(draw.EyePosition.z) - worldPosition[2] };
+					Float8 inverseLength = Float8(1.0f) / Sqrt(viewVector[0] * viewVector[0] + viewVector[1] * viewVector[1] + viewVector[2] * viewVector[2]);
+					Float8 normalDotLight = normal[0] * lightVector[0] + normal[1] * lightVector[1] + normal[2] * lightVector[2];
+					Float8 reflection[3];
+					for (UINT component = 0; component < 3; component++)
+					{
+						reflection[component] = lightVector[component] - Float8(2.0f) * normalDotLight * normal[component];
+					}
+					Float8 inverseReflectionLength = Float8(1.0f) / Sqrt(reflection[0] * reflection[0] + reflection[1] * reflection[1] + reflection[2] * reflection[2]);
+					Float8 specularAngle = Saturate((viewVector[0] * reflection[0] + viewVector[1] * reflection[1] + viewVector[2] * reflection[2]) * inverseLength * inverseReflectionLength);
+
+					// There is no vector power, so it is raised one pixel at a time
+					float specularBrightness[8];
+					specularAngle.Store(specularBrightness);
+					for (UINT lane = 0; lane < 8; lane++)
+					{
+						specularBrightness[lane] = (laneMask & (1 << lane)) ? powf(specularBrightness[lane], material.SpecularPower) : 0.0f;
+					}
+					Float8 brightness = Float8::Load(specularBrightness);
+					for (UINT channel = 0; channel < 4; channel++)
+					{
+						colour[channel] = colour[channel] + brightness * Float8((&material.SpecularColour.x)[channel]);
+					}
+				}
+
+				float finalColour[4][8];
+				for (UINT channel = 0; channel < 4; channel++)
+				{
+					Saturate(colour[channel]).Store(finalColour[channel]);
+				}
+				float texCoords[2][8];
+				if (hasTexture)
+				{
+					attributes[SoftwareTexCoordAttribute].Store(texCoords[0]);
+					attributes[SoftwareTexCoordAttribute + 1].Store(texCoords[1]);
+				}
+				for (UINT lane = 0; lane < 8; lane++)
+				{
+					if ((laneMask & (1 << lane)) == 0)
+					{
+						continue;
+					}
+					if (hasTexture)
+					{
+						float texel[4];
+						SampleTexture(*textureLevel, texCoords[0][lane], texCoords[1][lane], draw.IsPointSampled, draw.IsTextureWrapped, texel);
+						for (UINT channel = 0; channel < 4; channel++)
+						{
+							finalColour[channel][lane] *= texel[channel];
+						}
+					}
+					tileColours[pixel + lane] = PackColour(finalColour[0][lane], finalColour[1][lane], finalColour[2][lane], finalColour[3][lane]);
+					shadedPixelCount++;
+				}
+			}
+
+			// Keep the farthest depth of the block up to date, so that later triangles can be skipped
+			if (isBlockWritten)
+			{
+				const float* blockDepths = tileDepths + static_cast<size_t>(blockRow) * SoftwareBlockSize * SoftwareTileSize + blockColumn * SoftwareBlockSize;
+				Float8 maxDepth = Float8::Load(blockDepths);
+				for (UINT row = 1; row < SoftwareBlockSize; row++)
+				{
+					maxDepth = Max(maxDepth, Float8::Load(blockDepths + row * SoftwareTileSize));
+				}
+				float depths[8];
+				maxDepth.Store(depths);
+				blockMaxDepth = *max_element(depths, depths + 8);
+			}
+		}
+	}
+}
+
+void SoftwareRasteriser::CopyTile(UINT tile)
+{
+	UINT tileX = (tile % _tileColumns) * SoftwareTileSize;
+	UINT tileY = (tile / _tileColumns) * SoftwareTileSize;
+	UINT width = min(static_cast<UINT>(SoftwareTileSize), _width - tileX);
+	UINT height = min(static_cast<UINT>(SoftwareTileSize), _height - tileY);
+	const UINT* tileColours = &_tileColours[static_cast<size_t>(tile) * SoftwareTileSize * SoftwareTileSize];
+	for (UINT row = 0; row < height; row++)
+	{
+		memcpy(&_colourBuffer[static_cast<size_t>(tileY + row) * _width + tileX], tileColours + row * SoftwareTileSize, width * sizeof(UINT));
+	}
+}
+
+bool SoftwareRasteriser::SaveBitmap(const wstring& fileName) const
+{
+	// A negative height stores the rows top first, the order of the render target
+	BITMAPINFOHEADER infoHeader = { 0 };
+	infoHeader.biSize = sizeof(infoHeader);
+	infoHeader.biWidth = static_cast<LONG>(_width);
+	infoHeader.biHeight = -static_cast<LONG>(_height);
+	infoHeader.biPlanes = 1;
+	infoHeader.biBitCount = 32;
+	infoHeader.biCompression = BI_RGB;
+	infoHeader.biSizeImage = _width * _height * sizeof(UINT);
+
+	BITMAPFILEHEADER fileHeader = { 0 };
+	fileHeader.bfType = 0x4D42;
+	fileHeader.bfOffBits = sizeof(fileHeader) + sizeof(infoHeader);
+	fileHeader.bfSize = fileHeader.bfOffBits + infoHeader.biSizeImage;
+
+	ofstream file(fileName, ios::binary | ios::trunc);
+	file.write(reinterpret_cast<const char*>(&fileHeader), sizeof(fileHeader));
+	file.write(reinterpret_cast<const char*>(&infoHeader), sizeof(infoHeader));
+	file.write(reinterpret_cast<const char*>(_colourBuffer.data()), infoHeader.biSizeImage);
+	return file.good();
+}
+
+wstring BenchmarkSoftwareRasteriser()
+{
+	const UINT width = 1280;
+	const UINT height = 720;
+	const float clearColour[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+	SoftwareRasteriser rasteriser;
+	rasteriser.Resize(width, height);
+
+	// Every draw is lit by its vertex colours alone, and nothing is culled by its winding
+	SoftwareDrawState drawState;
+	drawState.Material.DirectionalLightVector = Vector4(0.0f, 0.0f, 1.0f, 0.0f);
+	drawState.CullMode = D3D11_CULL_NONE;
+
+	// The thread counts double up to the concurrency of the hardware. The calling thread takes part,
+	// so each pool has one thread fewer. There is always at least one pool, so that its overhead shows
+	unsigned int hardwareConcurrency = max(1u, thread::hardware_concurrency());
+	vector<unsigned int> threadCounts = { 1 };
+	for (unsigned int threadCount = 2; threadCount < max(2u, hardwareConcurrency); threadCount *= 2)
+	{
+		threadCounts.push_back(threadCount);
+	}
+	threadCounts.push_back(max(2u, hardwareConcurrency));
+
+	wstring report = L"Software rasteriser, " + to_wstring(width) + L"x" + to_wstring(height) + L"\n";
+	for (size_t triangleCount : { 1000, 10000, 100000 })
+	{
+		// Small right-angled triangles scattered over the screen at random depths, sized so that each
+		// pixel is covered four times on average whatever their number. They are drawn after a quad
+		// over the left half of the screen that is in front of all of them, so that the blocks there
+		// are culled by their depth
+		mt19937 random(1);
+		uniform_real_distribution<float> positions(-1.0f, 1.0f);
+		uniform_real_distribution<float> depths(0.1f, 1.0f);
+		uniform_real_distribution<float> colours(0.0f, 1.0f);
+		float side = sqrtf(4.0f * 4.0f * 2.0f / triangleCount);
+		vector<SoftwareVertex> vertices;
+		vertices.reserve(triangleCount * 3 + 6);
+		auto addVertex = [&vertices](float x, float y, float z, const Vector4& colour)
+		{
+			SoftwareVertex vertex = {};
+			vertex.Position = Vector4(x, y, z, 1.0f);
+			vertex.Attributes[SoftwareNormalAttribute + 2] = -1.0f;
+			vertex.Attributes[SoftwareColourAttribute] = colour.x;
+			vertex.Attributes[SoftwareColourAttribute + 1] = colour.y;
+			vertex.Attributes[SoftwareColourAttribute + 2] = colour.z;
+			vertex.Attributes[SoftwareColourAttribute + 3] = colour.w;
+			vertices.push_back(vertex);
+		};
+		const Vector4 grey(0.5f, 0.5f, 0.5f, 1.0f);
+		addVertex(-1.0f, 1.0f, 0.05f, grey);
+		addVertex(0.0f, 1.0f, 0.05f, grey);
+		addVertex(-1.0f, -1.0f, 0.05f, grey);
+		addVertex(0.0f, 1.0f, 0.05f, grey);
+		addVertex(0.0f, -1.0f, 0.05f, grey);
+		addVertex(-1.0f, -1.0f, 0.05f, grey);
+		for (size_t i = 0; i < triangleCount; i++)
+		{
+			float x = positions(random);
+			float y = positions(random);
+			float z = depths(random);
+			Vector4 colour(colours(random), colours(random), colours(random), 1.0f);
+			addVertex(x, y, z, colour);
+			addVertex(x + side, y, z, colour);
+			addVertex(x, y - side, z, colour);
+		}
+
+		report += to_wstring(triangleCount) + L" triangles and an occluding quad\n";
+		vector<UINT> singleThreadedImage;
+		double singleThreadedTime = 0.0;
+		for (unsigned int threadCount : threadCounts)
+		{
+			unique_ptr<ThreadPool> threadPool = threadCount > 1 ? make_unique<ThreadPool>(threadCount - 1) : nullptr;
+			double bestSetupTime = DBL_MAX;
+			double bestRasterisationTime = DBL_MAX;
+			for (UINT run = 0; run < 3; run++)
+			{
+				rasteriser.Clear(clearColour, 1.0f);
+				auto startTime = chrono::high_resolution_clock::now();
+				UINT drawIndex = rasteriser.AddDraw(drawState);
+				for (size_t vertex = 0; vertex < vertices.size(); vertex += 3)
+				{
+					rasteriser.AddTriangle(drawIndex, vertices[vertex], vertices[vertex + 1], vertices[vertex + 2]);
+				}
+				bestSetupTime = min(bestSetupTime, chrono::duration<double, milli>(chrono::high_resolution_clock::now() - startTime).count());
+				rasteriser.Resolve(threadPool.get());
+				bestRasterisationTime = min(bestRasterisationTime, rasteriser.GetStatistics().RasterisationTime);
+			}
+
+			// The image must not depend on the number of threads
+			const SoftwareRasteriserStatistics& statistics = rasteriser.GetStatistics();
+			report += threadCount > 1 ? to_wstring(threadCount) + L" threads: " : wstring(L"No thread pool: ");
+			report += L"setup " + to_wstring(bestSetupTime) + L" ms, rasterisation " + to_wstring(bestRasterisationTime) + L" ms, " +
+				to_wstring(statistics.ShadedPixelCount) + L" pixels shaded, " + to_wstring(statistics.DepthCulledBlockCount) + L" blocks culled by depth";
+			if (threadCount == 1)
+			{
+				singleThreadedTime = bestRasterisationTime;
+				singleThreadedImage.assign(rasteriser.GetColourBuffer(), rasteriser.GetColourBuffer() + width * height);
+			}
+			else
+			{
+				bool isSameImage = equal(singleThreadedImage.begin(), singleThreadedImage.end(), rasteriser.GetColourBuffer());
+				report += L", " + to_wstring(singleThreadedTime / bestRasterisationTime) + L" times as fast as no thread pool, " +
+					(isSameImage ? L"same image" : L"DIFFERENT IMAGE");
+			}
+			report += L"\n";
+		}
+	}
+	return report;
+}
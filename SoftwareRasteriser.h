@@ -0,0 +1,175 @@
+#pragma once
+#include <vector>
+#include "core.h"
+#include "DirectXCore.h"
+#include "ConstantBuffer.h"
+#include "ThreadPool.h"
+
+using namespace std;
+
+// The render target is split into square tiles, each of which is rasterised by a single
+// worker, and every tile is split into blocks whose farthest depth is kept for the
+// hierarchical depth test. A block row is eight pixels, the width of a Float8
+#define SoftwareTileSize		64
+#define SoftwareBlockSize		8
+#define SoftwareBlocksPerTile	(SoftwareTileSize / SoftwareBlockSize)
+
+// The values the vertex shader passes to the pixel shader, in the order of VertexOut in shader.hlsl
+#define SoftwareNormalAttribute			0
+#define SoftwareWorldPositionAttribute	3
+#define SoftwareColourAttribute			6
+#define SoftwareTexCoordAttribute		10
+#define SoftwareAttributeCount			12
+
+struct SoftwareVertex
+{
+	Vector4		Position;
+	float		Attributes[SoftwareAttributeCount];
+};
+
+// One level of a texture. Texels are stored as RGBA with red in the lowest byte
+struct SoftwareTextureLevel
+{
+	UINT			Width{ 0 };
+	UINT			Height{ 0 };
+	vector<UINT>	Texels;
+};
+
+// Everything the pixel shader and the output stage need for a draw. The constants are
+// copied when the draw is made, so the buffers they came from can be changed afterwards.
+// The texture must stay alive until the frame has been resolved.
+
+struct SoftwareDrawState
+{
+	MaterialConstants						Material;
+	Vector3									EyePosition;
+	// The shader permutation (see ShaderPermutations.h) the draw is shaded with
+	UINT									Permutation{ 0 };
+	const vector<SoftwareTextureLevel>*		Texture{ nullptr };
+	bool									IsPointSampled{ false };
+	bool									IsTextureWrapped{ false };
+	D3D11_CULL_MODE							CullMode{ D3D11_CULL_BACK };
+	bool									IsFrontCounterClockwise{ false };
+	bool									IsDepthEnabled{ true };
+	bool									IsDepthWritten{ true };
+	D3D11_COMPARISON_FUNC					DepthFunc{ D3D11_COMPARISON_LESS };
+};
+
+struct SoftwareRasteriserStatistics
+{
+	size_t		DrawCount{ 0 };
+	size_t		TriangleCount{ 0 };
+	// Triangles left after clipping and culling
+	size_t		SetupTriangleCount{ 0 };
+	size_t		BinnedTriangleCount{ 0 };
+	// Blocks skipped because the triangle was behind everything already drawn in them
+	size_t		DepthCulledBlockCount{ 0 };
+	size_t		ShadedPixelCount{ 0 };
+	double		GeometryTime{ 0 };
+	double		RasterisationTime{ 0 };
+};
+
+// A tile-based rasteriser that reproduces the lighting shader (shader.hlsl) on the CPU.
+//
+// Triangles are clipped and set up as they are added and binned into every tile they
+// overlap. Nothing is drawn until the frame is resolved, when each tile draws the
+// triangles in its bin in the order they were added, on a worker of the thread pool.
+// No two workers ever touch the same pixels, so the tiles need no locking. Coverage,
+// depth and shading are calculated for eight pixels at a time, and blocks that a
+// triangle is entirely behind are skipped without being looked at.
+//
+// Blending is not emulated: every draw writes its colour as it is.
+
+class SoftwareRasteriser
+{
+public:
+	SoftwareRasteriser() {};
+	~SoftwareRasteriser() {};
+
+	// Resizing discards the contents of the render target
+	void Resize(UINT width, UINT height);
+	// The target is cleared by the tiles when the frame is resolved
+	void Clear(const float colour[4], float depth);
+
+	// Returns the index to add the triangles of the draw with
+	UINT AddDraw(const SoftwareDrawState& drawState);
+	void AddTriangle(UINT drawIndex, const SoftwareVertex& vertex0, const SoftwareVertex& vertex1, const SoftwareVertex& vertex2);
+	// The time spent shading the vertices of the frame is measured by whoever shades them
+	void AddGeometryTime(double milliseconds) { _frameStatistics.GeometryTime += milliseconds; }
+
+	// Draw everything that has been added since the last resolve. The tiles are drawn in
+	// parallel if there is a thread pool
+	void Resolve(ThreadPool* threadPool);
+
+	UINT GetWidth() const { return _width; }
+	UINT GetHeight() const { return _height; }
+	// The render target as 32 bit BGRA pixels, top row first, ready to be shown or saved as a bitmap
+	const UINT* GetColourBuffer() const { return _colourBuffer.data(); }
+	// Save the render target as a 32 bit bitmap
+	bool SaveBitmap(const wstring& fileName) const;
+
+	// The statistics of the last frame that was resolved
+	const SoftwareRasteriserStatistics& GetStatistics() const { return _statistics; }
+
+private:
+	// A value that varies linearly over the screen, Value = X * x + Y * y + Z
+	struct Plane
+	{
+		float	X;
+		float	Y;
+		float	Z;
+	};
+
+	// A triangle set up for rasterisation. Each edge function is positive inside the triangle.
+	// Attributes are divided by w so that they can be interpolated linearly over the screen
+	struct Triangle
+	{
+		Plane		Edges[3];
+		bool		IsTopLeft[3];
+		Plane		Depth;
+		Plane		InverseW;
+		Plane		Attributes[SoftwareAttributeCount];
+		float		MinDepth;
+		float		MaxDepth;
+		int			MinX;
+		int			MinY;
+		int			MaxX;
+		int			MaxY;
+		// The texture level chosen for the whole triangle from its texel density
+		UINT		TextureLevel;
+		UINT		DrawIndex;
+	};
+
+	UINT							_width{ 0 };
+	UINT							_height{ 0 };
+	UINT							_tileColumns{ 0 };
+	UINT							_tileRows{ 0 };
+	// Each tile is stored as a contiguous block of pixels, so a worker only touches memory of its own
+	vector<UINT>					_tileColours;
+	vector<float>					_tileDepths;
+	// The farthest depth in every block
+	vector<float>					_blockMaxDepths;
+	// The render target in scan line order, filled in when the frame is resolved
+	vector<UINT>					_colourBuffer;
+
+	vector<SoftwareDrawState>		_draws;
+	vector<Triangle>				_triangles;
+	vector<vector<UINT>>			_bins;
+	bool							_isClearPending{ false };
+	UINT							_clearColour{ 0 };
+	float							_clearDepth{ 1.0f };
+	SoftwareRasteriserStatistics	_statistics;
+	SoftwareRasteriserStatistics	_frameStatistics;
+
+	void ClipAndSetup(UINT drawIndex, const SoftwareVertex* vertices, UINT vertexCount);
+	void SetupTriangle(UINT drawIndex, const SoftwareVertex& vertex0, const SoftwareVertex& vertex1, const SoftwareVertex& vertex2);
+	void Bin(const Triangle& triangle, UINT triangleIndex);
+
+	void DrawTile(UINT tile, size_t& depthCulledBlockCount, size_t& shadedPixelCount);
+	void DrawTriangle(UINT tile, const Triangle& triangle, size_t& depthCulledBlockCount, size_t& shadedPixelCount);
+	void CopyTile(UINT tile);
+};
+
+// Time adding and resolving frames of several numbers of triangles, without a thread pool
+// and with pools of several sizes, and return a report of the times and statistics
+wstring BenchmarkSoftwareRasteriser();
@@ -0,0 +1,546 @@
+#include <chrono>
+#include <wincodec.h>
+#include "SoftwareRenderDevice.h"
+#include "ConstantBuffer.h"
+#include "ShaderPermutations.h"
+
+HRESULT STDMETHODCALLTYPE SoftwareDeviceObject::QueryInterface(REFIID, void** object)
+{
+	// Software objects do not implement any Direct3D interface
+	*object = nullptr;
+	return E_NOINTERFACE;
+}
+
+ULONG STDMETHODCALLTYPE SoftwareDeviceObject::AddRef()
+{
+	return ++_referenceCount;
+}
+
+ULONG STDMETHODCALLTYPE SoftwareDeviceObject::Release()
+{
+	ULONG referenceCount = --_referenceCount;
+	if (referenceCount == 0)
+	{
+		delete this;
+	}
+	return referenceCount;
+}
+
+SoftwareBuffer::SoftwareBuffer(const D3D11_BUFFER_DESC& bufferDesc, const void* initialData) : _byteWidth(bufferDesc.ByteWidth), _data(bufferDesc.ByteWidth)
+{
+	if (initialData != nullptr)
+	{
+		memcpy(_data.data(), initialData, _byteWidth);
+	}
+}
+
+// The size of the vertex formats the software device can decode
+static UINT GetFormatSize(DXGI_FORMAT format)
+{
+	switch (format)
+	{
+	case DXGI_FORMAT_R32G32B32A32_FLOAT:
+		return 16;
+	case DXGI_FORMAT_R32G32B32_FLOAT:
+		return 12;
+	case DXGI_FORMAT_R32G32_FLOAT:
+	case DXGI_FORMAT_R16G16B16A16_SNORM:
+	case DXGI_FORMAT_R16G16B16A16_FLOAT:
+		return 8;
+	case DXGI_FORMAT_R32_FLOAT:
+	case DXGI_FORMAT_R8G8B8A8_UNORM:
+	case DXGI_FORMAT_R16G16_SNORM:
+	case DXGI_FORMAT_R16G16_FLOAT:
+		return 4;
+	default:
+		return 0;
+	}
+}
+
+SoftwareInputLayout::SoftwareInputLayout(const D3D11_INPUT_ELEMENT_DESC* elements, UINT elementCount)
+{
+	UINT nextOffsets[D3D11_IA_VERTEX_INPUT_RESOURCE_SLOT_COUNT] = { 0 };
+	for (UINT i = 0; i < elementCount; i++)
+	{
+		const D3D11_INPUT_ELEMENT_DESC& element = elements[i];
+		UINT offset = element.AlignedByteOffset == D3D11_APPEND_ALIGNED_ELEMENT ? nextOffsets[element.InputSlot] : element.AlignedByteOffset;
+		nextOffsets[element.InputSlot] = offset + GetFormatSize(element.Format);
+
+		string semanticName = element.SemanticName;
+		SoftwareSemantic semantic = SoftwareSemantic::Count;
+		if (semanticName == "POSITION")
+		{
+			semantic = SoftwareSemantic::Position;
+		}
+		else if (semanticName == "NORMAL")
+		{
+			semantic = SoftwareSemantic::Normal;
+			_isNormalOctahedral = element.Format == DXGI_FORMAT_R16G16_SNORM || element.Format == DXGI_FORMAT_R16G16_FLOAT || element.Format == DXGI_FORMAT_R32G32_FLOAT;
+		}
+		else if (semanticName == "TEXCOORD")
+		{
+			semantic = SoftwareSemantic::TexCoord;
+			_hasTexCoord = true;
+		}
+		else if (semanticName == "WORLD" && element.SemanticIndex < 4)
+		{
+			semantic = static_cast<SoftwareSemantic>(static_cast<UINT>(SoftwareSemantic::World0) + element.SemanticIndex);
+			_isInstanced = true;
+		}
+		else if (semanticName == "COLOUR")
+		{
+			semantic = SoftwareSemantic::Colour;
+		}
+		if (semantic != SoftwareSemantic::Count && element.InputSlot < 2)
+		{
+			_elements.push_back({ semantic, element.Format, element.InputSlot, offset });
+		}
+	}
+}
+
+Vector4 SoftwareInputLayout::Decode(DXGI_FORMAT format, const BYTE* data)
+{
+	const float* values = reinterpret_cast<const float*>(data);
+	switch (format)
+	{
+	case DXGI_FORMAT_R32G32B32A32_FLOAT:
+		return Vector4(values[0], values[1], values[2], values[3]);
+	case DXGI_FORMAT_R32G32B32_FLOAT:
+		return Vector4(values[0], values[1], values[2], 1.0f);
+	case DXGI_FORMAT_R32G32_FLOAT:
+		return Vector4(values[0], values[1], 0.0f, 1.0f);
+	case DXGI_FORMAT_R32_FLOAT:
+		return Vector4(values[0], 0.0f, 0.0f, 1.0f);
+	case DXGI_FORMAT_R8G8B8A8_UNORM:
+		return Vector4(data[0] / 255.0f, data[1] / 255.0f, data[2] / 255.0f, data[3] / 255.0f);
+	case DXGI_FORMAT_R16G16B16A16_SNORM:
+	{
+		const short* snorms = reinterpret_cast<const short*>(data);
+		return Vector4(DecodeSnorm16(snorms[0]), DecodeSnorm16(snorms[1]), DecodeSnorm16(snorms[2]), DecodeSnorm16(snorms[3]));
+	}
+	case DXGI_FORMAT_R16G16_SNORM:
+	{
+		const short* snorms = reinterpret_cast<const short*>(data);
+		return Vector4(DecodeSnorm16(snorms[0]), DecodeSnorm16(snorms[1]), 0.0f, 1.0f);
+	}
+	case DXGI_FORMAT_R16G16B16A16_FLOAT:
+	{
+		const HALF* halves = reinterpret_cast<const HALF*>(data);
+		return Vector4(XMConvertHalfToFloat(halves[0]), XMConvertHalfToFloat(halves[1]), XMConvertHalfToFloat(halves[2]), XMConvertHalfToFloat(halves[3]));
+	}
+	case DXGI_FORMAT_R16G16_FLOAT:
+	{
+		const HALF* halves = reinterpret_cast<const HALF*>(data);
+		return Vector4(XMConvertHalfToFloat(halves[0]), XMConvertHalfToFloat(halves[1]), 0.0f, 1.0f);
+	}
+	default:
+		return Vector4(0.0f, 0.0f, 0.0f, 1.0f);
+	}
+}
+
+void SoftwareRenderContext::IASetInputLayout(ID3D11InputLayout* inputLayout)
+{
+	_inputLayout = SoftwareDeviceObject::FromInterface<SoftwareInputLayout>(inputLayout);
+}
+
+void SoftwareRenderContext::IASetVertexBuffer(UINT slot, ID3D11Buffer* vertexBuffer, UINT stride, UINT offset)
+{
+	if (slot < _countof(_vertexBuffers))
+	{
+		_vertexBuffers[slot] = { SoftwareDeviceObject::FromInterface<SoftwareBuffer>(vertexBuffer), stride, offset };
+	}
+}
+
+void SoftwareRenderContext::IASetIndexBuffer(ID3D11Buffer* indexBuffer, DXGI_FORMAT format, UINT offset)
+{
+	_indexBuffer = SoftwareDeviceObject::FromInterface<SoftwareBuffer>(indexBuffer);
+	_indexFormat = format;
+	_indexOffset = offset;
+}
+
+void SoftwareRenderContext::VSSetConstantBuffer(UINT slot, ID3D11Buffer* constantBuffer)
+{
+	VSSetConstantBuffer(slot, constantBuffer, 0, 0);
+}
+
+void SoftwareRenderContext::PSSetConstantBuffer(UINT slot, ID3D11Buffer* constantBuffer)
+{
+	if (slot < _countof(_pixelConstantBuffers))
+	{
+		_pixelConstantBuffers[slot] = { SoftwareDeviceObject::FromInterface<SoftwareBuffer>(constantBuffer), 0 };
+	}
+}
+
+void SoftwareRenderContext::VSSetConstantBuffer(UINT slot, ID3D11Buffer* constantBuffer, UINT firstConstant, UINT)
+{
+	// A shader constant is 16 bytes
+	if (slot < _countof(_vertexConstantBuffers))
+	{
+		_vertexConstantBuffers[slot] = { SoftwareDeviceObject::FromInterface<SoftwareBuffer>(constantBuffer), firstConstant * 16 };
+	}
+}
+
+void SoftwareRenderContext::PSSetShaderResource(UINT slot, ID3D11ShaderResourceView* shaderResource)
+{
+	if (slot == 0)
+	{
+		_texture = SoftwareDeviceObject::FromInterface<SoftwareTexture>(shaderResource);
+	}
+}
+
+void SoftwareRenderContext::PSSetSampler(UINT slot, ID3D11SamplerState* sampler)
+{
+	if (slot == 0)
+	{
+		_sampler = SoftwareDeviceObject::FromInterface<SoftwareState<D3D11_SAMPLER_DESC>>(sampler);
+	}
+}
+
+void SoftwareRenderContext::RSSetState(ID3D11RasterizerState* rasteriserState)
+{
+	_rasteriserState = SoftwareDeviceObject::FromInterface<SoftwareState<D3D11_RASTERIZER_DESC>>(rasteriserState);
+}
+
+void SoftwareRenderContext::OMSetDepthStencilState(ID3D11DepthStencilState* depthStencilState)
+{
+	_depthStencilState = SoftwareDeviceObject::FromInterface<SoftwareState<D3D11_DEPTH_STENCIL_DESC>>(depthStencilState);
+}
+
+void SoftwareRenderContext::UpdateBuffer(ID3D11Buffer* buffer, const void* data)
+{
+	SoftwareBuffer* softwareBuffer = SoftwareDeviceObject::FromInterface<SoftwareBuffer>(buffer);
+	memcpy(softwareBuffer->GetData(), data, softwareBuffer->GetByteWidth());
+}
+
+void* SoftwareRenderContext::Map(ID3D11Buffer* buffer, D3D11_MAP)
+{
+	// Draws have finished reading the buffer by the time they return, so it can always be written in place
+	return SoftwareDeviceObject::FromInterface<SoftwareBuffer>(buffer)->GetData();
+}
+
+void SoftwareRenderContext::DrawIndexed(UINT indexCount, UINT startIndex, INT baseVertex)
+{
+	Draw(indexCount, 1, startIndex, baseVertex, 0);
+}
+
+void SoftwareRenderContext::DrawIndexedInstanced(UINT indexCount, UINT instanceCount, UINT startIndex, INT baseVertex, UINT startInstance)
+{
+	Draw(indexCount, instanceCount, startIndex, baseVertex, startInstance);
+}
+
+bool SoftwareRenderContext::GetDrawState(SoftwareDrawState& drawState) const
+{
+	const MaterialConstants* material = GetConstants<MaterialConstants>(_pixelConstantBuffers[MaterialConstantBufferSlot]);
+	const FrameConstants* frame = GetConstants<FrameConstants>(_pixelConstantBuffers[FrameConstantBufferSlot]);
+	if (material == nullptr || frame == nullptr)
+	{
+		return false;
+	}
+	drawState.Material = *material;
+	drawState.EyePosition = frame->EyePosition;
+	bool hasTexture = _inputLayout->HasTexCoord() && _texture != nullptr;
+	drawState.Permutation = SelectShaderPermutation(hasTexture, material->PointLightColour, material->PointLightRange, material->SpecularColour, material->SpecularPower);
+	drawState.Texture = hasTexture ? &_texture->GetLevels() : nullptr;
+
+	// Without a state object the defaults of Direct3D apply
+	if (_sampler != nullptr)
+	{
+		drawState.IsPointSampled = _sampler->GetDesc().Filter == D3D11_FILTER_MIN_MAG_MIP_POINT;
+		drawState.IsTextureWrapped = _sampler->GetDesc().AddressU == D3D11_TEXTURE_ADDRESS_WRAP;
+	}
+	if (_rasteriserState != nullptr)
+	{
+		drawState.CullMode = _rasteriserState->GetDesc().CullMode;
+		drawState.IsFrontCounterClockwise = _rasteriserState->GetDesc().FrontCounterClockwise != FALSE;
+	}
+	if (_depthStencilState != nullptr)
+	{
+		drawState.IsDepthEnabled = _depthStencilState->GetDesc().DepthEnable != FALSE;
+		drawState.IsDepthWritten = _depthStencilState->GetDesc().DepthWriteMask == D3D11_DEPTH_WRITE_MASK_ALL;
+		drawState.DepthFunc = _depthStencilState->GetDesc().DepthFunc;
+	}
+	return true;
+}
+
+void SoftwareRenderContext::Draw(UINT indexCount, UINT instanceCount, UINT startIndex, INT baseVertex, UINT startInstance)
+{
+	const VertexBufferBinding& vertexBuffer = _vertexBuffers[0];
+	if (_topology != D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST || _inputLayout == nullptr || vertexBuffer.Buffer == nullptr || vertexBuffer.Stride == 0 || _indexBuffer == nullptr)
+	{
+		return;
+	}
+	SoftwareDrawState drawState;
+	if (!GetDrawState(drawState))
+	{
+		return;
+	}
+	const MaterialConstants* material = GetConstants<MaterialConstants>(_vertexConstantBuffers[MaterialConstantBufferSlot]);
+	const FrameConstants* frame = GetConstants<FrameConstants>(_vertexConstantBuffers[FrameConstantBufferSlot]);
+	const ObjectConstants* object = GetConstants<ObjectConstants>(_vertexConstantBuffers[ObjectConstantBufferSlot]);
+	bool isInstanced = _inputLayout->IsInstanced();
+	if ((isInstanced && (frame == nullptr || _vertexBuffers[1].Buffer == nullptr)) || (!isInstanced && (object == nullptr || material == nullptr)))
+	{
+		return;
+	}
+	auto startTime = chrono::high_resolution_clock::now();
+
+	UINT drawIndex = _rasteriser.AddDraw(drawState);
+	UINT vertexCount = vertexBuffer.Buffer->GetByteWidth() > vertexBuffer.Offset ? (vertexBuffer.Buffer->GetByteWidth() - vertexBuffer.Offset) / vertexBuffer.Stride : 0;
+	if (_shadedVertices.size() < vertexCount)
+	{
+		_shadedVertices.resize(vertexCount);
+		_shadedVertexStamps.resize(vertexCount, _shadedVertexStamp);
+	}
+	UINT indexSize = _indexFormat == DXGI_FORMAT_R16_UINT ? 2 : 4;
+	UINT maxIndexCount = _indexBuffer->GetByteWidth() > _indexOffset ? (_indexBuffer->GetByteWidth() - _indexOffset) / indexSize : 0;
+	indexCount = startIndex < maxIndexCount ? min(indexCount, maxIndexCount - startIndex) : 0;
+	const BYTE* indices = _indexBuffer->GetData() + _indexOffset + static_cast<size_t>(startIndex) * indexSize;
+
+	for (UINT instance = 0; instance < instanceCount; instance++)
+	{
+		// The vertex shaders of shader.hlsl. Instances supply their own world transformation and colour
+		Matrix world;
+		Matrix worldViewProjection;
+		Vector4 colour;
+		if (isInstanced)
+		{
+			const VertexBufferBinding& instanceBuffer = _vertexBuffers[1];
+			size_t instanceOffset = instanceBuffer.Offset + static_cast<size_t>(startInstance + instance) * instanceBuffer.Stride;
+			if (instanceOffset + instanceBuffer.Stride > instanceBuffer.Buffer->GetByteWidth())
+			{
+				break;
+			}
+			Vector4 rows[4];
+			for (const SoftwareInputElement& element : _inputLayout->GetElements())
+			{
+				if (element.Slot != 1)
+				{
+					continue;
+				}
+				Vector4 value = SoftwareInputLayout::Decode(element.Format, instanceBuffer.Buffer->GetData() + instanceOffset + element.Offset);
+				if (element.Semantic == SoftwareSemantic::Colour)
+				{
+					colour = value;
+				}
+				else if (element.Semantic >= SoftwareSemantic::World0 && element.Semantic <= SoftwareSemantic::World3)
+				{
+					rows[static_cast<UINT>(element.Semantic) - static_cast<UINT>(SoftwareSemantic::World0)] = value;
+				}
+			}
+			world = Matrix(rows[0], rows[1], rows[2], rows[3]);
+			worldViewProjection = world * frame->ViewProjection;
+		}
+		else
+		{
+			world = object->WorldTransformation;
+			worldViewProjection = object->WorldViewProjection;
+			colour = material->AmbientLightColour;
+		}
+
+		_shadedVertexStamp++;
+		if (_shadedVertexStamp == 0)
+		{
+			fill(_shadedVertexStamps.begin(), _shadedVertexStamps.end(), 0);
+			_shadedVertexStamp = 1;
+		}
+		auto shadeVertex = [&](UINT index) -> const SoftwareVertex*
+		{
+			INT vertexIndex = static_cast<INT>(_indexFormat == DXGI_FORMAT_R16_UINT ? reinterpret_cast<const UINT16*>(indices)[index] : reinterpret_cast<const UINT*>(indices)[index]) + baseVertex;
+			if (vertexIndex < 0 || static_cast<UINT>(vertexIndex) >= vertexCount)
+			{
+				return nullptr;
+			}
+			SoftwareVertex& vertex = _shadedVertices[vertexIndex];
+			if (_shadedVertexStamps[vertexIndex] == _shadedVertexStamp)
+			{
+				return &vertex;
+			}
+			_shadedVertexStamps[vertexIndex] = _shadedVertexStamp;
+
+			Vector4 position(0.0f, 0.0f, 0.0f, 1.0f);
+			Vector4 normal;
+			Vector4 texCoord;
+			const BYTE* vertexData = vertexBuffer.Buffer->GetData() + vertexBuffer.Offset + static_cast<size_t>(vertexIndex) * vertexBuffer.Stride;
+			for (const SoftwareInputElement& element : _inputLayout->GetElements())
+			{
+				if (element.Slot != 0)
+				{
+					continue;
+				}
+				Vector4 value = SoftwareInputLayout::Decode(element.Format, vertexData + element.Offset);
+				switch (element.Semantic)
+				{
+				case SoftwareSemantic::Position:
+					position = Vector4(value.x, value.y, value.z, 1.0f);
+					break;
+				case SoftwareSemantic::Normal:
+					// The vertex shader reads a normal with two components as octahedral
+					if (_inputLayout->IsNormalOctahedral())
+					{
+						Vector3 decodedNormal = DecodeOctahedral(Vector2(value.x, value.y));
+						normal = Vector4(decodedNormal.x, decodedNormal.y, decodedNormal.z, 0.0f);
+					}
+					else
+					{
+						normal = Vector4(value.x, value.y, value.z, 0.0f);
+					}
+					break;
+				case SoftwareSemantic::TexCoord:
+					texCoord = value;
+					break;
+				default:
+					break;
+				}
+			}
+			vertex.Position = Vector4::Transform(position, worldViewProjection);
+			Vector4 worldPosition = Vector4::Transform(position, world);
+			Vector4 worldNormal = Vector4::Transform(normal, world);
+			worldNormal.Normalize();
+			float* attributes = vertex.Attributes;
+			attributes[SoftwareNormalAttribute] = worldNormal.x;
+			attributes[SoftwareNormalAttribute + 1] = worldNormal.y;
+			attributes[SoftwareNormalAttribute + 2] = worldNormal.z;
+			attributes[SoftwareWorldPositionAttribute] = worldPosition.x;
+			attributes[SoftwareWorldPositionAttribute + 1] = worldPosition.y;
+			attributes[SoftwareWorldPositionAttribute + 2] = worldPosition.z;
+			attributes[SoftwareColourAttribute] = colour.x;
+			attributes[SoftwareColourAttribute + 1] = colour.y;
+			attributes[SoftwareColourAttribute + 2] = colour.z;
+			attributes[SoftwareColourAttribute + 3] = colour.w;
+			attributes[SoftwareTexCoordAttribute] = texCoord.x;
+			attributes[SoftwareTexCoordAttribute + 1] = texCoord.y;
+			return &vertex;
+		};
+
+		for (UINT index = 0; index + 2 < indexCount; index += 3)
+		{
+			const SoftwareVertex* vertex0 = shadeVertex(index);
+			const SoftwareVertex* vertex1 = shadeVertex(index + 1);
+			const SoftwareVertex* vertex2 = shadeVertex(index + 2);
+			if (vertex0 != nullptr && vertex1 != nullptr && vertex2 != nullptr)
+			{
+				_rasteriser.AddTriangle(drawIndex, *vertex0, *vertex1, *vertex2);
+			}
+		}
+	}
+	_rasteriser.AddGeometryTime(chrono::duration<double, milli>(chrono::high_resolution_clock::now() - startTime).count());
+}
+
+SoftwareRenderDevice::SoftwareRenderDevice(UINT width, UINT height) : _immediateContext(_rasteriser)
+{
+	_rasteriser.Resize(width, height);
+}
+
+HRESULT SoftwareRenderDevice::CreateBuffer(const D3D11_BUFFER_DESC* bufferDesc, const D3D11_SUBRESOURCE_DATA* initialData, ID3D11Buffer** buffer)
+{
+	return SoftwareDeviceObject::Return(new SoftwareBuffer(*bufferDesc, initialData != nullptr ? initialData->pSysMem : nullptr), buffer);
+}
+
+HRESULT SoftwareRenderDevice::CreateVertexShader(const void*, SIZE_T, ID3D11VertexShader** vertexShader)
+{
+	return SoftwareDeviceObject::Return(new SoftwareDeviceObject(), vertexShader);
+}
+
+HRESULT SoftwareRenderDevice::CreatePixelShader(const void*, SIZE_T, ID3D11PixelShader** pixelShader)
+{
+	return SoftwareDeviceObject::Return(new SoftwareDeviceObject(), pixelShader);
+}
+
+HRESULT SoftwareRenderDevice::CreateInputLayout(const D3D11_INPUT_ELEMENT_DESC* elements, UINT elementCount, const void*, SIZE_T, ID3D11InputLayout** inputLayout)
+{
+	return SoftwareDeviceObject::Return(new SoftwareInputLayout(elements, elementCount), inputLayout);
+}
+
+HRESULT SoftwareRenderDevice::CreateRasterizerState(const D3D11_RASTERIZER_DESC* rasteriserDesc, ID3D11RasterizerState** rasteriserState)
+{
+	return SoftwareDeviceObject::Return(new SoftwareState<D3D11_RASTERIZER_DESC>(*rasteriserDesc), rasteriserState);
+}
+
+HRESULT SoftwareRenderDevice::CreateBlendState(const D3D11_BLEND_DESC* blendDesc, ID3D11BlendState** blendState)
+{
+	return SoftwareDeviceObject::Return(new SoftwareState<D3D11_BLEND_DESC>(*blendDesc), blendState);
+}
+
+HRESULT SoftwareRenderDevice::CreateDepthStencilState(const D3D11_DEPTH_STENCIL_DESC* depthStencilDesc, ID3D11DepthStencilState** depthStencilState)
+{
+	return SoftwareDeviceObject::Return(new SoftwareState<D3D11_DEPTH_STENCIL_DESC>(*depthStencilDesc), depthStencilState);
+}
+
+HRESULT SoftwareRenderDevice::CreateSamplerState(const D3D11_SAMPLER_DESC* samplerDesc, ID3D11SamplerState** samplerState)
+{
+	return SoftwareDeviceObject::Return(new SoftwareState<D3D11_SAMPLER_DESC>(*samplerDesc), samplerState);
+}
+
+HRESULT SoftwareRenderDevice::CreateTextureFromFile(const wchar_t* fileName, ID3D11ShaderResourceView** texture)
+{
+	// Decode the image into RGBA with WIC
+	ComPtr<IWICImagingFactory> imagingFactory;
+	ComPtr<IWICBitmapDecoder> decoder;
+	ComPtr<IWICBitmapFrameDecode> frame;
+	ComPtr<IWICFormatConverter> converter;
+	HRESULT result = CoCreateInstance(CLSID_WICImagingFactory, nullptr, CLSCTX_INPROC_SERVER, IID_PPV_ARGS(imagingFactory.GetAddressOf()));
+	if (SUCCEEDED(result))
+	{
+		result = imagingFactory->CreateDecoderFromFilename(fileName, nullptr, GENERIC_READ, WICDecodeMetadataCacheOnDemand, decoder.GetAddressOf());
+	}
+	if (SUCCEEDED(result))
+	{
+		result = decoder->GetFrame(0, frame.GetAddressOf());
+	}
+	if (SUCCEEDED(result))
+	{
+		result = imagingFactory->CreateFormatConverter(converter.GetAddressOf());
+	}
+	if (SUCCEEDED(result))
+	{
+		result = converter->Initialize(frame.Get(), GUID_WICPixelFormat32bppRGBA, WICBitmapDitherTypeNone, nullptr, 0.0, WICBitmapPaletteTypeCustom);
+	}
+	vector<SoftwareTextureLevel> levels(1);
+	if (SUCCEEDED(result))
+	{
+		result = converter->GetSize(&levels[0].Width, &levels[0].Height);
+	}
+	if (SUCCEEDED(result))
+	{
+		levels[0].Texels.resize(static_cast<size_t>(levels[0].Width) * levels[0].Height);
+		result = converter->CopyPixels(nullptr, levels[0].Width * sizeof(UINT), static_cast<UINT>(levels[0].Texels.size() * sizeof(UINT)), reinterpret_cast<BYTE*>(levels[0].Texels.data()));
+	}
+	if (FAILED(result))
+	{
+		return result;
+	}
+
+	// Build the mip chain by averaging each square of four texels
+	while (levels.back().Width > 1 || levels.back().Height > 1)
+	{
+		const SoftwareTextureLevel& source = levels.back();
+		SoftwareTextureLevel level;
+		level.Width = max(source.Width / 2, 1u);
+		level.Height = max(source.Height / 2, 1u);
+		level.Texels.resize(static_cast<size_t>(level.Width) * level.Height);
+		for (UINT y = 0; y < level.Height; y++)
+		{
+			UINT top = min(y * 2, source.Height - 1) * source.Width;
+			UINT bottom = min(y * 2 + 1, source.Height - 1) * source.Width;
+			for (UINT x = 0; x < level.Width; x++)
+			{
+				UINT left = min(x * 2, source.Width - 1);
+				UINT right = min(x * 2 + 1, source.Width - 1);
+				UINT texels[4] = { source.Texels[top + left], source.Texels[top + right], source.Texels[bottom + left], source.Texels[bottom + right] };
+				UINT texel = 0;
+				for (UINT shift = 0; shift < 32; shift += 8)
+				{
+					UINT sum = 2;
+					for (UINT sample : texels)
+					{
+						sum += (sample >> shift) & 0xFF;
+					}
+					texel |= (sum / 4) << shift;
+				}
+				level.Texels[y * level.Width + x] = texel;
+			}
+		}
+		levels.push_back(move(level));
+	}
+	return SoftwareDeviceObject::Return(new SoftwareTexture(move(levels)), texture);
+}
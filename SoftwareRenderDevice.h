@@ -0,0 +1,247 @@
+#pragma once
+#include <vector>
+#include <atomic>
+#include "core.h"
+#include "DirectXCore.h"
+#include "RenderDevice.h"
+#include "SoftwareRasteriser.h"
+#include "VertexCompression.h"
+
+using namespace std;
+
+// An object created by the software device. Like the objects of the null device it only
+// implements IUnknown, so that it can be held in a ComPtr, but it keeps whatever the
+// software device needs to draw with it: the contents of buffers, the decoded levels of
+// textures and the descriptions of states.
+
+class SoftwareDeviceObject : public IUnknown
+{
+public:
+	SoftwareDeviceObject() {};
+	virtual ~SoftwareDeviceObject() {};
+
+	HRESULT STDMETHODCALLTYPE QueryInterface(REFIID, void** object) override;
+	ULONG STDMETHODCALLTYPE AddRef() override;
+	ULONG STDMETHODCALLTYPE Release() override;
+
+	// Hand over a new object, with a reference count of one, as the interface the caller asked for
+	template<typename T>
+	static HRESULT Return(SoftwareDeviceObject* object, T** result)
+	{
+		*result = reinterpret_cast<T*>(static_cast<IUnknown*>(object));
+		return S_OK;
+	}
+
+	// Returns nullptr for a null interface
+	template<typename U, typename T>
+	static U* FromInterface(T* object) { return static_cast<U*>(static_cast<SoftwareDeviceObject*>(reinterpret_cast<IUnknown*>(object))); }
+
+private:
+	atomic<ULONG>		_referenceCount{ 1 };
+};
+
+class SoftwareBuffer : public SoftwareDeviceObject
+{
+public:
+	SoftwareBuffer(const D3D11_BUFFER_DESC& bufferDesc, const void* initialData);
+
+	UINT GetByteWidth() const { return _byteWidth; }
+	BYTE* GetData() { return _data.data(); }
+
+private:
+	UINT				_byteWidth;
+	vector<BYTE>		_data;
+};
+
+// The values the vertex shaders read, in the order they are decoded into
+enum class SoftwareSemantic : UINT
+{
+	Position,
+	Normal,
+	TexCoord,
+	World0,
+	World1,
+	World2,
+	World3,
+	Colour,
+	Count
+};
+
+struct SoftwareInputElement
+{
+	SoftwareSemantic	Semantic;
+	DXGI_FORMAT			Format;
+	UINT				Slot;
+	UINT				Offset;
+};
+
+// An input layout with the byte offsets of its elements resolved. Elements the shaders do not read are left out
+class SoftwareInputLayout : public SoftwareDeviceObject
+{
+public:
+	SoftwareInputLayout(const D3D11_INPUT_ELEMENT_DESC* elements, UINT elementCount);
+
+	const vector<SoftwareInputElement>& GetElements() const { return _elements; }
+	bool HasTexCoord() const { return _hasTexCoord; }
+	// Instanced layouts read the world transformation and colour of each instance from slot 1
+	bool IsInstanced() const { return _isInstanced; }
+	// Normals with two components are octahedral (see VertexCompression.h)
+	bool IsNormalOctahedral() const { return _isNormalOctahedral; }
+
+	// Decode an element into a vector, filling the components the format does not have as Direct3D does
+	static Vector4 Decode(DXGI_FORMAT format, const BYTE* data);
+
+private:
+	vector<SoftwareInputElement>	_elements;
+	bool							_hasTexCoord{ false };
+	bool							_isInstanced{ false };
+	bool							_isNormalOctahedral{ false };
+};
+
+class SoftwareTexture : public SoftwareDeviceObject
+{
+public:
+	SoftwareTexture(vector<SoftwareTextureLevel>&& levels) : _levels(move(levels)) {};
+
+	const vector<SoftwareTextureLevel>& GetLevels() const { return _levels; }
+
+private:
+	vector<SoftwareTextureLevel>	_levels;
+};
+
+// A state object, which is only its description
+template<typename TDesc>
+class SoftwareState : public SoftwareDeviceObject
+{
+public:
+	SoftwareState(const TDesc& desc) : _desc(desc) {};
+
+	const TDesc& GetDesc() const { return _desc; }
+
+private:
+	TDesc		_desc;
+};
+
+// A render context that draws with the software rasteriser. Bindings are only remembered
+// until a draw, which shades the vertices it uses as the lighting shader would and passes
+// its triangles to the rasteriser. The shaders that are bound are not looked at: the
+// vertex shader follows from the input layout and the pixel shader permutation from the
+// material, in the same way that the renderer chooses them.
+//
+// Only indexed triangle lists are drawn.
+
+class SoftwareRenderContext : public IRenderContext
+{
+public:
+	SoftwareRenderContext(SoftwareRasteriser& rasteriser) : _rasteriser(rasteriser) {};
+	~SoftwareRenderContext() {};
+
+	void IASetInputLayout(ID3D11InputLayout* inputLayout) override;
+	void IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY topology) override { _topology = topology; }
+	void IASetVertexBuffer(UINT slot, ID3D11Buffer* vertexBuffer, UINT stride, UINT offset) override;
+	void IASetIndexBuffer(ID3D11Buffer* indexBuffer, DXGI_FORMAT format, UINT offset) override;
+	void VSSetShader(ID3D11VertexShader*) override {};
+	void PSSetShader(ID3D11PixelShader*) override {};
+	void VSSetConstantBuffer(UINT slot, ID3D11Buffer* constantBuffer) override;
+	void PSSetConstantBuffer(UINT slot, ID3D11Buffer* constantBuffer) override;
+	void VSSetConstantBuffer(UINT slot, ID3D11Buffer* constantBuffer, UINT firstConstant, UINT constantCount) override;
+	void PSSetShaderResource(UINT slot, ID3D11ShaderResourceView* shaderResource) override;
+	void PSSetSampler(UINT slot, ID3D11SamplerState* sampler) override;
+	void RSSetState(ID3D11RasterizerState* rasteriserState) override;
+	void OMSetBlendState(ID3D11BlendState*) override {};
+	void OMSetDepthStencilState(ID3D11DepthStencilState* depthStencilState) override;
+
+	void UpdateBuffer(ID3D11Buffer* buffer, const void* data) override;
+	void* Map(ID3D11Buffer* buffer, D3D11_MAP mapType) override;
+	void Unmap(ID3D11Buffer*) override {};
+
+	void DrawIndexed(UINT indexCount, UINT startIndex, INT baseVertex) override;
+	void DrawIndexedInstanced(UINT indexCount, UINT instanceCount, UINT startIndex, INT baseVertex, UINT startInstance) override;
+
+private:
+	struct VertexBufferBinding
+	{
+		SoftwareBuffer*		Buffer{ nullptr };
+		UINT				Stride{ 0 };
+		UINT				Offset{ 0 };
+	};
+
+	struct ConstantBufferBinding
+	{
+		SoftwareBuffer*		Buffer{ nullptr };
+		UINT				Offset{ 0 };
+	};
+
+	SoftwareRasteriser&									_rasteriser;
+	D3D11_PRIMITIVE_TOPOLOGY							_topology{ D3D11_PRIMITIVE_TOPOLOGY_UNDEFINED };
+	SoftwareInputLayout*								_inputLayout{ nullptr };
+	VertexBufferBinding									_vertexBuffers[2];
+	SoftwareBuffer*										_indexBuffer{ nullptr };
+	DXGI_FORMAT											_indexFormat{ DXGI_FORMAT_R16_UINT };
+	UINT												_indexOffset{ 0 };
+	ConstantBufferBinding								_vertexConstantBuffers[3];
+	ConstantBufferBinding								_pixelConstantBuffers[3];
+	SoftwareTexture*									_texture{ nullptr };
+	SoftwareState<D3D11_SAMPLER_DESC>*					_sampler{ nullptr };
+	SoftwareState<D3D11_RASTERIZER_DESC>*				_rasteriserState{ nullptr };
+	SoftwareState<D3D11_DEPTH_STENCIL_DESC>*			_depthStencilState{ nullptr };
+
+	// The vertices shaded for the current instance. A vertex is only shaded once however many
+	// triangles use it, which is what the stamps are for
+	vector<SoftwareVertex>								_shadedVertices;
+	vector<UINT>										_shadedVertexStamps;
+	UINT												_shadedVertexStamp{ 0 };
+
+	template<typename T>
+	const T* GetConstants(const ConstantBufferBinding& binding) const
+	{
+		return binding.Buffer != nullptr && binding.Offset + sizeof(T) <= binding.Buffer->GetByteWidth() ? reinterpret_cast<const T*>(binding.Buffer->GetData() + binding.Offset) : nullptr;
+	}
+	bool GetDrawState(SoftwareDrawState& drawState) const;
+	void Draw(UINT indexCount, UINT instanceCount, UINT startIndex, INT baseVertex, UINT startInstance);
+};
+
+// A render device that draws into memory on the CPU, for machines without a GPU and for
+// rendering the scene to a file. It draws what the Direct3D 11 device would draw, with the
+// exceptions that there is no blending or multisampling.
+//
+// Draws are collected during the frame and rasterised when the frame is ended, on the thread
+// pool if the device has been given one. The render target is then ready to be presented or saved.
+
+class SoftwareRenderDevice : public IRenderDevice
+{
+public:
+	SoftwareRenderDevice(UINT width, UINT height);
+	~SoftwareRenderDevice() {};
+
+	IRenderContext* GetImmediateContext() override { return &_immediateContext; }
+
+	// Constants are copied when a draw is made, so a constant buffer can be overwritten at any time
+	bool IsConstantBufferOffsettingSupported() const override { return true; }
+	bool IsConstantBufferNoOverwriteSupported() const override { return true; }
+
+	HRESULT CreateBuffer(const D3D11_BUFFER_DESC* bufferDesc, const D3D11_SUBRESOURCE_DATA* initialData, ID3D11Buffer** buffer) override;
+	HRESULT CreateVertexShader(const void* byteCode, SIZE_T byteCodeLength, ID3D11VertexShader** vertexShader) override;
+	HRESULT CreatePixelShader(const void* byteCode, SIZE_T byteCodeLength, ID3D11PixelShader** pixelShader) override;
+	HRESULT CreateInputLayout(const D3D11_INPUT_ELEMENT_DESC* elements, UINT elementCount, const void* byteCode, SIZE_T byteCodeLength, ID3D11InputLayout** inputLayout) override;
+	HRESULT CreateRasterizerState(const D3D11_RASTERIZER_DESC* rasteriserDesc, ID3D11RasterizerState** rasteriserState) override;
+	HRESULT CreateBlendState(const D3D11_BLEND_DESC* blendDesc, ID3D11BlendState** blendState) override;
+	HRESULT CreateDepthStencilState(const D3D11_DEPTH_STENCIL_DESC* depthStencilDesc, ID3D11DepthStencilState** depthStencilState) override;
+	HRESULT CreateSamplerState(const D3D11_SAMPLER_DESC* samplerDesc, ID3D11SamplerState** samplerState) override;
+	// Textures are decoded with WIC, so COM must have been initialised
+	HRESULT CreateTextureFromFile(const wchar_t* fileName, ID3D11ShaderResourceView** texture) override;
+
+	void SetThreadPool(ThreadPool* threadPool) { _threadPool = threadPool; }
+	void Resize(UINT width, UINT height) { _rasteriser.Resize(width, height); }
+	void Clear(const float colour[4], float depth) { _rasteriser.Clear(colour, depth); }
+	// Rasterise everything drawn since the last frame ended
+	void EndFrame() { _rasteriser.Resolve(_threadPool); }
+
+	const SoftwareRasteriser& GetRasteriser() const { return _rasteriser; }
+	bool SaveBitmap(const wstring& fileName) const { return _rasteriser.SaveBitmap(fileName); }
+
+private:
+	SoftwareRasteriser			_rasteriser;
+	SoftwareRenderContext		_immediateContext;
+	ThreadPool*					_threadPool{ nullptr };
+};
@@ -1,30 +1,9 @@
 #pragma once
+#include "ConstantBuffer.h"
+#include "VertexCompression.h"
 
-#define ShaderFileName		L"shader.hlsl"
-#define VertexShaderName	"VS"
-#define PixelShaderName		"PS"
-
-// Format of the constant buffer. This must match the format of the
-// cbuffer structure in the shader
-
-struct CBuffer
-{
-    Matrix		WorldViewProjection;
-    Matrix		WorldTransformation;
-    Vector4		AmbientLightColour;
-    Vector4		DirectionalLightColour;
-    Vector4		DirectionalLightVector;
-    Vector4		PointLightColour;
-    Vector3		PointLightPosition;
-    float		PointLightRange = { 0 };
-    Vector4		SpecularColour;
-    float		SpecularPower = { 0 };
-    Vector3		EyePosition;
-    alignas(16) Vector3		Pad;
-};
-
-// Structure of a single vertex.  This must match the
-// structure of the input vertex in the shader
+// Structure of a single vertex, as the geometry is built. The resource cache compresses
+// it into a CompressedVertex (see VertexCompression.h) before it is uploaded
 
 struct Vertex
 {
@@ -33,16 +12,30 @@ struct Vertex
 };
 
 // The description of the vertex that is passed to CreateInputLayout.  This must
-// match the format of the vertex above and the format of the input vertex in the shader
+// match the format of the compressed vertex and the format of the input vertex in the shader
 
 D3D11_INPUT_ELEMENT_DESC teapotVertexDesc[] =
 {
-    { "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
-    { "NORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+    { "POSITION", 0, DXGI_FORMAT_R16G16B16A16_SNORM, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+    { "NORMAL", 0, DXGI_FORMAT_R16G16_SNORM, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+};
+
+// The description of the vertex used by the instanced vertex shader. The per-instance
+// data is read from the second vertex buffer slot and must match InstanceData
+
+D3D11_INPUT_ELEMENT_DESC instancedTeapotVertexDesc[] =
+{
+    { "POSITION", 0, DXGI_FORMAT_R16G16B16A16_SNORM, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+    { "NORMAL", 0, DXGI_FORMAT_R16G16_SNORM, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+    { "WORLD", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 0, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+    { "WORLD", 1, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+    { "WORLD", 2, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+    { "WORLD", 3, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+    { "COLOUR", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
 };
 
 // This example uses hard-coded vertices and indices for a teapote.
-float vertexFloats[] =
+const float vertexFloats[] =
 {
                  0.678873f, 0.330678f, 0.000000f,  0.669556f, 0.358022f, 0.000000f,
                  0.671003f, 0.374428f, 0.000000f,  0.680435f, 0.379897f, 0.000000f,
@@ -635,9 +628,7 @@ float vertexFloats[] =
                  0.573395f, 0.362623f,-0.165462f,  0.606002f, 0.330678f,-0.174537f
 };
 
-Vertex teapotVertices[ARRAYSIZE(vertexFloats) / 3];
-
-UINT teapotIndices[] = {
+const UINT teapotIndices[] = {
                        0,   7,   8,    8,   1,   0,    1,   8,   9,    9,   2,   1,
                    2,   9,  10,   10,   3,   2,    3,  10,  11,   11,   4,   3,
                    4,  11,  12,   12,   5,   4,    5,  12,  13,   13,   6,   5,
@@ -1,228 +1,135 @@
 #include "TeapotNode.h"
 #include "TeapotGeometry.h"
+#include "NormalGeneration.h"
 
 bool TeapotNode::Initialise()
 {
-	BuildVertices();
-	BuildNormals();
 	BuildGeometryBuffers();
-	BuildShaders();
-	BuildVertexLayout();
+	BuildBounds();
+	BuildPipelineState();
 	BuildConstantBuffer();
-	BuildRasteriserState();
 
 	return true;
 }
 
-void TeapotNode::Render()
+void TeapotNode::Extract(RenderQueue& renderQueue)
 {
-	// Create a complete matrix of the cumulative world, view, and projection transformations
-	Matrix completeTransformation = _cumulativeWorldTransformation * DirectXFramework::GetDXFramework()->GetViewTransformation() * DirectXFramework::GetDXFramework()->GetProjectionTransformation();
-	CBuffer constantBuffer;
-	// Apply the transformations to the constant buffer
+	// Create a complete matrix of the cumulative world, view, and projection transformations. The
+	// vertex buffer holds quantised positions, which the geometry's position decode turns back into
+	// those of the mesh, so it is applied first
+	Matrix worldTransformation = _geometry->PositionDecode * GetCumulativeWorldTransform();
+	Matrix completeTransformation = worldTransformation * DirectXFramework::GetDXFramework()->GetViewTransformation() * DirectXFramework::GetDXFramework()->GetProjectionTransformation();
+	ObjectConstants constantBuffer;
+	// Apply the transformations to the constant buffer. The lighting is held in the material
+	// and the eye position in the frame constants, which the render queue uploads
 	constantBuffer.WorldViewProjection = completeTransformation;
-	constantBuffer.WorldTransformation = _cumulativeWorldTransformation;
-	// Apply the colour to the cube
-	constantBuffer.AmbientLightColour = _colour;
-	// Create a directional light
-	constantBuffer.DirectionalLightColour = _directionalLightColour;
-	constantBuffer.DirectionalLightVector = _directionalLightVector;
-	// Create a point light
-	constantBuffer.PointLightColour = _pointLightColour;
-	constantBuffer.PointLightPosition = _pointLightPosition;
-	constantBuffer.PointLightRange = _pointLightRange;
-	// Create the specular light
-	constantBuffer.SpecularColour = _specularColour;
-	constantBuffer.SpecularPower = _specularPower;
-	// Get the eye position
-	constantBuffer.EyePosition = DirectXFramework::GetDXFramework()->GetCamera().GetEyePosition();
-
-	// Update the constant buffer. Note the layout of the constant buffer must match that in the shader
-	_deviceContext->VSSetConstantBuffers(0, 1, _constantBuffer.GetAddressOf());
-	_deviceContext->PSSetConstantBuffers(0, 1, _constantBuffer.GetAddressOf());
-	_deviceContext->UpdateSubresource(_constantBuffer.Get(), 0, 0, &constantBuffer, 0, 0);
-
-	// Now render the cube
-	// Specify the distance between vertices and the starting point in the vertex buffer
-	UINT32 stride = sizeof(Vertex);
-	UINT32 offset = 0;
-	// Set the vertex buffer and index buffer we are going to use
-	_deviceContext->IASetVertexBuffers(0, 1, _vertexBuffer.GetAddressOf(), &stride, &offset);
-	_deviceContext->IASetIndexBuffer(_indexBuffer.Get(), DXGI_FORMAT_R32_UINT, 0);
-
-	// Specify the layout of the polygons (it will rarely be different to this)
-	_deviceContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-
-	// Specify the layout of the input vertices.  This must match the layout of the input vertices in the shader
-	_deviceContext->IASetInputLayout(_layout.Get());
-
-	// Specify the vertex and pixel shaders we are going to use
-	_deviceContext->VSSetShader(_vertexShader.Get(), 0, 0);
-	_deviceContext->PSSetShader(_pixelShader.Get(), 0, 0);
-
-	// Specify details about how the object is to be drawn
-	_deviceContext->RSSetState(_rasteriserState.Get());
-
-	// Now draw the first cube
-	_deviceContext->DrawIndexed(ARRAYSIZE(teapotIndices), 0, 0);
+	constantBuffer.WorldTransformation = worldTransformation;
+
+	// Describe the draw. The render queue sorts the draws of the whole frame and binds
+	// only the state that differs from the previous draw
+	DrawPacket packet;
+	packet.Pipeline = _pipelineState.get();
+	packet.InstancedPipeline = _instancedPipelineState.get();
+	packet.Material = _material.get();
+	packet.VertexBuffer = _geometry->VertexBuffer.Get();
+	packet.IndexBuffer = _geometry->IndexBuffer.Get();
+	// A node that has not moved this frame keeps its constants in a buffer of its own, which
+	// is only uploaded to when they change. The constants of moving nodes go through the ring
+	packet.PersistentConstants = HasChanged() ? nullptr : &_persistentConstants;
+	packet.VertexStride = _geometry->BufferVertexStride;
+	// Draw the coarsest level of detail whose error would cover no more than the tolerated
+	// fraction of a pixel at the distance of the node
+	const LevelOfDetail& level = _geometry->SelectLevel(DirectXFramework::GetDXFramework()->GetErrorTolerance(GetCumulativeWorldTransform(), _geometry->Bounds));
+	packet.IndexCount = level.IndexCount;
+	packet.StartIndex = level.StartIndex;
+	// The render queue leaves out the meshlets of the level that cannot be seen
+	packet.Meshlets = _geometry->Meshlets.data() + level.FirstMeshlet;
+	packet.MeshletCount = level.MeshletCount;
+	packet.IndexFormat = _geometry->IndexFormat;
+	packet.IsTransparent = _colour.w < 1.0f;
+	renderQueue.Add(packet, constantBuffer, GetCumulativeWorldTransform().Translation());
 }
 
-void TeapotNode::BuildVertices()
+void TeapotNode::BuildVertices(vector<Vertex>& meshVertices)
 {
 	// Populate the vertices array with Vertex3 fields containing the values from vertexFloats array and add a normal field
+	meshVertices.resize(ARRAYSIZE(vertexFloats) / 3);
 	for (int i = 0; i < ARRAYSIZE(vertexFloats); i += 3)
 	{
-		teapotVertices[i / 3] = { Vector3(vertexFloats[i], vertexFloats[i + 1], vertexFloats[i + 2]), Vector3(0.0f) };
+		meshVertices[i / 3] = { Vector3(vertexFloats[i], vertexFloats[i + 1], vertexFloats[i + 2]), Vector3(0.0f) };
 	}
 }
 
-void TeapotNode::BuildNormals()
+void TeapotNode::BuildGeometryBuffers()
 {
-	UINT contributingCounts[ARRAYSIZE(teapotVertices)];
-
-	// For each Vertex, set the corresponding contributing count array entry to 0.
-	for (int i = 0; i < ARRAYSIZE(teapotVertices); i++)
+	// The geometry is built and copied into immutable buffers by the first node of this type
+	// only. The arrays in the geometry header are never modified
+	_geometry = _resourceCache.GetGeometry<Vertex>(L"Teapot", [](vector<Vertex>& meshVertices, vector<UINT>& meshIndices)
 	{
-		contributingCounts[i] = 0;
-	}
-
-	// For each Polygon, calcuate its normal then add it to the vertex normal for each
-	// of the 3 vertices included in the polygon, incrementing the correspending contributing count by 1
-	for (int i = 0; i < ARRAYSIZE(teapotIndices); i += 3)
-	{
-		Vector3 vectorA = teapotVertices[teapotIndices[i + 1]].Position - teapotVertices[teapotIndices[i]].Position;
-		Vector3 vectorB = teapotVertices[teapotIndices[i + 2]].Position - teapotVertices[teapotIndices[i]].Position;
-		Vector3 normal = vectorA.Cross(vectorB);
-
-		teapotVertices[teapotIndices[i]].Normal += normal;
-		teapotVertices[teapotIndices[i + 1]].Normal += normal;
-		teapotVertices[teapotIndices[i + 2]].Normal += normal;
-
-		contributingCounts[teapotIndices[i]]++;
-		contributingCounts[teapotIndices[i + 1]]++;
-		contributingCounts[teapotIndices[i + 2]]++;
-	}
-
-	// For each Vertex, divide the summed vertex normals by the number of times they were contributed to
-	// then normalise the resulting normal vector
-	for (int i = 0; i < ARRAYSIZE(teapotVertices); i++)
-	{
-		teapotVertices[i].Normal = teapotVertices[i].Normal / (float)contributingCounts[i];
-		teapotVertices[i].Normal.Normalize();
-	}
+		BuildVertices(meshVertices);
+		meshIndices.assign(begin(teapotIndices), end(teapotIndices));
+		GenerateNormals(meshVertices, meshIndices, NormalWeighting::Area, DirectXFramework::GetDXFramework()->GetThreadPool());
+	});
 }
 
-void TeapotNode::BuildGeometryBuffers()
+void TeapotNode::BuildBounds()
 {
-	// Setup the structure that specifies how big the vertex 
-	// buffer should be
-	D3D11_BUFFER_DESC vertexBufferDescriptor = { 0 };
-	vertexBufferDescriptor.Usage = D3D11_USAGE_IMMUTABLE;
-	vertexBufferDescriptor.ByteWidth = sizeof(Vertex) * ARRAYSIZE(teapotVertices);
-	vertexBufferDescriptor.BindFlags = D3D11_BIND_VERTEX_BUFFER;
-	vertexBufferDescriptor.CPUAccessFlags = 0;
-	vertexBufferDescriptor.MiscFlags = 0;
-	vertexBufferDescriptor.StructureByteStride = 0;
-
-	// Now set up a structure that tells DirectX where to get the
-	// data for the vertices from
-	D3D11_SUBRESOURCE_DATA vertexInitialisationData = { 0 };
-	vertexInitialisationData.pSysMem = teapotVertices;
-
-	// and create the vertex buffer
-	ThrowIfFailed(_device->CreateBuffer(&vertexBufferDescriptor, &vertexInitialisationData, _vertexBuffer.GetAddressOf()));
-
-	// Setup the structure that specifies how big the index 
-	// buffer should be
-	D3D11_BUFFER_DESC indexBufferDescriptor = { 0 };
-	indexBufferDescriptor.Usage = D3D11_USAGE_IMMUTABLE;
-	indexBufferDescriptor.ByteWidth = sizeof(UINT) * ARRAYSIZE(teapotIndices);
-	indexBufferDescriptor.BindFlags = D3D11_BIND_INDEX_BUFFER;
-	indexBufferDescriptor.CPUAccessFlags = 0;
-	indexBufferDescriptor.MiscFlags = 0;
-	indexBufferDescriptor.StructureByteStride = 0;
-
-	// Now set up a structure that tells DirectX where to get the
-	// data for the indices from
-	D3D11_SUBRESOURCE_DATA indexInitialisationData;
-	indexInitialisationData.pSysMem = teapotIndices;
-
-	// and create the index buffer
-	ThrowIfFailed(_device->CreateBuffer(&indexBufferDescriptor, &indexInitialisationData, _indexBuffer.GetAddressOf()));
+	// The bounding box of the vertices is calculated along with the geometry so that the node can be culled
+	SetLocalBounds(_geometry->Bounds);
 }
 
-void TeapotNode::BuildShaders()
+void TeapotNode::BuildPipelineState()
 {
-	DWORD shaderCompileFlags = 0;
-#if defined( _DEBUG )
-	shaderCompileFlags = D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION;
-#endif
-
-	ComPtr<ID3DBlob> compilationMessages = nullptr;
-
-	//Compile vertex shader
-	HRESULT hr = D3DCompileFromFile(ShaderFileName,
-		nullptr, D3D_COMPILE_STANDARD_FILE_INCLUDE,
-		VertexShaderName, "vs_5_0",
-		shaderCompileFlags, 0,
-		_vertexShaderByteCode.GetAddressOf(),
-		compilationMessages.GetAddressOf());
-
-	if (compilationMessages.Get() != nullptr)
+	// The cheapest permutation of the lighting shader that gives the same result is chosen for the node's
+	// material. Shaders are created once and shared by every node that uses the same permutation.
+	// The instanced vertex shader is used when several nodes share the same geometry
+	UINT permutation = SelectShaderPermutation(false, _pointLightColour, _pointLightRange, _specularColour, _specularPower);
+	VertexShaderPointer vertexShader = _resourceCache.GetVertexShader(VertexShaderName, permutation);
+	VertexShaderPointer instancedVertexShader = _resourceCache.GetVertexShader(InstancedVertexShaderName, permutation);
+	PixelShaderPointer pixelShader = _resourceCache.GetPixelShader(PixelShaderName, permutation);
+
+	// The shaders, input layout and fixed-function state are bound together in a single call. Nodes
+	// that ask for the same combination share a pipeline state, which the render queue sorts by
+	PipelineStateDesc pipelineStateDesc;
+	pipelineStateDesc.VertexShader = vertexShader;
+	pipelineStateDesc.PixelShader = pixelShader;
+	pipelineStateDesc.InputLayout = _resourceCache.GetInputLayout(L"PositionNormal", teapotVertexDesc, ARRAYSIZE(teapotVertexDesc), vertexShader);
+	pipelineStateDesc.RasteriserDesc.AntialiasedLineEnable = true;
+	// A node that is not opaque is drawn in the transparent pass, which blends it over the
+	// opaque draws that come before it
+	if (_colour.w < 1.0f)
 	{
-		// If there were any compilation messages, display them
-		MessageBoxA(0, (char*)compilationMessages->GetBufferPointer(), 0, 0);
+		pipelineStateDesc.SetAlphaBlending();
 	}
-	// Even if there are no compiler messages, check to make sure there were no other errors.
-	ThrowIfFailed(hr);
-	ThrowIfFailed(_device->CreateVertexShader(_vertexShaderByteCode->GetBufferPointer(), _vertexShaderByteCode->GetBufferSize(), NULL, _vertexShader.GetAddressOf()));
+	_pipelineState = _resourceCache.GetPipelineState(pipelineStateDesc);
 
-	// Compile pixel 
-	hr = D3DCompileFromFile(ShaderFileName,
-		nullptr, D3D_COMPILE_STANDARD_FILE_INCLUDE,
-		PixelShaderName, "ps_5_0",
-		shaderCompileFlags, 0,
-		_pixelShaderByteCode.GetAddressOf(),
-		compilationMessages.GetAddressOf());
-
-	if (compilationMessages.Get() != nullptr)
-	{
-		// If there were any compilation messages, display them
-		MessageBoxA(0, (char*)compilationMessages->GetBufferPointer(), 0, 0);
-	}
-	ThrowIfFailed(hr);
-	ThrowIfFailed(_device->CreatePixelShader(_pixelShaderByteCode->GetBufferPointer(), _pixelShaderByteCode->GetBufferSize(), NULL, _pixelShader.GetAddressOf()));
-}
-
-void TeapotNode::BuildVertexLayout()
-{
-	ThrowIfFailed(_device->CreateInputLayout(teapotVertexDesc, ARRAYSIZE(teapotVertexDesc), _vertexShaderByteCode->GetBufferPointer(), _vertexShaderByteCode->GetBufferSize(), _layout.GetAddressOf()));
+	// The instanced pipeline state only differs in its vertex shader and input layout
+	pipelineStateDesc.VertexShader = instancedVertexShader;
+	pipelineStateDesc.InputLayout = _resourceCache.GetInputLayout(L"InstancedPositionNormal", instancedTeapotVertexDesc, ARRAYSIZE(instancedTeapotVertexDesc), instancedVertexShader);
+	_instancedPipelineState = _resourceCache.GetPipelineState(pipelineStateDesc);
 }
 
 void TeapotNode::BuildConstantBuffer()
 {
+	// The colour and lighting of the node make up its material, which is shared with every
+	// node that has the same colour and lighting
+	MaterialConstants materialConstants;
+	materialConstants.AmbientLightColour = _colour;
+	materialConstants.DirectionalLightColour = _directionalLightColour;
+	materialConstants.DirectionalLightVector = _directionalLightVector;
+	materialConstants.PointLightColour = _pointLightColour;
+	materialConstants.PointLightPosition = _pointLightPosition;
+	materialConstants.PointLightRange = _pointLightRange;
+	materialConstants.SpecularColour = _specularColour;
+	materialConstants.SpecularPower = _specularPower;
+	_material = _resourceCache.GetMaterial(materialConstants);
+
+	// The object constants of a node that is not moving are kept in a buffer of its own
 	D3D11_BUFFER_DESC bufferDesc;
 	ZeroMemory(&bufferDesc, sizeof(bufferDesc));
 	bufferDesc.Usage = D3D11_USAGE_DEFAULT;
-	bufferDesc.ByteWidth = sizeof(CBuffer);
+	bufferDesc.ByteWidth = sizeof(ObjectConstants);
 	bufferDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
 
-	ThrowIfFailed(_device->CreateBuffer(&bufferDesc, NULL, _constantBuffer.GetAddressOf()));
-}
-
-void TeapotNode::BuildRasteriserState()
-{
-	// Set default and wireframe rasteriser states
-	D3D11_RASTERIZER_DESC rasteriserDesc;
-	rasteriserDesc.CullMode = D3D11_CULL_BACK;
-	rasteriserDesc.FrontCounterClockwise = false;
-	rasteriserDesc.DepthBias = 0;
-	rasteriserDesc.SlopeScaledDepthBias = 0.0f;
-	rasteriserDesc.DepthBiasClamp = 0.0f;
-	rasteriserDesc.DepthClipEnable = true;
-	rasteriserDesc.ScissorEnable = false;
-	rasteriserDesc.MultisampleEnable = false;
-	rasteriserDesc.AntialiasedLineEnable = true;
-	rasteriserDesc.FillMode = D3D11_FILL_SOLID;
-	ThrowIfFailed(_device->CreateRasterizerState(&rasteriserDesc, _rasteriserState.GetAddressOf()));
+	ThrowIfFailed(DirectXFramework::GetDXFramework()->GetRenderDevice()->CreateBuffer(&bufferDesc, NULL, _persistentConstants.Buffer.GetAddressOf()));
 }
@@ -4,6 +4,8 @@
 
 using namespace std;
 
+struct TexturedVertex;
+
 class TexturedCubeNode : public SceneNode
 {
 public:
@@ -13,34 +15,26 @@ public:
 	~TexturedCubeNode() {};
 
 	virtual bool Initialise(void) override;
-	virtual void Render(void) override;
+	virtual void Extract(RenderQueue& renderQueue) override;
 	virtual void Shutdown(void) override {};
 
-private:
-	ComPtr<ID3D11Device>			_device = DirectXFramework::GetDXFramework()->GetDevice();
-	ComPtr<ID3D11DeviceContext>		_deviceContext = DirectXFramework::GetDXFramework()->GetDeviceContext();
-
-	ComPtr<ID3D11ShaderResourceView> _texture;
+	const wstring& GetTextureFileName() const { return _textureFileName; }
 
-	ComPtr<ID3D11Buffer>			_vertexBuffer;
-	ComPtr<ID3D11Buffer>			_indexBuffer;
-
-	ComPtr<ID3DBlob>				_vertexShaderByteCode = nullptr;
-	ComPtr<ID3DBlob>				_pixelShaderByteCode = nullptr;
-	ComPtr<ID3D11VertexShader>		_vertexShader;
-	ComPtr<ID3D11PixelShader>		_pixelShader;
-	ComPtr<ID3D11InputLayout>		_layout;
-	ComPtr<ID3D11Buffer>			_constantBuffer;
+private:
+	ResourceCache&					_resourceCache = DirectXFramework::GetDXFramework()->GetResourceCache();
 
-	ComPtr<ID3D11RasterizerState>   _rasteriserState;
+	GeometryPointer					_geometry;
+	PipelineStatePointer			_pipelineState;
+	PipelineStatePointer			_instancedPipelineState;
+	MaterialPointer					_material;
+	PersistentConstantBuffer		_persistentConstants;
+	TexturePointer					_texture;
 
 	wstring							_textureFileName;
 
-	void BuildNormals();
 	void BuildGeometryBuffers();
-	void BuildShaders();
-	void BuildVertexLayout();
+	void BuildBounds();
+	void BuildPipelineState();
 	void BuildConstantBuffer();
-	void BuildRasteriserState();
 	void BuildTexture();
 };
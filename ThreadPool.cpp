@@ -0,0 +1,132 @@
+#include "ThreadPool.h"
+
+ThreadPool::ThreadPool(unsigned int threadCount)
+{
+	if (threadCount == 0)
+	{
+		unsigned int hardwareThreads = thread::hardware_concurrency();
+		threadCount = (hardwareThreads > 1) ? hardwareThreads - 1 : 0;
+	}
+
+	// Queue 0 belongs to the calling thread
+	for (unsigned int i = 0; i <= threadCount; i++)
+	{
+		_queues.push_back(make_unique<WorkQueue>());
+	}
+	for (unsigned int i = 1; i <= threadCount; i++)
+	{
+		_threads.emplace_back(&ThreadPool::WorkerLoop, this, i);
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		lock_guard<mutex> lock(_lock);
+		_isStopping = true;
+	}
+	_workAvailable.notify_all();
+	for (thread& worker : _threads)
+	{
+		worker.join();
+	}
+}
+
+void ThreadPool::Run(size_t count, const function<void(size_t)>& task)
+{
+	if (count == 0)
+	{
+		return;
+	}
+
+	// The task is published before any work is queued. Workers only read it after
+	// taking a task from a queue, so the queue locks order the two accesses
+	size_t queueCount = _queues.size();
+	_task = &task;
+	_remaining = count;
+	for (size_t i = 0; i < queueCount; i++)
+	{
+		lock_guard<mutex> lock(_queues[i]->Lock);
+		for (size_t j = count * i / queueCount; j < count * (i + 1) / queueCount; j++)
+		{
+			_queues[i]->Tasks.push_back(j);
+		}
+	}
+	{
+		lock_guard<mutex> lock(_lock);
+		_batch++;
+	}
+	_workAvailable.notify_all();
+
+	while (RunNextTask(0))
+	{
+	}
+
+	unique_lock<mutex> lock(_lock);
+	_workComplete.wait(lock, [this] { return _remaining == 0; });
+}
+
+void ThreadPool::WorkerLoop(unsigned int queueIndex)
+{
+	unsigned int lastBatch = 0;
+	while (true)
+	{
+		{
+			unique_lock<mutex> lock(_lock);
+			_workAvailable.wait(lock, [this, lastBatch] { return _isStopping || _batch != lastBatch; });
+			if (_isStopping)
+			{
+				return;
+			}
+			lastBatch = _batch;
+		}
+		while (RunNextTask(queueIndex))
+		{
+		}
+	}
+}
+
+bool ThreadPool::RunNextTask(unsigned int queueIndex)
+{
+	size_t taskIndex = 0;
+	bool hasTask = false;
+
+	// Take work from the back of our own queue first
+	{
+		WorkQueue& queue = *_queues[queueIndex];
+		lock_guard<mutex> lock(queue.Lock);
+		if (!queue.Tasks.empty())
+		{
+			taskIndex = queue.Tasks.back();
+			queue.Tasks.pop_back();
+			hasTask = true;
+		}
+	}
+
+	// Otherwise steal from the front of another queue
+	size_t queueCount = _queues.size();
+	for (size_t i = 1; i < queueCount && !hasTask; i++)
+	{
+		WorkQueue& queue = *_queues[(queueIndex + i) % queueCount];
+		lock_guard<mutex> lock(queue.Lock);
+		if (!queue.Tasks.empty())
+		{
+			taskIndex = queue.Tasks.front();
+			queue.Tasks.pop_front();
+			hasTask = true;
+		}
+	}
+
+	if (!hasTask)
+	{
+		return false;
+	}
+
+	(*_task)(taskIndex);
+	if (--_remaining == 0)
+	{
+		lock_guard<mutex> lock(_lock);
+		_workComplete.notify_all();
+	}
+	return true;
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include <vector>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+
+using namespace std;
+
+// A small work-stealing thread pool. Each batch of tasks is split into contiguous
+// blocks, one per worker queue. A worker takes tasks from the back of its own
+// queue and, once that is empty, steals from the front of the other queues.
+// The calling thread takes part in the work, so a pool with N threads runs
+// tasks on N + 1 threads.
+
+class ThreadPool
+{
+public:
+	// A thread count of zero creates one thread per additional hardware thread
+	ThreadPool(unsigned int threadCount = 0);
+	~ThreadPool();
+
+	// Number of threads that run tasks, including the calling thread
+	unsigned int GetConcurrency() const { return static_cast<unsigned int>(_queues.size()); }
+
+	// Runs task(i) for every i in [0, count) and returns once all of them have completed
+	void Run(size_t count, const function<void(size_t)>& task);
+
+private:
+	struct WorkQueue
+	{
+		mutex			Lock;
+		deque<size_t>	Tasks;
+	};
+
+	vector<thread>					_threads;
+	vector<unique_ptr<WorkQueue>>	_queues;
+
+	const function<void(size_t)>*	_task{ nullptr };
+	atomic<size_t>					_remaining{ 0 };
+	unsigned int					_batch{ 0 };
+	bool							_isStopping{ false };
+	mutex							_lock;
+	condition_variable				_workAvailable;
+	condition_variable				_workComplete;
+
+	void WorkerLoop(unsigned int queueIndex);
+	bool RunNextTask(unsigned int queueIndex);
+};
@@ -0,0 +1,293 @@
+#include "TraceReplayer.h"
+#include "MappedFile.h"
+
+// The names of the command types, in the order they are declared, for the report
+static const wchar_t* CommandTypeNames[CommandTypeCount] =
+{
+	L"SetPipelineState",
+	L"SetInputLayout",
+	L"SetPrimitiveTopology",
+	L"SetVertexBuffer",
+	L"SetIndexBuffer",
+	L"SetVertexShader",
+	L"SetPixelShader",
+	L"SetVertexConstantBuffer",
+	L"SetPixelConstantBuffer",
+	L"SetShaderResource",
+	L"SetSampler",
+	L"SetRasteriserState",
+	L"SetBlendState",
+	L"SetDepthStencilState",
+	L"UpdateConstantBuffer",
+	L"MapBuffer",
+	L"UnmapBuffer",
+	L"DrawIndexed",
+	L"DrawIndexedInstanced"
+};
+
+bool TraceReplayer::Replay(const wstring& fileName, IRenderDevice* renderDevice)
+{
+	MappedFile traceFile(fileName);
+	const BYTE* trace = traceFile.GetData();
+	size_t traceSize = traceFile.GetSize();
+	if (trace == nullptr || traceSize < sizeof(FrameTraceHeader))
+	{
+		return false;
+	}
+	FrameTraceHeader header;
+	memcpy(&header, trace, sizeof(header));
+	if (header.Magic != FrameTraceMagic || header.Version != FrameTraceVersion || header.CommandSize != sizeof(Command))
+	{
+		return false;
+	}
+
+	_renderDevice = renderDevice;
+	_objects.clear();
+	_frameStatistics.clear();
+	_totalStatistics = TraceFrameStatistics();
+	_createdObjectCount = 0;
+	_stateFilter.Begin(renderDevice->GetImmediateContext());
+	_stateFilter.Invalidate();
+
+	// Records are not aligned in the trace, so every header is copied out before it is read
+	TraceFrameStatistics statistics;
+	size_t position = sizeof(header);
+	while (position + sizeof(TraceRecordHeader) <= traceSize)
+	{
+		TraceRecordHeader recordHeader;
+		memcpy(&recordHeader, trace + position, sizeof(recordHeader));
+		position += sizeof(recordHeader);
+		// The last record of a trace whose capture did not finish can be cut short
+		if (recordHeader.Size > traceSize - position)
+		{
+			break;
+		}
+		const BYTE* payload = trace + position;
+		position += recordHeader.Size;
+
+		bool isReplayed = true;
+		switch (recordHeader.Type)
+		{
+		case TraceRecordType::CreateObject:
+			isReplayed = ReplayCreation(payload, recordHeader.Size);
+			break;
+
+		case TraceRecordType::Command:
+			isReplayed = ReplayCommand(payload, recordHeader.Size, statistics);
+			break;
+
+		case TraceRecordType::EndFrame:
+			EndFrame(statistics);
+			break;
+
+		default:
+			isReplayed = false;
+			break;
+		}
+		if (!isReplayed)
+		{
+			return false;
+		}
+	}
+
+	// The calls after the last frame marker still make up a frame
+	if (statistics.CallCount > 0)
+	{
+		EndFrame(statistics);
+	}
+	return true;
+}
+
+bool TraceReplayer::ReplayCreation(const BYTE* payload, UINT size)
+{
+	TraceObjectCreation creation;
+	if (size < sizeof(creation))
+	{
+		return false;
+	}
+	memcpy(&creation, payload, sizeof(creation));
+
+	// An object is held as the interface it was created as, which starts with IUnknown
+	IUnknown* object = nullptr;
+	HRESULT result = E_FAIL;
+	switch (creation.ObjectType)
+	{
+	case TraceObjectType::Buffer:
+		{
+			D3D11_BUFFER_DESC bufferDesc;
+			if (size < sizeof(creation) + sizeof(bufferDesc))
+			{
+				return false;
+			}
+			memcpy(&bufferDesc, payload + sizeof(creation), sizeof(bufferDesc));
+			D3D11_SUBRESOURCE_DATA initialData = { 0 };
+			initialData.pSysMem = payload + sizeof(creation) + sizeof(bufferDesc);
+			bool hasInitialData = bufferDesc.ByteWidth > 0 && size == sizeof(creation) + sizeof(bufferDesc) + bufferDesc.ByteWidth;
+			ID3D11Buffer* buffer = nullptr;
+			result = _renderDevice->CreateBuffer(&bufferDesc, hasInitialData ? &initialData : nullptr, &buffer);
+			object = buffer;
+		}
+		break;
+
+	case TraceObjectType::VertexShader:
+		{
+			ID3D11VertexShader* vertexShader = nullptr;
+			result = _renderDevice->CreateVertexShader(nullptr, 0, &vertexShader);
+			object = vertexShader;
+		}
+		break;
+
+	case TraceObjectType::PixelShader:
+		{
+			ID3D11PixelShader* pixelShader = nullptr;
+			result = _renderDevice->CreatePixelShader(nullptr, 0, &pixelShader);
+			object = pixelShader;
+		}
+		break;
+
+	case TraceObjectType::InputLayout:
+		{
+			ID3D11InputLayout* inputLayout = nullptr;
+			result = _renderDevice->CreateInputLayout(nullptr, 0, nullptr, 0, &inputLayout);
+			object = inputLayout;
+		}
+		break;
+
+	case TraceObjectType::RasteriserState:
+		{
+			ID3D11RasterizerState* rasteriserState = nullptr;
+			result = _renderDevice->CreateRasterizerState(nullptr, &rasteriserState);
+			object = rasteriserState;
+		}
+		break;
+
+	case TraceObjectType::BlendState:
+		{
+			ID3D11BlendState* blendState = nullptr;
+			result = _renderDevice->CreateBlendState(nullptr, &blendState);
+			object = blendState;
+		}
+		break;
+
+	case TraceObjectType::DepthStencilState:
+		{
+			ID3D11DepthStencilState* depthStencilState = nullptr;
+			result = _renderDevice->CreateDepthStencilState(nullptr, &depthStencilState);
+			object = depthStencilState;
+		}
+		break;
+
+	case TraceObjectType::SamplerState:
+		{
+			ID3D11SamplerState* samplerState = nullptr;
+			result = _renderDevice->CreateSamplerState(nullptr, &samplerState);
+			object = samplerState;
+		}
+		break;
+
+	case TraceObjectType::Texture:
+		{
+			ID3D11ShaderResourceView* texture = nullptr;
+			result = _renderDevice->CreateTextureFromFile(nullptr, &texture);
+			object = texture;
+		}
+		break;
+	}
+	if (FAILED(result))
+	{
+		return false;
+	}
+
+	// The object already holds the reference it was created with. A handle that is created
+	// again belonged to an object that was released during the capture, so the old one is released too
+	ComPtr<IUnknown>& replayedObject = _objects[creation.Handle];
+	replayedObject = nullptr;
+	replayedObject.Attach(object);
+	_createdObjectCount++;
+	return true;
+}
+
+bool TraceReplayer::ReplayCommand(const BYTE* payload, UINT size, TraceFrameStatistics& statistics)
+{
+	Command command;
+	if (size < sizeof(command))
+	{
+		return false;
+	}
+	memcpy(&command, payload, sizeof(command));
+	if (command.Type >= CommandType::Count)
+	{
+		return false;
+	}
+
+	// Swap the handle for the object that was created for it and point at the data that follows the command
+	if (command.Object != nullptr)
+	{
+		auto object = _objects.find(reinterpret_cast<UINT64>(command.Object));
+		if (object == _objects.end())
+		{
+			return false;
+		}
+		command.Object = object->second.Get();
+	}
+	UINT dataSize = size - sizeof(command);
+	command.Data = dataSize > 0 ? payload + sizeof(command) : nullptr;
+	if (command.Type == CommandType::UpdateConstantBuffer && command.Data == nullptr)
+	{
+		return false;
+	}
+
+	statistics.CallCounts[static_cast<size_t>(command.Type)]++;
+	statistics.CallCount++;
+	statistics.UploadedByteCount += dataSize;
+	CommandList::ExecuteCommand(command, _stateFilter);
+	return true;
+}
+
+void TraceReplayer::EndFrame(TraceFrameStatistics& statistics)
+{
+	const DeviceStateStatistics& stateStatistics = _stateFilter.GetStatistics();
+	statistics.RedundantBindCount = stateStatistics.FilteredCallCount;
+	statistics.DrawCount = stateStatistics.DrawCount;
+
+	for (size_t type = 0; type < CommandTypeCount; type++)
+	{
+		_totalStatistics.CallCounts[type] += statistics.CallCounts[type];
+	}
+	_totalStatistics.CallCount += statistics.CallCount;
+	_totalStatistics.RedundantBindCount += statistics.RedundantBindCount;
+	_totalStatistics.UploadedByteCount += statistics.UploadedByteCount;
+	_totalStatistics.DrawCount += statistics.DrawCount;
+	_frameStatistics.push_back(statistics);
+
+	statistics = TraceFrameStatistics();
+	_stateFilter.Begin(_renderDevice->GetImmediateContext());
+}
+
+// A line with the counts of a frame, followed by the number of calls of every type that was called
+static wstring FormatStatistics(const wstring& title, const TraceFrameStatistics& statistics)
+{
+	wstring line = title + L": " + to_wstring(statistics.CallCount) + L" calls, " +
+		to_wstring(statistics.RedundantBindCount) + L" redundant binds, " +
+		to_wstring(statistics.DrawCount) + L" draws, " +
+		to_wstring(statistics.UploadedByteCount) + L" bytes uploaded |";
+	for (size_t type = 0; type < CommandTypeCount; type++)
+	{
+		if (statistics.CallCounts[type] > 0)
+		{
+			line += L" " + wstring(CommandTypeNames[type]) + L" " + to_wstring(statistics.CallCounts[type]);
+		}
+	}
+	return line + L"\n";
+}
+
+wstring TraceReplayer::GetReport() const
+{
+	wstring report = L"Replayed " + to_wstring(_frameStatistics.size()) + L" frames and created " + to_wstring(_createdObjectCount) + L" objects\n";
+	report += FormatStatistics(L"Total", _totalStatistics);
+	for (size_t frame = 0; frame < _frameStatistics.size(); frame++)
+	{
+		report += FormatStatistics(L"Frame " + to_wstring(frame), _frameStatistics[frame]);
+	}
+	return report;
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include <vector>
+#include <unordered_map>
+#include "core.h"
+#include "DirectXCore.h"
+#include "RenderDevice.h"
+#include "DeviceStateFilter.h"
+#include "FrameTrace.h"
+
+using namespace std;
+
+struct TraceFrameStatistics
+{
+	size_t		CallCounts[CommandTypeCount] = { 0 };
+	size_t		CallCount{ 0 };
+	// Binds that would not have changed the state of the device
+	size_t		RedundantBindCount{ 0 };
+	size_t		UploadedByteCount{ 0 };
+	size_t		DrawCount{ 0 };
+};
+
+// Replays a frame trace on a render device and measures every frame in it. The objects in
+// the trace are created again on the device, so the device must not need anything but the
+// description of a buffer to create an object: the null device is the one to replay on.
+//
+// The calls of every frame are counted by type, and the binds are passed through a device
+// state filter of their own, which finds the binds that did not change anything.
+
+class TraceReplayer
+{
+public:
+	TraceReplayer() {};
+	~TraceReplayer() {};
+
+	// Returns false if the trace cannot be read or was captured by a different build
+	bool Replay(const wstring& fileName, IRenderDevice* renderDevice);
+
+	size_t GetFrameCount() const { return _frameStatistics.size(); }
+	const TraceFrameStatistics& GetFrameStatistics(size_t frame) const { return _frameStatistics[frame]; }
+	const TraceFrameStatistics& GetTotalStatistics() const { return _totalStatistics; }
+	size_t GetCreatedObjectCount() const { return _createdObjectCount; }
+
+	// A report of the totals followed by a line for every frame
+	wstring GetReport() const;
+
+private:
+	IRenderDevice*								_renderDevice{ nullptr };
+	DeviceStateFilter							_stateFilter;
+	// The objects created for the replay, found by the handles they had in the trace
+	unordered_map<UINT64, ComPtr<IUnknown>>		_objects;
+	vector<TraceFrameStatistics>				_frameStatistics;
+	TraceFrameStatistics						_totalStatistics;
+	size_t										_createdObjectCount{ 0 };
+
+	bool ReplayCreation(const BYTE* payload, UINT size);
+	bool ReplayCommand(const BYTE* payload, UINT size, TraceFrameStatistics& statistics);
+	void EndFrame(TraceFrameStatistics& statistics);
+};
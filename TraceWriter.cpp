@@ -0,0 +1,91 @@
+#include "TraceWriter.h"
+
+TraceWriter::~TraceWriter()
+{
+	Close();
+}
+
+bool TraceWriter::Open(const wstring& fileName)
+{
+	Close();
+	_file.open(fileName, ios::binary | ios::trunc);
+	if (!_file)
+	{
+		return false;
+	}
+	_writtenByteCount = 0;
+	_isClosing = false;
+	_block.reserve(TraceBlockSize);
+	_thread = thread(&TraceWriter::WriterLoop, this);
+	return true;
+}
+
+void TraceWriter::Close()
+{
+	if (!IsOpen())
+	{
+		return;
+	}
+	Flush();
+	{
+		lock_guard<mutex> lock(_lock);
+		_isClosing = true;
+	}
+	_blocksAvailable.notify_one();
+	_thread.join();
+	_file.close();
+}
+
+void TraceWriter::Write(const void* data, size_t size)
+{
+	const BYTE* bytes = static_cast<const BYTE*>(data);
+	_block.insert(_block.end(), bytes, bytes + size);
+	_writtenByteCount += size;
+	if (_block.size() >= TraceBlockSize)
+	{
+		Flush();
+	}
+}
+
+void TraceWriter::Flush()
+{
+	if (_block.empty())
+	{
+		return;
+	}
+	vector<BYTE> nextBlock;
+	{
+		lock_guard<mutex> lock(_lock);
+		_pendingBlocks.push_back(move(_block));
+		if (!_freeBlocks.empty())
+		{
+			nextBlock = move(_freeBlocks.back());
+			_freeBlocks.pop_back();
+		}
+	}
+	_blocksAvailable.notify_one();
+	_block = move(nextBlock);
+	_block.clear();
+	_block.reserve(TraceBlockSize);
+}
+
+void TraceWriter::WriterLoop()
+{
+	unique_lock<mutex> lock(_lock);
+	while (true)
+	{
+		_blocksAvailable.wait(lock, [this] { return _isClosing || !_pendingBlocks.empty(); });
+		if (_pendingBlocks.empty())
+		{
+			return;
+		}
+
+		// The block is written without holding the lock, so more blocks can be queued meanwhile
+		vector<BYTE> block = move(_pendingBlocks.front());
+		_pendingBlocks.pop_front();
+		lock.unlock();
+		_file.write(reinterpret_cast<const char*>(block.data()), block.size());
+		lock.lock();
+		_freeBlocks.push_back(move(block));
+	}
+}
@@ -0,0 +1,48 @@
+#pragma once
+#include <vector>
+#include <deque>
+#include <fstream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "core.h"
+
+using namespace std;
+
+#define TraceBlockSize		(1024 * 1024)
+
+// Streams a file to disk on a thread of its own. Writes are appended to a block in
+// memory, and full blocks are handed to the writer thread, so the thread that writes
+// never waits on the disk. The memory of blocks that have been written is reused.
+
+class TraceWriter
+{
+public:
+	TraceWriter() {};
+	~TraceWriter();
+
+	bool Open(const wstring& fileName);
+	// Write everything that is still in memory and close the file
+	void Close();
+	bool IsOpen() const { return _thread.joinable(); }
+
+	void Write(const void* data, size_t size);
+	// Hand the current block to the writer thread, even if it is not full
+	void Flush();
+
+	size_t GetWrittenByteCount() const { return _writtenByteCount; }
+
+private:
+	ofstream				_file;
+	vector<BYTE>			_block;
+	deque<vector<BYTE>>		_pendingBlocks;
+	vector<vector<BYTE>>	_freeBlocks;
+	size_t					_writtenByteCount{ 0 };
+
+	thread					_thread;
+	mutex					_lock;
+	condition_variable		_blocksAvailable;
+	bool					_isClosing{ false };
+
+	void WriterLoop();
+};
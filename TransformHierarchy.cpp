@@ -0,0 +1,337 @@
+#include <algorithm>
+#include <chrono>
+#include <cfloat>
+#include "TransformHierarchy.h"
+
+size_t TransformHierarchy::Add(size_t parentIndex, const Matrix& localTransformation, SceneNode* node)
+{
+	size_t index = _parentIndices.size();
+	_localTransformations.push_back(localTransformation);
+	_worldTransformations.push_back(localTransformation);
+	_parentIndices.push_back(parentIndex);
+	_subtreeEnds.push_back(index + 1);
+	_nodes.push_back(node);
+	_isDirty.push_back(0);
+	_hasChanged.push_back(0);
+	return index;
+}
+
+void TransformHierarchy::Clear()
+{
+	_localTransformations.clear();
+	_worldTransformations.clear();
+	_parentIndices.clear();
+	_subtreeEnds.clear();
+	_nodes.clear();
+	_isDirty.clear();
+	_dirtyIndices.clear();
+	_hasChanged.clear();
+	_changedIndices.clear();
+	_isFullUpdateRequired = true;
+	_isLayoutValid = true;
+}
+
+void TransformHierarchy::SetLocalTransform(size_t index, const Matrix& localTransformation)
+{
+	_localTransformations[index] = localTransformation;
+	if (!_isDirty[index])
+	{
+		_isDirty[index] = 1;
+		_dirtyIndices.push_back(index);
+	}
+}
+
+void TransformHierarchy::Update(const Matrix& rootTransformation)
+{
+	// Reset the nodes that changed during the previous update
+	for (size_t index : _changedIndices)
+	{
+		_hasChanged[index] = 0;
+	}
+	_changedIndices.clear();
+
+	if (_parentIndices.size() == 0)
+	{
+		return;
+	}
+
+	if (_isFullUpdateRequired || rootTransformation != _rootTransformation)
+	{
+		_rootTransformation = rootTransformation;
+		_isFullUpdateRequired = false;
+		UpdateSubtree(0, _parentIndices.size());
+	}
+	else
+	{
+		// Process the dirty nodes in order so that a node lying inside a subtree
+		// that has already been recomputed can simply be skipped
+		sort(_dirtyIndices.begin(), _dirtyIndices.end());
+		size_t updatedEnd = 0;
+		for (size_t index : _dirtyIndices)
+		{
+			if (index >= updatedEnd)
+			{
+				updatedEnd = _subtreeEnds[index];
+				UpdateSubtree(index, updatedEnd);
+			}
+		}
+	}
+
+	for (size_t index : _dirtyIndices)
+	{
+		_isDirty[index] = 0;
+	}
+	_dirtyIndices.clear();
+}
+
+void TransformHierarchy::UpdateSubtree(size_t first, size_t last)
+{
+	if (_threadPool != nullptr && last - first >= _parallelThreshold)
+	{
+		_parallelRanges.clear();
+		CollectParallelRanges(first, last);
+		_threadPool->Run(_parallelRanges.size(), [this](size_t task)
+			{
+				UpdateRange(_parallelRanges[task].first, _parallelRanges[task].second);
+			});
+	}
+	else
+	{
+		UpdateRange(first, last);
+	}
+
+	// The changed list is always built in index order, so it does not depend on
+	// whether the subtree was updated in parallel
+	for (size_t i = first; i < last; i++)
+	{
+		_changedIndices.push_back(i);
+	}
+}
+
+void TransformHierarchy::CollectParallelRanges(size_t first, size_t last)
+{
+	if (last - first <= ParallelGrainSize)
+	{
+		_parallelRanges.push_back(make_pair(first, last));
+		return;
+	}
+
+	// Update the root of a large subtree straight away. Each of its child subtrees
+	// then only depends on nodes that have already been computed. Child subtrees
+	// that are next to each other are merged into ranges of up to the grain size,
+	// so that a node with many small children does not become a task per child
+	UpdateRange(first, first + 1);
+	size_t rangeStart = first + 1;
+	size_t child = first + 1;
+	while (child < last)
+	{
+		size_t childEnd = _subtreeEnds[child];
+		if (childEnd - child > ParallelGrainSize)
+		{
+			if (rangeStart < child)
+			{
+				_parallelRanges.push_back(make_pair(rangeStart, child));
+			}
+			CollectParallelRanges(child, childEnd);
+			rangeStart = childEnd;
+		}
+		else if (childEnd - rangeStart > ParallelGrainSize)
+		{
+			_parallelRanges.push_back(make_pair(rangeStart, child));
+			rangeStart = child;
+		}
+		child = childEnd;
+	}
+	if (rangeStart < last)
+	{
+		_parallelRanges.push_back(make_pair(rangeStart, last));
+	}
+}
+
+void TransformHierarchy::UpdateRange(size_t first, size_t last)
+{
+	// Only the first node is a root. Every other node appears after its parent,
+	// so the parent's world transformation is always up to date when it is read
+	size_t i = first;
+	if (i == 0)
+	{
+		_worldTransformations[0] = _localTransformations[0] * _rootTransformation;
+		_hasChanged[0] = 1;
+		i++;
+	}
+	for (; i < last; i++)
+	{
+		_worldTransformations[i] = _localTransformations[i] * _worldTransformations[_parentIndices[i]];
+		_hasChanged[i] = 1;
+	}
+}
+
+// Add a subtree of the given number of nodes to a hierarchy, in which every node shares the nodes below it between
+// up to the given number of children
+static void AddBenchmarkSubtree(TransformHierarchy& hierarchy, size_t parentIndex, size_t nodeCount, size_t branching)
+{
+	size_t index = hierarchy.GetCount();
+	hierarchy.Add(parentIndex, Matrix::CreateRotationY(0.01f * (index % 97)) * Matrix::CreateTranslation(static_cast<float>(index % 13), 1.0f, 0.5f), nullptr);
+	size_t descendantCount = nodeCount - 1;
+	size_t childCount = min(branching, descendantCount);
+	for (size_t child = 0; child < childCount; child++)
+	{
+		AddBenchmarkSubtree(hierarchy, index, descendantCount * (child + 1) / childCount - descendantCount * child / childCount, branching);
+	}
+	hierarchy.SetSubtreeEnd(index, hierarchy.GetCount());
+}
+
+wstring BenchmarkTransformHierarchy()
+{
+	// A node of a scene graph that is updated by recursion, with its children allocated one by one
+	struct RecursiveNode
+	{
+		Matrix								LocalTransformation;
+		Matrix								WorldTransformation;
+		vector<unique_ptr<RecursiveNode>>	Children;
+		size_t								Index{ 0 };
+
+		void Update(const Matrix& parentTransformation)
+		{
+			WorldTransformation = LocalTransformation * parentTransformation;
+			for (const unique_ptr<RecursiveNode>& child : Children)
+			{
+				child->Update(WorldTransformation);
+			}
+		}
+
+		void Flatten(TransformHierarchy& hierarchy, size_t parentIndex, vector<size_t>& flattenedIndices) const
+		{
+			size_t index = hierarchy.Add(parentIndex, LocalTransformation, nullptr);
+			flattenedIndices[Index] = index;
+			for (const unique_ptr<RecursiveNode>& child : Children)
+			{
+				child->Flatten(hierarchy, index, flattenedIndices);
+			}
+			hierarchy.SetSubtreeEnd(index, hierarchy.GetCount());
+		}
+	};
+
+	wstring report;
+	for (size_t nodeCount : { 1000, 10000, 100000 })
+	{
+		// Each node has up to eight children, and the nodes are created a level at a time
+		vector<RecursiveNode*> nodes;
+		nodes.reserve(nodeCount);
+		unique_ptr<RecursiveNode> root = make_unique<RecursiveNode>();
+		nodes.push_back(root.get());
+		for (size_t i = 1; i < nodeCount; i++)
+		{
+			RecursiveNode* parent = nodes[(i - 1) / 8];
+			parent->Children.push_back(make_unique<RecursiveNode>());
+			RecursiveNode* node = parent->Children.back().get();
+			node->Index = i;
+			node->LocalTransformation = Matrix::CreateRotationY(0.01f * (i % 97)) * Matrix::CreateTranslation(static_cast<float>(i % 13), 1.0f, 0.5f);
+			nodes.push_back(node);
+		}
+
+		// The same tree in depth-first order, as the scene graph flattens it
+		TransformHierarchy hierarchy;
+		vector<size_t> flattenedIndices(nodeCount);
+		root->Flatten(hierarchy, TransformHierarchy::NoParent, flattenedIndices);
+
+		// Moving the root changes every world transformation, so both are timed updating all of them
+		const UINT runCount = 20;
+		double recursiveTime = DBL_MAX;
+		double flattenedTime = DBL_MAX;
+		double partialTime = DBL_MAX;
+		for (UINT run = 0; run < runCount; run++)
+		{
+			Matrix rootTransformation = Matrix::CreateTranslation(static_cast<float>(run), 0.0f, 0.0f);
+			auto startTime = chrono::high_resolution_clock::now();
+			root->Update(rootTransformation);
+			recursiveTime = min(recursiveTime, chrono::duration<double, milli>(chrono::high_resolution_clock::now() - startTime).count());
+
+			startTime = chrono::high_resolution_clock::now();
+			hierarchy.Update(rootTransformation);
+			flattenedTime = min(flattenedTime, chrono::duration<double, milli>(chrono::high_resolution_clock::now() - startTime).count());
+		}
+		// Only the subtrees of the nodes that move are updated by the flattened hierarchy
+		Matrix rootTransformation = Matrix::CreateTranslation(static_cast<float>(runCount), 0.0f, 0.0f);
+		root->Update(rootTransformation);
+		hierarchy.Update(rootTransformation);
+		for (UINT run = 0; run < runCount; run++)
+		{
+			auto startTime = chrono::high_resolution_clock::now();
+			for (size_t i = run % 100; i < nodeCount; i += 100)
+			{
+				hierarchy.SetLocalTransform(flattenedIndices[i], nodes[i]->LocalTransformation);
+			}
+			hierarchy.Update(rootTransformation);
+			partialTime = min(partialTime, chrono::duration<double, milli>(chrono::high_resolution_clock::now() - startTime).count());
+		}
+
+		// The two updates must give the same transformations
+		float largestDifference = 0.0f;
+		for (size_t i = 0; i < nodeCount; i++)
+		{
+			const Matrix& recursive = nodes[i]->WorldTransformation;
+			const Matrix& flattened = hierarchy.GetWorldTransform(flattenedIndices[i]);
+			for (int element = 0; element < 16; element++)
+			{
+				largestDifference = max(largestDifference, fabsf(recursive.m[element / 4][element % 4] - flattened.m[element / 4][element % 4]));
+			}
+		}
+		report += L"Transform hierarchy, " + to_wstring(nodeCount) + L" nodes: recursive " + to_wstring(recursiveTime) + L" ms, flattened " +
+			to_wstring(flattenedTime) + L" ms (" + to_wstring(recursiveTime / flattenedTime) + L" times as fast), flattened with 1% of the nodes moved " +
+			to_wstring(partialTime) + L" ms, largest difference " + to_wstring(largestDifference) + L"\n";
+	}
+
+	// How updating a large tree scales with the number of threads, both for a tree in which every node has up to
+	// eight children and for a flat one in which every node is a child of the root
+	const size_t nodeCount = 100000;
+	unsigned int hardwareConcurrency = max(1u, thread::hardware_concurrency());
+	for (size_t branching : { static_cast<size_t>(8), nodeCount - 1 })
+	{
+		TransformHierarchy hierarchy;
+		AddBenchmarkSubtree(hierarchy, TransformHierarchy::NoParent, nodeCount, branching);
+		report += L"Transform hierarchy, " + to_wstring(nodeCount) + L" nodes, " + (branching == 8 ? L"eight children per node" : L"flat") + L"\n";
+		vector<Matrix> singleThreadedTransformations;
+		double singleThreadedTime = 0.0;
+		for (unsigned int threadCount = 1; threadCount <= hardwareConcurrency; threadCount++)
+		{
+			// The calling thread takes part, so the pool has one thread fewer
+			unique_ptr<ThreadPool> threadPool = threadCount > 1 ? make_unique<ThreadPool>(threadCount - 1) : nullptr;
+			hierarchy.SetThreadPool(threadPool.get());
+			double bestTime = DBL_MAX;
+			for (UINT run = 0; run < 20; run++)
+			{
+				Matrix rootTransformation = Matrix::CreateTranslation(static_cast<float>(threadCount * 20 + run), 0.0f, 0.0f);
+				auto startTime = chrono::high_resolution_clock::now();
+				hierarchy.Update(rootTransformation);
+				bestTime = min(bestTime, chrono::duration<double, milli>(chrono::high_resolution_clock::now() - startTime).count());
+			}
+			hierarchy.Update(Matrix::Identity);
+
+			// The result must not depend on the number of threads
+			float largestDifference = 0.0f;
+			if (threadCount == 1)
+			{
+				singleThreadedTime = bestTime;
+				for (size_t i = 0; i < nodeCount; i++)
+				{
+					singleThreadedTransformations.push_back(hierarchy.GetWorldTransform(i));
+				}
+			}
+			else
+			{
+				for (size_t i = 0; i < nodeCount; i++)
+				{
+					for (int element = 0; element < 16; element++)
+					{
+						largestDifference = max(largestDifference, fabsf(hierarchy.GetWorldTransform(i).m[element / 4][element % 4] - singleThreadedTransformations[i].m[element / 4][element % 4]));
+					}
+				}
+			}
+			report += to_wstring(threadCount) + L" threads: " + to_wstring(bestTime) + L" ms, " + to_wstring(singleThreadedTime / bestTime) +
+				L" times as fast as one thread, largest difference " + to_wstring(largestDifference) + L"\n";
+		}
+		hierarchy.SetThreadPool(nullptr);
+	}
+	return report;
+}
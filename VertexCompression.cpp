@@ -0,0 +1,159 @@
+#include <algorithm>
+#include <cmath>
+#include <cfloat>
+#include "VertexCompression.h"
+
+// The offsets of the attributes in the vertex formats the nodes build
+#define NormalOffset				12
+#define TexCoordOffset				24
+#define TexturedVertexStride		32
+
+static float SignNotZero(float value)
+{
+	return value >= 0.0f ? 1.0f : -1.0f;
+}
+
+Vector2 EncodeOctahedral(const Vector3& normal)
+{
+	float length = fabsf(normal.x) + fabsf(normal.y) + fabsf(normal.z);
+	if (length == 0.0f)
+	{
+		return Vector2(0.0f, 0.0f);
+	}
+	Vector2 encoded(normal.x / length, normal.y / length);
+	if (normal.z < 0.0f)
+	{
+		// The lower half of the octahedron is folded over the corners of the square
+		encoded = Vector2((1.0f - fabsf(encoded.y)) * SignNotZero(encoded.x), (1.0f - fabsf(encoded.x)) * SignNotZero(encoded.y));
+	}
+	return encoded;
+}
+
+Vector3 DecodeOctahedral(const Vector2& encoded)
+{
+	Vector3 normal(encoded.x, encoded.y, 1.0f - fabsf(encoded.x) - fabsf(encoded.y));
+	float fold = max(-normal.z, 0.0f);
+	normal.x += normal.x >= 0.0f ? -fold : fold;
+	normal.y += normal.y >= 0.0f ? -fold : fold;
+	normal.Normalize();
+	return normal;
+}
+
+short EncodeSnorm16(float value)
+{
+	return static_cast<short>(lroundf(min(max(value, -1.0f), 1.0f) * 32767.0f));
+}
+
+float DecodeSnorm16(short value)
+{
+	// -32768 and -32767 both decode to -1
+	return max(value / 32767.0f, -1.0f);
+}
+
+// Quantise a normal, choosing whichever of the four nearest representable points decodes closest to it
+static void EncodeNormal(const Vector3& normal, short encoded[2])
+{
+	Vector2 octahedral = EncodeOctahedral(normal);
+	float bestDot = -2.0f;
+	for (UINT candidate = 0; candidate < 4; candidate++)
+	{
+		float u = (candidate & 1) ? ceilf(octahedral.x * 32767.0f) : floorf(octahedral.x * 32767.0f);
+		float v = (candidate & 2) ? ceilf(octahedral.y * 32767.0f) : floorf(octahedral.y * 32767.0f);
+		short quantised[2] = { static_cast<short>(min(max(u, -32767.0f), 32767.0f)), static_cast<short>(min(max(v, -32767.0f), 32767.0f)) };
+		float dot = DecodeOctahedral(Vector2(DecodeSnorm16(quantised[0]), DecodeSnorm16(quantised[1]))).Dot(normal);
+		if (dot > bestDot)
+		{
+			bestDot = dot;
+			encoded[0] = quantised[0];
+			encoded[1] = quantised[1];
+		}
+	}
+}
+
+VertexCompressionStatistics CompressGeometry(const vector<BYTE>& vertices, UINT vertexStride, const vector<UINT>& indices, CompressedGeometry& compressedGeometry)
+{
+	VertexCompressionStatistics statistics;
+	UINT vertexCount = static_cast<UINT>(vertices.size() / vertexStride);
+	bool hasTexCoord = vertexStride >= TexturedVertexStride;
+	UINT compressedStride = hasTexCoord ? sizeof(CompressedTexturedVertex) : sizeof(CompressedVertex);
+
+	// Quantise the positions to the cube around the centre of the mesh whose side is its largest extent
+	Vector3 minimum(FLT_MAX, FLT_MAX, FLT_MAX);
+	Vector3 maximum(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+	for (UINT vertex = 0; vertex < vertexCount; vertex++)
+	{
+		const Vector3& position = *reinterpret_cast<const Vector3*>(&vertices[static_cast<size_t>(vertex) * vertexStride]);
+		minimum = Vector3::Min(minimum, position);
+		maximum = Vector3::Max(maximum, position);
+	}
+	Vector3 centre = vertexCount > 0 ? (minimum + maximum) * 0.5f : Vector3(0.0f, 0.0f, 0.0f);
+	Vector3 halfExtents = vertexCount > 0 ? (maximum - minimum) * 0.5f : Vector3(0.0f, 0.0f, 0.0f);
+	float scale = max(max(halfExtents.x, halfExtents.y), halfExtents.z);
+	if (scale == 0.0f)
+	{
+		scale = 1.0f;
+	}
+	compressedGeometry.PositionDecode = Matrix::CreateScale(scale) * Matrix::CreateTranslation(centre);
+
+	compressedGeometry.VertexStride = compressedStride;
+	compressedGeometry.Vertices.assign(static_cast<size_t>(vertexCount) * compressedStride, 0);
+	for (UINT vertex = 0; vertex < vertexCount; vertex++)
+	{
+		const BYTE* source = &vertices[static_cast<size_t>(vertex) * vertexStride];
+		BYTE* destination = &compressedGeometry.Vertices[static_cast<size_t>(vertex) * compressedStride];
+		// Both compressed formats start in the same way
+		CompressedVertex& compressedVertex = *reinterpret_cast<CompressedVertex*>(destination);
+
+		const Vector3& position = *reinterpret_cast<const Vector3*>(source);
+		Vector3 relativePosition = (position - centre) / scale;
+		compressedVertex.Position[0] = EncodeSnorm16(relativePosition.x);
+		compressedVertex.Position[1] = EncodeSnorm16(relativePosition.y);
+		compressedVertex.Position[2] = EncodeSnorm16(relativePosition.z);
+		compressedVertex.Position[3] = EncodeSnorm16(1.0f);
+		Vector3 decodedPosition = Vector3::Transform(Vector3(DecodeSnorm16(compressedVertex.Position[0]), DecodeSnorm16(compressedVertex.Position[1]), DecodeSnorm16(compressedVertex.Position[2])), compressedGeometry.PositionDecode);
+		statistics.MaxPositionError = max(statistics.MaxPositionError, (decodedPosition - position).Length());
+
+		Vector3 normal = *reinterpret_cast<const Vector3*>(source + NormalOffset);
+		normal.Normalize();
+		EncodeNormal(normal, compressedVertex.Normal);
+		Vector3 decodedNormal = DecodeOctahedral(Vector2(DecodeSnorm16(compressedVertex.Normal[0]), DecodeSnorm16(compressedVertex.Normal[1])));
+		float normalError = acosf(min(max(decodedNormal.Dot(normal), -1.0f), 1.0f)) * 180.0f / XM_PI;
+		statistics.MaxNormalError = max(statistics.MaxNormalError, normalError);
+
+		if (hasTexCoord)
+		{
+			CompressedTexturedVertex& compressedTexturedVertex = *reinterpret_cast<CompressedTexturedVertex*>(destination);
+			const Vector2& texCoord = *reinterpret_cast<const Vector2*>(source + TexCoordOffset);
+			compressedTexturedVertex.TextureCoordinates[0] = XMConvertFloatToHalf(texCoord.x);
+			compressedTexturedVertex.TextureCoordinates[1] = XMConvertFloatToHalf(texCoord.y);
+			Vector2 decodedTexCoord(XMConvertHalfToFloat(compressedTexturedVertex.TextureCoordinates[0]), XMConvertHalfToFloat(compressedTexturedVertex.TextureCoordinates[1]));
+			statistics.MaxTexCoordError = max(statistics.MaxTexCoordError, max(fabsf(decodedTexCoord.x - texCoord.x), fabsf(decodedTexCoord.y - texCoord.y)));
+		}
+	}
+
+	// 16-bit indices can address every vertex of all but the largest meshes
+	if (vertexCount <= 65536)
+	{
+		compressedGeometry.IndexFormat = DXGI_FORMAT_R16_UINT;
+		compressedGeometry.Indices.resize(indices.size() * sizeof(UINT16));
+		UINT16* compressedIndices = reinterpret_cast<UINT16*>(compressedGeometry.Indices.data());
+		for (size_t i = 0; i < indices.size(); i++)
+		{
+			compressedIndices[i] = static_cast<UINT16>(indices[i]);
+		}
+	}
+	else
+	{
+		compressedGeometry.IndexFormat = DXGI_FORMAT_R32_UINT;
+		compressedGeometry.Indices.resize(indices.size() * sizeof(UINT));
+		memcpy(compressedGeometry.Indices.data(), indices.data(), compressedGeometry.Indices.size());
+	}
+
+	statistics.VertexStride = vertexStride;
+	statistics.CompressedVertexStride = compressedStride;
+	statistics.IndexSize = sizeof(UINT);
+	statistics.CompressedIndexSize = compressedGeometry.IndexFormat == DXGI_FORMAT_R16_UINT ? sizeof(UINT16) : sizeof(UINT);
+	statistics.ByteCount = vertices.size() + indices.size() * sizeof(UINT);
+	statistics.CompressedByteCount = compressedGeometry.Vertices.size() + compressedGeometry.Indices.size();
+	return statistics;
+}
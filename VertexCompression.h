@@ -0,0 +1,70 @@
+#pragma once
+#include <vector>
+#include "core.h"
+#include "DirectXCore.h"
+#include <DirectXPackedVector.h>
+
+using namespace std;
+using namespace DirectX::PackedVector;
+
+// Compression of geometry for the vertex and index buffers.
+//
+// The vertices are built by the nodes with full precision, starting with the position and
+// the normal, as Vector3, which may be followed by the texture coordinates, as a Vector2.
+// They are uploaded as
+//
+//   POSITION	R16G16B16A16_SNORM	Relative to the centre of the mesh
+//   NORMAL		R16G16_SNORM		A point on an octahedron folded out onto a square (Cigolle et al. 2014)
+//   TEXCOORD	R16G16_FLOAT
+//
+// which halves the size of both vertex formats. Positions are quantised with the same scale
+// on every axis, so that the transformation that decodes them can be folded into the world
+// transformation without bending the normals. Indices are 16-bit whenever every vertex can
+// be reached with one.
+
+struct CompressedVertex
+{
+	short		Position[4];
+	short		Normal[2];
+};
+
+struct CompressedTexturedVertex
+{
+	short		Position[4];
+	short		Normal[2];
+	HALF		TextureCoordinates[2];
+};
+
+struct VertexCompressionStatistics
+{
+	UINT		VertexStride{ 0 };
+	UINT		CompressedVertexStride{ 0 };
+	UINT		IndexSize{ 0 };
+	UINT		CompressedIndexSize{ 0 };
+	size_t		ByteCount{ 0 };
+	size_t		CompressedByteCount{ 0 };
+	// The largest differences between the decoded and the original values. The position error
+	// is in the units of the mesh and the normal error is an angle in degrees
+	float		MaxPositionError{ 0 };
+	float		MaxNormalError{ 0 };
+	float		MaxTexCoordError{ 0 };
+};
+
+struct CompressedGeometry
+{
+	vector<BYTE>	Vertices;
+	UINT			VertexStride{ 0 };
+	vector<BYTE>	Indices;
+	DXGI_FORMAT		IndexFormat{ DXGI_FORMAT_R32_UINT };
+	// Transforms the quantised positions back into those of the mesh
+	Matrix			PositionDecode;
+};
+
+// These match the decoding of the formats above by the input assembler and the vertex shader
+Vector2 EncodeOctahedral(const Vector3& normal);
+Vector3 DecodeOctahedral(const Vector2& encoded);
+short EncodeSnorm16(float value);
+float DecodeSnorm16(short value);
+
+// Compress the vertices and indices of a mesh and measure the error of the compressed vertices
+VertexCompressionStatistics CompressGeometry(const vector<BYTE>& vertices, UINT vertexStride, const vector<UINT>& indices, CompressedGeometry& compressedGeometry);
@@ -1,7 +1,34 @@
-cbuffer ConstantBuffer 
+// Lighting shader used by every node. It is compiled into a separate permutation
+// for each combination of the following, so that terms that do not contribute
+// to a material are removed from the pixel shader altogether:
+//
+//   HAS_TEXTURE		The vertices carry texture coordinates and the colour is modulated by the texture
+//   SPECULAR			The specular light is calculated
+//   NUM_POINT_LIGHTS	The number of point lights (0 or 1)
+//
+// The permutations are compiled ahead of time by CompileShaders.bat.
+
+#ifndef HAS_TEXTURE
+#define HAS_TEXTURE 0
+#endif
+#ifndef SPECULAR
+#define SPECULAR 1
+#endif
+#ifndef NUM_POINT_LIGHTS
+#define NUM_POINT_LIGHTS 1
+#endif
+
+// The constants are split by how often they change. This must match ConstantBuffer.h
+
+cbuffer FrameConstants : register(b0)
+{
+	matrix	viewProjection;
+	float3	eyePosition;
+	float	framePad;
+};
+
+cbuffer MaterialConstants : register(b1)
 {
-	matrix	worldViewProjection; 
-	matrix  worldTransformation;
 	float4	ambientLightColour;
 	float4  directionalLightColour;
 	float4  directionalLightVector;
@@ -10,14 +37,46 @@ cbuffer ConstantBuffer
 	float	pointLightRange;
 	float4	specularColour;
 	float	specularPower;
-	float3	eyePosition;
-	float3	pad;
+	float3	materialPad;
 };
 
+cbuffer ObjectConstants : register(b2)
+{
+	matrix	worldViewProjection;
+	matrix  worldTransformation;
+};
+
+#if HAS_TEXTURE
+Texture2D Texture;
+SamplerState ss;
+#endif
+
+// The vertices are compressed (see VertexCompression.h). The positions are quantised relative
+// to the centre of the mesh, which the world transformation accounts for, and the normals are
+// octahedral
 struct VertexIn
 {
 	float3 InputPosition : POSITION;
-	float3 Normal		 : NORMAL;
+	float2 Normal		 : NORMAL;
+#if HAS_TEXTURE
+	float2 TexCoord		 : TEXCOORD;
+#endif
+};
+
+// Input of the instanced vertex shader. The world transformation and colour of each
+// instance are read from the instance buffer in the second vertex buffer slot
+struct InstancedVertexIn
+{
+	float3 InputPosition : POSITION;
+	float2 Normal		 : NORMAL;
+#if HAS_TEXTURE
+	float2 TexCoord		 : TEXCOORD;
+#endif
+	float4 World0		 : WORLD0;
+	float4 World1		 : WORLD1;
+	float4 World2		 : WORLD2;
+	float4 World3		 : WORLD3;
+	float4 Colour		 : COLOUR;
 };
 
 struct VertexOut
@@ -25,16 +84,51 @@ struct VertexOut
 	float4 OutputPosition	: SV_POSITION;
 	float4 Normal			: TEXCOORD0;
 	float4 WorldPosition	: TEXCOORD1;
+	float4 Colour			: TEXCOORD2;
+#if HAS_TEXTURE
+	float2 TexCoord			: TEXCOORD3;
+#endif
 };
 
+// Unfold a normal from the square back onto the octahedron. This must match DecodeOctahedral in VertexCompression.cpp
+float3 DecodeOctahedral(float2 encoded)
+{
+	float3 normal = float3(encoded, 1.0f - abs(encoded.x) - abs(encoded.y));
+	float fold = saturate(-normal.z);
+	normal.xy += (normal.xy >= 0.0f) ? -fold : fold;
+	return normalize(normal);
+}
+
 VertexOut VS(VertexIn vin)
 {
 	VertexOut vout;
 
-	// Convert inputs for each vertex to the formatted output position, normal, and world position
+	// Convert inputs for each vertex to the formatted output position, normal, world position, and texture coordinates
 	vout.OutputPosition = mul(worldViewProjection, float4(vin.InputPosition, 1.0f));
-	vout.Normal = normalize(mul(worldTransformation, float4(vin.Normal, 0.0f)));
+	vout.Normal = normalize(mul(worldTransformation, float4(DecodeOctahedral(vin.Normal), 0.0f)));
 	vout.WorldPosition = mul(worldTransformation, float4(vin.InputPosition, 1.0f));
+	vout.Colour = ambientLightColour;
+#if HAS_TEXTURE
+	vout.TexCoord = vin.TexCoord;
+#endif
+
+	return vout;
+}
+
+// Instanced draws do not use the object constants. The world transformation comes from the instance
+VertexOut VSInstanced(InstancedVertexIn vin)
+{
+	VertexOut vout;
+	matrix instanceWorld = matrix(vin.World0, vin.World1, vin.World2, vin.World3);
+
+	// Convert inputs for each vertex to the formatted output position, normal, world position, and texture coordinates
+	vout.WorldPosition = mul(float4(vin.InputPosition, 1.0f), instanceWorld);
+	vout.OutputPosition = mul(viewProjection, vout.WorldPosition);
+	vout.Normal = normalize(mul(float4(DecodeOctahedral(vin.Normal), 0.0f), instanceWorld));
+	vout.Colour = vin.Colour;
+#if HAS_TEXTURE
+	vout.TexCoord = vin.TexCoord;
+#endif
 
 	return vout;
 }
@@ -44,25 +138,32 @@ float4 PS(VertexOut pin) : SV_Target
 	// Calculate the diffuse light
 	float4 lightVector = -directionalLightVector;
 	float diffuseBrightness = saturate(dot(pin.Normal, lightVector));
-	float4 diffuseLight = saturate(ambientLightColour + diffuseBrightness * directionalLightColour);
+	float4 finalColour = saturate(pin.Colour + diffuseBrightness * directionalLightColour);
 
+#if NUM_POINT_LIGHTS > 0
 	// Calcuate the point light
 	float3 pointVector = normalize(pointLightPosition.xyz - pin.WorldPosition.xyz);
 	float pointDistance = length(pointVector);
 	float pointBrightness = saturate(dot(pin.Normal.xyz, pointVector));
 	float pointAttenuation = saturate(1 - (pointDistance / pointLightRange));
-	float4 pointLight = saturate(pointBrightness * pointLightColour) * pointAttenuation;
+	finalColour += saturate(pointBrightness * pointLightColour) * pointAttenuation;
+#endif
 
+#if SPECULAR
 	// Calculate the specular light
 	float3 viewVector = normalize(eyePosition - pin.WorldPosition.xyz);
 	float3 reflectionVector = normalize(reflect(lightVector.xyz, pin.Normal.xyz));
 	float specularAngle = saturate(dot(viewVector, reflectionVector));
 	float specularBrightness = pow(saturate(specularAngle), specularPower);
-	float4 specularLight = specularBrightness * specularColour;
+	finalColour += specularBrightness * specularColour;
+#endif
 
-	// Calculate the final colour of the lighting
-	float4 finalColour = saturate(diffuseLight + pointLight + specularLight);
+	// Calculate the final colour of the lighting. The lights are opaque, so the opacity is
+	// that of the material alone
+	finalColour = saturate(finalColour);
+	finalColour.a = pin.Colour.a;
+#if HAS_TEXTURE
+	finalColour *= Texture.Sample(ss, pin.TexCoord);
+#endif
 	return finalColour;
 }
-
-